@@ -102,10 +102,35 @@ namespace eutelescope {
              
         private:
 
-            bool calTanH(double &corr, double y, double p0, double p1, double p2, double p3);
+            //! Calibration parameters of the pixels of one ROC
+            /*! One array per parameter, indexed by x * _noOfYPixel + y,
+             *  so that the parameters of a batch of pixels are read from
+             *  contiguous memory.
+             */
+            struct ROCCalibration {
+                std::vector< double > par0;
+                std::vector< double > par1;
+                std::vector< double > par2;
+                std::vector< double > par3;
+            };
+
+            //! Stores the parameters read for one ROC
+            void addROCCalibration( const std::vector< cal_param > & cal_roc );
+
+            //! Calibrates the pixels of _pixelIndex and _rawSignal with the tanh fit of a ROC
+            /*! The results go to _calibratedSignal, _isCalibrated is 0
+             *  for the pixels out of the range of the fit.
+             */
+            void calTanH( unsigned int iROC );
 	    bool calWeibull(double &corr, double y);
 	    bool calLinear(double &corr, double y);
-            std::vector< std::vector< cal_param > > calibration;
+            std::vector< ROCCalibration > calibration;
+
+            //! Pixels of the sensor being calibrated
+            std::vector< int > _pixelIndex;
+            std::vector< double > _rawSignal;
+            std::vector< double > _calibratedSignal;
+            std::vector< char > _isCalibrated;
 
     };
 
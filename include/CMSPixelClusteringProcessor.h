@@ -27,6 +27,7 @@
 // eutelescope includes ".h"
 #include "EUTelExceptions.h"
 #include "EUTELESCOPE.h"
+#include "EUTelGenericSparsePixel.h"
 
 // marlin includes ".h"
 #include "marlin/EventModifier.h"
@@ -108,6 +109,34 @@ namespace eutelescope {
     
     protected:
 	void Clustering(LCEvent * evt, LCCollectionVec * pulse);
+
+	//! Groups the pixels of _pixels into clusters
+	/*! Two pixels are neighbours if they are within MinXDistance and
+	 *  MinYDistance and, for diagonal partners, MinDiagonalDistance. A
+	 *  cluster is a group of pixels connected by neighbours. The
+	 *  neighbours of a pixel are looked up in a grid over the hit
+	 *  pixels, so the time is linear in the number of pixels.
+	 *
+	 *  @return The number of clusters. The pixels of cluster i are
+	 *  _clusterPixels[ _clusterBegin[i] ] to _clusterPixels[ _clusterBegin[i+1] - 1 ].
+	 */
+	int findClusters();
+
+	//! First pixel of the cluster of a pixel
+	int findClusterRoot( int iPixel );
+
+	//! Hit pixels of the sensor being clustered
+	std::vector< EUTelGenericSparsePixel > _pixels;
+
+	//! Index in _pixels of the pixels of each cluster, cluster after cluster
+	std::vector< int > _clusterPixels;
+	std::vector< int > _clusterBegin;
+
+	//! Working space of findClusters(), kept to avoid allocations
+	std::vector< int > _pixelGrid;
+	std::vector< int > _clusterParent;
+	std::vector< int > _clusterLabel;
+
 	std::string _zsDataCollectionName;
 	std::string _clusterCollectionName;
     
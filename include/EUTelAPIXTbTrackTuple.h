@@ -7,9 +7,7 @@
 #include <string>
 #include <vector>
 
-#include <TFile.h>
-#include <TTree.h>
-#include <TVectorT.h>
+#include "EUTelRootTupleWriter.h"
 
 namespace eutelescope {
   class EUTelAPIXTbTrackTuple : public marlin::Processor {
@@ -61,37 +59,45 @@ namespace eutelescope {
 
     bool _isFirstEvent;
     
-    TFile* _file;
+    //! Output settings, see EUTelRootTupleWriter
+    int _basketSize;
+    int _autoFlush;
+    int _compressionLevel;
+    int _writerQueueDepth;
 
-    TTree* _eutracks;
+    //! Writes the trees rawdata, tracks and fitpoints
+    EUTelRootTupleWriter _tuple;
+
+    //! Columns of the tracks tree
     int _nTrackParams;
-    std::vector<double> *_xPos;
-    std::vector<double> *_yPos;
-    std::vector<double> *_dxdz;
-    std::vector<double> *_dydz;
-    std::vector<int>    *_trackIden;
-    std::vector<int>    *_trackNum;
-    std::vector<double> *_chi2;
-    std::vector<double> *_ndof;    
+    int _colNTrackParams;
+    int _colTrackEvt;
+    int _colXPos;
+    int _colYPos;
+    int _colDxdz;
+    int _colDydz;
+    int _colTrackNum;
+    int _colTrackIden;
+    int _colChi2;
+    int _colNdof;
 
-    TTree* _zstree;
+    //! Columns of the rawdata tree
     int _nPixHits;
-    std::vector<int> *p_col;
-    std::vector<int> *p_row;
-    std::vector<int> *p_tot;
-    std::vector<int> *p_iden;
-    std::vector<int> *p_lv1;
-    std::vector<int> *p_chip;
+    int _colNPixHits;
+    int _colZsEvt;
+    int _colCol;
+    int _colRow;
+    int _colTot;
+    int _colLv1;
+    int _colIden;
 
-    TTree* _euhits;
+    //! Columns of the fitpoints tree
     int _nHits;
-    std::vector<double> *_hitXPos;
-    std::vector<double> *_hitYPos;
-    std::vector<double> *_hitZPos;
-    std::vector<int>    *_hitSensorId;
-
-    TTree* _versionTree;
-    std::vector<double>* _versionNo;
+    int _colNHits;
+    int _colHitXPos;
+    int _colHitYPos;
+    int _colHitZPos;
+    int _colHitSensorId;
   };
 
   //! A global instance of the processor.
@@ -11,6 +11,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelPseudo1DHistogram.h"
+#include "EUTelEtaFunction2DImpl.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -26,6 +27,7 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
 
 
 #undef MARLIN_USE_HISTOGRAM
@@ -126,6 +128,14 @@ namespace eutelescope {
    *
    *  @param OutputEtaFileName The name of the output file.
    *
+   *  @param Eta2DCollectionName Optional name of the collection of
+   *  two dimensional eta maps (EUTelEtaFunction2DImpl), where the eta
+   *  value along x depends also on the CoG along y and viceversa. No
+   *  map is calculated if empty.
+   *
+   *  @param NumberOfBins2D Number of bins along x and y of the eta
+   *  maps.
+   *
    *  @author Antonio Bulgheroni, INFN <mailto:antonio.bulgheroni@gmail.com>
    *  @version $Id$
    *
@@ -317,8 +327,19 @@ namespace eutelescope {
      */
     std::string _outputEtaFileName;
 
+    //! Eta map output collection name
+    /*! Empty if the two dimensional eta maps are not calculated
+     */
+    std::string _eta2DCollectionName;
+
+    //! Number of bins along x and y of the eta maps
+    std::vector<int > _noOfBin2D;
+
   private:
 
+    //! Eta map of a sensor from its 2D CoG histogram
+    EUTelEtaFunction2DImpl * calculateEta2D(int sensorID, const std::vector< double > & cogHisto2D) const;
+
     //! Boolean return value
     /*! This boolean is used as return value for conditional steering
      *  file. Eta function calculation requires to loop over a certain
@@ -360,6 +381,12 @@ namespace eutelescope {
      */
     std::map<int, EUTelPseudo1DHistogram* > _integralHistoY;
 
+    //! CoG histograms for the eta maps
+    /*! The key value is the sensor ID, the bins are stored with x
+     *  running fastest.
+     */
+    std::map< int, std::vector< double > > _cogHisto2D;
+
     //! Number of detector planes in the run
     /*! This is the total number of detector saved into this input
      *  file
@@ -0,0 +1,173 @@
+/*
+ * File:   EUTelCellIDCodec.h
+ *
+ * Compile-time cell ID decoding for the fixed EUTelescope encodings
+ *
+ */
+
+#ifndef EUTELCELLIDCODEC_H
+#define	EUTELCELLIDCODEC_H
+
+// eutelescope includes ".h"
+#include "EUTELESCOPE.h"
+
+// lcio includes <.h>
+#include "LCIOTypes.h"
+#include "EVENT/LCIO.h"
+#include "EVENT/LCCollection.h"
+#include "EVENT/LCParameters.h"
+#include "UTIL/BitField64.h"
+
+// system includes <>
+#include <string>
+
+namespace eutelescope {
+
+    namespace CellIDCodec {
+
+        /**
+         * One unsigned field of a cell ID, @c Width bits starting at bit @c Offset.
+         * LCIO BitField64 allocates the fields of an encoding string
+         * from bit 0 upward, in the order they are listed, so offsets
+         * are the running sum of the preceding widths.
+         */
+        template< unsigned int Offset, unsigned int Width >
+        struct Field {
+            static const unsigned int offset = Offset;
+            static const unsigned int width = Width;
+
+            static inline lcio::long64 mask() {
+                return ( ( static_cast< lcio::long64 >( 1 ) << Width ) - 1 ) << Offset;
+            }
+
+            static inline int decode( const lcio::long64 cellID ) {
+                return static_cast< int >( ( cellID >> Offset ) & ( ( static_cast< lcio::long64 >( 1 ) << Width ) - 1 ) );
+            }
+
+            static inline lcio::long64 encode( const lcio::long64 cellID, const int value ) {
+                return ( cellID & ~mask() ) | ( ( static_cast< lcio::long64 >( value ) << Offset ) & mask() );
+            }
+        };
+
+#define EUTEL_CELLID_FIELD( NAME, OFFSET, WIDTH ) \
+        struct NAME : public Field< OFFSET, WIDTH > { static const char * name() { return #NAME; } }
+
+        /** EUTELESCOPE::HITENCODING "sensorID:7,properties:7" */
+        struct HitEncoding {
+            static const char * encoding() { return EUTELESCOPE::HITENCODING; }
+            EUTEL_CELLID_FIELD( sensorID, 0, 7 );
+            EUTEL_CELLID_FIELD( properties, 7, 7 );
+        };
+
+        /** EUTELESCOPE::ZSDATADEFAULTENCODING "sensorID:7,sparsePixelType:5" */
+        struct ZSDataEncoding {
+            static const char * encoding() { return EUTELESCOPE::ZSDATADEFAULTENCODING; }
+            EUTEL_CELLID_FIELD( sensorID, 0, 7 );
+            EUTEL_CELLID_FIELD( sparsePixelType, 7, 5 );
+        };
+
+        /** EUTELESCOPE::ZSCLUSTERDEFAULTENCODING "sensorID:7,sparsePixelType:5,quality:5" */
+        struct ZSClusterEncoding {
+            static const char * encoding() { return EUTELESCOPE::ZSCLUSTERDEFAULTENCODING; }
+            EUTEL_CELLID_FIELD( sensorID, 0, 7 );
+            EUTEL_CELLID_FIELD( sparsePixelType, 7, 5 );
+            EUTEL_CELLID_FIELD( quality, 12, 5 );
+        };
+
+        /** EUTELESCOPE::MATRIXDEFAULTENCODING "sensorID:7,xMin:12,xMax:12,yMin:12,yMax:12" */
+        struct MatrixEncoding {
+            static const char * encoding() { return EUTELESCOPE::MATRIXDEFAULTENCODING; }
+            EUTEL_CELLID_FIELD( sensorID, 0, 7 );
+            EUTEL_CELLID_FIELD( xMin, 7, 12 );
+            EUTEL_CELLID_FIELD( xMax, 19, 12 );
+            EUTEL_CELLID_FIELD( yMin, 31, 12 );
+            EUTEL_CELLID_FIELD( yMax, 43, 12 );
+        };
+
+        /** EUTELESCOPE::CLUSTERDEFAULTENCODING "sensorID:7,xSeed:12,ySeed:12,xCluSize:5,yCluSize:5,quality:7" */
+        struct ClusterEncoding {
+            static const char * encoding() { return EUTELESCOPE::CLUSTERDEFAULTENCODING; }
+            EUTEL_CELLID_FIELD( sensorID, 0, 7 );
+            EUTEL_CELLID_FIELD( xSeed, 7, 12 );
+            EUTEL_CELLID_FIELD( ySeed, 19, 12 );
+            EUTEL_CELLID_FIELD( xCluSize, 31, 5 );
+            EUTEL_CELLID_FIELD( yCluSize, 36, 5 );
+            EUTEL_CELLID_FIELD( quality, 41, 7 );
+        };
+
+        /** EUTELESCOPE::PULSEDEFAULTENCODING "sensorID:7,xSeed:12,ySeed:12,xCluSize:5,yCluSize:5,type:5,quality:5" */
+        struct PulseEncoding {
+            static const char * encoding() { return EUTELESCOPE::PULSEDEFAULTENCODING; }
+            EUTEL_CELLID_FIELD( sensorID, 0, 7 );
+            EUTEL_CELLID_FIELD( xSeed, 7, 12 );
+            EUTEL_CELLID_FIELD( ySeed, 19, 12 );
+            EUTEL_CELLID_FIELD( xCluSize, 31, 5 );
+            EUTEL_CELLID_FIELD( yCluSize, 36, 5 );
+            EUTEL_CELLID_FIELD( type, 41, 5 );
+            EUTEL_CELLID_FIELD( quality, 46, 5 );
+        };
+
+#undef EUTEL_CELLID_FIELD
+
+        /** Full 64 bit cell ID of a tracker object, as assembled by UTIL::CellIDDecoder */
+        template< class T >
+        inline lcio::long64 cellID( const T * object ) {
+            return ( static_cast< lcio::long64 >( object->getCellID0() ) & 0xffffffff ) |
+                   ( static_cast< lcio::long64 >( object->getCellID1() ) << 32 );
+        }
+
+        /**
+         * Cell ID reader for the elements of one collection.
+         * If the CellIDEncoding parameter of the collection is the
+         * default encoding Encoding::encoding(), fields are decoded with
+         * the constant shifts and masks of Encoding. Otherwise the
+         * reader falls back to a generic LCIO BitField64 built from the
+         * collection's own encoding string, looking fields up by name.
+         *
+         * Usage:
+         *   CellIDCodec::Reader< CellIDCodec::ZSDataEncoding > reader( collection );
+         *   int sensorID = reader.get< CellIDCodec::ZSDataEncoding::sensorID >( zsData );
+         */
+        template< class Encoding >
+        class Reader {
+        public:
+
+            explicit Reader( const EVENT::LCCollection * collection ) : _bitField( 0 ) {
+                const std::string encoding = collection->getParameters().getStringVal( lcio::LCIO::CellIDEncoding );
+                if ( encoding != Encoding::encoding() ) _bitField = new UTIL::BitField64( encoding );
+            }
+
+            ~Reader() {
+                delete _bitField;
+            }
+
+            /** True if the constant-shift decoding is used */
+            bool isCompiled() const {
+                return _bitField == 0;
+            }
+
+            template< class F >
+            int get( const lcio::long64 id ) const {
+                if ( _bitField == 0 ) return F::decode( id );
+                _bitField->setValue( id );
+                return static_cast< int >( ( *_bitField )[ F::name() ].value() );
+            }
+
+            template< class F, class T >
+            int get( const T * object ) const {
+                return get< F >( cellID( object ) );
+            }
+
+        private:
+            Reader( const Reader & );
+            void operator=( const Reader & );
+
+            // Generic decoder, only used if the collection is not encoded with Encoding
+            UTIL::BitField64 * _bitField;
+        };
+
+    }
+
+}
+
+#endif	/* EUTELCELLIDCODEC_H */
@@ -11,6 +11,7 @@
 
 // eutelescope includes ".h"
 #include "EUTelROI.h"
+#include "EUTelClusterSummary.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -248,6 +249,34 @@ namespace eutelescope {
 
   public:
 
+    //! Figures of merit of a cluster the selection criteria are applied to
+    /*! They are calculated once per cluster before the selection, only
+     *  those needed by the switched on criteria, the others are left
+     *  undefined. The N pixel figures have one entry for each N of the
+     *  corresponding threshold vector.
+     */
+    struct ClusterFeatures {
+      int   detectorID;
+      int   detectorPos;
+      bool  isDFF;
+      //! Were the noise values available when the figures were calculated?
+      bool  hasNoise;
+      int   quality;
+      float totalCharge;
+      float totalSNR;
+      float seedCharge;
+      float seedSNR;
+      float clusterNoise;
+      float xCoG;
+      float yCoG;
+      std::vector< float > nCharge;
+      std::vector< float > nSNR;
+      std::vector< float > nxnCharge;
+      std::vector< float > nxnSNR;
+    };
+
+    //! A selection criterion of the cluster based cuts
+    typedef bool ( EUTelClusterFilter::*ClusterCriterion )( const ClusterFeatures & ) const;
 
     //! Returns a new instance of EUTeleClusterSeparationProcessor
     /*! This method returns an new instance of the this processor.  It
@@ -346,7 +375,7 @@ namespace eutelescope {
      *  @return True if the @c cluster has a charge below its own threshold.
      *
      */
-    bool isAboveMinTotalCharge(EUTelVirtualCluster * cluster) const ;
+    bool isAboveMinTotalCharge(const ClusterFeatures & cluster) const ;
 
 
     //! Check if the total cluster SNR is above a certain value
@@ -358,7 +387,7 @@ namespace eutelescope {
      *  @return True if the @c cluster has a SNR below its own
      *  threshold.
      */
-    bool isAboveMinTotalSNR(EUTelVirtualCluster * cluster) const;
+    bool isAboveMinTotalSNR(const ClusterFeatures & cluster) const;
 
     //! Check if the total cluster charge is below a certain value
     /*! This is used to select clusters having a total integrated
@@ -381,7 +410,7 @@ namespace eutelescope {
      *  @param cluster The cluster under test.
      *
      */
-    bool isAboveNumberOfHitPixel(EUTelVirtualCluster * cluster) const;
+    bool isAboveNumberOfHitPixel(const ClusterFeatures & cluster) const;
 
 
     //! Check against the charge collected by N pixels
@@ -396,7 +425,7 @@ namespace eutelescope {
      *  @return True if the charge is above threshold
      *  @param cluster The cluster under test.
      */
-    bool isAboveNMinCharge(EUTelVirtualCluster * cluster) const;
+    bool isAboveNMinCharge(const ClusterFeatures & cluster) const;
 
     //! Check against the SNR of the N most significant pixels
     /*! The SNR of the cluster made by the first N significant pixels
@@ -409,7 +438,7 @@ namespace eutelescope {
      *  @return True if the SNR is above threshold
      *  @param cluster The cluster under test.
      */
-    bool isAboveNMinSNR(EUTelVirtualCluster * cluster) const;
+    bool isAboveNMinSNR(const ClusterFeatures & cluster) const;
 
     //! Check against the charge collected by N x N pixels
     /*! This cut is working on the charge collected by a subframe N x
@@ -418,7 +447,7 @@ namespace eutelescope {
      *  @param cluster The cluster under test.
      *  @return True if the charge is above threshold.
      */
-    bool isAboveNxNMinCharge(EUTelVirtualCluster * cluster) const;
+    bool isAboveNxNMinCharge(const ClusterFeatures & cluster) const;
 
     //! Check against the SNR collected by N x N pixels
     /*! This cut is working on the SNR collected by a subframe N x
@@ -427,7 +456,7 @@ namespace eutelescope {
      *  @param cluster The cluster under test.
      *  @return True if the SNR is above threshold.
      */
-    bool isAboveNxNMinSNR(EUTelVirtualCluster * cluster) const;
+    bool isAboveNxNMinSNR(const ClusterFeatures & cluster) const;
 
     //! Seed pixel cut
     /*! This is used to select clusters having a seed pixel charge
@@ -436,7 +465,7 @@ namespace eutelescope {
      *  @return True if the seed pixel charge is above threshold
      *  @param cluster The cluster under test.
      */
-    bool isAboveMinSeedCharge(EUTelVirtualCluster * cluster) const;
+    bool isAboveMinSeedCharge(const ClusterFeatures & cluster) const;
 
     //! Seed SNR cut
     /*! This is used to select clusters having a seed pixel SNR above
@@ -445,7 +474,7 @@ namespace eutelescope {
      *  @return True if the seed SNR is above threshold
      *  @param cluster The cluster under test.
      */
-    bool isAboveMinSeedSNR(EUTelVirtualCluster * cluster) const;
+    bool isAboveMinSeedSNR(const ClusterFeatures & cluster) const;
 
     //! Quality cut
     /*! This is a selection cut based on the cluster quality. Only
@@ -458,7 +487,7 @@ namespace eutelescope {
      *  @return True if the quality is correct
      *  @param cluster The cluster under test.
      */
-    bool hasQuality(EUTelVirtualCluster * cluster) const;
+    bool hasQuality(const ClusterFeatures & cluster) const;
 
     //! Same number of hits
     /*! This selection criterion can be used to select events in which
@@ -503,7 +532,7 @@ namespace eutelescope {
      *  @param cluster The cluster under test.
      *
      */
-    bool isInsideROI(EUTelVirtualCluster * cluster) const;
+    bool isInsideROI(const ClusterFeatures & cluster) const;
 
     //! Outside the ROI
     /*! This selection criterion can be used to get only clusters
@@ -513,7 +542,7 @@ namespace eutelescope {
      *  @param cluster The cluster under test.
      *
      */
-    bool isOutsideROI(EUTelVirtualCluster * cluster) const;
+    bool isOutsideROI(const ClusterFeatures & cluster) const;
 
     //! Below the maximum cluster noise
     /*! This selection criterion is based on the full cluster noise.
@@ -522,7 +551,7 @@ namespace eutelescope {
      *  allowed.
      *  @param cluster The cluster under test
      */
-    bool isBelowMaxClusterNoise(EUTelVirtualCluster * cluster) const;
+    bool isBelowMaxClusterNoise(const ClusterFeatures & cluster) const;
 
     //! Print the rejection summary
     /*! To better understand which cut is more important, a rejection
@@ -559,6 +588,12 @@ namespace eutelescope {
      */
     void checkCriteria() ;
 
+    //! Calculates the figures of merit needed by the selection
+    /*! The cluster object is only used for the N pixel charges and
+     *  the noise related figures, it is NULL if none of them is needed.
+     */
+    void fillClusterFeatures( const EUTelClusterSummary::Cluster & summary, EUTelVirtualCluster * cluster, ClusterFeatures & features ) const;
+
   protected:
 
     //! Input pulse collection name.
@@ -866,6 +901,26 @@ namespace eutelescope {
 
     //digital fixed frame cuts
     std::vector<int> _DFFNHitsCuts;
+
+    //! The switched on cluster based criteria
+    /*! They are set by checkCriteria(), in the order they are applied,
+     *  one list for the digital fixed frame clusters and one for all
+     *  the others.
+     */
+    std::vector< ClusterCriterion > _clusterCriteria;
+    std::vector< ClusterCriterion > _dffClusterCriteria;
+
+    //! The N of the N pixel and N x N pixel thresholds
+    std::vector< int > _minNChargePixels;
+    std::vector< int > _minNSNRPixels;
+    std::vector< int > _minNxNChargePixels;
+    std::vector< int > _minNxNSNRPixels;
+
+    //! Figures of merit of the clusters of the current event
+    /*! The vector is never shrunk, so the vectors inside the features
+     *  keep their memory from event to event.
+     */
+    std::vector< ClusterFeatures > _clusterFeatures;
   public:
 
     //! Helper predicate class
@@ -0,0 +1,126 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELCLUSTERSUMMARY_H
+#define EUTELCLUSTERSUMMARY_H 1
+
+// eutelescope includes ".h"
+#include "EUTELESCOPE.h"
+
+// lcio includes <.h>
+#include <EVENT/LCEvent.h>
+#include <IMPL/LCCollectionVec.h>
+
+// system includes <>
+#include <string>
+#include <vector>
+
+namespace eutelescope {
+
+  class EUTelVirtualCluster;
+
+  //! Decoded clusters of a pulse collection of the current event
+  /*! Reading the charge, seed or center of gravity of a cluster
+   *  requires wrapping its TrackerDataImpl into the EUTelVirtualCluster
+   *  class matching its type and recomputing them from the pixel
+   *  values. The summary does this once per event for all the pulses
+   *  of a collection and keeps the results in a table with one entry
+   *  per pulse, in the order of the collection, so that all the
+   *  processors reading the same pulse collection share the work.
+   *
+   *  There is one summary per pulse collection name. update() decodes
+   *  the collection the first time it is called for it and does nothing
+   *  for the other calls, as long as the event holds the same collection
+   *  object with the same number of pulses.
+   *
+   *  Sparse clusters are decoded as kEUTelGenericSparsePixel clusters.
+   *  The cluster noise and the N pixel charges are not part of the
+   *  summary, since they depend on the noise and status collections and
+   *  on the pixel numbers each processor uses. createCluster() gives the
+   *  cluster object of a pulse for them.
+   *
+   *  Usage:
+   *  <pre>
+   *  EUTelClusterSummary & summary = EUTelClusterSummary::getInstance( _pulseCollectionName );
+   *  if ( !summary.update( event ) ) return;
+   *  for ( size_t i = 0; i < summary.size(); ++i ) {
+   *    const EUTelClusterSummary::Cluster & cluster = summary[i];
+   *    if ( !cluster.isDecoded ) continue;
+   *    ...
+   *  }
+   *  </pre>
+   */
+  class EUTelClusterSummary {
+
+  public:
+
+    //! Summary of one pulse
+    struct Cluster {
+      int sensorID;
+      ClusterType type;
+      int quality;
+      //! Seed pixel
+      int xSeed;
+      int ySeed;
+      //! Central pixel
+      int xCenter;
+      int yCenter;
+      //! Cluster size in pixels
+      int xSize;
+      int ySize;
+      //! Center of gravity in pixels
+      float xCoG;
+      float yCoG;
+      float totalCharge;
+      float seedCharge;
+      //! False if the cluster type is unknown, the other values are then not set
+      bool isDecoded;
+    };
+
+    //! Summary of the pulse collection with the given name
+    static EUTelClusterSummary & getInstance( const std::string & pulseCollectionName );
+
+    EUTelClusterSummary();
+
+    //! Decodes the pulse collection if not done yet for this event
+    /*! @return false if the event has no such collection, the summary
+     *  is then empty
+     */
+    bool update( EVENT::LCEvent * event );
+
+    //! Cluster object of pulse i, for the values not in the summary
+    /*! @return a new cluster owned by the caller, NULL if the cluster
+     *  type is unknown
+     */
+    EUTelVirtualCluster * createCluster( size_t i ) const;
+
+    //! Number of pulses
+    size_t size() const { return _clusters.size(); }
+
+    //! Summary of pulse i of the collection
+    const Cluster & operator[]( size_t i ) const { return _clusters[i]; }
+
+    //! The pulse collection of the current event, NULL if not found
+    IMPL::LCCollectionVec * getCollection() const { return _collection; }
+
+  private:
+
+    std::vector< Cluster > _clusters;
+
+    //! Identification of the decoded collection
+    int _runNumber;
+    int _eventNumber;
+    int _nElements;
+
+    IMPL::LCCollectionVec * _collection;
+    std::string _collectionName;
+  };
+
+}
+
+#endif
@@ -32,6 +32,7 @@
 #endif
 
 // lcio includes <.h>
+#include <IMPL/TrackerDataImpl.h>
 #include <IMPL/TrackerRawDataImpl.h>
 #include <IMPL/LCCollectionVec.h>
 
@@ -375,6 +376,20 @@ namespace eutelescope {
      */
     void resetStatus(IMPL::TrackerRawDataImpl * status);
 
+    //! Seed search in the NZS frames of _nzsFrames
+    /*! Resets the status of every frame and fills the seed candidate
+     *  map of the frame with the good pixels having a signal in excess
+     *  of _ffSeedCut times their noise, sorted by increasing signal.
+     *
+     *  The threshold is applied to the whole frame by a branch free
+     *  loop over the plain signal, noise and status arrays, which the
+     *  compiler can vectorise, so only the few candidates are looked
+     *  at one by one. The frames are independent and searched in
+     *  parallel if Eutelescope is built with OpenMP, the cluster
+     *  building and the LCIO output stay in the calling thread.
+     */
+    void findSeedCandidates();
+
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
     //! Book histograms
     /*! This method is used to prepare the needed directory structure
@@ -442,7 +457,8 @@ namespace eutelescope {
      *  user. All candidates are added to a vector< pair< float, int > >
      *  (EUTelClusteringProcessor::_seedCandidateMap) where the first
      *  template element is the (float) pixel charge and the second is
-     *  the pixel index.
+     *  the pixel index. This search is done by findSeedCandidates()
+     *  for all sensors at once.
      *
      *  \li This is the sorted using the std::algorithm library by the first element of the pair
      *  i.e. the pixel signal. In this way, at the end of
@@ -753,10 +769,27 @@ namespace eutelescope {
      */
     void readCollections(LCEvent *evt);
 
-    //! The seed candidate pixel map.
+    //! A NZS frame to be clustered
+    struct NZSSensorFrame {
+      IMPL::TrackerDataImpl    * nzsData;
+      IMPL::TrackerDataImpl    * noise;
+      IMPL::TrackerRawDataImpl * status;
+      int sensorID;
+      int maxX;
+      int maxY;
+    };
+
+    //! The NZS frames of the current event passed to findSeedCandidates()
+    std::vector< NZSSensorFrame > _nzsFrames;
+
+    //! The seed candidate pixel maps, one per entry of _nzsFrames.
     /*! This is a vector which stores the seed index and the size of the signal. The signal is the floating point and the unsigned integer is the 
+     *  pixel index. The vectors keep their memory from event to event.
      */
-    std::vector< std::pair<float,unsigned int> > _seedCandidateMap;    
+    std::vector< std::vector< std::pair<float,unsigned int> > > _seedCandidateMap;
+
+    //! Seed flags of every pixel, one per entry of _nzsFrames
+    std::vector< std::vector< unsigned char > > _seedFlags;
 
     //! Total cluster found
     /*! This is a map correlating the sensorID number and the
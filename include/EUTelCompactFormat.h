@@ -0,0 +1,268 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELCOMPACTFORMAT_H
+#define EUTELCOMPACTFORMAT_H 1
+
+// system includes <>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstddef>
+
+namespace eutelescope {
+
+  //! Compact intermediate file format for hits, tracks and states
+  /*! Files in this format are meant to be passed between two
+   *  reconstruction stages in place of a full LCIO file. They are
+   *  written by EUTelCompactWriter and read back by
+   *  EUTelCompactReader.
+   *
+   *  A file is a fixed header followed by records. Each record is a
+   *  RecordHeader and a payload, padded to 8 bytes:
+   *
+   *  - a run dictionary (RunDictionary) is written before the first
+   *    event block of every run. It holds the run header and the
+   *    name, kind and cell ID encoding of all the stored collections,
+   *    so that the event blocks only refer to collections by index.
+   *  - a collection update lists the flag and cell ID encoding of
+   *    the collections that first appear in an event after the run
+   *    dictionary was written; it applies to the following blocks.
+   *  - an event block (EventBlock) holds a group of consecutive
+   *    events of the same run. All the hits of the block are stored
+   *    column by column (all the cellID0, then all the x, ...), the
+   *    same for tracks. Every value has a fixed width, so a column is
+   *    decoded with a single copy.
+   *
+   *  If zlib is available (USE_ZLIB), record payloads can be
+   *  compressed one by one. Data are stored in the byte order of the
+   *  writing machine; the reader refuses files with a different one.
+   *
+   *  Tracks and states are both stored as LCIO tracks: track to state
+   *  and track to hit relations are saved as indices into the tracks
+   *  and hits of the same event. Relations to objects which are not
+   *  in one of the stored collections are lost, as in LCIO.
+   */
+  namespace compact {
+
+    //! Format version, increase when the layout changes
+    /*! Version 2 added the collection update record. Files of an
+     *  older version can still be read.
+     */
+    const unsigned int formatVersion = 2;
+
+    //! Kind of a stored collection
+    enum CollectionKind {
+      kHitCollection   = 0,
+      kTrackCollection = 1,
+      kStateCollection = 2
+    };
+
+    //! Record types
+    enum RecordType {
+      kEndOfFile           = 0,
+      kRunDictionaryRecord = 1,
+      kEventBlockRecord    = 2,
+      kCollectionUpdateRecord = 3
+    };
+
+    //! Description of one stored collection
+    struct CollectionEntry {
+      std::string name;
+      int kind;
+      int flag;
+      std::string cellIDEncoding;
+    };
+
+    //! One run header parameter
+    struct ParameterEntry {
+      //! Value type: 0 int, 1 float, 2 string
+      int type;
+      std::string key;
+      std::vector< int > intValues;
+      std::vector< float > floatValues;
+      std::vector< std::string > stringValues;
+    };
+
+    //! Run header and collection dictionary of one run
+    struct RunDictionary {
+      int runNumber;
+      std::string detectorName;
+      std::string description;
+      std::vector< CollectionEntry > collections;
+      std::vector< ParameterEntry > parameters;
+
+      RunDictionary() : runNumber( 0 ), detectorName(), description(), collections(), parameters() { }
+      void clear();
+    };
+
+    //! Columns of a block of events
+    /*! Hits and tracks are stored event by event and, inside an
+     *  event, collection by collection in dictionary order. Columns
+     *  with several values per element (covariance matrices,
+     *  reference points) keep the values of one element together.
+     */
+    struct EventBlock {
+      // one entry per event
+      std::vector< int > eventNumber;
+      std::vector< long long > timeStamp;
+      std::vector< int > eventType;
+
+      //! Number of elements per event and collection (nEvents x nCollections), -1 if the collection is missing
+      std::vector< int > collectionSize;
+
+      // one entry per hit
+      std::vector< int > hitCellID0;
+      std::vector< int > hitCellID1;
+      std::vector< int > hitType;
+      std::vector< int > hitQuality;
+      std::vector< double > hitX;
+      std::vector< double > hitY;
+      std::vector< double > hitZ;
+      std::vector< float > hitEDep;
+      std::vector< float > hitEDepError;
+      std::vector< float > hitTime;
+      //! 6 values per hit
+      std::vector< float > hitCov;
+
+      // one entry per track or state
+      std::vector< int > trackType;
+      std::vector< int > trackNdf;
+      std::vector< float > trackD0;
+      std::vector< float > trackPhi;
+      std::vector< float > trackOmega;
+      std::vector< float > trackZ0;
+      std::vector< float > trackTanLambda;
+      std::vector< float > trackChi2;
+      std::vector< float > trackdEdx;
+      std::vector< float > trackdEdxError;
+      std::vector< float > trackRadiusOfInnermostHit;
+      //! 15 values per track
+      std::vector< float > trackCov;
+      //! 3 values per track
+      std::vector< float > trackReferencePoint;
+      //! Number of entries in trackHitIndex and trackSubTrackIndex for each track
+      std::vector< int > trackNHits;
+      std::vector< int > trackNSubTracks;
+
+      //! Hits of all tracks, as index into the hits of the event (-1 if not stored)
+      std::vector< int > trackHitIndex;
+      //! Sub-tracks (states) of all tracks, as index into the tracks of the event (-1 if not stored)
+      std::vector< int > trackSubTrackIndex;
+
+      EventBlock();
+      void clear();
+      int getNumberOfEvents() const { return static_cast< int >( eventNumber.size() ); }
+
+      //! Check that all the column lengths agree, the argument is the dictionary size
+      bool isConsistent( size_t nCollections ) const;
+    };
+
+
+    //! Writes a compact file
+    /*! Errors are reported by throwing lcio::IOException */
+    class CompactFileWriter {
+    public:
+      CompactFileWriter();
+      ~CompactFileWriter();
+
+      //! Open a new file, compressionLevel 0 disables the compression
+      void open( const std::string & fileName, int compressionLevel );
+      void close();
+      bool isOpen() const { return _file.is_open(); }
+
+      void write( const RunDictionary & dictionary );
+      void write( const EventBlock & block );
+
+      //! Flag and encoding of the given dictionary collections, known only after the dictionary was written
+      void writeCollectionUpdate( const RunDictionary & dictionary, const std::vector< unsigned int > & collections );
+
+      //! Number of payload bytes before and after compression
+      unsigned long long getRawBytes() const { return _rawBytes; }
+      unsigned long long getStoredBytes() const { return _storedBytes; }
+
+    private:
+      CompactFileWriter( const CompactFileWriter & );
+      CompactFileWriter & operator=( const CompactFileWriter & );
+
+      void writeRecord( unsigned int type );
+
+      std::ofstream _file;
+      std::string _fileName;
+      int _compressionLevel;
+
+      //! Payload of the record being written and its compressed copy, reused
+      std::vector< char > _payload;
+      std::vector< char > _compressed;
+
+      unsigned long long _rawBytes;
+      unsigned long long _storedBytes;
+    };
+
+
+    //! Reads a compact file
+    /*! The file is memory mapped; uncompressed payloads are decoded
+     *  directly from the mapped pages. Errors are reported by
+     *  throwing lcio::IOException.
+     *
+     *  Usage:
+     *    reader.open( fileName );
+     *    while ( ( type = reader.nextRecord() ) != kEndOfFile ) {
+     *      if ( type == kRunDictionaryRecord ) reader.read( dictionary );
+     *      else if ( type == kCollectionUpdateRecord ) reader.readCollectionUpdate( dictionary );
+     *      else if ( type == kEventBlockRecord ) reader.read( block );
+     *    }
+     */
+    class CompactFileReader {
+    public:
+      CompactFileReader();
+      ~CompactFileReader();
+
+      void open( const std::string & fileName );
+      void close();
+
+      //! Move to the next record and return its type (RecordType)
+      int nextRecord();
+
+      //! Decode the current record
+      void read( RunDictionary & dictionary );
+      void read( EventBlock & block );
+
+      //! Apply the current collection update record to the dictionary of the run
+      void readCollectionUpdate( RunDictionary & dictionary );
+
+    private:
+      CompactFileReader( const CompactFileReader & );
+      CompactFileReader & operator=( const CompactFileReader & );
+
+      //! Payload of the current record, uncompressed if needed
+      void getPayload( const char *& begin, const char *& end );
+
+      std::string _fileName;
+      const char * _mapped;
+      size_t _size;
+
+      //! Offset of the next record
+      size_t _position;
+
+      // current record
+      unsigned int _recordType;
+      unsigned int _recordFlags;
+      const char * _recordPayload;
+      unsigned long long _recordRawSize;
+      unsigned long long _recordStoredSize;
+
+      //! Uncompressed payload, reused
+      std::vector< char > _uncompressed;
+    };
+
+  }
+
+}
+
+#endif
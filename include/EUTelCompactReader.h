@@ -0,0 +1,90 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELCOMPACTREADER_H
+#define EUTELCOMPACTREADER_H 1
+
+// eutelescope includes ".h"
+#include "EUTelCompactFormat.h"
+
+// marlin includes ".h"
+#include "marlin/DataSourceProcessor.h"
+
+// lcio includes <.h>
+#include <IMPL/TrackerHitImpl.h>
+#include <IMPL/TrackImpl.h>
+#include <IMPL/LCRunHeaderImpl.h>
+
+// system includes <>
+#include <string>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Reads a compact intermediate file
+  /*! This data source processor reads back the files written by
+   *  EUTelCompactWriter and passes their runs and events to the
+   *  following processors, as if they came from an LCIO file.
+   *
+   *  Hit collections are made of TrackerHitImpl, track and state
+   *  collections of TrackImpl, with their hit and sub-track relations
+   *  restored, as written by the track processors. An end of run event
+   *  (kEORE) is added after the last event.
+   *
+   *  Make sure not to specify any LCIOInputFiles in the steering.
+   *
+   *  @param CompactFileName Name of the input file
+   */
+  class EUTelCompactReader : public marlin::DataSourceProcessor {
+
+  public:
+
+    //! Default constructor
+    EUTelCompactReader();
+
+    //! New processor
+    virtual EUTelCompactReader * newProcessor();
+
+    //! Reads the file and processes its runs and events
+    virtual void readDataSource( int numEvents );
+
+    virtual void init();
+
+    virtual void end();
+
+  protected:
+
+    //! Processes the run header stored in a dictionary, the caller owns the returned header
+    IMPL::LCRunHeaderImpl * processDictionary( const compact::RunDictionary & dictionary );
+
+    //! Builds the event iEvent of the block and processes it
+    void processBlockEvent( const compact::RunDictionary & dictionary, const compact::EventBlock & block, int iEvent );
+
+    //! Input file name
+    std::string _fileName;
+
+    //! Position of the first hit, track and relations of the next event in the current block
+    size_t _nextHit;
+    size_t _nextTrack;
+    size_t _nextHitIndex;
+    size_t _nextSubTrackIndex;
+
+    //! Hits and tracks of the event being built, reused
+    std::vector< IMPL::TrackerHitImpl * > _eventHits;
+    std::vector< IMPL::TrackImpl * > _eventTracks;
+
+    int _runNumber;
+    int _nEvents;
+  };
+
+  //! A global instance of the processor
+  EUTelCompactReader gEUTelCompactReader;
+
+}
+
+#endif
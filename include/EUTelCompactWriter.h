@@ -0,0 +1,141 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELCOMPACTWRITER_H
+#define EUTELCOMPACTWRITER_H 1
+
+// eutelescope includes ".h"
+#include "EUTelCompactFormat.h"
+
+// marlin includes ".h"
+#include "marlin/Processor.h"
+
+// lcio includes <.h>
+#include <EVENT/LCCollection.h>
+#include <EVENT/TrackerHit.h>
+#include <EVENT/Track.h>
+
+// system includes <>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace eutelescope {
+
+  //! Writes hits, tracks and states to a compact intermediate file
+  /*! This processor stores the selected collections in the compact
+   *  format described in EUTelCompactFormat.h, to be read by the next
+   *  reconstruction stage with EUTelCompactReader instead of an LCIO
+   *  file. The run header is kept, the other collections of the event
+   *  are not written.
+   *
+   *  Events are collected in blocks of EventsPerBlock events; every
+   *  block is stored column by column and, if Eutelescope was built
+   *  with zlib, compressed.
+   *
+   *  <h4>Input collections</h4>
+   *  <br><b>HitCollectionNames</b> TrackerHit collections.
+   *  <br><b>TrackCollectionNames</b> Track collections (EUTelTrack).
+   *  <br><b>StateCollectionNames</b> Track collections holding the
+   *  states of the tracks (EUTelState).
+   *
+   *  Hits and states used by the tracks must be in one of the written
+   *  collections, otherwise the relation is lost.
+   *
+   *  @param CompactFileName Name of the output file
+   *  @param EventsPerBlock Number of events in one block
+   *  @param CompressionLevel zlib compression level, 0 to switch the compression off
+   */
+  class EUTelCompactWriter : public marlin::Processor {
+
+  public:
+
+    //! Returns a new instance of EUTelCompactWriter
+    virtual Processor * newProcessor() {
+      return new EUTelCompactWriter;
+    }
+
+    //! Default constructor
+    EUTelCompactWriter();
+
+    //! Opens the output file
+    virtual void init();
+
+    //! Writes out the events of the previous run and prepares the dictionary of the new one
+    virtual void processRunHeader( LCRunHeader * run );
+
+    //! Adds the event to the current block
+    virtual void processEvent( LCEvent * evt );
+
+    //! Writes out the last block and closes the file
+    virtual void end();
+
+  protected:
+
+    //! Writes the run dictionary if not yet done and the current block
+    void flushBlock();
+
+    //! Index of the hits and tracks of the event, used to store the relations
+    void indexEvent();
+
+    void addHit( const EVENT::TrackerHit * hit );
+    void addTrack( const EVENT::Track * track );
+
+    //! Output file name
+    std::string _fileName;
+
+    //! Collections to be written
+    std::vector< std::string > _hitCollectionNames;
+    std::vector< std::string > _trackCollectionNames;
+    std::vector< std::string > _stateCollectionNames;
+
+    //! Number of events per block
+    int _eventsPerBlock;
+
+    //! zlib compression level
+    int _compressionLevel;
+
+    compact::CompactFileWriter _writer;
+
+    //! Dictionary of the current run
+    compact::RunDictionary _dictionary;
+
+    //! Is the dictionary of the current run already in the file?
+    bool _dictionaryWritten;
+
+    //! Are flag and encoding of each dictionary collection known?
+    std::vector< bool > _collectionSeen;
+
+    //! Collections first seen after the dictionary was written, for the next collection update
+    std::vector< unsigned int > _collectionsToUpdate;
+
+    //! Events not yet written
+    compact::EventBlock _block;
+
+    //! Collections of the current event, in dictionary order (0 if missing)
+    std::vector< EVENT::LCCollection * > _eventCollections;
+
+    //! Position of the hits and tracks in the current event
+    std::map< const EVENT::TrackerHit *, int > _hitIndex;
+    std::map< const EVENT::Track *, int > _trackIndex;
+
+    //! Run header available
+    bool _runOpen;
+
+    int _nEvents;
+
+    //! Relations to hits or tracks which are not written
+    int _nLostRelations;
+  };
+
+  //! A global instance of the processor
+  EUTelCompactWriter gEUTelCompactWriter;
+
+}
+
+#endif
@@ -93,6 +93,18 @@ namespace eutelescope {
     virtual int  read_track(LCEvent *event); 
     virtual int  read_track_from_collections(LCEvent *event); 
 
+    //! Empties the per event tables, the memory of the vectors is kept
+    void clearTrackTables();
+
+    //! Sorts the DUT hits of the event into the matching grid
+    void buildHitIndex();
+
+    //! Closest DUT hit not yet matched within _distMax of any fitted position of a track
+    /*! Returns false if there is none. Ties go to the first fitted
+     *  position and then to the first hit, as in a scan over all pairs.
+     */
+    bool findClosestHit(int itrack, int& bestfit, int& besthit) const;
+
 
     //! Returns a new instance of EUTelDUTHistograms
     /*! This method returns an new instance of the this processor.  It
@@ -271,6 +283,24 @@ protected:
  
     std::vector<float > _DUTalign;
 
+    //! Grid of the DUT hits of the event used for matching
+    /*! The cells are at least _distMax wide, so a hit close enough to a
+     *  fitted position is in the same cell or in one of its neighbours.
+     *  The hits of cell i are _hitCellIndex[_hitCellStart[i]] up to
+     *  _hitCellIndex[_hitCellStart[i+1]], in the order of _measuredX.
+     */
+    double _hitGridX0;
+    double _hitGridY0;
+    double _hitGridCell;
+    int _hitGridNX;
+    int _hitGridNY;
+    std::vector<int> _hitCell;
+    std::vector<int> _hitCellStart;
+    std::vector<int> _hitCellIndex;
+
+    //! DUT hits already matched to a track in this event
+    std::vector<bool> _hitMatched;
+
 
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
     //! AIDA histogram maps
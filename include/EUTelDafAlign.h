@@ -62,7 +62,11 @@ namespace eutelescope {
   protected:
     //params
     bool _runPede;
+    //! Run pede at the end, false for split jobs which only write their binary file
+    bool _executePede;
     std::string _pedeSteerfileName, _binaryFilename, _alignmentConstantLCIOFile, _alignmentConstantCollectionName;
+    //! Binary files of other jobs of the same run, given to pede together with _binaryFilename
+    std::vector<std::string> _additionalBinaryFilenames;
     std::vector<int> _translate, _translateX, _translateY, _zRot, _scale, _scaleX, _scaleY;
     std::vector<float>_resXMin, _resXMax, _resYMin, _resYMax;
     //Variables
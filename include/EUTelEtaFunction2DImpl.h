@@ -0,0 +1,77 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+#ifndef EUTELETAFUNCTION2DIMPL_H
+#define EUTELETAFUNCTION2DIMPL_H
+
+// lcio includes <.h>
+#include <lcio.h>
+#include <IMPL/LCGenericObjectImpl.h>
+
+// system includes <>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Two dimensional Eta map LCIO implementation
+  /*! The one dimensional Eta functions assume that the CoG along x
+   *  does not depend on the position along y and viceversa. The map
+   *  drops this assumption: the Eta value along x is calculated for
+   *  every bin of the CoG along y and the other way round.
+   *
+   *  The integer values are the sensor ID and the number of bins along
+   *  x and y. The first four double values are the first and the last
+   *  bin centers along x and y, the bins are uniform in between. They
+   *  are followed by the Eta values along x and by the Eta values
+   *  along y, @a nBinX times @a nBinY each with x running fastest.
+   *
+   *  The map is written by the EUTelCalculateEtaProcessor and applied
+   *  using EUTelEtaTable2D.
+   */
+  class EUTelEtaFunction2DImpl : public IMPL::LCGenericObjectImpl {
+
+  public:
+    //! Constructor with all the needed parameters
+    /*! @param sensorID The is the sensorID of this sensor.
+     *  @param nBinX Number of bins along x
+     *  @param nBinY Number of bins along y
+     *  @param xFirst Center of the first bin along x
+     *  @param xLast Center of the last bin along x
+     *  @param yFirst Center of the first bin along y
+     *  @param yLast Center of the last bin along y
+     *  @param xEta The Eta values along x, nBinX * nBinY values with x running fastest
+     *  @param yEta The Eta values along y, same layout as @a xEta
+     */
+    EUTelEtaFunction2DImpl(int sensorID, int nBinX, int nBinY, double xFirst, double xLast, double yFirst, double yLast,
+                           const std::vector<double > & xEta, const std::vector<double > & yEta);
+
+    //! Default destructor
+    virtual ~EUTelEtaFunction2DImpl() { /* NO-OP */ ; }
+
+    //! Get the sensor ID
+    int getSensorID() const { return getIntVal( 0 ); }
+
+    //! Get the number of bins along x
+    int getNoOfBinX() const { return getIntVal( 1 ); }
+
+    //! Get the number of bins along y
+    int getNoOfBinY() const { return getIntVal( 2 ); }
+
+  private:
+
+    void getNFloat() {;}
+    void getFloatVal() {;}
+    void setFloatVal(unsigned int, float) {;}
+    void isFixedSize() {;}
+
+  };
+
+}
+
+#endif
@@ -129,7 +129,8 @@ namespace eutelescope {
      *  binary search algorthim can be replaced with a much faster
      *  calculation of the x closest pair of values. Because of this
      *  lack in generality, we prefer to invest some calculation power
-     *  in the binary search.
+     *  in the binary search. EUTelEtaTable does the faster calculation
+     *  for functions with uniform binning.
      *
      *  @param x is the current CoG value
      *  @return the corresponding Eta value
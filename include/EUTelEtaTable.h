@@ -0,0 +1,170 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELETATABLE_H
+#define EUTELETATABLE_H 1
+
+// lcio includes <.h>
+#include <EVENT/LCGenericObject.h>
+
+// system includes <>
+#include <cstddef>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Eta function sampled on a uniform grid
+  /*! EUTelEtaFunctionImpl::getEtaFromCoG looks for the bins around the
+   *  CoG with a binary search, because nothing in the stored function
+   *  says that the bins are uniform. The EUTelCalculateEtaProcessor
+   *  always writes uniform bins, so the table checks this once when it
+   *  is built and afterwards finds the bin with one multiplication.
+   *  The interpolation is the same linear one of getEtaFromCoG and
+   *  CoG values outside the bin centers get the first or last Eta
+   *  value. A function with non uniform bins is resampled at the same
+   *  number of uniform bins between its first and last bin center.
+   *
+   *  Usage:
+   *  <pre>
+   *  EUTelEtaTable etaX( etaXCollection->getElementAt( i ) );
+   *  double x = etaX.getEta( xCoG );
+   *  etaX.apply( nCluster, xCoGArray, xEtaArray );
+   *  </pre>
+   */
+  class EUTelEtaTable {
+
+  public:
+
+    //! Table of an Eta function
+    /*! @param etaFunction An EUTelEtaFunctionImpl or the LCGenericObject
+     *  read back from the Eta condition file.
+     */
+    explicit EUTelEtaTable( const EVENT::LCGenericObject * etaFunction );
+
+    //! Sensor ID of the Eta function, -1 if it has none
+    int getSensorID() const { return _sensorID; }
+
+    //! Number of bins of the table
+    int getNoOfBin() const { return static_cast< int >( _value.size() ); }
+
+    //! Eta for a given CoG value
+    double getEta( double cog ) const {
+      const double t = ( cog - _first ) * _invStep;
+      if ( !( t > 0. ) ) return _value.front();
+      if ( t >= _lastIndex ) return _value.back();
+      const int i = static_cast< int >( t );
+      return _value[i] + ( t - i ) * _slope[i];
+    }
+
+    //! Eta for n CoG values
+    template < class T > void apply( size_t n, const T * cog, T * eta ) const {
+      for ( size_t i = 0; i < n; ++i ) eta[i] = static_cast< T >( getEta( cog[i] ) );
+    }
+
+  private:
+
+    int _sensorID;
+
+    //! Center of the first bin
+    double _first;
+
+    //! Inverse of the bin width, 0 for a single bin
+    double _invStep;
+
+    //! Index of the last bin
+    double _lastIndex;
+
+    //! Eta value at every bin center
+    std::vector< double > _value;
+
+    //! Difference to the Eta value of the next bin, 0 for the last bin
+    std::vector< double > _slope;
+
+  };
+
+  //! Two dimensional Eta map sampled on a uniform grid
+  /*! Applies the Eta maps written as EUTelEtaFunction2DImpl. The Eta
+   *  values along x and y are bilinearly interpolated between the four
+   *  bin centers around the CoG, CoG values outside the bin centers
+   *  get the values of the closest edge.
+   */
+  class EUTelEtaTable2D {
+
+  public:
+
+    //! Table of an Eta map
+    /*! @param etaFunction An EUTelEtaFunction2DImpl or the
+     *  LCGenericObject read back from the Eta condition file.
+     */
+    explicit EUTelEtaTable2D( const EVENT::LCGenericObject * etaFunction );
+
+    int getSensorID() const { return _sensorID; }
+
+    //! Eta along x and y for a given CoG
+    void getEta( double xCoG, double yCoG, double & xEta, double & yEta ) const {
+      int ix, iy;
+      double fx, fy;
+      locate( ( xCoG - _xFirst ) * _xInvStep, _nBinX, ix, fx );
+      locate( ( yCoG - _yFirst ) * _yInvStep, _nBinY, iy, fy );
+      const int ix1 = ix + 1 < _nBinX ? ix + 1 : ix;
+      const int iy1 = iy + 1 < _nBinY ? iy + 1 : iy;
+      const int i00 = iy  * _nBinX + ix;
+      const int i10 = iy  * _nBinX + ix1;
+      const int i01 = iy1 * _nBinX + ix;
+      const int i11 = iy1 * _nBinX + ix1;
+      const double w00 = ( 1. - fx ) * ( 1. - fy );
+      const double w10 = fx * ( 1. - fy );
+      const double w01 = ( 1. - fx ) * fy;
+      const double w11 = fx * fy;
+      xEta = w00 * _xEta[i00] + w10 * _xEta[i10] + w01 * _xEta[i01] + w11 * _xEta[i11];
+      yEta = w00 * _yEta[i00] + w10 * _yEta[i10] + w01 * _yEta[i01] + w11 * _yEta[i11];
+    }
+
+    //! Eta along x and y for n CoG values
+    template < class T > void apply( size_t n, const T * xCoG, const T * yCoG, T * xEta, T * yEta ) const {
+      double x, y;
+      for ( size_t i = 0; i < n; ++i ) {
+        getEta( xCoG[i], yCoG[i], x, y );
+        xEta[i] = static_cast< T >( x );
+        yEta[i] = static_cast< T >( y );
+      }
+    }
+
+  private:
+
+    //! Bin i and fraction f of the way to bin i + 1 at grid position t
+    static void locate( double t, int nBin, int & i, double & f ) {
+      if ( !( t > 0. ) ) {
+        i = 0;
+        f = 0.;
+      } else if ( t >= nBin - 1 ) {
+        i = nBin - 1;
+        f = 0.;
+      } else {
+        i = static_cast< int >( t );
+        f = t - i;
+      }
+    }
+
+    int _sensorID;
+    int _nBinX;
+    int _nBinY;
+    double _xFirst;
+    double _xInvStep;
+    double _yFirst;
+    double _yInvStep;
+
+    //! Eta values at the bin centers, x running fastest
+    std::vector< double > _xEta;
+    std::vector< double > _yEta;
+
+  };
+
+}
+
+#endif
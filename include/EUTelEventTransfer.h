@@ -0,0 +1,69 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELEVENTTRANSFER_H
+#define EUTELEVENTTRANSFER_H 1
+
+// lcio includes <.h>
+#include <lcio.h>
+#include <EVENT/LCEvent.h>
+#include <EVENT/LCRunHeader.h>
+#include <IMPL/LCEventImpl.h>
+#include <IMPL/LCRunHeaderImpl.h>
+
+// system includes <>
+#include <set>
+#include <string>
+
+//! Defined if LCIO readers and writers can be used from several threads
+/*! Up to LCIO v02-12 the SIO layer keeps its streams and blocks in
+ *  global managers, so only one thread at a time may read or write
+ *  any LCIO file.
+ */
+#if defined(LCIO_VERSION_GE)
+#if LCIO_VERSION_GE(2,13)
+#define EUTEL_SIO_THREAD_SAFE 1
+#endif
+#endif
+
+namespace eutelescope {
+
+  //! Copy of a run header with its parameters, owned by the caller
+  IMPL::LCRunHeaderImpl * copyRunHeader( const EVENT::LCRunHeader * run );
+
+  //! New event taking over the collections of evt
+  /*! LCIO readers and Marlin delete an event as soon as the next one
+   *  is read. The returned event, owned by the caller, has the same
+   *  header, parameters and collections as evt and can be kept after
+   *  evt is gone: the collections owned by evt are not deleted with
+   *  it any more, but with the new event. Collections evt does not
+   *  own, like the ones of the conditions processors, are only
+   *  referenced by the new event.
+   *
+   *  @param evt An LCEventImpl, as all events read by LCIO or built
+   *  by the Eutelescope readers.
+   */
+  IMPL::LCEventImpl * takeEvent( EVENT::LCEvent * evt );
+
+  //! As takeEvent, but with copies of the collections evt does not own
+  /*! An event kept for a writer thread must not reference collections
+   *  the processing thread goes on changing or replacing, like the
+   *  pedestal, noise and status collections added with
+   *  takeCollection or the conditions collections. These are deep
+   *  copied into the new event instead, except the ones named in
+   *  skipNames, which are left out.
+   *
+   *  Only full collections of TrackerData, TrackerRawData and
+   *  LCGenericObject can be copied. If evt has any other collection
+   *  it does not own, nothing is taken from evt and NULL is returned.
+   */
+  IMPL::LCEventImpl * takeEventCopy( EVENT::LCEvent * evt, const std::set< std::string > & skipNames );
+
+}
+
+#endif
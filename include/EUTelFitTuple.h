@@ -26,6 +26,8 @@
 #include <AIDA/ITuple.h>
 #endif
 
+#include "EUTelRootTupleWriter.h"
+
 // system includes <>
 #include <string>
 #include <vector>
@@ -72,6 +74,13 @@ namespace eutelescope {
    * \param MissingValue Value (double) which is used for missing
    *        measurements.
    *
+   * \param RootFileName If set, the n-tuple is written as ROOT tree
+   *        with one branch per column to this file instead of the AIDA
+   *        tuple (see EUTelRootTupleWriter).
+   *
+   * \param BasketSize, AutoFlush, CompressionLevel, WriterQueueDepth
+   *        Settings of the ROOT tree, see EUTelRootTupleWriter::open().
+   *
 
    * \author A.F.Zarnecki, University of Warsaw
    * @version $Id$
@@ -225,6 +234,33 @@ namespace eutelescope {
 
     AIDA::ITuple * _FitTuple;
 
+    //! Sets a column of the current row, in the ROOT tree or the AIDA tuple
+    template < class T > void fillColumn( int column, T value ) {
+#if defined(USE_ROOT) || defined(MARLIN_USE_ROOT)
+      if ( _writeRootTuple ) {
+        _rootTuple.set( column, value );
+        return;
+      }
+#endif
+      _FitTuple->fill( column, value );
+    }
+
+#endif
+
+    //! ROOT output file, empty for the AIDA tuple
+    std::string _rootFileName;
+
+    //! ROOT tree settings
+    int _basketSize;
+    int _autoFlush;
+    int _compressionLevel;
+    int _writerQueueDepth;
+
+    //! Is the n-tuple written with _rootTuple?
+    bool _writeRootTuple;
+
+#if defined(USE_ROOT) || defined(MARLIN_USE_ROOT)
+    EUTelRootTupleWriter _rootTuple;
 #endif
 
   } ;
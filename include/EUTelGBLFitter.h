@@ -64,7 +64,7 @@ namespace eutelescope {
 			~EUTelGBLFitter();
 			//SET
 			void setInformationForGBLPointList(EUTelTrack& track, std::vector< gbl::GblPoint >& pointList);
-			void setMeasurementGBL(gbl::GblPoint& point, const double *hitPos, double statePos[3], double combinedCov[4], TMatrixD projection);
+			void setMeasurementGBL(gbl::GblPoint& point, const double *hitPos, double statePos[3], double combinedCov[4], const TMatrixD& projection);
 			void setKinkInformationToTrack(gbl::GblTrajectory* traj, std::vector< gbl::GblPoint >& pointList,EUTelTrack &track);
 			void setPointVec( std::vector< gbl::GblPoint >& pointList, gbl::GblPoint& point);
 			void setPairAnyStateAndPointLabelVec(std::vector< gbl::GblPoint >& pointList, gbl::GblTrajectory*);
@@ -87,6 +87,8 @@ namespace eutelescope {
 				this->_mille = _mille;
 			}
 			void setMillepede( EUTelMillepede* Mille ) { _MilleInterface =  Mille; }
+			/** Take the material between planes from the interpolated material maps of the geometry instead of the exact TGeo integral */
+			void setUseRadLengthMap( bool useMap ) { _useRadLengthMap = useMap; }
 			void SetJacobain(TMatrixD matrix ){
 				_jacobianAlignment = matrix;
 			}
@@ -98,8 +100,8 @@ namespace eutelescope {
 			void setExcludeFromFitPlanes(const std::vector<int>&);
 			void setMEstimatorType( const std::string& _mEstimatorType );
 			//GET
-			gbl::GblPoint getLabelToPoint(std::vector<gbl::GblPoint> & pointList, int label);
-			void getResidualOfTrackandHits(gbl::GblTrajectory* traj, std::vector< gbl::GblPoint > pointList, EUTelTrack& track, map< int, map< float, float > > & SensorResidual, map< int, map< float, float > >& sensorResidualError);
+			const gbl::GblPoint& getLabelToPoint(const std::vector<gbl::GblPoint> & pointList, int label);
+			void getResidualOfTrackandHits(gbl::GblTrajectory* traj, const std::vector< gbl::GblPoint >& pointList, EUTelTrack& track, map< int, map< float, float > > & SensorResidual, map< int, map< float, float > >& sensorResidualError);
 			inline int getAlignmentMode() const {
 				return _alignmentMode;
 			}
@@ -128,7 +130,7 @@ namespace eutelescope {
 			//OTHER FUNCTIONS
 			void resetPerTrack();
 			void findScattersZPositionBetweenTwoStates(EUTelState& state);
-			TMatrixD findScattersJacobians(EUTelState state, EUTelState nextTrack);
+			const TMatrixD& findScattersJacobians(EUTelState& state, EUTelState& nextTrack);
 			void updateTrackFromGBLTrajectory(gbl::GblTrajectory* traj,std::vector< gbl::GblPoint >& pointList, EUTelTrack & track, map<int, vector<double> > &  mapSensorIDToCorrectionVec );
 			void prepareLCIOTrack( gbl::GblTrajectory*, vector<const IMPL::TrackImpl*>::const_iterator&, double, int); 
 			void prepareMilleOut( gbl::GblTrajectory* );
@@ -150,6 +152,7 @@ namespace eutelescope {
 			gbl::MilleBinary* _mille;
 			std::string _binaryname;
 			TMatrixD _jacobianAlignment;
+			/** Jacobians between the scatterers, allocated once and overwritten for every pair of states */
 			std::vector<TMatrixD> _scattererJacobians;
 			std::vector<float> _scattererPositions;
 			std::vector<int> _globalLabels;
@@ -173,6 +176,7 @@ namespace eutelescope {
 			std::vector< pair< EUTelState, int> > _vectorOfPairsMeasurementStatesAndLabels;//This is used within alignment since you need to associate MEASUREMENT states to  labels
 			std::vector< pair< EUTelState, int> > _vectorOfPairsStatesAndLabels;//This is used in track fit since you want to associate ANY states to labels.
 			unsigned int _counter_num_pointer;
+			bool _useRadLengthMap;
 			EUTelMillepede* _MilleInterface;
         
     };
@@ -26,6 +26,7 @@
 // EUTELESCOPE
 #include "EUTelUtility.h"
 #include "EUTelGenericPixGeoMgr.h"
+#include "EUTelRadLengthMap.h"
 
 // ROOT
 #if defined(USE_ROOT) || defined(MARLIN_USE_ROOT)
@@ -86,6 +87,9 @@ const Double_t PI     = 3.141592653589793;
 const Double_t DEG    = 180./PI; 
 const Double_t RADIAN = PI/180.; 
 
+/** Jacobian of the five track parameters, of fixed size and kept on the stack */
+typedef Eigen::Matrix<double, 5, 5> Jacobian5d;
+
 class EUTelGeometryTelescopeGeoDescription
 {
   private:
@@ -173,6 +177,14 @@ class EUTelGeometryTelescopeGeoDescription
 
 	/** */
 	static unsigned _counter;
+	/** Material maps of the gaps between planes, keyed by the sensor IDs of both planes */
+	std::map< std::pair<int, int>, EUTelRadLengthMap > _radLengthMaps;
+	/** Bin size of the material maps in position [mm] */
+	double _radLengthMapPositionStep;
+	/** Range of the material maps in track slope, [-max,max] */
+	double _radLengthMapMaxSlope;
+	/** Number of bins of the material maps in each track slope */
+	int _radLengthMapSlopeBins;
 
   public:
 	/** Retrieves the instanstance of geometry.
@@ -366,6 +378,19 @@ class EUTelGeometryTelescopeGeoDescription
 
 	// Geometry operations
 	float findRadLengthIntegral( const double[], const double[], bool );
+	/** Radiation length integral between two points on the planes sensorID and nextSensorID
+	 * (boundary volumes included), interpolated in the material map of this plane gap.
+	 * Lines outside of the map are integrated exactly with findRadLengthIntegral.
+	 */
+	float findRadLengthIntegralInGap( int sensorID, int nextSensorID, const double globalPosStart[], const double globalPosFinish[] );
+	/** Binning of the material maps: position bin size [mm], maximum track slope and
+	 * number of bins in each slope. Removes all maps computed so far.
+	 */
+	void setRadLengthMapBinning( double positionStep, double maxSlope, int nSlopeBins );
+	/** Compare the material maps of all consecutive planes with the exact integral
+	 * for nSamples random lines per gap. Returns the largest relative deviation.
+	 */
+	float checkRadLengthMaps( int nSamples );
 
 	int getSensorID( const float globalPos[] ) const;
 
@@ -393,8 +418,17 @@ class EUTelGeometryTelescopeGeoDescription
 
 	TMatrixD getPropagationJacobianCurvilinear(float ds, float qbyp, TVector3 t1, TVector3 t2);
 
+	/** As above, filling a fixed-size matrix: no allocation for each scatterer in the track fit */
+	void getPropagationJacobianCurvilinear(float ds, float qbyp, const TVector3& t1, const TVector3& t2, Jacobian5d& jacobian);
+
 	TMatrixD getLocalToCurvilinearTransformMatrix(TVector3 globalMomentum, int  planeID, float charge);
 
+	/** As above, filling a fixed-size matrix */
+	void getLocalToCurvilinearTransformMatrix(const TVector3& globalMomentum, int  planeID, float charge, Jacobian5d& jacobian);
+
+	/** Copy of a fixed-size Jacobian into a ROOT matrix of the same dimensions */
+	static void copyJacobian(const Jacobian5d& jacobian, TMatrixD& matrix);
+
 	TMatrix getPropagationJacobianF( float x0, float y0, float z0, float px, float py, float pz, float _beamQ, float dz );
 
 	const TGeoHMatrix* getHMatrix( const double globalPos[] );
@@ -440,6 +474,10 @@ private:
 	void readGear();
 
 	void translateSiPlane2TGeo(TGeoVolume*,int );
+	/** Material map of a plane gap, created with the current binning if needed */
+	EUTelRadLengthMap& getRadLengthMap( int sensorID, int nextSensorID );
+	/** Points of a map line (x,y at the first plane centre z, dx/dz, dy/dz) on both planes */
+	void getRadLengthMapLinePoints( int sensorID, int nextSensorID, const double line[], double globalPosStart[], double globalPosFinish[] );
 };
         
 inline EUTelGeometryTelescopeGeoDescription& gGeometry( gear::GearMgr* _g = marlin::Global::GEAR )
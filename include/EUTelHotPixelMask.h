@@ -0,0 +1,132 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELHOTPIXELMASK_H
+#define EUTELHOTPIXELMASK_H 1
+
+// lcio includes <.h>
+#include <EVENT/LCEvent.h>
+#include <IMPL/TrackerDataImpl.h>
+#include <IMPL/TrackerHitImpl.h>
+
+// system includes <>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace eutelescope {
+
+  //! Bitmap of the hot pixels of all sensors
+  /*! The hot pixels of a sensor are stored as one bit per pixel in the
+   *  bounding box of its hot pixels, rows of 32 bit words along x. A
+   *  pixel lookup is an index calculation, and a cluster is first
+   *  tested against the mask words covering its bounding box, so that
+   *  the pixels of a cluster are only looked at one by one if the box
+   *  contains a hot pixel.
+   *
+   *  There is one mask per hot pixel collection name, shared by all
+   *  processors reading the same collection. update() loads the mask
+   *  from the first event of every run and does nothing for the other
+   *  events, so processors can call it for every event.
+   *
+   *  Only kEUTelGenericSparsePixel data is supported, both for the hot
+   *  pixel collection and for the clusters.
+   *
+   *  Usage:
+   *  <pre>
+   *  EUTelHotPixelMask & mask = EUTelHotPixelMask::getInstance( _hotPixelCollectionName );
+   *  mask.update( event );
+   *  if ( mask.hitTouchesMask( hit ) ) continue;
+   *  </pre>
+   */
+  class EUTelHotPixelMask {
+
+  public:
+
+    //! Mask of the hot pixel collection with the given name
+    static EUTelHotPixelMask & getInstance( const std::string & hotPixelCollectionName );
+
+    EUTelHotPixelMask();
+
+    //! Loads the mask if event belongs to a run not loaded yet
+    /*! @return true if the hot pixel collection was found in the first
+     *  event of the current run
+     */
+    bool update( EVENT::LCEvent * event );
+
+    //! Forgets all hot pixels
+    void clear();
+
+    //! Masks a pixel, the bitmap is rebuilt by the next lookup
+    void addPixel( int sensorID, int x, int y );
+
+    //! Is no pixel masked?
+    bool isEmpty() const { return _nPixels == 0; }
+
+    //! Number of hot pixels of a sensor
+    size_t getNumberOfPixels( int sensorID ) const;
+
+    //! Is the pixel hot?
+    bool isMasked( int sensorID, int x, int y ) const {
+      if ( _dirty ) build();
+      if ( sensorID < 0 || sensorID >= static_cast< int >( _sensors.size() ) ) return false;
+      const SensorMask & sensor = _sensors[ sensorID ];
+      const int ix = x - sensor.x0;
+      const int iy = y - sensor.y0;
+      if ( ix < 0 || ix >= sensor.nX || iy < 0 || iy >= sensor.nY ) return false;
+      return ( sensor.words[ iy * sensor.nWords + ( ix >> 5 ) ] >> ( ix & 31 ) ) & 1u;
+    }
+
+    //! Does a cluster contain a hot pixel?
+    /*! @param zsCluster Zero suppressed data of the cluster with
+     *  kEUTelGenericSparsePixel pixels
+     */
+    bool clusterTouchesMask( int sensorID, const IMPL::TrackerDataImpl * zsCluster ) const;
+
+    //! Does the cluster of a hit contain a hot pixel?
+    /*! Only hits made of kEUTelSparseClusterImpl clusters can be
+     *  tested, false is returned for all other hits.
+     */
+    bool hitTouchesMask( const IMPL::TrackerHitImpl * hit ) const;
+
+  private:
+
+    //! Bitmap of one sensor, bit ix of row iy is pixel ( x0 + ix, y0 + iy )
+    struct SensorMask {
+      int x0;
+      int y0;
+      int nX;
+      int nY;
+      int nWords;
+      std::vector< unsigned int > words;
+    };
+
+    //! Rebuilds the bitmaps from _pixels
+    void build() const;
+
+    //! Is a pixel of row iy between ixMin and ixMax hot?
+    static bool rowTouchesMask( const SensorMask & sensor, int iy, int ixMin, int ixMax );
+
+    //! Hot pixels ( x, y ) of every sensor
+    std::map< int, std::vector< std::pair< int, int > > > _pixels;
+    size_t _nPixels;
+
+    //! Bitmaps indexed by sensor ID, built on the first lookup after a change
+    mutable std::vector< SensorMask > _sensors;
+    mutable bool _dirty;
+
+    //! Run the mask was loaded for, -1 before the first update()
+    int _runNumber;
+    bool _collectionFound;
+
+    std::string _collectionName;
+  };
+
+}
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELLCIOREADAHEAD_H
+#define EUTELLCIOREADAHEAD_H 1
+
+// marlin includes ".h"
+#include "marlin/DataSourceProcessor.h"
+
+// lcio includes <.h>
+#include <lcio.h>
+#include <IO/LCReader.h>
+#include <IO/LCRunListener.h>
+#include <IO/LCEventListener.h>
+#include <IMPL/LCEventImpl.h>
+#include <IMPL/LCRunHeaderImpl.h>
+
+// system includes <>
+#include <string>
+#include <vector>
+
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
+
+namespace eutelescope {
+
+  //! Reads LCIO files on a helper thread ahead of the processors
+  /*! When Marlin reads the LCIO input files itself, every event is
+   *  read, decompressed and unpacked before the processors see it,
+   *  and the processors wait meanwhile. This data source processor
+   *  reads the same files on a helper thread, which works on the next
+   *  ReadAheadDepth records while the processors are busy with the
+   *  current event.
+   *
+   *  The records are passed to the processors in the order of the
+   *  files, run headers included. LCIO deletes an event as soon as
+   *  the next one is read, so the collections of the events read
+   *  ahead are moved to new events with takeEvent and the run headers
+   *  are copied. Existing collections keep their read only access, as
+   *  when Marlin reads the files.
+   *
+   *  As when Marlin reads the files, the first SkipNEvents events are
+   *  skipped, at most MaxRecordNumber records are read, run headers
+   *  included, and the event modifiers are called before the
+   *  processors see an event.
+   *
+   *  Reading ahead needs pthreads and LCIO v02-13 or newer, whose SIO
+   *  layer can be used by the helper thread while the processors write
+   *  LCIO files. Otherwise, or with ReadAheadDepth set to 0, the files
+   *  are read in the processing thread.
+   *
+   *  Make sure not to specify any LCIOInputFiles in the steering.
+   *
+   *  @param InputFiles LCIO files to be read, in this order
+   *  @param ReadAheadDepth Records read ahead by the helper thread, 0 to read in the processing thread
+   */
+  class EUTelLCIOReadAhead : public marlin::DataSourceProcessor {
+
+  public:
+
+    //! Default constructor
+    EUTelLCIOReadAhead();
+
+    //! New processor
+    virtual EUTelLCIOReadAhead * newProcessor();
+
+    //! Reads the files and processes their runs and events
+    virtual void readDataSource( int numEvents );
+
+    virtual void init();
+
+    virtual void end();
+
+  private:
+
+    //! A run header or an event read from the files
+    /*! Only one of the two is set, a record with none marks the end of
+     *  the input.
+     */
+    struct Record {
+      IMPL::LCRunHeaderImpl * runHeader;
+      IMPL::LCEventImpl * event;
+    };
+
+    //! Receives the records from LCReader::readStream
+    /*! The processor itself cannot be the listener, because its
+     *  processEvent is called by the ProcessorMgr for the very events
+     *  it passes on.
+     */
+    class StreamListener : public IO::LCRunListener, public IO::LCEventListener {
+    public:
+      explicit StreamListener( EUTelLCIOReadAhead * reader ) : _reader( reader ) { }
+      virtual void processRunHeader( EVENT::LCRunHeader * run );
+      virtual void modifyRunHeader( EVENT::LCRunHeader * ) { }
+      virtual void processEvent( EVENT::LCEvent * evt );
+      virtual void modifyEvent( EVENT::LCEvent * ) { }
+    private:
+      EUTelLCIOReadAhead * _reader;
+    };
+
+    //! Opens the files and reads them through the listener until the end or a stop
+    void readFiles();
+
+    //! Passes a run header to the processors
+    void deliverRunHeader( EVENT::LCRunHeader * run );
+
+    //! Passes an event to the processors
+    void deliverEvent( EVENT::LCEvent * evt );
+
+    //! Calls the run header modifiers and processors, in the processing thread
+    void passRunHeader( EVENT::LCRunHeader * run );
+
+    //! Calls the event modifiers and processors, in the processing thread
+    void passEvent( EVENT::LCEvent * evt );
+
+#ifdef USE_PTHREAD
+    static void * readerThread( void * processor );
+
+    //! Queues the record, waiting for a free slot. Returns false and keeps the record if reading was stopped
+    bool queueRecord( const Record & record );
+
+    //! Takes the next record, waiting for the helper thread
+    Record nextRecord();
+
+    //! Stops the helper thread and deletes the records it has read
+    void stopReader();
+#endif
+
+    //! Input file names
+    std::vector< std::string > _fileNames;
+
+    //! Records read ahead by the helper thread
+    int _readAheadDepth;
+
+    //! Maximum number of records to be read, run headers included, 0 or less for all
+    int _maxRecords;
+
+    //! Events skipped at the beginning of the input
+    int _skipEvents;
+
+    //! Events passed to the processors
+    int _nEvents;
+
+    //! Error of the helper thread, empty if none
+    std::string _readError;
+
+    //! Warning of the helper thread, empty if none
+    std::string _readWarning;
+
+    //! Is the helper thread reading the files?
+    bool _background;
+
+    //! Records waiting for the processors, used as a ring
+    std::vector< Record > _queue;
+
+#ifdef USE_PTHREAD
+    pthread_t _thread;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _recordQueued;
+    pthread_cond_t _recordTaken;
+    size_t _nQueued;
+    size_t _producerSlot;
+    size_t _consumerSlot;
+    bool _stop;
+#endif
+
+  };
+
+  //! A global instance of the processor
+  EUTelLCIOReadAhead gEUTelLCIOReadAhead;
+
+}
+
+#endif
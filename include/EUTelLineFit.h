@@ -13,6 +13,7 @@
 // built only if GEAR is available
 #ifdef USE_GEAR
 // eutelescope includes ".h"
+#include "EUTelStraightLineFitter.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -211,6 +212,9 @@ namespace eutelescope {
     double * _xFitPos;
     double * _yFitPos;
 
+    //! Straight line fit of the track
+    EUTelStraightLineFitter _lineFitter;
+
     //! Fill histogram switch
     /*! Only for debug reason
      */
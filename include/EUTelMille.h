@@ -14,6 +14,8 @@
 #ifdef USE_GEAR
 // eutelescope includes ".h"
 #include "EUTelUtility.h"
+#include "EUTelStraightLineFitter.h"
+#include "EUTelHotPixelMask.h"
 
 //#include "TrackerHitImpl2.h"
 #include "IMPL/TrackerHitImpl.h"
@@ -246,16 +248,11 @@ namespace eutelescope {
                           double angleFit[2]
                           );
 
+    //! Prepares _lineFitter for nTracksFitter tracks, with the plane resolutions and the excluded planes
+    void setupLineFitter(unsigned int nPlanesFitter, int nTracksFitter, const double xResFitter[], const double yResFitter[]);
 
-    //recursive method which searches for track candidates - with omits!
-    virtual void findtracks2(
-                            int missinghits,
-                            std::vector<IntVec > &indexarray, //resulting vector of hit indizes
-                            IntVec vec, //for internal use
-                            std::vector<std::vector<EUTelMille::HitsInPlane> > &_hitsArray, //contains all hits for each plane
-                            unsigned int i, //plane number
-                            int y //hit index number
-                            );
+    //! Adds chi2 and copies residuals and angles of one track fitted by _lineFitter
+    void getLineFitResult(int track, double chi2Fit[2], double residXFit[], double residYFit[], double angleFit[2]) const;
 
 
     //recursive method which searches for track candidates
@@ -267,6 +264,35 @@ namespace eutelescope {
                             int y //hit index number
                             );
 
+    //! Road search for track candidates - with omits!
+    /*! Depth-first search over the planes, recursing once per plane
+     *  and keeping the hit indices of the current candidate in one
+     *  reused buffer instead of copying them at every level. The
+     *  hits of each plane are sorted in x once per event, so that
+     *  only the hits inside the road [x - ResidualsXMax, x +
+     *  ResidualsXMax] around the previous hit are tested against the
+     *  residual cuts. Candidates which exceed the allowed number of
+     *  missing hits are pruned as soon as the limit is crossed.
+     *
+     *  The candidates come out in the order of the former search over
+     *  all hits, hit index by hit index. That search produced the
+     *  candidate with a missing hit once for every hit failing the
+     *  cuts; it is now produced once, at the place of the first
+     *  failing hit. These duplicates no longer count against
+     *  MaxTrackCandidates, where the search stops, so an event hitting
+     *  the cap can deliver more distinct candidates to Millepede than
+     *  before.
+     *
+     *  @param indexarray resulting vector of hit indices, one entry
+     *  per plane (-1 for a missing hit)
+     *  @param allHitsArray contains all hits for each plane
+     *  @return false if the search was stopped by the candidate cap
+     */
+    bool findTrackCandidates(
+                            std::vector<IntVec > &indexarray,
+                            const std::vector<std::vector<EUTelMille::HitsInPlane> > &allHitsArray
+                            );
+
     //! Returns a new instance of EUTelMille
     /*! This method returns a new instance of this processor.  It is
      *  called by Marlin execution framework and it shouldn't be
@@ -302,9 +328,9 @@ namespace eutelescope {
      */
     virtual void processRunHeader (LCRunHeader * run);
 
-    //! Called for first event per run
-    /*! Reads hotpixel information from hotPixelCollection into hotPixelMap
-     * to be used in the sensor exclusion area logic 
+    //! Called for every event
+    /*! Gets the shared hot pixel mask of hotPixelCollection, which is
+     * loaded from the first event of every run
      */
     virtual void  FillHotPixelMap(LCEvent *event);
 
@@ -389,16 +415,8 @@ namespace eutelescope {
      */
     std::string _hotPixelCollectionName;
 
-    //! Vector of map arrays, keeps record of hit pixels 
-    /*! The vector elements are sorted by Detector ID
-     *  For each Detector unique ID element a map of pixels is created. 
-     *  first level key   sensor unique 
-     *              value sensor map
-     *  sensor map key    unique row number
-     *             value  vector of column numbers.
-     */
-    
-    std::map<std::string, bool > _hotPixelMap;
+    //! Hot pixels of all sensors
+    EUTelHotPixelMask* _hotPixelMask;
 
     //! Sensor ID vector
     IntVec _sensorIDVec;
@@ -500,6 +518,35 @@ namespace eutelescope {
     int _nMilleDataPoints;
     int _nMilleTracks;
 
+    //! Number of events passed through the track candidate search
+    int _nTrackSearchEvents;
+
+    //! Number of events in which MaxTrackCandidates was reached
+    int _nTrackSearchCapReached;
+
+    //! Recursion step of findTrackCandidates on plane @c plane
+    void extendTrackCandidate(
+                            std::vector<IntVec > &indexarray,
+                            const std::vector<std::vector<EUTelMille::HitsInPlane> > &allHitsArray,
+                            unsigned int plane,
+                            int missinghits
+                            );
+
+    //! Residual cut between hits on plane @c e and @c e+1
+    bool passTrackSearchResidualCuts( int e, double residualX, double residualY ) const;
+
+    //! Hit index of the current candidate per plane, reused for all events
+    IntVec _trackSearchIndices;
+
+    //! Hits of each plane as (x, hit index) sorted in x, reused for all events
+    std::vector< std::vector< std::pair< double, int > > > _trackSearchSortedX;
+
+    //! Hit indices continuing the current candidate per plane, reused for all events
+    std::vector< IntVec > _trackSearchAccepted;
+
+    //! Set when the current search reached MaxTrackCandidates
+    bool _trackSearchCapHit;
+
     // Mille
     Mille * _mille;
 
@@ -596,6 +643,9 @@ namespace eutelescope {
 
     DoubleVec _siPlaneZPosition;
 
+    //! Straight line fit of the track candidates of an event
+    EUTelStraightLineFitter _lineFitter;
+
     //! Fill histogram switch
     /*! Only for debug reason
      */
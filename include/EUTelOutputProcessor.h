@@ -20,6 +20,17 @@
 // lcio includes <.h>
 #include <lcio.h>
 #include <IO/LCWriter.h>
+#include <IMPL/LCEventImpl.h>
+#include <IMPL/LCRunHeaderImpl.h>
+
+// system includes <>
+#include <string>
+#include <vector>
+#include <utility>
+
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
 
 
 namespace eutelescope {
@@ -64,12 +75,41 @@ namespace eutelescope {
    *  file will allow to remove all the intermediate EORE and leaving
    *  only the last one.
    *
+   *  Serialising and compressing the events is the most expensive
+   *  part of writing them. If Eutelescope was built with pthreads and
+   *  a thread safe LCIO (v02-13 or newer) and WriterQueueDepth is
+   *  larger than 0, this is done by a background writer thread and
+   *  processEvent returns as soon as the event is queued. The event
+   *  itself is deleted by Marlin when the next one is read, so its
+   *  collections are moved to a new event with takeEventCopy, which
+   *  is queued instead and deleted after it has been written. The
+   *  collections the event does not own, like pedestal, noise and
+   *  status or the conditions, keep changing in the processing
+   *  thread and are copied; an event with such a collection of a
+   *  type that cannot be copied is written in the processing thread
+   *  once the queue is empty. At most WriterQueueDepth events wait
+   *  for the writer. The writer thread does not log, its messages
+   *  and errors are logged by the processing thread with the next
+   *  record.
+   *  Run headers go through the same queue, so records are written in
+   *  the order they were processed.
+   *
+   *  The output can be split in files of SplitEventCount events. The
+   *  first file has the name given in LCIOOutputFile, the following
+   *  ones get the suffix _001, _002 and so on before the
+   *  extension. Each file ends with an EORE and each new file starts
+   *  with a copy of the current run header, so every file can be
+   *  analysed on its own. An EORE is always written to the current
+   *  file, even if it is full.
+   *
    *  @see marlin::LCIOOutputProcessor
    *  @see eutelescope::EventType
    *  @see eutelescope::EUTelEventImpl
    *
    *  @param All parameters available in LCIOOutputProcessir
    *  @param SkipIntermediateEORE Remove EORE in between following runs.
+   *  @param WriterQueueDepth Events buffered for the background writer, 0 to write in the processing thread.
+   *  @param SplitEventCount Maximum number of events per output file, 0 not to split.
    *
    *
    *  @author Antonio Bulgheroni, INFN <mailto:antonio.bulgheroni@gmail.com>
@@ -124,6 +164,89 @@ namespace eutelescope {
      */
     virtual void end() ;
 
+  private:
+
+    //! A run header or an event waiting to be written
+    struct Record {
+      IMPL::LCRunHeaderImpl * runHeader;
+      IMPL::LCEventImpl * event;
+    };
+
+    //! Writes a run header in the writing thread
+    void writeRunHeader( LCRunHeader * run );
+
+    //! Writes an event in the writing thread, opening a new file if the current one is full
+    void writeEvent( LCEvent * evt );
+
+    //! Appends an EORE to the current file
+    void writeEORE();
+
+    //! Closes the current file and opens the next one of the split output
+    void openNextFile();
+
+    //! Writes and deletes the record
+    void writeRecord( Record & record );
+
+    //! Logs a message or an error of the writing
+    /*! Called from the writer thread, the text is kept for
+     *  logWriterReports instead.
+     */
+    void report( bool isError, const std::string & text );
+
+    //! Logs the messages and errors the writer thread left, in the processing thread
+    void logWriterReports();
+
+#ifdef USE_PTHREAD
+    static void * writerThread( void * processor );
+    void writeQueue();
+
+    //! Queues the record, waiting for a free slot
+    void queueRecord( const Record & record );
+
+    //! Waits until the writer thread has written all queued records
+    void waitForWriter();
+#endif
+
+    //! Events buffered for the background writer
+    int _writerQueueDepth;
+
+    //! Maximum number of events per output file
+    int _splitEventCount;
+
+    //! Events written to the current file
+    int _nEventInFile;
+
+    //! Number of the current file of the split output
+    int _nFile;
+
+    //! Type of the last event written to the current file
+    EventType _lastWrittenType;
+
+    //! Copy of the last run header, written at the beginning of every new file
+    IMPL::LCRunHeaderImpl * _lastRunHeader;
+
+    //! Records the writer thread failed to write
+    int _nWriteErrors;
+
+    bool _background;
+
+    //! Records waiting for the writer thread, used as a ring
+    std::vector< Record > _queue;
+
+    //! Messages of the writer thread not logged yet, true for errors
+    std::vector< std::pair< bool, std::string > > _writerReports;
+
+#ifdef USE_PTHREAD
+    pthread_t _thread;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _recordQueued;
+    pthread_cond_t _recordWritten;
+    size_t _nQueued;
+    size_t _producerSlot;
+    size_t _consumerSlot;
+    bool _stop;
+#endif
+
 
   protected:
     
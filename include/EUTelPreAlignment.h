@@ -15,6 +15,7 @@
 // eutelescope includes ".h"
 //#include "TrackerHitImpl2.h"
 #include "EUTelReferenceHit.h"
+#include "EUTelHotPixelMask.h"
 
 //ROOT includes
 #include "TVector3.h"
@@ -134,12 +135,19 @@ namespace eutelescope {
     virtual void end();
     virtual bool hitContainsHotPixels( TrackerHitImpl   * hit) ;
 
-    //! Called for first event per run
-    /*! Reads hotpixel information from hotPixelCollection into hotPixelMap
-     * to be used in the sensor exclusion area logic 
+    //! Called for every event
+    /*! Gets the shared hot pixel mask of hotPixelCollection, which is
+     * loaded from the first event of every run
      */
     virtual void  FillHotPixelMap(LCEvent *event);
 
+  protected:
+    //! Decodes sensor ID, position and hot pixel status of all hits once per event
+    /*! Hits of the fixed plane go to _refHitX/Y, the hits of the other
+     *  planes are grouped by prealigner into _preAlignerHitX/Y.
+     */
+    void prepareHits( LCCollectionVec * inputCollectionVec );
+
   private:
     //! Hot pixel collection name.
     /*! 
@@ -154,14 +162,10 @@ namespace eutelescope {
     bool             _useReferenceHitCollection;
     LCCollectionVec* _referenceHitVec;    
     
-    //! map of vectors, keeps record of hit pixels 
-    /*! 
-     *  For each Detector a vector is stored in a map.
-     *  Each vector holds pairs of integers (representing X and Y pixel array positions).
-     *  If an element (i.e. the X and Y position of a pixel) is present in the vector,
-     *  this indicates that the corresponding pixel was marked "hot"
+    //! Hot pixels of all sensors
+    /*! Hits with a hot pixel are not used for the correlations
      */
-    std::map<int, std::vector<std::pair<short, short> > > _hotPixelMap;
+    EUTelHotPixelMask* _hotPixelMask;
  
     //! How many events are needed to get reasonable correlation plots 
     /*! (and Offset DB values) 
@@ -220,6 +224,44 @@ namespace eutelescope {
     std::map<unsigned int, AIDA::IBaseHistogram * > _hitYCorr;
 #endif
 
+    //! Index in _preAligners of every sensor ID except the fixed plane
+    std::map< int, int > _sensorIDToPreAligner;
+
+    //! Correlation band of every prealigner, from the cuts of its position along Z
+    std::vector< float > _preAlignerXMin;
+    std::vector< float > _preAlignerXMax;
+    std::vector< float > _preAlignerYMin;
+    std::vector< float > _preAlignerYMax;
+
+#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA) 
+    //! Correlation histograms of every prealigner
+    std::vector< AIDA::IHistogram1D * > _preAlignerXCorr;
+    std::vector< AIDA::IHistogram1D * > _preAlignerYCorr;
+#endif
+
+    //! Hit positions in the fixed plane of the current event
+    std::vector< double > _refHitX;
+    std::vector< double > _refHitY;
+
+    //! Hits of the other planes in collection order, with the index of their prealigner
+    std::vector< int > _hitPreAligner;
+    std::vector< double > _hitX;
+    std::vector< double > _hitY;
+
+    //! Hits of the other planes grouped by prealigner
+    /*! The hits of _preAligners[i] are from _preAlignerHitStart[i] up
+     *  to _preAlignerHitStart[i+1]
+     */
+    std::vector< int > _preAlignerHitStart;
+    std::vector< int > _preAlignerHitFill;
+    std::vector< double > _preAlignerHitX;
+    std::vector< double > _preAlignerHitY;
+
+    //! Correlations of one hit in the fixed plane inside the correlation bands
+    std::vector< float > _correlationX;
+    std::vector< float > _correlationY;
+    std::vector< int > _correlationPreAligner;
+
 
 
   protected:
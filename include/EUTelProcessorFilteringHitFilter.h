@@ -7,6 +7,8 @@
 
 #include "marlin/Processor.h"
 
+#include "EUTelHotPixelMask.h"
+
 #include "IMPL/TrackerHitImpl.h"
 #include <IMPL/LCCollectionVec.h>
 #include <IMPL/TrackImpl.h>
@@ -63,7 +65,7 @@ namespace eutelescope {
         int _nProcessedEvents;
 
         // treat hits with hotpixels
-        std::map<std::string, bool > _hotPixelMap;
+        EUTelHotPixelMask* _hotPixelMask;
  
     };
 
@@ -121,6 +121,50 @@ namespace eutelescope {
 
 			/** Track fitter */
 			EUTelGBLFitter *_trackFitter;
+
+			/** Use the interpolated material maps of the plane gaps for the scatterers */
+			bool _useRadLengthMap;
+
+			/** Material map binning: position bin [mm], maximum slope, number of slope bins */
+			float _radLengthMapPositionStep;
+			float _radLengthMapMaxSlope;
+			int _radLengthMapSlopeBins;
+
+			/** Number of random lines per plane gap to check the material maps against the exact integral */
+			int _radLengthMapCheckSamples;
+
+			/** Number of threads fitting the tracks of one event (needs OpenMP) */
+			int _nFitThreads;
+
+			/** One track fitter per fitting thread; _trackFitter is the first one */
+			std::vector< EUTelGBLFitter* > _trackFitters;
+
+			/** GBL point list of each fitting thread, reused for all tracks: cleared per track, capacity kept */
+			std::vector< std::vector< gbl::GblPoint > > _pointLists;
+
+			/** CPU time spent in track fits [s], summed over threads */
+			double _fitTime;
+
+			/** Number of tracks given to the fit */
+			int _nFittedTracks;
+
+			/** Result of the fit of one track. Filled by the fitting threads and
+			 *  used afterwards, in the original track order, for histograms and output.
+			 */
+			struct TrackFitResult {
+				TrackFitResult() : ierr(-1), chi2(0.), ndf(0), residual(), residualError(), error() {}
+				int ierr;
+				double chi2;
+				int ndf;
+				map< int, map< float, float > > residual;
+				map< int, map< float, float > > residualError;
+				/** Message of an exception thrown during the fit, empty if none */
+				std::string error;
+			};
+
+			/** Fit one track with the given fitter and point list; never throws */
+			void fitTrack(EUTelGBLFitter* fitter, std::vector< gbl::GblPoint >& pointList, EUTelTrack& track, bool curved, TrackFitResult& result);
+
 			//Function defined now for the processor////////////////////////////
 			void outputLCIO(LCEvent* evt, std::vector< EUTelTrack >& tracks);
 
@@ -13,6 +13,7 @@
 #ifdef USE_GEAR
 // eutelescope includes ".h"
 #include "EUTelUtility.h"
+#include "EUTelEtaTable.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -199,8 +200,14 @@ namespace eutelescope {
    *  @param EtaCollectionName A vector of strings with the name of
    *  the eta collection along x and y.
    *
+   *  @param Eta2DCollectionName Name of a collection of 2D Eta maps
+   *  as written by EUTelCalculateEtaProcessor. If set, the maps are
+   *  used instead of the functions along x and y.
+   *
    *  @param EtaSwitch A boolean to switch on and off the eta
-   *  corrections.
+   *  corrections. The Eta functions correct the CoG shift with
+   *  respect to the seed pixel of the full cluster, so they have to
+   *  be calculated with the "Full" cluster type selection.
    *
    *  @param CoGAlgorithm The center of gravity is calculated always
    *  using the same algorithm but different results can be obtained
@@ -347,6 +354,15 @@ namespace eutelescope {
     //! Reference Hit file 
     std::string _referenceHitLCIOFile;
 
+    //! Eta correction switch
+    bool _etaCorrection;
+
+    //! Names of the Eta function collections along x and y
+    std::vector< std::string > _etaCollectionNames;
+
+    //! Name of the 2D Eta map collection, empty to use the functions along x and y
+    std::string _eta2DCollectionName;
+
 
   private:
 
@@ -446,6 +462,31 @@ namespace eutelescope {
 
    
     void DumpReferenceHitDB();
+
+    //! Builds the Eta tables from the condition collections
+    /*! The tables are rebuilt only when the conditions processor
+     *  attached a different collection to the event or a new run
+     *  started.
+     */
+    void loadEtaTables( LCEvent * event );
+
+    //! Applies the Eta correction to the CoG of a cluster
+    /*! The CoG shift with respect to the seed pixel is replaced by
+     *  its Eta value. The CoG is left untouched for sensors without
+     *  an Eta function.
+     */
+    void applyEta( int sensorID, int xSeed, int ySeed, float & xCoG, float & yCoG );
+
+    //! Eta tables keyed by sensor ID
+    std::map< int, EUTelEtaTable > _etaXTables;
+    std::map< int, EUTelEtaTable > _etaYTables;
+    std::map< int, EUTelEtaTable2D > _eta2DTables;
+
+    //! Condition collections the tables were built from
+    std::vector< const LCCollection * > _etaCollections;
+
+    //! Sensors already reported without Eta function
+    std::set< int > _noEtaSensorID;
  
   };
 
@@ -12,6 +12,7 @@
 // eutelescope includes ".h"
 #include "EUTelEventImpl.h"
 #include "EUTelGenericSparsePixel.h"
+#include "EUTelHotPixelMask.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -101,12 +102,6 @@ class EUTelProcessorNoisyClusterMasker : public marlin::Processor {
 
   protected:
 
-	void readHotPixelList (LCEvent * event); 
-
-	//! Encoding function to encode the two pixel indices in a unique way
-	/*! Uses Cantor's pairing function */ 
-	inline int encode (int X, int Y); 
-
 	//! Input collection name for data	
 	std::string _inputCollectionName;
 
@@ -143,8 +138,8 @@ class EUTelProcessorNoisyClusterMasker : public marlin::Processor {
 	/*! False is everything is OK, true otherwise */
 	bool  _wrongDataFormat;
 
-	//! Map linking the noise vectors of each plane to the plane ID
-	std::map<int, std::vector<int> > _hotPixelMap;
+	//! Hot pixels of all planes, shared with the other processors
+	EUTelHotPixelMask* _hotPixelMask;
 
 	//! Map counting the removed hot pixels per plane
 	std::map<int, int> _maskedNoisyClusters;
@@ -65,6 +65,11 @@ struct sensor {
  *  @param ExcludedPlanes Planes to be excluded from processing
  *
  *  @param HotPixelCollectionName The name of the collection in the output file
+ *
+ *  @param HitCountFile Name of an LCIO file with the hit count of every
+ *  pixel, written at the end. Hit counts of jobs processing parts of
+ *  the same run are merged into one hot pixel DB by the hotpixelmerge
+ *  tool.
  */
 class EUTelProcessorNoisyPixelFinder : public marlin::Processor {
 
@@ -227,6 +232,18 @@ protected:
     //! write out the list of hot pixels
     void HotPixelDBWriter();
 
+    //! write out the hit count of every pixel
+    void HitCountWriter();
+
+    //! Hit count output file, empty not to write one
+    std::string _hitCountFile;
+
+    //! Name of the hit count collection in the hit count file
+    std::string _hitCountCollectionName;
+
+    //! Number of events whose hits were counted
+    int _nCountedEvents;
+
     //! Flag which will be set once we're done finding noisy pixels
     bool _finished;
 };
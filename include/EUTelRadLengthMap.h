@@ -0,0 +1,126 @@
+/*
+ * File:   EUTelRadLengthMap.h
+ *
+ * Material map of the gap between two sensor planes
+ */
+#ifndef EUTELRADLENGTHMAP_H
+#define	EUTELRADLENGTHMAP_H
+
+// C++
+#include <vector>
+#include <cmath>
+
+namespace eutelescope {
+namespace geo{
+
+/** @class EUTelRadLengthMap
+ * Radiation length integrals along straight lines crossing the gap
+ * between two planes. A line is described by its position (x,y) in the
+ * plane z = z0 of the first sensor centre and by its slopes dx/dz and
+ * dy/dz. The integrals are kept on a regular grid in these four
+ * variables and interpolated linearly in each of them.
+ *
+ * The map does not know the geometry: the owner computes the integral
+ * of a grid node (see getNodeLine) the first time the node is needed
+ * and stores it with setNodeValue. So only the part of the map crossed
+ * by tracks is ever computed.
+ */
+class EUTelRadLengthMap
+{
+  public:
+	/** Number of line parameters: x, y, dx/dz, dy/dz */
+	static const int nDim = 4;
+	/** Number of grid nodes used for one interpolation */
+	static const int nCorners = 16;
+
+	EUTelRadLengthMap() : _values(), _filled(), _nFilled(0) {
+		for( int i = 0; i < nDim; ++i ) { _minimum[i] = 0.; _step[i] = 1.; _nBins[i] = 0; _stride[i] = 0; }
+	}
+
+	/** Set the range and number of bins of the four line parameters, removes all values */
+	void setBinning( const double minimum[nDim], const double maximum[nDim], const int nBins[nDim] ) {
+		int nNodes = 1;
+		for( int i = 0; i < nDim; ++i ) {
+			_nBins[i] = nBins[i] > 0 ? nBins[i] : 1;
+			_minimum[i] = minimum[i];
+			_step[i] = ( maximum[i] - minimum[i] ) / _nBins[i];
+			_stride[i] = nNodes;
+			nNodes *= _nBins[i] + 1;
+		}
+		_values.assign( nNodes, 0. );
+		_filled.assign( nNodes, 0 );
+		_nFilled = 0;
+	}
+
+	/** Is the line inside the range of the map? */
+	bool contains( const double line[nDim] ) const {
+		if( _values.empty() ) return false;
+		for( int i = 0; i < nDim; ++i ) {
+			const double u = ( line[i] - _minimum[i] ) / _step[i];
+			if( !( u >= 0. && u <= _nBins[i] ) ) return false;
+		}
+		return true;
+	}
+
+	/** Grid nodes surrounding the line and their interpolation weights. The line must be inside the map. */
+	void getCorners( const double line[nDim], int nodes[nCorners], double weights[nCorners] ) const {
+		int lower[nDim];
+		double fraction[nDim];
+		for( int i = 0; i < nDim; ++i ) {
+			const double u = ( line[i] - _minimum[i] ) / _step[i];
+			lower[i] = static_cast< int >( std::floor( u ) );
+			if( lower[i] >= _nBins[i] ) lower[i] = _nBins[i] - 1;
+			if( lower[i] < 0 ) lower[i] = 0;
+			fraction[i] = u - lower[i];
+		}
+		for( int corner = 0; corner < nCorners; ++corner ) {
+			int node = 0;
+			double weight = 1.;
+			for( int i = 0; i < nDim; ++i ) {
+				const bool upper = ( corner >> i ) & 1;
+				node += ( lower[i] + ( upper ? 1 : 0 ) ) * _stride[i];
+				weight *= upper ? fraction[i] : 1. - fraction[i];
+			}
+			nodes[corner] = node;
+			weights[corner] = weight;
+		}
+	}
+
+	/** Line parameters of a grid node */
+	void getNodeLine( int node, double line[nDim] ) const {
+		for( int i = nDim - 1; i >= 0; --i ) {
+			line[i] = _minimum[i] + ( node / _stride[i] ) * _step[i];
+			node %= _stride[i];
+		}
+	}
+
+	bool isNodeFilled( int node ) const { return _filled[node] != 0; }
+
+	float getNodeValue( int node ) const { return _values[node]; }
+
+	void setNodeValue( int node, float value ) {
+		if( !_filled[node] ) { _filled[node] = 1; ++_nFilled; }
+		_values[node] = value;
+	}
+
+	/** Number of grid nodes */
+	int getNumberOfNodes() const { return static_cast< int >( _values.size() ); }
+
+	/** Number of grid nodes already computed */
+	int getNumberOfFilledNodes() const { return _nFilled; }
+
+  private:
+	double _minimum[nDim];
+	double _step[nDim];
+	int _nBins[nDim];
+	/** Index distance of neighbouring nodes along each parameter */
+	int _stride[nDim];
+	std::vector< float > _values;
+	std::vector< unsigned char > _filled;
+	int _nFilled;
+};
+
+} // namespace geo
+} // namespace eutelescope
+
+#endif	/* EUTELRADLENGTHMAP_H */
@@ -0,0 +1,219 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELROOTTUPLEWRITER_H
+#define EUTELROOTTUPLEWRITER_H 1
+
+#if defined(USE_ROOT) || defined(MARLIN_USE_ROOT)
+
+// ROOT includes
+#include <Rtypes.h>
+
+// system includes <>
+#include <string>
+#include <vector>
+
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
+
+class TFile;
+class TTree;
+
+namespace eutelescope {
+
+  //! Writes n-tuples as ROOT trees with one branch per column
+  /*! The branches are bound once to buffers owned by the writer, so
+   *  filling a row does not allocate: scalar columns are plain values,
+   *  vector columns keep their capacity from row to row and can be
+   *  reserved when the column is added. Basket size, cluster size
+   *  (auto flush) and compression level of the file are set by open().
+   *
+   *  One row spans all the trees of the writer: fill() adds one entry
+   *  to every tree, so the trees can be used as friends.
+   *
+   *  If Eutelescope was built with pthreads and ROOT 6, trees can be
+   *  filled by a background thread: fill() then hands the row over to
+   *  the writer thread and the processor continues with the next event
+   *  while the baskets are compressed and written. At most QueueDepth
+   *  rows wait for the writer. All ROOT calls on the file and the trees
+   *  happen in the writer thread from book() until finish() returns,
+   *  so friends of the trees are set with addFriend() before book().
+   *  ROOT thread safety is switched on by open(), before the file is
+   *  created.
+   *
+   *  Usage:
+   *  <pre>
+   *  writer.open( fileName, compressionLevel, basketSize, autoFlush, queueDepth );
+   *  int tree = writer.addTree( "tracks", "tracks" );
+   *  int chi2 = writer.addColumn( tree, "chi2", EUTelRootTupleWriter::kDoubleVector, 10 );
+   *  writer.addFriend( tree, otherTree );
+   *  writer.book();
+   *  // for every event
+   *  writer.clearRow();
+   *  writer.push_back( chi2, value );
+   *  writer.fill();
+   *  // at the end
+   *  writer.close();
+   *  </pre>
+   */
+  class EUTelRootTupleWriter {
+
+  public:
+
+    enum ColumnType { kInt, kLong, kFloat, kDouble, kIntVector, kDoubleVector };
+
+    EUTelRootTupleWriter();
+
+    //! Closes the file if still open
+    ~EUTelRootTupleWriter();
+
+    //! Creates the output file
+    /*! @param compressionLevel ROOT compression level of the file, -1 for the ROOT default
+     *  @param basketSize Basket size in bytes of all branches, 0 for the ROOT default
+     *  @param autoFlush Cluster size of the trees, see TTree::SetAutoFlush, 0 for the ROOT default
+     *  @param queueDepth Rows buffered for the background writer, 0 to fill the trees in the calling thread
+     */
+    void open( const std::string & fileName, int compressionLevel, int basketSize, Long64_t autoFlush, int queueDepth );
+
+    //! Adds a tree, returns its index
+    int addTree( const std::string & name, const std::string & title );
+
+    //! Adds a column to a tree before book(), returns its index
+    /*! @param reserve Preallocated number of elements of a vector column
+     */
+    int addColumn( int tree, const std::string & name, ColumnType type, size_t reserve = 0 );
+
+    //! Makes friendTree a friend of tree, before book()
+    void addFriend( int tree, int friendTree );
+
+    //! Creates the branches and starts the writer thread
+    void book();
+
+    //! Tree, not to be used between book() and finish() if there is a writer thread
+    TTree * getTree( int tree ) const { return _trees[tree]; }
+
+    TFile * getFile() const { return _file; }
+
+    //! Is a background thread writing the trees?
+    bool isBackground() const { return _background; }
+
+    //! Sets a scalar column of the current row
+    template < class T > void set( int column, T value ) {
+      const Column & c = _columns[column];
+      switch ( c.type ) {
+      case kInt:    _row->ints[c.slot]    = static_cast< Int_t >( value ); break;
+      case kLong:   _row->longs[c.slot]   = static_cast< Long64_t >( value ); break;
+      case kFloat:  _row->floats[c.slot]  = static_cast< Float_t >( value ); break;
+      case kDouble: _row->doubles[c.slot] = static_cast< Double_t >( value ); break;
+      default: break;
+      }
+    }
+
+    //! Appends to a vector column of the current row
+    template < class T > void push_back( int column, T value ) {
+      const Column & c = _columns[column];
+      if ( c.type == kIntVector ) _row->intVectors[c.slot].push_back( static_cast< Int_t >( value ) );
+      else if ( c.type == kDoubleVector ) _row->doubleVectors[c.slot].push_back( static_cast< Double_t >( value ) );
+    }
+
+    //! Empties the vector columns of the current row, their memory is kept
+    void clearRow();
+
+    //! Adds the current row to all trees and starts a new, empty row
+    void fill();
+
+    //! Waits until all rows are in the trees and stops the writer thread
+    void finish();
+
+    //! Finishes, writes the trees and closes the file
+    void close();
+
+    //! Number of rows passed to fill()
+    Long64_t getNumberOfRows() const { return _nRows; }
+
+  private:
+
+    struct Column {
+      int tree;
+      std::string name;
+      ColumnType type;
+      size_t slot;
+      size_t reserve;
+    };
+
+    //! Values of one row, one entry per column of the type
+    struct Row {
+      std::vector< Int_t > ints;
+      std::vector< Long64_t > longs;
+      std::vector< Float_t > floats;
+      std::vector< Double_t > doubles;
+      std::vector< std::vector< Int_t > > intVectors;
+      std::vector< std::vector< Double_t > > doubleVectors;
+    };
+
+    //! Makes row the next entry of the trees, leaves row with empty vectors
+    void fillTrees( Row & row );
+
+    void allocate( Row & row ) const;
+
+#ifdef USE_PTHREAD
+    static void * writerThread( void * writer );
+    void writeQueue();
+#endif
+
+    TFile * _file;
+    std::vector< TTree * > _trees;
+    std::vector< Column > _columns;
+
+    //! Number of columns of each type
+    size_t _nSlots[6];
+
+    int _basketSize;
+    Long64_t _autoFlush;
+
+    //! Buffers the branches are bound to
+    Row _treeRow;
+
+    //! Addresses of the vector buffers, the branches keep pointers to them
+    std::vector< std::vector< Int_t > * > _intVectorAddresses;
+    std::vector< std::vector< Double_t > * > _doubleVectorAddresses;
+
+    //! Row being filled by the processor
+    Row * _row;
+
+    bool _booked;
+    bool _background;
+    Long64_t _nRows;
+    Long64_t _nFillErrors;
+
+    //! Rows waiting for the writer thread, used as a ring
+    std::vector< Row > _queue;
+    size_t _queueDepth;
+
+#ifdef USE_PTHREAD
+    pthread_t _thread;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _rowQueued;
+    pthread_cond_t _rowWritten;
+    size_t _nQueued;
+    size_t _producerSlot;
+    size_t _consumerSlot;
+    bool _stop;
+#endif
+
+    //! Not copyable
+    EUTelRootTupleWriter( const EUTelRootTupleWriter & );
+    EUTelRootTupleWriter & operator=( const EUTelRootTupleWriter & );
+  };
+
+}
+
+#endif // USE_ROOT || MARLIN_USE_ROOT
+
+#endif
@@ -11,6 +11,8 @@
 #include "TMatrixDSym.h"
 #endif
 //lcio
+#include "EVENT/Track.h"
+#include "EVENT/TrackerHit.h"
 #include "IMPL/TrackImpl.h"
 #include "EUTelGeometryTelescopeGeoDescription.h"
 
@@ -21,31 +23,36 @@ using namespace std;
 
 namespace eutelescope {
 
-	class  EUTelState : public IMPL::TrackImpl{
+	//State of a track on one plane. The state is a plain value: a track keeps its states in a vector and copies them with it.
+	//LCIO tracks are only used to store states in files. See EUTelState(const EVENT::Track*) and createLCIOTrack() for the mapping of the members onto the TrackImpl fields.
+	class  EUTelState {
 		public: 
 			EUTelState();
-			EUTelState(EUTelState *state);
+			//Read a state stored as LCIO track
+			explicit EUTelState(const EVENT::Track* lcioState);
 			//getters
-			EVENT::TrackerHit* getHit();
-			int getDimensionSize() const ;
-			int	getLocation() const;
-			TMatrixDSym getStateCov() const;
+			EVENT::TrackerHit* getHit() const { return _hit; }
+			int getDimensionSize() const { return _dimension; }
+			int	getLocation() const { return _location; }
 			TVectorD getStateVec() const ;
-			inline float  getBeamCharge() const  { return getdEdxError();}
-			inline float  getBeamEnergy() const {return getdEdx();}
-			float getIntersectionLocalXZ() const {return getPhi();}
-			float getIntersectionLocalYZ() const {return getTanLambda();}
-			float getArcLengthToNextState() const {return getChi2();} 
-			float* getPosition() const; 
+			inline float  getBeamCharge() const  { return _beamCharge;}
+			inline float  getBeamEnergy() const {return _beamEnergy;}
+			float getIntersectionLocalXZ() const {return _intersectionLocalXZ;}
+			float getIntersectionLocalYZ() const {return _intersectionLocalYZ;}
+			float getArcLengthToNextState() const {return _arcLengthToNextState;} 
+			float getOmega() const { return _omega; }
+			float* getPosition() { return _position; }
+			const float* getPosition() const { return _position; }
 			TVector3 getPositionGlobal() const; 
 			void getCombinedHitAndStateCovMatrixInLocalFrame(double (&cov)[4]) const;
-			bool getIsThereAHit() const;
+			bool getIsThereAHit() const { return _hit != NULL; }
 			TMatrixD getProjectionMatrix() const;
 			TVector3 getIncidenceUnitMomentumVectorInLocalFrame();
 			TMatrixDSym getScatteringVarianceInLocalFrame();
 			TMatrixDSym getScatteringVarianceInLocalFrame(float percentageRadiationLength);
-			TVectorD getKinks();
+			TVectorD getKinks() const;
 			//setters
+			void setHit(EVENT::TrackerHit* hit) { _hit = hit; }
 			void setDimensionSize(int dimension);
 			void setLocation(int location);
 			void setBeamEnergy(float beamE);
@@ -53,11 +60,12 @@ namespace eutelescope {
 			void setIntersectionLocalYZ(float directionYZ);
 			void setIntersectionLocalXZ(float directionXZ);
 			void setLocalXZAndYZIntersectionAndCurvatureUsingGlobalMomentum(TVector3 momentumIn);
+			void setOmega(float omega) { _omega = omega; }
 			void setPositionLocal(float position[]);
 			void setPositionGlobal(float positionGlobal[]);
 			void setCombinedHitAndStateCovMatrixInLocalFrame(double cov[4]);
 			void setStateVec(TVectorD stateVec);
-			void setArcLengthToNextState(float arcLength){setChi2(arcLength);} 
+			void setArcLengthToNextState(float arcLength){ _arcLengthToNextState = arcLength; } 
 			void setKinks(TVectorD kinks);
 			//initialise
 			void initialiseCurvature();
@@ -66,13 +74,31 @@ namespace eutelescope {
 			//compute
 			TVector3 computeCartesianMomentum() const ;
 			TMatrix computePropagationJacobianFromLocalStateToNextLocalState(TVector3 positionEnd, TVector3 momentumEnd, float arcLength,float nextPlaneID);
+			//Store the state as LCIO track. The caller owns the returned object.
+			IMPL::TrackImpl* createLCIOTrack() const;
 			//print
-			void print();
-			bool operator<(const EUTelState compareState ) const;
-			bool operator==(const EUTelState compareState ) const;
+			void print() const;
+			bool operator<(const EUTelState& compareState ) const;
+			bool operator==(const EUTelState& compareState ) const;
 
   	private:
+			int _location;
+			int _dimension;
+			//Local position, z included
+			float _position[3];
+			//dx/dz and dy/dz in the local frame
+			float _intersectionLocalXZ;
+			float _intersectionLocalYZ;
+			//Curvature: charge/energy
+			float _omega;
+			float _beamEnergy;
+			float _beamCharge;
+			float _arcLengthToNextState;
+			float _kinks[2];
 			float _covCombinedMatrix[4];
+			//Hit of the event hit collection on this plane, NULL if there is none. Not owned: the state is only valid as long as
+			//the event (or other owner) of the hit exists. States, and tracks holding them, must not be kept across events.
+			EVENT::TrackerHit* _hit;
 	};
 
 }
@@ -0,0 +1,112 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+#ifndef EUTELSTRAIGHTLINEFITTER_H
+#define EUTELSTRAIGHTLINEFITTER_H 1
+
+// system includes <>
+#include <vector>
+
+namespace eutelescope {
+
+  //! Weighted straight line fit of many tracks at once
+  /*! Fits x(z) = x0 + tx * z and y(z) = y0 + ty * z independently for
+   *  a batch of track candidates crossing the same planes (see Blobel,
+   *  page 162). The resolution of a plane is the same for all tracks;
+   *  an excluded plane gets weight zero, so it does not enter the fit
+   *  but still gets a residual.
+   *
+   *  Hits are stored plane by plane, with the tracks of the batch next
+   *  to each other, so that every step of the fit is a loop over tracks
+   *  on contiguous memory which the compiler can vectorize. The buffers
+   *  are kept between batches: once the largest batch has been seen no
+   *  more memory is allocated.
+   *
+   *  Usage:
+   *  <pre>
+   *  fitter.reset( nPlanes, nTracks );
+   *  fitter.setPlaneResolution( plane, resolX, resolY );   // every plane
+   *  fitter.excludePlane( plane );                         // after the resolutions
+   *  fitter.setHit( track, plane, x, y, z );                // every hit
+   *  fitter.fit();
+   *  fitter.getChi2X( track ); fitter.getResidualX( track, plane ); ...
+   *  </pre>
+   *  Residuals are fit minus measurement, as in EUTelMille.
+   */
+  class EUTelStraightLineFitter {
+
+  public:
+
+    EUTelStraightLineFitter();
+
+    //! Starts a new batch, hits and exclusions of the previous batch are forgotten
+    void reset( int nPlanes, int nTracks );
+
+    //! Resolution of a plane, for all tracks of the batch
+    void setPlaneResolution( int plane, double resolX, double resolY );
+
+    //! Removes a plane from the fit
+    void excludePlane( int plane );
+
+    void setHit( int track, int plane, double x, double y, double z ) {
+      const int i = plane * _nTracks + track;
+      _x[i] = x;
+      _y[i] = y;
+      _z[i] = z;
+    }
+
+    //! Fits all tracks of the batch
+    void fit();
+
+    int getNumberOfPlanes() const { return _nPlanes; }
+    int getNumberOfTracks() const { return _nTracks; }
+
+    double getChi2X( int track ) const { return _chi2X[track]; }
+    double getChi2Y( int track ) const { return _chi2Y[track]; }
+    double getSlopeX( int track ) const { return _slopeX[track]; }
+    double getSlopeY( int track ) const { return _slopeY[track]; }
+    //! Fitted position at z = 0
+    double getInterceptX( int track ) const { return _meanX[track] - _slopeX[track] * _meanZX[track]; }
+    double getInterceptY( int track ) const { return _meanY[track] - _slopeY[track] * _meanZY[track]; }
+    double getResidualX( int track, int plane ) const { return _residX[ plane * _nTracks + track ]; }
+    double getResidualY( int track, int plane ) const { return _residY[ plane * _nTracks + track ]; }
+
+  private:
+
+    int _nPlanes;
+    int _nTracks;
+
+    //! Weights 1/sigma^2 of the planes, 0 for excluded planes
+    std::vector< double > _weightX;
+    std::vector< double > _weightY;
+
+    //! Hits and residuals, index plane * _nTracks + track
+    std::vector< double > _x;
+    std::vector< double > _y;
+    std::vector< double > _z;
+    std::vector< double > _residX;
+    std::vector< double > _residY;
+
+    //! Per track results and weighted means
+    std::vector< double > _meanZX;
+    std::vector< double > _meanZY;
+    std::vector< double > _meanX;
+    std::vector< double > _meanY;
+    std::vector< double > _slopeX;
+    std::vector< double > _slopeY;
+    std::vector< double > _chi2X;
+    std::vector< double > _chi2Y;
+
+    //! Sums reused by fit()
+    std::vector< double > _sumZZX;
+    std::vector< double > _sumZZY;
+  };
+
+}
+
+#endif
@@ -252,6 +252,15 @@ namespace eutelescope {
    *        sensor layer (in Y direction) 
    * \param SlopeDistanceMax Maximum hit distance from the expected
    *        position, used for hit preselection (see above).
+   *
+   * \param IncrementalFit  Calculate \f$ \chi^{2} \f$ of the track
+   *        hypotheses incrementally, plane by plane, reusing the
+   *        result for the common first planes of consecutive hypotheses
+   *        (default). The full matrix fit is only done for tracks
+   *        which are stored, or when \f$ \chi^{2} \f$ is too close to
+   *        the cut values to decide. Set to false to fit every
+   *        hypothesis from scratch, e.g. to compare CPU time (printed
+   *        at the end of the job as a function of the number of hits).
    * 
    * \par Performance issues
    * As described above, if multiple hits are found in telescope
@@ -275,6 +284,11 @@ namespace eutelescope {
    *      tracks (without missing hits) matrix inversion is done only
    *      once and not for each track hypothesis.
    *
+   *  \li Keep \e IncrementalFit set to \e true . Track hypotheses are
+   *      then checked plane by plane and all hypotheses starting with
+   *      hits giving \f$ \chi^{2} \f$ above \e Chi2Max are rejected
+   *      without fitting them.
+   *
    *  \li Use beam constraint (set \e UseBeamConstraint to \e true ),
    *      even if beam spread is large. With beam
    *      constraint first two hits are sufficent to recognize bad track
@@ -437,6 +451,33 @@ namespace eutelescope {
     //! Solve matrix equation
     int GaussjSolve(double * alfa, double * beta, int n);
 
+    //! Partial track fit in one plane (XZ or YZ)
+    /*! The \f$ \chi^{2} \f$ of the track in planes 0 to N, minimised
+     *  in the positions in planes 0 to N-2, written as quadratic form in
+     *  the positions in planes N-1 and N:
+     *  \f$ f^{T} M f - 2 g^{T} f + c \f$
+     */
+    struct PartialFit {
+      double m00, m01, m11;
+      double g0, g1;
+      double c;
+    };
+
+    //! Start partial fit in the first plane
+    void StartPartialFit(PartialFit & fit, double pos, double weight);
+
+    //! Extend partial fit to plane ipl
+    /*! Scattering in plane ipl-1 (and beam constraint, for ipl=1) and
+     *  the measurement in plane ipl (weight 0 if no hit) are added
+     */
+    void ExtendPartialFit(const PartialFit & prev, PartialFit & next, int ipl, double pos, double weight, double slope);
+
+    //! Minimal \f$ \chi^{2} \f$ of the partial fit
+    /*! Equal to the \f$ \chi^{2} \f$ of the track with all further
+     *  planes missing, which is a lower limit for all its extensions
+     */
+    double GetPartialFitChi2(const PartialFit & fit);
+
 
     //! Silicon planes parameters as described in GEAR
     /*! This structure actually contains the following:
@@ -583,6 +624,18 @@ namespace eutelescope {
     int * _planeChoice;
     type_fitcount * _planeMod;
 
+    // Incremental fit: partial fits in X and Y up to given plane, and
+    // the hit choice in each plane they were calculated for
+
+    bool _useIncrementalFit;
+    PartialFit * _partialFitX;
+    PartialFit * _partialFitY;
+    int * _partialFitChoice;
+
+    // Track search CPU time [s] and number of events, vs number of accepted hits
+
+    std::map<int, std::pair<double, int> > _searchTime;
+
     // Fitting algorithm arrays
 
     double * _planeX  ;
@@ -10,7 +10,9 @@
 #include "TMatrixDSym.h"
 #endif
 //lcio
+#include "EVENT/Track.h"
 #include "IMPL/TrackImpl.h"
+#include "IMPL/LCCollectionVec.h"
 #include "EUTelGeometryTelescopeGeoDescription.h"
 #include "EUTelState.h"
 
@@ -21,19 +23,32 @@ using namespace std;
 
 namespace eutelescope {
 
-	class  EUTelTrack : public IMPL::TrackImpl{
+	//Track made of the states on the planes it crosses. States are stored by value and in order, copying a track copies its states.
+	//LCIO is only used at the input and output of processors, see EUTelTrack(const EVENT::Track*) and createLCIOTrack().
+	class  EUTelTrack {
 		public: 
 			EUTelTrack();
-			EUTelTrack( const EUTelTrack& track);
-			EUTelTrack( const EUTelTrack& track,bool);
+			//Read a track stored as LCIO track with its states as sub-tracks
+			explicit EUTelTrack(const EVENT::Track* lcioTrack);
 			//getters
 			int getNumberOfHitsOnTrack() const;
-			std::vector<EUTelState> getStates();
-			std::vector<EUTelState*> getStatesPointers();
+			std::vector<EUTelState>& getStates() { return _states; }
+			const std::vector<EUTelState>& getStates() const { return _states; }
+			float getChi2() const { return _chi2; }
+			int getNdf() const { return _ndf; }
+			//setters
+			void addState(const EUTelState& state) { _states.push_back(state); }
+			void setChi2(float chi2) { _chi2 = chi2; }
+			void setNdf(int ndf) { _ndf = ndf; }
+			//Store the track as LCIO track. The states are created as well and added to stateCollection, which owns them. The caller owns the returned track.
+			IMPL::TrackImpl* createLCIOTrack(IMPL::LCCollectionVec* stateCollection) const;
 			//print
 			void print();
 
   	private:
+			std::vector<EUTelState> _states;
+			float _chi2;
+			int _ndf;
 	};
 
 }
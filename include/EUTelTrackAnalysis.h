@@ -30,8 +30,8 @@ namespace eutelescope {
 
     EUTelTrackAnalysis(map< int,  AIDA::IProfile2D*> mapFromSensorIDToHistogramX, map< int,  AIDA::IProfile2D*> mapFromSensorIDToHistogramY, map< int,   AIDA::IHistogram1D *> mapFromSensorIDToKinkXZ,map< int,   AIDA::IHistogram1D *> mapFromSensorIDToKinkYZ);
 
-		void plotResidualVsPosition(EUTelTrack);
-		void plotIncidenceAngles(EUTelTrack track);
+		void plotResidualVsPosition(const EUTelTrack& track);
+		void plotIncidenceAngles(const EUTelTrack& track);
 		void setSensorIDTo2DResidualHistogramX(map< int,  AIDA::IProfile2D*> mapFromSensorIDToHistogramX){_mapFromSensorIDToHistogramX=mapFromSensorIDToHistogramX;}
 		void setSensorIDTo2DResidualHistogramY(map< int,  AIDA::IProfile2D*> mapFromSensorIDToHistogramY){_mapFromSensorIDToHistogramY=mapFromSensorIDToHistogramY;}
 		void setSensorIDToIncidenceAngleXZ( map< int,  AIDA::IHistogram1D * > mapFromSensorIDToKinkXZ){_mapFromSensorIDToIncidenceXZ=mapFromSensorIDToKinkXZ;}
@@ -14,9 +14,30 @@
 #define TDSIntegrationStorage_H 1
 
 #include <map>
+#include <string>
+#include <iostream>
+#include <cstdlib>
 
 namespace TDS {
 
+//! Parameters the stored integration results depend on
+/*! Stored results may only be reused, e.g. from a cache file, if all
+    of these parameters are identical.
+*/
+  struct TDSIntegrationStorageKey {
+    double pixelLength, pixelWidth, height, lambda, reflectedContribution;
+    unsigned long long int integMaxNumberPixelsAlongL, integMaxNumberPixelsAlongW;
+    unsigned long long int integPixelSegmentsAlongL, integPixelSegmentsAlongW, integPixelSegmentsAlongH;
+    unsigned long long int gslCalls;
+    char detectorType[16];
+  };
+
+//! One integration result in a cache file
+  struct TDSIntegrationStorageRecord {
+    unsigned long long int integSegmentID;
+    double integrationResult;
+  };
+
 //! Storage of integration results for Tracker Detailed Simulation
 /*! 
    A storage for integration results - may be used for many layers with the same pixel sizes, lambda, height etc.
@@ -60,11 +81,24 @@ namespace TDS {
           }
 
         // If only one is != 0 then other dimensions have just 1 segment each!!!
+
+        isCacheAttached = false;
+        isCacheModified = false;
+        cacheData = 0;
+        cacheDataSize = 0;
+        isCacheDataMapped = false;
+        cacheRecords = 0;
+        numberOfCacheRecords = 0;
       };
 
     //! Destructor
+    /*! If a cache file is attached, results added since it was read
+        are written back to it.
+     */
     ~TDSIntegrationStorage() 
       { 
+        if ( isCacheAttached && isCacheModified ) writeToFile();
+        releaseCacheData();
       };
 
     //! Number of segments for ONE pixel along L (integration results are stored for each segment)
@@ -104,9 +138,25 @@ namespace TDS {
 
 
     //! Is the result already stored?
-    inline bool isResultStored(const unsigned long long int integSegmentID)
+    inline bool isResultStored(const unsigned long long int integSegmentID) const
+      {
+        double integrationResult;
+        return findResult(integSegmentID, integrationResult);
+      };
+
+    //! Look up a stored result
+    /*! Results computed in this job are searched first, then the
+        results of the cache file.
+     */
+    inline bool findResult(const unsigned long long int integSegmentID, double & integrationResult) const
       {
-        return integResultsForSegments.find(integSegmentID) != integResultsForSegments.end();
+        std::map<unsigned long long int, double>::const_iterator it = integResultsForSegments.find(integSegmentID);
+        if ( it != integResultsForSegments.end() )
+          {
+            integrationResult = it->second;
+            return true;
+          }
+        return numberOfCacheRecords != 0 && findCachedResult(integSegmentID, integrationResult);
       };
 
     //! Store a charge deposit from the segment in the pixel
@@ -115,23 +165,92 @@ namespace TDS {
     inline void rememberResult(const unsigned long long int integSegmentID, double integrationResult)
       {
         integResultsForSegments[ integSegmentID ] = integrationResult;
+        isCacheModified = true;
       };
 
 
-    //! Return a stored result
-    inline double getResult(const unsigned long long int integSegmentID)
+    //! Return a stored result, 0 if there is none
+    inline double getResult(const unsigned long long int integSegmentID) const
       {
-        return integResultsForSegments[ integSegmentID ];
+        double integrationResult = 0.;
+        findResult(integSegmentID, integrationResult);
+        return integrationResult;
       };
 
 
+    //! Number of stored results
+    inline unsigned int getNumberOfResults() const { return integResultsForSegments.size() + numberOfCacheRecords; };
+
+
+    //! Binary cache file for the results
+    /*! The TDSPixelsChargeMap using this storage attaches the file
+        before its first integration, when all the parameters the
+        results depend on are known. If the file was written for the
+        same parameters, it is memory mapped and its results are used
+        in place. The destructor writes all results back to the file
+        if new ones were added, so the next job starts with the
+        complete table. The file may be shared by parallel jobs: it
+        is replaced atomically.
+     */
+    inline void setCacheFile(const std::string & filename) { cacheFileName = filename; };
+
+    inline const std::string & getCacheFile() const { return cacheFileName; };
+
+
+    //! Write all results to the attached cache file
+    bool writeToFile();
+
+
+    //! Version of the cache file layout
+    static const unsigned long long int cacheFileVersion = 1;
+
+
     private:
 
+    // the cache data is owned by the storage
+    TDSIntegrationStorage(const TDSIntegrationStorage &);
+    TDSIntegrationStorage & operator=(const TDSIntegrationStorage &);
+
+
+    //! Attach the cache file for results with the given key
+    /*! Returns the number of results found in the file (0 if it does
+        not exist, does not match or was attached before).
+     */
+    unsigned int attachCacheFile(const TDSIntegrationStorageKey & key);
+
+    //! Binary search in the records of the cache file
+    bool findCachedResult(const unsigned long long int integSegmentID, double & integrationResult) const;
+
+    //! Unmap or free the contents of the cache file
+    void releaseCacheData();
+
+
+    //! Cache file set with setCacheFile()
+    std::string cacheFileName;
+
+    //! Key of the results in the cache file
+    TDSIntegrationStorageKey cacheKey;
+
+    //! Has the cache file been attached?
+    bool isCacheAttached;
+
+    //! Have results been added since the cache file was read?
+    bool isCacheModified;
+
+    //! Contents of the cache file, mapped or read into memory
+    void * cacheData;
+    size_t cacheDataSize;
+    bool isCacheDataMapped;
+
+    //! Results of the cache file, sorted in segment ID
+    const TDSIntegrationStorageRecord * cacheRecords;
+    size_t numberOfCacheRecords;
+
 
     //! For integration-results storage - number of segments/divisions of ONE pixel 
     unsigned int integPixelSegmentsAlongL, integPixelSegmentsAlongW, integPixelSegmentsAlongH;
 
-    //! Map for storing the results of integration
+    //! Map for storing the results of integration computed in this job
     /*! Function integSegmentID() is used as a key 
       map< segmentL*1000000000000 + segmentW*1000000000 + segmentH*1000000 + pixelL*1000 + pixelW , charge> 
      */
@@ -0,0 +1,205 @@
+// Version: $Id$
+/*
+   Description: Dense, tiled storage of pixel charges for Tracker Detailed Simulation.
+   The pixel plane is divided into square tiles of tileSide x tileSide pixels.
+   Memory of a tile is allocated when the first pixel in it is stored and kept
+   afterwards; the list of touched tiles makes clearing and scanning the grid
+   proportional to the number of tiles actually used in the event.
+
+*/
+
+#ifndef TDSPIXELSCHARGEGRID_H
+#define TDSPIXELSCHARGEGRID_H 1
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace TDS {
+
+//! Dense pixel charge storage for Tracker Detailed Simulation
+/*!
+   Used by TDSPixelsChargeMap instead of its std::map when the dense
+   charge map is switched on. Pixels are addressed by their indexes
+   along L and W; within a tile by the cell number
+   (indexAlongL%tileSide)*tileSide + indexAlongW%tileSide.
+   <br>
+   A pixel is "stored" once it has been accessed with getCharge(),
+   exactly like a pixel inserted into the map, also if its charge is 0.
+*/
+  class TDSPixelsChargeGrid {
+
+    friend class TDSPixelsChargeMap;
+
+    public:
+
+    //! Tile side, in pixels (power of 2)
+    static const unsigned int tileBits = 3;
+    static const unsigned int tileSide = 1 << tileBits;
+    static const unsigned int tileArea = tileSide * tileSide;
+
+    //! Constructor
+    TDSPixelsChargeGrid() : numberTilesAlongL(0), numberTilesAlongW(0), numberOfPixels(0) {};
+
+    //! Set the dimensions of the pixel plane (removes all pixels)
+    void setSize(const unsigned long int numberPixelsAlongL, const unsigned long int numberPixelsAlongW)
+      {
+        numberTilesAlongL = (numberPixelsAlongL + tileSide - 1) >> tileBits;
+        numberTilesAlongW = (numberPixelsAlongW + tileSide - 1) >> tileBits;
+        tiles.clear();
+        tiles.resize(numberTilesAlongL * numberTilesAlongW);
+        touchedTiles.clear();
+        numberOfPixels = 0;
+      }
+
+    //! Remove all pixels
+    void clear()
+      {
+        for (unsigned int k = 0; k < touchedTiles.size(); k++)
+          {
+            Tile & tile = tiles[ touchedTiles[k] ];
+            tile.charge.assign(tileArea, 0.);
+            tile.stored.assign(tileArea, 0);
+            tile.touched = false;
+          }
+        touchedTiles.clear();
+        numberOfPixels = 0;
+      }
+
+    //! Number of stored pixels
+    inline unsigned long int size() const { return numberOfPixels; }
+
+    //! Pointer to the charge of a stored pixel, 0 if the pixel is not stored
+    inline double * findCharge(const unsigned long int indexAlongL, const unsigned long int indexAlongW)
+      {
+        Tile & tile = tiles[ tileIndex(indexAlongL, indexAlongW) ];
+        if ( ! tile.touched ) return 0;
+        const unsigned int c = cell(indexAlongL, indexAlongW);
+        return tile.stored[c] ? &tile.charge[c] : 0;
+      }
+
+    //! Charge of a pixel, the pixel is stored (with charge 0) if it was not
+    inline double & getCharge(const unsigned long int indexAlongL, const unsigned long int indexAlongW)
+      {
+        const unsigned long int t = tileIndex(indexAlongL, indexAlongW);
+        Tile & tile = tiles[t];
+        if ( ! tile.touched ) touchTile(t);
+        const unsigned int c = cell(indexAlongL, indexAlongW);
+        if ( ! tile.stored[c] )
+          {
+            tile.stored[c] = 1;
+            ++numberOfPixels;
+          }
+        return tile.charge[c];
+      }
+
+    //! Stored pixels as (tile, cell) pairs in increasing pixel ID order
+    /*! That is along L, then along W, the order in which the std::map of
+     *  TDSPixelsChargeMap is iterated. Rows of pixels cross all used tiles
+     *  of a row of tiles, so the used tiles are sorted first.
+     */
+    void getStoredCells(std::vector< std::pair<unsigned long int, unsigned int> > & cells)
+      {
+        cells.clear();
+        cells.reserve(numberOfPixels);
+        std::sort(touchedTiles.begin(), touchedTiles.end());
+        unsigned int first = 0;
+        while ( first < touchedTiles.size() )
+          {
+            const unsigned long int tileRow = touchedTiles[first] / numberTilesAlongW;
+            unsigned int last = first + 1;
+            while ( last < touchedTiles.size() && touchedTiles[last] / numberTilesAlongW == tileRow ) ++last;
+            for (unsigned int row = 0; row < tileArea; row += tileSide)
+              {
+                for (unsigned int k = first; k < last; k++)
+                  {
+                    const Tile & tile = tiles[ touchedTiles[k] ];
+                    for (unsigned int c = row; c < row + tileSide; c++)
+                      {
+                        if ( tile.stored[c] ) cells.push_back(std::make_pair(touchedTiles[k], c));
+                      }
+                  }
+              }
+            first = last;
+          }
+      }
+
+    //! Number of tiles of the plane
+    inline unsigned long int getNumberOfTiles() const { return tiles.size(); }
+
+    //! Remove a pixel (if stored)
+    inline void erase(const unsigned long int indexAlongL, const unsigned long int indexAlongW)
+      {
+        Tile & tile = tiles[ tileIndex(indexAlongL, indexAlongW) ];
+        if ( tile.touched ) eraseCell(tile, cell(indexAlongL, indexAlongW));
+      }
+
+
+    private:
+
+    struct Tile {
+      Tile() : touched(false) {};
+      std::vector<double> charge;
+      std::vector<unsigned char> stored;
+      bool touched;
+    };
+
+    inline unsigned long int tileIndex(const unsigned long int indexAlongL, const unsigned long int indexAlongW) const
+      {
+        return (indexAlongL >> tileBits) * numberTilesAlongW + (indexAlongW >> tileBits);
+      }
+
+    static inline unsigned int cell(const unsigned long int indexAlongL, const unsigned long int indexAlongW)
+      {
+        return ((indexAlongL & (tileSide - 1)) << tileBits) | (indexAlongW & (tileSide - 1));
+      }
+
+    //! Index along L of cell c of tile t
+    inline unsigned long int cellIndexAlongL(const unsigned long int t, const unsigned int c) const
+      {
+        return ((t / numberTilesAlongW) << tileBits) + (c >> tileBits);
+      }
+
+    //! Index along W of cell c of tile t
+    inline unsigned long int cellIndexAlongW(const unsigned long int t, const unsigned int c) const
+      {
+        return ((t % numberTilesAlongW) << tileBits) + (c & (tileSide - 1));
+      }
+
+    void touchTile(const unsigned long int t)
+      {
+        Tile & tile = tiles[t];
+        if ( tile.charge.empty() )
+          {
+            tile.charge.assign(tileArea, 0.);
+            tile.stored.assign(tileArea, 0);
+          }
+        tile.touched = true;
+        touchedTiles.push_back(t);
+      }
+
+    inline void eraseCell(Tile & tile, const unsigned int c)
+      {
+        if ( tile.stored[c] )
+          {
+            tile.stored[c] = 0;
+            tile.charge[c] = 0.;
+            --numberOfPixels;
+          }
+      }
+
+    unsigned long int numberTilesAlongL, numberTilesAlongW;
+
+    // All tiles of the plane; pixel memory of untouched tiles is allocated on first use
+    std::vector<Tile> tiles;
+
+    // Tiles used since the last clear() (sorted by getStoredCells())
+    std::vector<unsigned long int> touchedTiles;
+
+    unsigned long int numberOfPixels;
+
+  };
+
+}
+
+#endif
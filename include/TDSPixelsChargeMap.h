@@ -29,6 +29,7 @@
 #include <string>
 #include <cmath>
 #include <algorithm>
+#include <vector>
 
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_monte.h>
@@ -38,6 +39,7 @@
 #include <TDSIntegrationStorage.h>
 #include <TDSPixel.h>
 #include <TDSPrecluster.h>
+#include <TDSPixelsChargeGrid.h>
 
 //! Namespace
 /*!
@@ -238,7 +240,12 @@ namespace TDS {
     /*! To speed up the digitization, results of numerical integration
      *  should be stored in dedicated storage. If many sensors of the
      *  same type are digitized, same storage should be used, so
-     *  integration results can be shared.
+     *  integration results can be shared. If a cache file is set
+     *  for the storage (TDSIntegrationStorage::setCacheFile), it is
+     *  attached before the first integration, so that results of
+     *  previous jobs with the same pixel pitch, height, charge
+     *  distribution parameters, integration range, storage
+     *  segmentation and number of GSL calls are not computed again.
      */
 
     void setPointerToIntegrationStorage(TDSIntegrationStorage * val_integrationStorage);
@@ -307,10 +314,36 @@ namespace TDS {
 
     inline void clear()
       {
+        if (useDenseChargeMap) denseChargeMap.clear();
         pixelsChargeMap.clear();
       };
 
 
+    //! Use dense, tiled charge storage instead of the std::map
+    /*! Pixel charges are kept in tiles of 8x8 pixels allocated on first
+     *  use, so that charge deposition is plain array access and clear(),
+     *  noise, threshold and precluster methods scan only the tiles used
+     *  in the event. Pixels are visited in pixel ID order as in the map,
+     *  so random numbers for noise and fluctuations are drawn in the same
+     *  order and results do not depend on the storage.
+     *  By default update() switches to the dense storage by itself once
+     *  the map holds at least as many pixels as the grid has tiles (and
+     *  not less than 1024); calling this method turns that off.
+     *  Pixels' dimensions have to be set before; stored pixels are moved
+     *  to the new storage.
+     */
+
+    void setDenseChargeMap(const bool val = true);
+
+
+    //! Is dense charge storage used?
+
+    inline bool isDenseChargeMapUsed()
+      {
+        return useDenseChargeMap;
+      }
+
+
     //! Scale charge deposited in the map
     /*! New value of total charge is returned
      */
@@ -370,7 +403,7 @@ namespace TDS {
 
     inline unsigned int getPixelsNumber()
       {
-        return pixelsChargeMap.size();
+        return useDenseChargeMap ? denseChargeMap.size() : pixelsChargeMap.size();
       }
 
 
@@ -378,7 +411,7 @@ namespace TDS {
 
     inline bool isPixelStored()
     {
-      return pixelsChargeMap.size() != 0;
+      return getPixelsNumber() != 0;
     }
 
 
@@ -386,6 +419,7 @@ namespace TDS {
 
     inline bool isPixelStored(type_PixelID pixID)
     {
+      if (useDenseChargeMap) return isPixelStored(pixID/tenTo10, pixID%tenTo10);
       return pixelsChargeMap.find(pixID) != pixelsChargeMap.end();
     }
 
@@ -394,6 +428,11 @@ namespace TDS {
 
     inline bool isPixelStored(unsigned long int indexAlongL, unsigned long int indexAlongW)
     {
+      if (useDenseChargeMap)
+        {
+          return indexAlongL < numberPixelsAlongL && indexAlongW < numberPixelsAlongW &&
+            denseChargeMap.findCharge(indexAlongL, indexAlongW) != 0;
+        }
       return pixelsChargeMap.find( getPixelID(indexAlongL, indexAlongW) ) != pixelsChargeMap.end();
     }
 
@@ -582,6 +621,24 @@ namespace TDS {
     // Map of pixels <pixID, pixCharge> for given part of given layer
     type_PixelsChargeMap pixelsChargeMap;
 
+    // Dense alternative to pixelsChargeMap (see setDenseChargeMap())
+    TDSPixelsChargeGrid denseChargeMap;
+    bool useDenseChargeMap;
+
+    // Storage set by the user, otherwise chosen by update()
+    bool isDenseChargeMapChosen;
+    static const unsigned long int denseChargeMapMinPixels = 1024;
+
+    // Move the stored pixels to the dense (val) or map storage
+    void moveChargeMap(const bool val);
+
+    // Stored cells of denseChargeMap in pixel ID order (kept to reuse the memory)
+    std::vector< std::pair<unsigned long int, unsigned int> > denseCells;
+
+    // Pixel with the greatest (findMaximum) or smallest charge in denseChargeMap,
+    // compared with 'smaller'; ties go to the smallest pixel ID, as for the map
+    type_PixelID getDensePixelID_extreme(bool (*smaller)(std::pair<type_PixelID, double>, std::pair<type_PixelID, double>), bool findMaximum);
+
     bool isIntegrationInitialized;
 
     unsigned int integMaxNumberPixelsAlongL, integMaxNumberPixelsAlongW;
@@ -594,6 +651,21 @@ namespace TDS {
     TDSIntegrationStorage * integrationStorage;
     bool useIntegrationStorage;
 
+    //! Attach the cache file of the integration storage, keyed by the current parameters
+    void attachIntegrationStorageCache();
+
+    //! Has the cache file of the integration storage been attached?
+    bool isIntegrationStorageCacheAttached;
+
+
+    // Buffers of update(), reused for all steps
+    // Integration points along the current step
+    std::vector<double> integPointL, integPointW, integPointH;
+    // Charge deposited by the current step in the rectangle of pixels it can reach
+    std::vector<double> stepDeposit;
+    // Pixels of the rectangle reached by at least one integration point
+    std::vector<char> stepDepositTouched;
+
 
     // Integration part variables (GSL - C library)
     const gsl_rng_type *gsl_T;
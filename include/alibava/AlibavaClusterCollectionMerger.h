@@ -17,15 +17,36 @@
 #include "marlin/DataSourceProcessor.h"
 
 // lcio includes <.h>
+#include <lcio.h>
 #include <IMPL/LCCollectionVec.h>
+#include <IMPL/LCEventImpl.h>
+#include <IO/LCReader.h>
+#include <EVENT/LCEvent.h>
 
 // system includes <>
 #include <string>
 #include <vector>
 
+#ifdef USE_PTHREAD
+#include <pthread.h>
+#endif
+
 namespace alibava {
 	
 	
+	//! Merges the cluster collections of a telescope and an alibava file
+	/*! The events of the two files are paired on a synchronisation key,
+	 *  the event number by default. The native formats of both DAQs
+	 *  carry no common trigger number, so SyncKey can pick the LCIO
+	 *  time stamp or an integer event parameter written by the
+	 *  converters instead.
+	 *
+	 *  Each file is read on its own helper thread, PrefetchDepth events
+	 *  ahead, while the processors work on the merged event. The
+	 *  prefetching needs pthreads and LCIO v02-13 or newer, as for
+	 *  EUTelLCIOReadAhead; otherwise the files are read in the
+	 *  processing thread.
+	 */
 	class AlibavaClusterCollectionMerger : public marlin::DataSourceProcessor    {
 		
 	public:
@@ -100,10 +121,147 @@ namespace alibava {
 		
 		//! Event ID difference
 		int _eventIDDiff;
+
+		//! Resynchronise the two streams on their synchronisation key
+		/*! The key difference of the first merged pair is taken as
+		 *  reference. Whenever a later pair deviates from it, the stream
+		 *  which is behind is advanced until the difference is restored,
+		 *  i.e. events dropped by one of the DAQs are skipped instead of
+		 *  shifting all following pairs.
+		 */
+		bool _resynchronise;
+
+		//! Synchronisation key: EventNumber, TimeStamp or Parameter
+		std::string _syncKey;
+
+		//! Integer event parameter used as key with SyncKey Parameter, e.g. a trigger number
+		std::string _syncParameterName;
+
+		//! Largest deviation of the time stamp difference still matching, with SyncKey TimeStamp
+		/*! The reference difference follows every match, so that a
+		 *  slow drift of the two clocks is tolerated.
+		 */
+		int _timeStampTolerance;
+
+		//! Events read ahead per file, 0 to read in the processing thread
+		int _prefetchDepth;
+
+		//! Maximum number of events skipped in one resynchronisation
+		/*! If the streams cannot be matched within this number of
+		 *  events the merging is stopped with an error.
+		 */
+		int _maxResyncSkip;
 	
 	private:
-		
-		void copyClustersInCollection(LCCollectionVec * outputPulseColVec, LCCollectionVec * outputSparseColVec, LCCollectionVec * inputPulseColVec, LCCollectionVec * inputSparseColVec );
+
+		//! One input file, read ahead on a helper thread if possible
+		/*! LCIO deletes an event as soon as the next one is read, so the
+		 *  collections of every event are moved to a new event with
+		 *  takeEvent. The events are read in update mode and returned
+		 *  to the caller, who deletes them.
+		 */
+		class EventStream {
+		public:
+			explicit EventStream( const std::string & name );
+			~EventStream();
+
+			//! Opens the file, throws an IOException on failure
+			void open( const std::string & fileName );
+
+			//! Next run header, only to be read before start
+			EVENT::LCRunHeader * readNextRunHeader();
+
+			//! Starts the helper thread reading depth events ahead
+			void start( int depth );
+
+			//! Next event, owned by the caller, 0 at the end of the file
+			IMPL::LCEventImpl * nextEvent();
+
+			//! Stops the helper thread, deletes the events read ahead and closes the file
+			void close();
+
+			//! Read error of the helper thread, empty if none
+			const std::string & getReadError() const { return _readError; }
+
+		private:
+			EventStream( const EventStream & );
+			EventStream & operator=( const EventStream & );
+
+			//! Reads and takes the next event of the file
+			IMPL::LCEventImpl * readEvent();
+
+#ifdef USE_PTHREAD
+			static void * readerThread( void * stream );
+
+			//! Queues the event, waiting for a free slot. Returns false if reading was stopped
+			bool queueEvent( IMPL::LCEventImpl * event );
+#endif
+
+			std::string _name;
+			IO::LCReader * _reader;
+			bool _isOpen;
+			std::string _readError;
+
+			//! Is the helper thread reading the file?
+			bool _background;
+
+			//! Events waiting for the merger, used as a ring; 0 marks the end of the file
+			std::vector< IMPL::LCEventImpl * > _queue;
+
+#ifdef USE_PTHREAD
+			pthread_t _thread;
+			pthread_mutex_t _mutex;
+			pthread_cond_t _eventQueued;
+			pthread_cond_t _eventTaken;
+			size_t _nQueued;
+			size_t _producerSlot;
+			size_t _consumerSlot;
+			bool _stop;
+#endif
+		};
+
+		//! Moves the clusters of the input collections to the output collections
+		/*! The input events are read in update mode, so the cluster
+		 *  objects are re-encoded and handed over to the output
+		 *  collections instead of being copied. The input collections
+		 *  keep null entries in their place. Pulses without sparse
+		 *  frame, or sharing one with a pulse already moved, are
+		 *  dropped and counted.
+		 */
+		void moveClustersToCollection(LCCollectionVec * outputPulseColVec, LCCollectionVec * outputSparseColVec, LCCollectionVec * inputPulseColVec, LCCollectionVec * inputSparseColVec );
+
+		//! Advances the lagging stream until the synchronisation keys match again
+		/*! Skipped events are deleted.
+		 *  @return false if the streams could not be resynchronised
+		 */
+		bool synchroniseEvents(EventStream & telescopeStream, EventStream & alibavaStream, IMPL::LCEventImpl *& telescopeEvent, IMPL::LCEventImpl *& alibavaEvent);
+
+		//! Synchronisation key of an event
+		lcio::long64 getSyncKey( const EVENT::LCEvent * event ) const;
+
+		//! Keys which can be used for the synchronisation
+		enum SyncKeyType { kSyncEventNumber, kSyncTimeStamp, kSyncParameter };
+
+		//! The SyncKey in use
+		SyncKeyType _syncKeyType;
+
+		//! Key difference alibava - telescope of the first merged pair
+		lcio::long64 _syncKeyOffset;
+
+		//! True after the first pair has been merged
+		bool _syncKeyOffsetSet;
+
+		//! Number of telescope events skipped during resynchronisation
+		int _skippedTelescopeEvents;
+
+		//! Number of alibava events skipped during resynchronisation
+		int _skippedAlibavaEvents;
+
+		//! Number of resynchronisations
+		int _resyncCounter;
+
+		//! Number of pulses dropped because their sparse frame was missing or already moved
+		int _droppedPulses;
 
 	};
 	
@@ -19,6 +19,7 @@
 
 // system includes <>
 #include <string>
+#include <map>
 
 using namespace std;
 using namespace lcio;
@@ -33,7 +34,13 @@ namespace alibava {
 		
 		void createFile(string filename, IMPL::LCRunHeaderImpl* runHeader);
 		
+		//! Pedestal, noise or calibration values keyed by collection name and chip number
+		typedef std::map< std::string, std::map< int, EVENT::FloatVec > > PedNoiCalContent;
+
 		void addToFile(string filename, string collectionName, int chipnum, EVENT::FloatVec datavec);
+
+		// adds all collections and chips of content to the file with a single rewrite
+		void addToFile(string filename, const PedNoiCalContent & content);
 		
 		EVENT::FloatVec getPedNoiCalForChip(string filename, string collectionName, unsigned int chipnum);
 		
@@ -184,10 +184,26 @@ namespace alibava {
 		std::string getNoiseHistoName(unsigned int ichip);
 				
 		//! Calculates and saves pedestal and noise values
-		/*! Fills the histograms
-		 */		
+		/*! Fills the histograms and writes pedestal and noise of all
+		 *  chips to the pedestal file in a single call.
+		 *
+		 *  Unless _useGausFit is set, pedestal and noise are estimated
+		 *  from the moments of the channel histogram, refined by
+		 *  _refinementIterations truncated Gaussian steps in a window
+		 *  of +/- _refinementWindow sigma. The channels are independent
+		 *  and are processed in parallel when compiled with OpenMP.
+		 */
 		void calculatePedestalNoise();
 
+		//! Use the ROOT Gaussian fit of each channel instead of the fast estimator
+		bool _useGausFit;
+
+		//! Number of truncated Gaussian iterations after the moment estimate
+		int _refinementIterations;
+
+		//! Half width of the truncation window in units of sigma
+		float _refinementWindow;
+
 		
 	};
 	
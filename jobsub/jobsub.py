@@ -295,6 +295,42 @@ def runMarlin(filenamebase, jobtask, silent):
         exit(1)
     return rcode
 
+def setGlobalParameter(sstring, name, value):
+    """ Set the value of a parameter of the global section of the steering string; the parameter is added if missing """
+    import re
+    pattern = re.compile(r'(<parameter\s+name\s*=\s*"'+name+r'"\s+value\s*=\s*")[^"]*(")', re.IGNORECASE)
+    if pattern.search(sstring):
+        return pattern.sub(lambda m: m.group(1)+str(value)+m.group(2), sstring)
+    globalTag = re.compile(r'(<global\s*>)', re.IGNORECASE)
+    if not globalTag.search(sstring):
+        raise EOFError("Could not find the global section")
+    return globalTag.sub(lambda m: m.group(1)+'\n      <parameter name="'+name+'" value="'+str(value)+'"/>', sstring, 1)
+
+def runSplitJobs(jobs, jobtask, silent, maxjobs):
+    """ Runs Marlin concurrently on the steering files of the split jobs, at most maxjobs at a time; returns the return code of each job """
+    from threading import Thread, BoundedSemaphore
+    rcodes = dict()
+    slots = BoundedSemaphore(maxjobs)
+    def runJob(basefilename, splitname):
+        slots.acquire()
+        try:
+            try:
+                rcodes[basefilename] = runMarlin(basefilename, splitname, silent)
+            except (SystemExit, Exception), e:
+                # sys.exit or an OSError in runMarlin would only end this thread
+                logging.getLogger('jobsub.' + splitname).error("Marlin could not be run: "+str(e))
+                rcodes[basefilename] = 1
+        finally:
+            slots.release()
+    threads = list()
+    for basefilename, splitname in jobs:
+        t = Thread(target=runJob, args=(basefilename, jobtask+"."+splitname))
+        t.start()
+        threads.append(t)
+    for t in threads:
+        t.join()
+    return rcodes
+
 def zipLogs(path, filename):
     """  stores output from Marlin in zip file; enables compression if necessary module is available """
     import zipfile
@@ -374,6 +410,9 @@ def main(argv=None):
     parser.add_argument("-l", "--log", default="info", help="Sets the verbosity of log messages during job submission where LEVEL is either debug, info, warning or error", metavar="LEVEL")
     parser.add_argument("-s", "--silent", action="store_true", default=False, help="Suppress non-error (stdout) Marlin output to console")
     parser.add_argument("--dry-run", action="store_true", default=False, help="Write steering files but skip actual Marlin execution")
+    parser.add_argument("--split", type=int, default=1, metavar="N", help="Split each run into N jobs processing consecutive event ranges, run concurrently on the local machine (or written for batch submission together with --dry-run); the steering file template has to contain the '@SplitIndex@' placeholder in its output file names")
+    parser.add_argument("--split-events", type=int, default=0, metavar="M", help="Number of events processed by each split job but the last one, which processes all the remaining events; required together with --split")
+    parser.add_argument("--max-jobs", type=int, default=0, metavar="K", help="Maximum number of split jobs running at the same time on the local machine; defaults to the number of CPUs")
     parser.add_argument("--plain", action="store_true", default=False, help="Output written to stdout/stderr and log file in prefix-less format i.e. without time stamping")
     parser.add_argument("jobtask", help="Which task to submit (e.g. convert, hitmaker, align); task names are arbitrary and can be set up by the user; they determine e.g. the config section and default steering file names.")
     parser.add_argument("runs", help="The runs to be analyzed; can be a list of single runs and/or a range, e.g. 1056-1060.", nargs='*')
@@ -425,6 +464,22 @@ def main(argv=None):
         log.error("At least one run is specified multiple times!")
         return 2
 
+    if args.split < 1:
+        log.error("The number of split jobs has to be at least one")
+        return 2
+    if args.split > 1 and args.split_events < 1:
+        log.error("Please specify the number of events of each split job using --split-events")
+        return 2
+    if args.max_jobs < 0:
+        log.error("The maximum number of concurrent jobs cannot be negative")
+        return 2
+    if args.max_jobs == 0:
+        try:
+            from multiprocessing import cpu_count
+            args.max_jobs = cpu_count()
+        except (ImportError, NotImplementedError):
+            args.max_jobs = 1
+
     # dictionary keeping our parameters
     # here you can set some minimal default config values that will (possibly) be overwritten by the config file
     parameters = {"templatepath":".", "templatefile":args.jobtask+"-tmp.xml", "logpath":"."}
@@ -533,6 +588,7 @@ def main(argv=None):
     prevINTHandler = signal.signal(signal.SIGINT, signal_handler)
 
     log.info("Will now start processing the following runs: "+', '.join(map(str, runs)))
+    failedSplitJobs = 0
     # now loop over all runs
     for run in runs:
         if keepRunning['Sigint'] == 'seen':
@@ -568,33 +624,94 @@ def main(argv=None):
             log.error("No reference to run number ('@RunNumber@') found in template file "+steeringTmpFileName)
             return 1
                 
-        if not checkSteer(steeringString):
-            return 1
+        if args.split == 1:
+            # without splitting the split index is left empty
+            try:
+                steeringString = ireplace("@SplitIndex@", "", steeringString)
+            except EOFError:
+                pass
 
-        log.debug ("Writing steering file for run number "+runnr)
-        basefilename = args.jobtask+"-"+runnr
-        steeringFile = open(basefilename+".xml", "w")
-        try:
-            steeringFile.write(steeringString)
-        finally:
-            steeringFile.close()
+            if not checkSteer(steeringString):
+                return 1
 
-        # bail out if running a dry run
-        if args.dry_run:
-            log.info("Dry run: skipping Marlin execution. Steering file written to "+basefilename+'.xml')
+            log.debug ("Writing steering file for run number "+runnr)
+            basefilename = args.jobtask+"-"+runnr
+            steeringFile = open(basefilename+".xml", "w")
+            try:
+                steeringFile.write(steeringString)
+            finally:
+                steeringFile.close()
+
+            # bail out if running a dry run
+            if args.dry_run:
+                log.info("Dry run: skipping Marlin execution. Steering file written to "+basefilename+'.xml')
+            else:
+                rcode = runMarlin(basefilename, args.jobtask, args.silent) # start Marlin execution
+                if rcode == 0:
+                    log.info("Marlin execution done")
+                else:
+                    log.error("Marlin returned with error code "+str(rcode))
+                zipLogs(parameters["logpath"], basefilename)
         else:
-            rcode = runMarlin(basefilename, args.jobtask, args.silent) # start Marlin execution
-            if rcode == 0:
-                log.info("Marlin execution done")
+            # one steering file per event range; the split index keeps the output files of the jobs apart
+            jobs = list()
+            for isplit in range(args.split):
+                splitname = "split%03d" % isplit
+                try:
+                    splitString = ireplace("@SplitIndex@", "-"+splitname, steeringString)
+                except EOFError:
+                    log.error("No reference to the split index ('@SplitIndex@') found in template file "+steeringTmpFileName+": the split jobs would overwrite each other's output")
+                    return 1
+                # MaxRecordNumber counts run headers as records; LCIO skips
+                # the run header together with the skipped events, so only
+                # the first job reads it. The last job takes all the
+                # remaining events
+                if isplit == args.split-1:
+                    maxrecords = 0
+                elif isplit == 0:
+                    maxrecords = args.split_events+1
+                else:
+                    maxrecords = args.split_events
+                try:
+                    splitString = setGlobalParameter(splitString, "SkipNEvents", isplit*args.split_events)
+                    splitString = setGlobalParameter(splitString, "MaxRecordNumber", maxrecords)
+                except EOFError:
+                    log.error("No global section found in template file "+steeringTmpFileName)
+                    return 1
+
+                if not checkSteer(splitString):
+                    return 1
+
+                basefilename = args.jobtask+"-"+runnr+"-"+splitname
+                log.debug ("Writing steering file "+basefilename+".xml")
+                steeringFile = open(basefilename+".xml", "w")
+                try:
+                    steeringFile.write(splitString)
+                finally:
+                    steeringFile.close()
+                jobs.append((basefilename, splitname))
+
+            if args.dry_run:
+                log.info("Dry run: skipping Marlin execution. Steering files written to "+', '.join(job[0]+'.xml' for job in jobs))
             else:
-                log.error("Marlin returned with error code "+str(rcode))
-            zipLogs(parameters["logpath"], basefilename)
+                log.info("Running "+str(len(jobs))+" split jobs of "+str(args.split_events)+" events for run number "+runnr+", at most "+str(args.max_jobs)+" at a time")
+                rcodes = runSplitJobs(jobs, args.jobtask, args.silent, args.max_jobs)
+                for basefilename, splitname in jobs:
+                    if rcodes.get(basefilename) == 0:
+                        log.info("Marlin execution of "+basefilename+" done")
+                    else:
+                        log.error("Marlin execution of "+basefilename+" returned with error code "+str(rcodes.get(basefilename)))
+                        failedSplitJobs += 1
+                    zipLogs(parameters["logpath"], basefilename)
         
     # return to the prvious signal handler
     signal.signal(signal.SIGINT, prevINTHandler)
     if log.error.counter>0:
         log.warning("There were "+str(log.error.counter)+" error messages reported")
 
+    if failedSplitJobs > 0:
+        log.error(str(failedSplitJobs)+" split jobs failed, their part of the run is missing in the merged output")
+        return 1
     return 0
 
 if __name__ == "__main__":
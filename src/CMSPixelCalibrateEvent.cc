@@ -184,7 +184,7 @@ void CMSPixelCalibrateEventProcessor::initializeCalibration() throw ( marlin::St
             throw StopProcessingException( this ) ;
         }
         
-        calibration.push_back(cal_roc);
+        addROCCalibration( cal_roc );
         
     } // end looping over noOfROC
     
@@ -250,7 +250,7 @@ void CMSPixelCalibrateEventProcessor::initializeGaintanhCalibration() throw ( ma
             throw StopProcessingException( this ) ;
         }
         
-        calibration.push_back(cal_roc);
+        addROCCalibration( cal_roc );
         
     } // end looping over noOfROC
     
@@ -308,46 +308,59 @@ void CMSPixelCalibrateEventProcessor::processEvent (LCEvent * event) {
         CellIDDecoder<TrackerDataImpl> cellDecoder(inputCollectionVec);
 
         LCCollectionVec * correctedDataCollection = new LCCollectionVec(LCIO::TRACKERDATA);
+        CellIDEncoder<TrackerDataImpl> idDataEncoder(EUTELESCOPE::ZSDATADEFAULTENCODING, correctedDataCollection);
             
         for (unsigned int iDetector = 0; iDetector < inputCollectionVec->size(); iDetector++) {
 
             TrackerDataImpl  * sparseData   = dynamic_cast < TrackerDataImpl * >(inputCollectionVec->getElementAt(iDetector));
 
             TrackerDataImpl     * corrected = new TrackerDataImpl;
-            CellIDEncoder<TrackerDataImpl> idDataEncoder(EUTELESCOPE::ZSDATADEFAULTENCODING, correctedDataCollection);
             idDataEncoder["sensorID"] = static_cast<int> (cellDecoder(sparseData)["sensorID"]);
             idDataEncoder["sparsePixelType"] = static_cast<int> (cellDecoder( sparseData )["sparsePixelType"]);
             idDataEncoder.setCellID(corrected);
 
             EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel>  correctedData( corrected ) ;
 
-            auto_ptr<EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel> > pixelData( new EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel>( sparseData ));
+            EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel> pixelData( sparseData );
 
-            // Loop over all pixels in the sparseData object.
             EUTelGenericSparsePixel Pixel;
-            auto_ptr<EUTelGenericSparsePixel> correctedPixel( new EUTelGenericSparsePixel );
+            EUTelGenericSparsePixel correctedPixel;
+
+            // The tanh calibration of all pixels of the sparseData
+            // object is done in one go
+            if(_phCalibration) {
+                _pixelIndex.resize( pixelData.size() );
+                _rawSignal.resize( pixelData.size() );
+                for ( unsigned int iPixel = 0; iPixel < pixelData.size(); iPixel++ ) {
+                    pixelData.getSparsePixelAt( iPixel, &Pixel);
+                    _pixelIndex[iPixel] = Pixel.getXCoord()*_noOfYPixel + Pixel.getYCoord();
+                    _rawSignal[iPixel]  = Pixel.getSignal();
+                }
+                calTanH( iDetector );
+            }
 
-            for ( unsigned int iPixel = 0; iPixel < pixelData->size(); iPixel++ ) {
-                pixelData->getSparsePixelAt( iPixel, &Pixel);
+            for ( unsigned int iPixel = 0; iPixel < pixelData.size(); iPixel++ ) {
+                pixelData.getSparsePixelAt( iPixel, &Pixel);
 
-                correctedPixel->setXCoord( Pixel.getXCoord() );
-                correctedPixel->setYCoord( Pixel.getYCoord() );
-                
-                int iPix = Pixel.getXCoord()*_noOfYPixel + Pixel.getYCoord();
+                correctedPixel.setXCoord( Pixel.getXCoord() );
+                correctedPixel.setYCoord( Pixel.getYCoord() );
 
                 double corrected;
 		bool rangecheck = true;
-                if(_phCalibration) rangecheck = calTanH(corrected,Pixel.getSignal(),calibration[iDetector][iPix].par0,calibration[iDetector][iPix].par1,calibration[iDetector][iPix].par2,calibration[iDetector][iPix].par3);
+                if(_phCalibration) {
+                    rangecheck = _isCalibrated[iPixel];
+                    corrected  = _calibratedSignal[iPixel];
+                }
 		else rangecheck = calWeibull(corrected,Pixel.getSignal());
                 
 	        if(rangecheck) {
-		  correctedPixel->setSignal( static_cast< short int >(corrected));
+		  correctedPixel.setSignal( static_cast< short int >(corrected));
                     
                     // Filling histogramms if needed:
-               		if ( _fillHistos ) fillHistos ( static_cast< int >(Pixel.getSignal()), static_cast< int >(correctedPixel->getSignal()), iDetector );
+               		if ( _fillHistos ) fillHistos ( static_cast< int >(Pixel.getSignal()), static_cast< int >(correctedPixel.getSignal()), iDetector );
                		
                		// Debug output:
-                    streamlog_out ( DEBUG5 ) << "evt" << evt->getEventNumber() << " ROC" << iDetector << " Pixel " << Pixel.getXCoord() << " " << Pixel.getYCoord() << ": " << Pixel.getSignal() << " -> " << correctedPixel->getSignal() << endl;
+                    streamlog_out ( DEBUG5 ) << "evt" << evt->getEventNumber() << " ROC" << iDetector << " Pixel " << Pixel.getXCoord() << " " << Pixel.getYCoord() << ": " << Pixel.getSignal() << " -> " << correctedPixel.getSignal() << endl;
                 }
                 else {
                     streamlog_out ( WARNING ) << "evt" << evt->getEventNumber() << " ROC" << iDetector << " Pixel " << Pixel.getXCoord() << " " << Pixel.getYCoord() << ": failed to calibrate! Skipping." << endl;
@@ -359,7 +372,7 @@ void CMSPixelCalibrateEventProcessor::processEvent (LCEvent * event) {
                     // This event contains pixel that cannot be calibrated and has to be skipped.
                     throw SkipEventException(this);  
                 }
-                correctedData.addSparsePixel( correctedPixel.get() );			
+                correctedData.addSparsePixel( &correctedPixel );			
                 
             }
             correctedDataCollection->push_back( corrected );
@@ -389,13 +402,40 @@ void CMSPixelCalibrateEventProcessor::end() {
 }
 
 
-bool CMSPixelCalibrateEventProcessor::calTanH(double &corr, double y, double p0, double p1, double p2, double p3) {
-  // Check for ATanh boundaries, values should be in  (-1,1)
-  if(-1 < (y-p3)/p2 && (y-p3)/p2 < 1) {
-    corr = (TMath::ATanH((y-p3)/p2) + p1)/p0;
-    return true;
+void CMSPixelCalibrateEventProcessor::addROCCalibration( const std::vector< cal_param > & cal_roc ) {
+  ROCCalibration roc;
+  roc.par0.reserve( cal_roc.size() );
+  roc.par1.reserve( cal_roc.size() );
+  roc.par2.reserve( cal_roc.size() );
+  roc.par3.reserve( cal_roc.size() );
+  for ( size_t iPix = 0; iPix < cal_roc.size(); iPix++ ) {
+    roc.par0.push_back( cal_roc[iPix].par0 );
+    roc.par1.push_back( cal_roc[iPix].par1 );
+    roc.par2.push_back( cal_roc[iPix].par2 );
+    roc.par3.push_back( cal_roc[iPix].par3 );
+  }
+  calibration.push_back( roc );
+}
+
+void CMSPixelCalibrateEventProcessor::calTanH( unsigned int iROC ) {
+  const size_t nPixel = _rawSignal.size();
+  _calibratedSignal.resize( nPixel );
+  _isCalibrated.resize( nPixel );
+  if ( nPixel == 0 ) return;
+
+  const ROCCalibration & roc = calibration[iROC];
+  const double * p0 = &roc.par0[0];
+  const double * p1 = &roc.par1[0];
+  const double * p2 = &roc.par2[0];
+  const double * p3 = &roc.par3[0];
+
+  for ( size_t i = 0; i < nPixel; i++ ) {
+    const int iPix = _pixelIndex[i];
+    const double x = ( _rawSignal[i] - p3[iPix] ) / p2[iPix];
+    // Check for ATanh boundaries, values should be in  (-1,1)
+    _isCalibrated[i] = ( -1 < x && x < 1 );
+    _calibratedSignal[i] = _isCalibrated[i] ? ( TMath::ATanH( x ) + p1[iPix] ) / p0[iPix] : 0.;
   }
-  else return false;
 }
 
 bool CMSPixelCalibrateEventProcessor::calWeibull(double &corr, double y) {
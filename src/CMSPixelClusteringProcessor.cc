@@ -105,7 +105,7 @@ std::string CMSPixelClusteringProcessor::_clusterMorepxHistoName        = "clust
 
 static const int NOCLUSTER=-1;
 
-CMSPixelClusteringProcessor::CMSPixelClusteringProcessor () : Processor("CMSPixelClusteringProcessor"), _zsDataCollectionName(""), _clusterCollectionName(""), _iRun(0), _iEvt(0), _isFirstEvent(true), _iClusters(0), _iPlaneClusters(),  _initialClusterCollectionSize(0), _minNPixels(0), _minXDistance(0), _minYDistance(0), _minDiagDistance(0), _minCharge(0), _fillHistos(false), hotPixelCollectionVec(), _hitIndexMapVec(), _noOfDetector(0), _isGeometryReady(false), _sensorIDVec(), _siPlanesParameters(), _siPlanesLayerLayout(), _orderedSensorIDVec(), _histoInfoFileName(""), _hotPixelCollectionName(""), _clusterSpectraNVector(), _clusterSpectraNxNVector(), _aidaHistoMap() {
+CMSPixelClusteringProcessor::CMSPixelClusteringProcessor () : Processor("CMSPixelClusteringProcessor"), _pixels(), _clusterPixels(), _clusterBegin(), _pixelGrid(), _clusterParent(), _clusterLabel(), _zsDataCollectionName(""), _clusterCollectionName(""), _iRun(0), _iEvt(0), _isFirstEvent(true), _iClusters(0), _iPlaneClusters(),  _initialClusterCollectionSize(0), _minNPixels(0), _minXDistance(0), _minYDistance(0), _minDiagDistance(0), _minCharge(0), _fillHistos(false), hotPixelCollectionVec(), _hitIndexMapVec(), _noOfDetector(0), _isGeometryReady(false), _sensorIDVec(), _siPlanesParameters(), _siPlanesLayerLayout(), _orderedSensorIDVec(), _histoInfoFileName(""), _hotPixelCollectionName(""), _clusterSpectraNVector(), _clusterSpectraNxNVector(), _aidaHistoMap() {
 	 _description = "CMSPixelClusteringProcessor is searching clusters in zero suppressed data.";
 
 	registerInputCollection (LCIO::TRACKERDATA, "ZSDataCollectionName", "LCIO converted data files", _zsDataCollectionName, string("zsdata_pixel"));
@@ -383,10 +383,10 @@ void CMSPixelClusteringProcessor::Clustering(LCEvent * evt, LCCollectionVec * cl
 			streamlog_out ( DEBUG5 ) << "Processing data on detector " << sensorID << ", " << pixelData->size() << " pixels " << endl;
 
 			// Loop over all pixels in the sparseData object.
-			std::vector<EUTelGenericSparsePixel*> PixelVec;
 			EUTelGenericSparsePixel Pixel;
+			_pixels.clear();
 
-			 //Push all single Pixels of one plane in the PixelVec
+			 //Push all single Pixels of one plane in the pixel list
 			for ( unsigned int iPixel = 0; iPixel < pixelData->size(); iPixel++ ) {
 				pixelData->getSparsePixelAt( iPixel, &Pixel);
 
@@ -401,109 +401,32 @@ void CMSPixelClusteringProcessor::Clustering(LCEvent * evt, LCCollectionVec * cl
                     }
                 }
 
-				PixelVec.push_back(new EUTelGenericSparsePixel(Pixel));
+				_pixels.push_back(Pixel);
 			}
 			
-			streamlog_out ( DEBUG5 ) << "Hit Pixels: " << PixelVec.size() << endl;
+			streamlog_out ( DEBUG5 ) << "Hit Pixels: " << _pixels.size() << endl;
 			
 			/* --- Here the real clustering happens --- */
-			 int nClusters = 0;
-			std::vector<int> clusterNumber;
-
-			if (!PixelVec.empty()) clusterNumber.assign(PixelVec.size(), NOCLUSTER);
-			
-			
 			streamlog_out( DEBUG5 ) << "Starting with clustering..." << endl;
-			if (PixelVec.size() > 1) {
-				//Now compare all pixel in one plane with each other
-				for ( unsigned int aPixel=0;aPixel < PixelVec.size();++aPixel) {
-					for ( unsigned int bPixel=aPixel+1; bPixel < PixelVec.size(); ++bPixel) {
-						EUTelGenericSparsePixel *aPix = PixelVec.at(aPixel);
-						EUTelGenericSparsePixel *bPix = PixelVec.at(bPixel);
-						int xDist = abs( aPix->getXCoord() - bPix->getXCoord() );
-						int yDist = abs( aPix->getYCoord() - bPix->getYCoord() );
-						
-						if ( ( xDist <= _minXDistance) && (yDist <= _minYDistance)  ) { // This means they are neighbours in x-direction && this means they are neighbours in y-direction
-							bool skipPixel = false;
-							if (_minDiagDistance != -1) {
-								bool areDiagonalPartners =  (xDist != 0 && yDist != 0);  // If true then these pixels are diagonal partners
-								int diagDist = max(xDist,yDist);
-								if (areDiagonalPartners && diagDist > _minDiagDistance) skipPixel = true;
-							}
-						
-							if (skipPixel == false) {
-								
-								if ( (clusterNumber.at(aPixel) == NOCLUSTER) && clusterNumber.at(bPixel) == NOCLUSTER) { // None of these pixels have been assigned to a cluster
-									++nClusters;
-									clusterNumber.at(aPixel) = nClusters;
-									clusterNumber.at(bPixel) = nClusters;
-									streamlog_out ( DEBUG5 ) << "assigning clusternumber: " << nClusters << endl;
-								}else if ( (clusterNumber.at(aPixel) == NOCLUSTER) && clusterNumber.at(bPixel) != NOCLUSTER) { 
-								    // b was assigned already, a not
-									clusterNumber.at(aPixel) = clusterNumber.at(bPixel);
-								}else if ( (clusterNumber.at(aPixel) != NOCLUSTER) && clusterNumber.at(bPixel) == NOCLUSTER) { 
-								    // a was assigned already, b not
-									clusterNumber.at(bPixel) = clusterNumber.at(aPixel);
-								}else { 
-								    // Both pixels have a clusternumber already
-									int min = std::min(clusterNumber.at(aPixel), clusterNumber.at(bPixel));
-									clusterNumber.at(aPixel) = min;
-									clusterNumber.at(bPixel) = min;
-								}
-							} else { // These pixels are not neighboured due to diagonal cut
-								if ( clusterNumber.at(aPixel) == NOCLUSTER ) {
-									++nClusters;
-									clusterNumber.at(aPixel) = nClusters;
-								}
-								if ( clusterNumber.at(bPixel) == NOCLUSTER ) {
-									++nClusters;
-									clusterNumber.at(bPixel) = nClusters;
-								}
-							}
-						} else { // These pixels are not neighboured
-							if ( clusterNumber.at(aPixel) == NOCLUSTER ) {
-								++nClusters;
-								clusterNumber.at(aPixel) = nClusters;
-							}
-							if ( clusterNumber.at(bPixel) == NOCLUSTER ) {
-								++nClusters;
-								clusterNumber.at(bPixel) = nClusters;
-							}
-						}
-					}
-				}
-			} else { 
-			    // You can't use the clustering algorithm with only one pixel
-				if (PixelVec.size() == 1) clusterNumber.at(0) = 1;
-			}
-			
-			// It happens, that nCluster is higher that the real number of clusters, as a clusternumber can be deleted in the else-block, so lets correct it
-			std::set<int> clusterSet;
-			for (unsigned int i=0; i<PixelVec.size();++i) {
-				clusterSet.insert(clusterNumber.at(i));
-				if ( clusterNumber.at(i) == NOCLUSTER) {streamlog_out(MESSAGE1) << "Cluster with ID -1 in " << i << endl;}
-			}
-			nClusters = clusterSet.size();
-			
+			const int nClusters = findClusters();
 			
 			if (nClusters != 0) streamlog_out( DEBUG5 ) << "Found " << nClusters << " clusters in sensor " << sensorID<< endl;
 			
 			/* --- Finished Clustering --- */
 			
 			/* --- Push back one Collection per Cluster --- */
-			std::set<int>::iterator it;
-			for (it = clusterSet.begin(); it != clusterSet.end(); ++it) {
+			for ( int iCluster = 0; iCluster < nClusters; ++iCluster ) {
+				const int clusterID = iCluster + 1;
 				lcio::TrackerPulseImpl * pulseFrame = new lcio::TrackerPulseImpl();
 				lcio::TrackerDataImpl * clusterFrame = new lcio::TrackerDataImpl();
-				eutelescope::EUTelSparseClusterImpl< eutelescope::EUTelGenericSparsePixel > *pixelCluster = new eutelescope::EUTelSparseClusterImpl< eutelescope::EUTelGenericSparsePixel >(clusterFrame);	
-				for (unsigned int i=0;i< PixelVec.size();i++) {
-					if(clusterNumber.at(i)== *it) { 
-					    // Put only these pixels in that ClusterCollection that belong to that cluster
-						pixelCluster->addSparsePixel(PixelVec.at(i));
-						streamlog_out( DEBUG5 ) << "Adding Pixel " << i << " to cluster " << clusterNumber.at(i) << endl;
-					}
+				auto_ptr< eutelescope::EUTelSparseClusterImpl< eutelescope::EUTelGenericSparsePixel > > pixelCluster( new eutelescope::EUTelSparseClusterImpl< eutelescope::EUTelGenericSparsePixel >(clusterFrame) );
+				for ( int i = _clusterBegin[iCluster]; i < _clusterBegin[iCluster + 1]; i++ ) {
+				    // Put only these pixels in that ClusterCollection that belong to that cluster
+					pixelCluster->addSparsePixel( &_pixels[ _clusterPixels[i] ] );
+					streamlog_out( DEBUG5 ) << "Adding Pixel " << _clusterPixels[i] << " to cluster " << clusterID << endl;
 				}
 	            
+	            bool isAccepted = false;
 	            streamlog_out( DEBUG5 ) << "size: " << pixelCluster->size() << ">=" << _minNPixels << " && charge: " << pixelCluster->getTotalCharge() << ">=" << _minCharge << endl;
                 if ( (pixelCluster->size() >= static_cast< unsigned int >(_minNPixels)) && (pixelCluster->getTotalCharge() >= static_cast< unsigned int >(_minCharge)) ) {
 
@@ -517,11 +440,10 @@ void CMSPixelClusteringProcessor::Clustering(LCEvent * evt, LCCollectionVec * cl
 					pixelCluster->getClusterSize(xsize,ysize);
 					if (x >= 0 && x <= _siPlanesLayerLayout->getSensitiveNpixelX( _layerIndexMap[ sensorID ] ) && 
 					    y >= 0 && y <= _siPlanesLayerLayout->getSensitiveNpixelY( _layerIndexMap[ sensorID ] )) {
-						streamlog_out( DEBUG5 ) << "Clustervars: ROC" << sensorID << " Cl" << *it << " x" << x << " y" << y << " dx" <<xsize << " dy" << ysize << " " << type << endl;
+						streamlog_out( DEBUG5 ) << "Clustervars: ROC" << sensorID << " Cl" << clusterID << " x" << x << " y" << y << " dx" <<xsize << " dy" << ysize << " " << type << endl;
 						_iClusters++;
 						_iPlaneClusters[sensorID]++;
 
-						int clusterID = *it;
 						zsDataEncoder["sensorID"]      = sensorID;
 						zsDataEncoder["clusterID"]     = clusterID;
 						zsDataEncoder["xSeed"]         = static_cast< long >(x);
@@ -539,9 +461,15 @@ void CMSPixelClusteringProcessor::Clustering(LCEvent * evt, LCCollectionVec * cl
 						idClusterEncoder["type"] 		= static_cast<int>(kEUTelSparseClusterImpl);
 						idClusterEncoder.setCellID(clusterFrame);
 						sparseClusterCollectionVec->push_back(clusterFrame);
+						isAccepted = true;
 					}
-					else streamlog_out( DEBUG5 ) << "No cluster: ROC" << sensorID << " Cl" << *it << " x" << x << " y" << y << " dx" <<xsize << " dy" << ysize << " " << type << endl;
+					else streamlog_out( DEBUG5 ) << "No cluster: ROC" << sensorID << " Cl" << clusterID << " x" << x << " y" << y << " dx" <<xsize << " dy" << ysize << " " << type << endl;
+
+				}
 
+				if ( !isAccepted ) {
+					delete pulseFrame;
+					delete clusterFrame;
 				}
             }
 		 }
@@ -549,6 +477,91 @@ void CMSPixelClusteringProcessor::Clustering(LCEvent * evt, LCCollectionVec * cl
     evt->addCollection( sparseClusterCollectionVec, "original_zsdata" );
 }
 
+int CMSPixelClusteringProcessor::findClusterRoot( int iPixel ) {
+	while ( _clusterParent[iPixel] != iPixel ) {
+		// path halving: every pixel on the way points to its grandparent
+		_clusterParent[iPixel] = _clusterParent[ _clusterParent[iPixel] ];
+		iPixel = _clusterParent[iPixel];
+	}
+	return iPixel;
+}
+
+int CMSPixelClusteringProcessor::findClusters() {
+
+	const int nPixels = _pixels.size();
+	_clusterBegin.assign( 1, 0 );
+	_clusterPixels.clear();
+	if ( nPixels == 0 ) return 0;
+
+	// Bounding box of the hit pixels, the grid has one cell per pixel
+	int xMin = _pixels[0].getXCoord();
+	int xMax = xMin;
+	int yMin = _pixels[0].getYCoord();
+	int yMax = yMin;
+	for ( int iPixel = 1; iPixel < nPixels; ++iPixel ) {
+		xMin = std::min( xMin, static_cast< int >( _pixels[iPixel].getXCoord() ) );
+		xMax = std::max( xMax, static_cast< int >( _pixels[iPixel].getXCoord() ) );
+		yMin = std::min( yMin, static_cast< int >( _pixels[iPixel].getYCoord() ) );
+		yMax = std::max( yMax, static_cast< int >( _pixels[iPixel].getYCoord() ) );
+	}
+	const int nX = xMax - xMin + 1;
+	const int nY = yMax - yMin + 1;
+	_pixelGrid.assign( nX * nY, NOCLUSTER );
+
+	// Every pixel starts as its own cluster. Only the pixels before the
+	// current one are in the grid, so each pair of neighbours is merged
+	// once. The root of a cluster is always its first pixel.
+	_clusterParent.resize( nPixels );
+	for ( int iPixel = 0; iPixel < nPixels; ++iPixel ) _clusterParent[iPixel] = iPixel;
+
+	for ( int iPixel = 0; iPixel < nPixels; ++iPixel ) {
+		const int x = _pixels[iPixel].getXCoord() - xMin;
+		const int y = _pixels[iPixel].getYCoord() - yMin;
+		const int yFirst = std::max( 0, y - _minYDistance );
+		const int yLast  = std::min( nY - 1, y + _minYDistance );
+		const int xFirst = std::max( 0, x - _minXDistance );
+		const int xLast  = std::min( nX - 1, x + _minXDistance );
+		for ( int iy = yFirst; iy <= yLast; ++iy ) {
+			for ( int ix = xFirst; ix <= xLast; ++ix ) {
+				const int neighbour = _pixelGrid[ iy * nX + ix ];
+				if ( neighbour == NOCLUSTER ) continue;
+
+				// These pixels are not neighboured due to diagonal cut
+				const int xDist = abs( ix - x );
+				const int yDist = abs( iy - y );
+				if ( _minDiagDistance != -1 && xDist != 0 && yDist != 0 && std::max( xDist, yDist ) > _minDiagDistance ) continue;
+
+				const int aRoot = findClusterRoot( iPixel );
+				const int bRoot = findClusterRoot( neighbour );
+				if ( aRoot < bRoot )      _clusterParent[bRoot] = aRoot;
+				else if ( bRoot < aRoot ) _clusterParent[aRoot] = bRoot;
+			}
+		}
+		_pixelGrid[ y * nX + x ] = iPixel;
+	}
+
+	// Number the clusters in the order of their first pixel and list
+	// their pixels in input order, cluster after cluster
+	_clusterLabel.resize( nPixels );
+	int nClusters = 0;
+	for ( int iPixel = 0; iPixel < nPixels; ++iPixel ) {
+		const int root = findClusterRoot( iPixel );
+		_clusterLabel[iPixel] = ( root == iPixel ) ? nClusters++ : _clusterLabel[root];
+	}
+
+	_clusterBegin.assign( nClusters + 1, 0 );
+	for ( int iPixel = 0; iPixel < nPixels; ++iPixel ) ++_clusterBegin[ _clusterLabel[iPixel] + 1 ];
+	for ( int iCluster = 0; iCluster < nClusters; ++iCluster ) _clusterBegin[iCluster + 1] += _clusterBegin[iCluster];
+
+	// _clusterParent is not needed any more, it keeps the next free
+	// slot of every cluster
+	_clusterPixels.resize( nPixels );
+	std::copy( _clusterBegin.begin(), _clusterBegin.end() - 1, _clusterParent.begin() );
+	for ( int iPixel = 0; iPixel < nPixels; ++iPixel ) _clusterPixels[ _clusterParent[ _clusterLabel[iPixel] ]++ ] = iPixel;
+
+	return nClusters;
+}
+
 void CMSPixelClusteringProcessor::check (LCEvent * /* evt */) {
     // Nothing to check here - could be used to fill check plots in reconstruction processor
 }
@@ -17,6 +17,8 @@
 #include <IMPL/TrackImpl.h>
 #include <UTIL/CellIDDecoder.h>
 
+#include <TTree.h>
+
 #include <algorithm>
 
 using namespace eutelescope;
@@ -36,30 +38,36 @@ EUTelAPIXTbTrackTuple::EUTelAPIXTbTrackTuple()
   _runNr(0),
   _evtNr(0),
   _isFirstEvent(false),
-  _file(NULL),
-  _eutracks(NULL),
+  _basketSize(0),
+  _autoFlush(0),
+  _compressionLevel(-1),
+  _writerQueueDepth(0),
+  _tuple(),
   _nTrackParams(0),
-  _xPos(NULL),
-  _yPos(NULL),
-  _dxdz(NULL),
-  _dydz(NULL),
-  _trackIden(NULL),
-  _trackNum(NULL),
-  _chi2(NULL),
-  _ndof(NULL),
-  _zstree(NULL),
+  _colNTrackParams(0),
+  _colTrackEvt(0),
+  _colXPos(0),
+  _colYPos(0),
+  _colDxdz(0),
+  _colDydz(0),
+  _colTrackNum(0),
+  _colTrackIden(0),
+  _colChi2(0),
+  _colNdof(0),
   _nPixHits(0),
-  p_col(NULL),
-  p_row(NULL),
-  p_tot(NULL),
-  p_iden(NULL),
-  p_lv1(NULL),
-  _euhits(NULL),
+  _colNPixHits(0),
+  _colZsEvt(0),
+  _colCol(0),
+  _colRow(0),
+  _colTot(0),
+  _colLv1(0),
+  _colIden(0),
   _nHits(0),
-  _hitXPos(NULL),
-  _hitYPos(NULL),
-  _hitZPos(NULL),
-  _hitSensorId(NULL)
+  _colNHits(0),
+  _colHitXPos(0),
+  _colHitYPos(0),
+  _colHitZPos(0),
+  _colHitSensorId(0)
  {
   //processor description
   _description = "Prepare tbtrack style n-tuple with track fit results" ;
@@ -81,6 +89,18 @@ EUTelAPIXTbTrackTuple::EUTelAPIXTbTrackTuple()
   registerProcessorParameter ("DUTIDs", "Int std::vector containing the IDs of the DUTs",
 		  		_DUTIDs, std::vector<int>());
 
+  registerOptionalParameter ("BasketSize", "Basket size in bytes of the branches, 0 for the ROOT default",
+		  		_basketSize, static_cast<int>(0));
+
+  registerOptionalParameter ("AutoFlush", "Cluster size of the trees (TTree::SetAutoFlush): >0 entries, <0 bytes, 0 for the ROOT default",
+		  		_autoFlush, static_cast<int>(0));
+
+  registerOptionalParameter ("CompressionLevel", "ROOT compression level of the output file, -1 for the ROOT default",
+		  		_compressionLevel, static_cast<int>(-1));
+
+  registerOptionalParameter ("WriterQueueDepth", "Number of events buffered for a background writer thread, 0 to write in the processing thread",
+		  		_writerQueueDepth, static_cast<int>(0));
+
 }
 
 
@@ -210,20 +230,30 @@ void EUTelAPIXTbTrackTuple::processEvent( LCEvent * event )
 	}
  
         //fill the trees	
-	_zstree->Fill();
-	_eutracks->Fill();
-	_euhits->Fill();
+	_tuple.set( _colNTrackParams, _nTrackParams );
+	_tuple.set( _colTrackEvt, _nEvt );
+	_tuple.set( _colNPixHits, _nPixHits );
+	_tuple.set( _colZsEvt, _nEvt );
+	_tuple.set( _colNHits, _nHits );
+	_tuple.fill();
 
 	_isFirstEvent = false;
 }
 
 void EUTelAPIXTbTrackTuple::end()
 {
+	//all events must be in the trees before anything else is written to the file
+	_tuple.finish();
+
 	//write version number
-	_versionNo->push_back(1.1);
-	_versionTree->Fill();
+	_tuple.getFile()->cd();
+	std::vector<double> versionNo(1, 1.1);
+	std::vector<double>* versionNoAddress = &versionNo;
+	TTree* versionTree = new TTree("version","version");
+	versionTree->Branch("no", &versionNoAddress);
+	versionTree->Fill();
 	//Maybe some stats output?
-	_file->Write();
+	_tuple.close();
 }
 
 //Read in TrackerHit(Impl) to later dump them
@@ -272,10 +302,10 @@ bool EUTelAPIXTbTrackTuple::readHits( std::string hitColName, LCEvent* event )
 		xUnRot += _xSensSize.at(sensorID)/2.0;
 		yUnRot += _ySensSize.at(sensorID)/2.0;
 		
-    		_hitXPos->push_back(xUnRot);
-    		_hitYPos->push_back(yUnRot);
-    		_hitZPos->push_back(z);
-    		_hitSensorId->push_back(sensorID);
+    		_tuple.push_back( _colHitXPos, xUnRot);
+    		_tuple.push_back( _colHitYPos, yUnRot);
+    		_tuple.push_back( _colHitZPos, z);
+    		_tuple.push_back( _colHitSensorId, sensorID);
 	}
 
 	return true;
@@ -336,14 +366,14 @@ bool EUTelAPIXTbTrackTuple::readTracks(LCEvent* event)
       			//double z = pos[2]; //not used!
 			
 				//eutrack tree
-      			_xPos->push_back(x);
-      			_yPos->push_back(y);
-      			_dxdz->push_back(dxdz);
-      			_dydz->push_back(dydz);
-      			_trackIden->push_back(sensorID);
-      			_trackNum->push_back(itrack);
-      			_chi2->push_back(chi2);
-      			_ndof->push_back(ndof);
+      			_tuple.push_back( _colXPos, x);
+      			_tuple.push_back( _colYPos, y);
+      			_tuple.push_back( _colDxdz, dxdz);
+      			_tuple.push_back( _colDydz, dydz);
+      			_tuple.push_back( _colTrackIden, sensorID);
+      			_tuple.push_back( _colTrackNum, itrack);
+      			_tuple.push_back( _colChi2, chi2);
+      			_tuple.push_back( _colNdof, ndof);
     		}
   	}
 
@@ -382,11 +412,11 @@ bool EUTelAPIXTbTrackTuple::readZsHits( std::string colName, LCEvent* event)
 			{
 				apixData->getSparsePixelAt( iHit, &apixPixel);
 				_nPixHits++;
-				p_iden->push_back( sensorID );
-				p_row->push_back( apixPixel.getYCoord() );
-				p_col->push_back( apixPixel.getXCoord() );
-				p_tot->push_back( static_cast< int >(apixPixel.getSignal()) );
-				p_lv1->push_back( static_cast< int >(apixPixel.getTime()) );
+				_tuple.push_back( _colIden, sensorID );
+				_tuple.push_back( _colRow, apixPixel.getYCoord() );
+				_tuple.push_back( _colCol, apixPixel.getXCoord() );
+				_tuple.push_back( _colTot, static_cast< int >(apixPixel.getSignal()) );
+				_tuple.push_back( _colLv1, static_cast< int >(apixPixel.getTime()) );
      		}
     	}
 		else
@@ -399,90 +429,46 @@ bool EUTelAPIXTbTrackTuple::readZsHits( std::string colName, LCEvent* event)
 
 void EUTelAPIXTbTrackTuple::clear()
 {
-	/* Clear zsdata */
-	p_col->clear();
-	p_row->clear();
-	p_tot->clear();
-	p_iden->clear();
-	p_lv1->clear();
+	/* Clear zsdata, hittrack and hits, the buffers keep their memory */
+	_tuple.clearRow();
 	_nPixHits = 0;
-	/* Clear hittrack */
-	_xPos->clear();
-	_yPos->clear();
-	_dxdz->clear();
-	_dydz->clear();
-	_trackNum->clear();
-	_trackIden->clear();
-	_chi2->clear();
-	_ndof->clear();
-	//Clear hits
-	_hitXPos->clear();
-	_hitYPos->clear();
-	_hitZPos->clear();
-	_hitSensorId->clear();
 }
 
 void EUTelAPIXTbTrackTuple::prepareTree()
 {
-	_file = new TFile(_path2file.c_str(),"RECREATE");
-
-	_xPos = new std::vector<double>();	     
-	_yPos = new std::vector<double>();	   
-	_dxdz = new std::vector<double>();	   
-	_dydz = new std::vector<double>();	   
-	_trackIden  = new std::vector<int>();
-	_trackNum = new std::vector<int>();
-	_chi2 = new std::vector<double>();	   
-	_ndof = new std::vector<double>();    
-
-	p_col = new std::vector<int>();
-	p_row = new std::vector<int>();
-	p_tot = new std::vector<int>();
-	p_iden = new std::vector<int>();
-	p_lv1 = new std::vector<int>();
-
-	_hitXPos = new std::vector<double>();
-	_hitYPos = new std::vector<double>();
-	_hitZPos = new std::vector<double>();
-	_hitSensorId  = new std::vector<int>();
-
-	_versionNo = new std::vector<double>();
-	_versionTree = new TTree("version","version");
-	_versionTree->Branch("no", &_versionNo);
-
-	_euhits = new TTree("fitpoints","fitpoints");
-	_euhits->SetAutoSave(1000000000);
-	
-	_euhits->Branch("nHits", &_nHits);
-	_euhits->Branch("xPos", &_hitXPos);
-	_euhits->Branch("yPos", &_hitYPos);
-	_euhits->Branch("zPos", &_hitZPos);
-	_euhits->Branch("sensorId", &_hitSensorId);
-
-	_zstree = new TTree("rawdata", "rawdata");
-	_zstree->SetAutoSave(1000000000);
-	_zstree->Branch("nPixHits", &_nPixHits);
-	_zstree->Branch("euEvt",    &_nEvt);
-	_zstree->Branch("col",      &p_col);
-	_zstree->Branch("row",      &p_row);
-	_zstree->Branch("tot",      &p_tot);
-	_zstree->Branch("lv1",      &p_lv1);
-	_zstree->Branch("iden",     &p_iden);
+	_tuple.open(_path2file, _compressionLevel, _basketSize, _autoFlush, _writerQueueDepth);
+
+	const int euhits = _tuple.addTree("fitpoints","fitpoints");
+	_colNHits       = _tuple.addColumn(euhits, "nHits",    EUTelRootTupleWriter::kInt);
+	_colHitXPos     = _tuple.addColumn(euhits, "xPos",     EUTelRootTupleWriter::kDoubleVector, 16);
+	_colHitYPos     = _tuple.addColumn(euhits, "yPos",     EUTelRootTupleWriter::kDoubleVector, 16);
+	_colHitZPos     = _tuple.addColumn(euhits, "zPos",     EUTelRootTupleWriter::kDoubleVector, 16);
+	_colHitSensorId = _tuple.addColumn(euhits, "sensorId", EUTelRootTupleWriter::kIntVector, 16);
+
+	const int zstree = _tuple.addTree("rawdata", "rawdata");
+	_colNPixHits = _tuple.addColumn(zstree, "nPixHits", EUTelRootTupleWriter::kInt);
+	_colZsEvt    = _tuple.addColumn(zstree, "euEvt",    EUTelRootTupleWriter::kInt);
+	_colCol      = _tuple.addColumn(zstree, "col",      EUTelRootTupleWriter::kIntVector, 256);
+	_colRow      = _tuple.addColumn(zstree, "row",      EUTelRootTupleWriter::kIntVector, 256);
+	_colTot      = _tuple.addColumn(zstree, "tot",      EUTelRootTupleWriter::kIntVector, 256);
+	_colLv1      = _tuple.addColumn(zstree, "lv1",      EUTelRootTupleWriter::kIntVector, 256);
+	_colIden     = _tuple.addColumn(zstree, "iden",     EUTelRootTupleWriter::kIntVector, 256);
 
 	//Tree for storing all track param info
-	_eutracks = new TTree("tracks", "tracks");
-	_eutracks->SetAutoSave(1000000000);
-	_eutracks->Branch("nTrackParams", &_nTrackParams);
-	_eutracks->Branch("euEvt", &_nEvt);
-	_eutracks->Branch("xPos", &_xPos);
-	_eutracks->Branch("yPos", &_yPos);
-	_eutracks->Branch("dxdz", &_dxdz);
-	_eutracks->Branch("dydz", &_dydz);
-	_eutracks->Branch("trackNum", &_trackNum);
-	_eutracks->Branch("iden", &_trackIden);
-	_eutracks->Branch("chi2", &_chi2);
-	_eutracks->Branch("ndof", &_ndof);
-
-	_euhits->AddFriend(_zstree);
-	_euhits->AddFriend(_eutracks);
+	const int eutracks = _tuple.addTree("tracks", "tracks");
+	_colNTrackParams = _tuple.addColumn(eutracks, "nTrackParams", EUTelRootTupleWriter::kInt);
+	_colTrackEvt     = _tuple.addColumn(eutracks, "euEvt",        EUTelRootTupleWriter::kInt);
+	_colXPos         = _tuple.addColumn(eutracks, "xPos",         EUTelRootTupleWriter::kDoubleVector, 16);
+	_colYPos         = _tuple.addColumn(eutracks, "yPos",         EUTelRootTupleWriter::kDoubleVector, 16);
+	_colDxdz         = _tuple.addColumn(eutracks, "dxdz",         EUTelRootTupleWriter::kDoubleVector, 16);
+	_colDydz         = _tuple.addColumn(eutracks, "dydz",         EUTelRootTupleWriter::kDoubleVector, 16);
+	_colTrackNum     = _tuple.addColumn(eutracks, "trackNum",     EUTelRootTupleWriter::kIntVector, 16);
+	_colTrackIden    = _tuple.addColumn(eutracks, "iden",         EUTelRootTupleWriter::kIntVector, 16);
+	_colChi2         = _tuple.addColumn(eutracks, "chi2",         EUTelRootTupleWriter::kDoubleVector, 16);
+	_colNdof         = _tuple.addColumn(eutracks, "ndof",         EUTelRootTupleWriter::kDoubleVector, 16);
+
+	_tuple.addFriend(euhits, zstree);
+	_tuple.addFriend(euhits, eutracks);
+
+	_tuple.book();
 }
@@ -19,6 +19,7 @@
 #include "EUTelBrickedClusterImpl.h"
 #include "EUTelSparseClusterImpl.h"
 #include "EUTelEtaFunctionImpl.h"
+#include "EUTelEtaFunction2DImpl.h"
 #include "EUTelPseudo1DHistogram.h"
 #include "EUTelExceptions.h"
 
@@ -59,6 +60,7 @@
 #include <sstream>
 #include <memory>
 #include <cstdlib>
+#include <cmath>
 #include <map>
 
 using namespace std;
@@ -135,6 +137,17 @@ EUTelCalculateEtaProcessor::EUTelCalculateEtaProcessor () : Processor("EUTelCalc
 
   registerOptionalParameter("RejectSinglePixelCluster","reject single pixel cluster. 1=reject, 0=keep, 2=reject clusters with two pixels, where the second pixel is not diagonal to the seed. ",_rejectsingplepixelcluster, static_cast <int> (0));
 
+  registerOptionalParameter("Eta2DCollectionName",
+                            "Set the name of the collection of 2D eta maps (leave empty not to calculate them)",
+                            _eta2DCollectionName, string(""));
+
+  IntVec noOfBin2DExample;
+  noOfBin2DExample.push_back(50);
+  noOfBin2DExample.push_back(50);
+  registerOptionalParameter("NumberOfBins2D",
+                            "Write here in how many bins the seed pixel should be divided (x and y) for the 2D eta maps",
+                            _noOfBin2D, noOfBin2DExample, noOfBin2DExample.size());
+
 
 
 }
@@ -154,12 +167,17 @@ void EUTelCalculateEtaProcessor::init () {
   _cogHistogramY.clear();
   _integralHistoX.clear();
   _integralHistoY.clear();
+  _cogHisto2D.clear();
 
   if(_rejectsingplepixelcluster != 0 && _rejectsingplepixelcluster != 1 && _rejectsingplepixelcluster != 2)
     {
       streamlog_out ( ERROR4 ) << "the parameter RejectSinglePixelCluster must set to 0,1 or 2, but it is "<<  _rejectsingplepixelcluster<< endl;
       exit(-1);
     }
+
+  if ( !_eta2DCollectionName.empty() && ( _noOfBin2D.size() != 2 || _noOfBin2D[0] < 1 || _noOfBin2D[1] < 1 ) ) {
+    throw InvalidParameterException("NumberOfBins2D must be two positive numbers of bins along x and y");
+  }
 }
 
 void EUTelCalculateEtaProcessor::processRunHeader (LCRunHeader * rdr) {
@@ -416,6 +434,20 @@ void EUTelCalculateEtaProcessor::processEvent (LCEvent * event) {
               {
                 _cogHistogramX[detectorID]->fill(static_cast<double>(xShift), 1.0);
                 _cogHistogramY[detectorID]->fill(static_cast<double>(yShift), 1.0);
+
+                if ( !_eta2DCollectionName.empty() ) {
+                  // same binning as the pseudo histograms: the right edge
+                  // belongs to the last bin, entries outside are dropped
+                  vector< double > & cogHisto2D = _cogHisto2D[ detectorID ];
+                  if ( cogHisto2D.empty() ) cogHisto2D.assign( _noOfBin2D[0] * _noOfBin2D[1], 0. );
+                  double xBin = floor( ( xShift - _min ) / ( _max - _min ) * _noOfBin2D[0] );
+                  double yBin = floor( ( yShift - _min ) / ( _max - _min ) * _noOfBin2D[1] );
+                  if ( xShift == _max ) xBin = _noOfBin2D[0] - 1;
+                  if ( yShift == _max ) yBin = _noOfBin2D[1] - 1;
+                  if ( xBin >= 0 && xBin < _noOfBin2D[0] && yBin >= 0 && yBin < _noOfBin2D[1] ) {
+                    cogHisto2D[ static_cast< int >( yBin ) * _noOfBin2D[0] + static_cast< int >( xBin ) ] += 1.0;
+                  }
+                }
               }
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
             {
@@ -568,9 +600,11 @@ void EUTelCalculateEtaProcessor::finalizeProcessor() {
 
     int iDetector = iter->first;
 
+    // running sum instead of integral(1, iBin) for every bin
+    integral = 0;
     for (int iBin = 1; iBin <= _cogHistogramX[iDetector]->getNumberOfBins(); iBin++ ) {
       double x = _cogHistogramX[iDetector]->getBinCenter(iBin);
-      integral = _cogHistogramX[iDetector]->integral(1, iBin);
+      integral += _cogHistogramX[iDetector]->getBinContent(iBin);
       _integralHistoX[iDetector]->fill(x, integral);
 
     }
@@ -593,9 +627,10 @@ void EUTelCalculateEtaProcessor::finalizeProcessor() {
     etaBinCenter.clear();
     etaBinValue.clear();
 
+    integral = 0;
     for (int iBin = 1; iBin <= _cogHistogramY[iDetector]->getNumberOfBins(); iBin++ ) {
       double y = _cogHistogramY[iDetector]->getBinCenter(iBin);
-      integral = _cogHistogramY[iDetector]->integral(1, iBin);
+      integral += _cogHistogramY[iDetector]->getBinContent(iBin);
       _integralHistoY[iDetector]->fill(y, integral);
     }
 
@@ -665,6 +700,14 @@ void EUTelCalculateEtaProcessor::finalizeProcessor() {
   event->addCollection(etaXCollection, _etaXCollectionName);
   event->addCollection(etaYCollection, _etaYCollectionName);
 
+  if ( !_eta2DCollectionName.empty() ) {
+    LCCollectionVec * eta2DCollection = new LCCollectionVec(LCIO::LCGENERICOBJECT);
+    for ( map< int, vector< double > >::iterator iter2D = _cogHisto2D.begin(); iter2D != _cogHisto2D.end(); ++iter2D ) {
+      eta2DCollection->push_back( calculateEta2D( iter2D->first, iter2D->second ) );
+    }
+    event->addCollection(eta2DCollection, _eta2DCollectionName);
+  }
+
   lcWriter->writeEvent(event);
   delete event;
 
@@ -678,6 +721,61 @@ void EUTelCalculateEtaProcessor::finalizeProcessor() {
 }
 
 
+EUTelEtaFunction2DImpl * EUTelCalculateEtaProcessor::calculateEta2D(int sensorID, const vector< double > & cogHisto2D) const {
+
+  const int nBinX = _noOfBin2D[0];
+  const int nBinY = _noOfBin2D[1];
+
+  // the eta value along x is the integral of the CoG distribution
+  // along x in the same y bin, and viceversa. Rows and columns without
+  // entries get the eta function of the projection
+  vector< double > xProjection( nBinX, 0. );
+  vector< double > yProjection( nBinY, 0. );
+  for ( int iY = 0; iY < nBinY; iY++ ) {
+    for ( int iX = 0; iX < nBinX; iX++ ) {
+      xProjection[iX] += cogHisto2D[ iY * nBinX + iX ];
+      yProjection[iY] += cogHisto2D[ iY * nBinX + iX ];
+    }
+  }
+  for ( int iX = 1; iX < nBinX; iX++ ) xProjection[iX] += xProjection[iX - 1];
+  for ( int iY = 1; iY < nBinY; iY++ ) yProjection[iY] += yProjection[iY - 1];
+
+  vector< double > xEta( nBinX * nBinY, 0. );
+  vector< double > yEta( nBinX * nBinY, 0. );
+  for ( int iY = 0; iY < nBinY; iY++ ) {
+    double integral = 0;
+    for ( int iX = 0; iX < nBinX; iX++ ) {
+      integral += cogHisto2D[ iY * nBinX + iX ];
+      xEta[ iY * nBinX + iX ] = integral;
+    }
+    for ( int iX = 0; iX < nBinX; iX++ ) {
+      double & eta = xEta[ iY * nBinX + iX ];
+      if ( integral > 0 )                    eta = eta / integral - 0.5;
+      else if ( xProjection.back() > 0 )     eta = xProjection[iX] / xProjection.back() - 0.5;
+    }
+  }
+  for ( int iX = 0; iX < nBinX; iX++ ) {
+    double integral = 0;
+    for ( int iY = 0; iY < nBinY; iY++ ) {
+      integral += cogHisto2D[ iY * nBinX + iX ];
+      yEta[ iY * nBinX + iX ] = integral;
+    }
+    for ( int iY = 0; iY < nBinY; iY++ ) {
+      double & eta = yEta[ iY * nBinX + iX ];
+      if ( integral > 0 )                    eta = eta / integral - 0.5;
+      else if ( yProjection.back() > 0 )     eta = yProjection[iY] / yProjection.back() - 0.5;
+    }
+  }
+
+  const double xBinWidth = ( _max - _min ) / nBinX;
+  const double yBinWidth = ( _max - _min ) / nBinY;
+  return new EUTelEtaFunction2DImpl( sensorID, nBinX, nBinY,
+                                     _min + 0.5 * xBinWidth, _max - 0.5 * xBinWidth,
+                                     _min + 0.5 * yBinWidth, _max - 0.5 * yBinWidth,
+                                     xEta, yEta );
+}
+
+
 void EUTelCalculateEtaProcessor::end() {
 
   if(!_isEtaCalculationFinished ){
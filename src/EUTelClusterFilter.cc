@@ -12,6 +12,7 @@
 // eutelescope includes ".h"
 #include "EUTELESCOPE.h"
 #include "EUTelVirtualCluster.h"
+#include "EUTelClusterSummary.h"
 #include "EUTelFFClusterImpl.h"
 #include "EUTelDFFClusterImpl.h"
 #include "EUTelBrickedClusterImpl.h"
@@ -691,6 +692,82 @@ void EUTelClusterFilter::checkCriteria() {
     _rejectionMap.insert( make_pair("SameNumberOfHitCut", rejectedCounter ));
   }
 
+  // the N of the N pixel thresholds are the first number of every set
+  const size_t module = _noOfDetectors + 1;
+  _minNChargePixels.clear();
+  _minNSNRPixels.clear();
+  _minNxNChargePixels.clear();
+  _minNxNSNRPixels.clear();
+  if ( _minNChargeSwitch )   for ( size_t i = 0; i < _minNChargeVec.size();   i += module ) _minNChargePixels.push_back( static_cast<int > ( _minNChargeVec[i] ) );
+  if ( _minNSNRSwitch )      for ( size_t i = 0; i < _minNSNRVec.size();      i += module ) _minNSNRPixels.push_back( static_cast<int > ( _minNSNRVec[i] ) );
+  if ( _minNxNChargeSwitch ) for ( size_t i = 0; i < _minNxNChargeVec.size(); i += module ) _minNxNChargePixels.push_back( static_cast<int > ( _minNxNChargeVec[i] ) );
+  if ( _minNxNSNRSwitch )    for ( size_t i = 0; i < _minNxNSNRVec.size();    i += module ) _minNxNSNRPixels.push_back( static_cast<int > ( _minNxNSNRVec[i] ) );
+
+  // only the switched on criteria are applied to the clusters. All of
+  // them are evaluated, so that the rejection summary counts every
+  // failed criterion
+  _clusterCriteria.clear();
+  _dffClusterCriteria.clear();
+  if ( _dffnhitsswitch )        _dffClusterCriteria.push_back( &EUTelClusterFilter::isAboveNumberOfHitPixel );
+  if ( _minTotalChargeSwitch )  _clusterCriteria.push_back( &EUTelClusterFilter::isAboveMinTotalCharge );
+  if ( _minTotalSNRSwitch )     _clusterCriteria.push_back( &EUTelClusterFilter::isAboveMinTotalSNR );
+  if ( _minNChargeSwitch )      _clusterCriteria.push_back( &EUTelClusterFilter::isAboveNMinCharge );
+  if ( _minNSNRSwitch )         _clusterCriteria.push_back( &EUTelClusterFilter::isAboveNMinSNR );
+  if ( _minNxNChargeSwitch )    _clusterCriteria.push_back( &EUTelClusterFilter::isAboveNxNMinCharge );
+  if ( _minNxNSNRSwitch )       _clusterCriteria.push_back( &EUTelClusterFilter::isAboveNxNMinSNR );
+  if ( _minSeedChargeSwitch )   _clusterCriteria.push_back( &EUTelClusterFilter::isAboveMinSeedCharge );
+  if ( _minSeedSNRSwitch )      _clusterCriteria.push_back( &EUTelClusterFilter::isAboveMinSeedSNR );
+  if ( _maxClusterNoiseSwitch ) _clusterCriteria.push_back( &EUTelClusterFilter::isBelowMaxClusterNoise );
+
+  vector< ClusterCriterion > commonCriteria;
+  if ( _clusterQualitySwitch )  commonCriteria.push_back( &EUTelClusterFilter::hasQuality );
+  if ( _insideROISwitch )       commonCriteria.push_back( &EUTelClusterFilter::isInsideROI );
+  if ( _outsideROISwitch )      commonCriteria.push_back( &EUTelClusterFilter::isOutsideROI );
+  _clusterCriteria.insert( _clusterCriteria.end(), commonCriteria.begin(), commonCriteria.end() );
+  _dffClusterCriteria.insert( _dffClusterCriteria.end(), commonCriteria.begin(), commonCriteria.end() );
+
+  streamlog_out ( DEBUG1 ) << _clusterCriteria.size() << " cluster based criteria switched on, "
+                           << _dffClusterCriteria.size() << " for digital fixed frame clusters" << endl;
+}
+
+void EUTelClusterFilter::fillClusterFeatures( const EUTelClusterSummary::Cluster & summary, EUTelVirtualCluster * cluster, ClusterFeatures & features ) const {
+
+  // the noise values are set to the cluster only if the noise related
+  // cuts are possible
+  features.hasNoise = _noiseRelatedCuts;
+
+  if ( features.isDFF ) {
+    if ( _dffnhitsswitch ) features.totalCharge = summary.totalCharge;
+  } else {
+    if ( _minTotalChargeSwitch ) features.totalCharge = summary.totalCharge;
+    if ( _minSeedChargeSwitch )  features.seedCharge  = summary.seedCharge;
+
+    // the pixels are sorted once for all the N pixel thresholds
+    if ( _minNChargeSwitch ) features.nCharge = cluster->getClusterCharge( _minNChargePixels );
+
+    features.nxnCharge.resize( _minNxNChargePixels.size() );
+    for ( size_t i = 0; i < _minNxNChargePixels.size(); ++i ) {
+      features.nxnCharge[i] = cluster->getClusterCharge( _minNxNChargePixels[i], _minNxNChargePixels[i] );
+    }
+
+    if ( features.hasNoise ) {
+      if ( _minTotalSNRSwitch )     features.totalSNR     = cluster->getClusterSNR();
+      if ( _minSeedSNRSwitch )      features.seedSNR      = cluster->getSeedSNR();
+      if ( _maxClusterNoiseSwitch ) features.clusterNoise = cluster->getClusterNoise();
+      if ( _minNSNRSwitch )         features.nSNR         = cluster->getClusterSNR( _minNSNRPixels );
+
+      features.nxnSNR.resize( _minNxNSNRPixels.size() );
+      for ( size_t i = 0; i < _minNxNSNRPixels.size(); ++i ) {
+        features.nxnSNR[i] = cluster->getClusterSNR( _minNxNSNRPixels[i], _minNxNSNRPixels[i] );
+      }
+    }
+  }
+
+  if ( _clusterQualitySwitch ) features.quality = summary.quality;
+  if ( _insideROISwitch || _outsideROISwitch ) {
+    features.xCoG = summary.xCoG;
+    features.yCoG = summary.yCoG;
+  }
 }
 
 
@@ -743,266 +820,162 @@ void EUTelClusterFilter::processEvent (LCEvent * event) {
         vector<int > clusterNoVec(_noOfDetectors, 0);
 
         // CLUSTER BASED CUTS
-        for ( int iPulse = 0; iPulse < pulseCollectionVec->getNumberOfElements(); iPulse++ )
+        // first the figures of merit of all the clusters, taken from the
+        // cluster summary shared with the other processors reading the
+        // same pulse collection...
+        EUTelClusterSummary & clusterSummary = EUTelClusterSummary::getInstance( _inputPulseCollectionName );
+        if ( !clusterSummary.update( evt ) ) throw DataNotAvailableException( _inputPulseCollectionName );
+
+        // ... decoding the cluster again only for the N pixel charges and the noise
+        const bool needsCluster = _minNChargeSwitch || _minNxNChargeSwitch || _noiseRelatedCuts;
+
+        const int nPulses = pulseCollectionVec->getNumberOfElements();
+        if ( static_cast< int >( _clusterFeatures.size() ) < nPulses ) _clusterFeatures.resize( nPulses );
+        for ( int iPulse = 0; iPulse < nPulses; iPulse++ )
         {
-            streamlog_out ( DEBUG1 ) << "Filtering cluster " << iPulse + 1  << " / " << pulseCollectionVec->getNumberOfElements() << endl;
-            TrackerPulseImpl * pulse = dynamic_cast<TrackerPulseImpl* > (pulseCollectionVec->getElementAt(iPulse));
-            ClusterType type         = static_cast<ClusterType> (static_cast<int> ( inputDecoder(pulse)["type"] ));
-            EUTelVirtualCluster * cluster;
-            SparsePixelType       pixelType;
+            streamlog_out ( DEBUG1 ) << "Filtering cluster " << iPulse + 1  << " / " << nPulses << endl;
+            const EUTelClusterSummary::Cluster & summary = clusterSummary[ iPulse ];
+            ClusterType type = summary.type;
 
-            if ( type == kEUTelDFFClusterImpl )
+            if ( !summary.isDecoded )
             {
-                cluster = new EUTelDFFClusterImpl( static_cast<TrackerDataImpl*> (pulse->getTrackerData() ) );
+                streamlog_out ( ERROR4 ) << "Unknown cluster type. Sorry for quitting" << endl;
+                throw UnknownDataTypeException("Cluster type unknown");
             }
-            else if ( type == kEUTelBrickedClusterImpl )
-            {
-                cluster = new EUTelBrickedClusterImpl( static_cast<TrackerDataImpl*> (pulse->getTrackerData() ) );
+            auto_ptr<EUTelVirtualCluster> cluster( needsCluster ? clusterSummary.createCluster( iPulse ) : 0 );
 
-                if ( _noiseRelatedCuts )
+            if ( _noiseRelatedCuts && ( type == kEUTelFFClusterImpl || type == kEUTelBrickedClusterImpl ) )
+            {
+                // the EUTelFFClusterImpl and EUTelBrickedClusterImpl don't
+                // contain the noise and status information in the
+                // TrackerData object. So this is the right place to attach
+                // to the cluster the noise information.
+                //! ---
+                //! ((NOTE TAKI)): actually i think each cluster does contain its own noise values already!
+                //! each candidate, that was created in clusearch, already had its noise set properly!
+                //! this routine here seems to set the noise again but will set noise = 0, if a pixel is a bad one.
+                //! this might cause the bricked cluster to see some pixels with noise = 0 again!
+                //! ---
+                try
                 {
-                    // the EUTelBrickedClusterImpl doesn't contain the noise and status
-                    // information in the TrackerData object. So this is the right
-                    // place to attach to the cluster the noise information.
-                    //! ---
-                    //! ((NOTE TAKI)): actually i think each cluster does contain its own noise values already!
-                    //! each candidate, that was created in clusearch, already had its noise set properly!
-                    //! is this information kept when storing the clusters inside the corresponding collection?
-                    //! not sure what happened to the status, as well!
-                    //! well... this routine here seems to set the noise again but will set noise = 0, if a pixel is a bad one.
-                    //! this might cause the bricked cluster to see some pixels with noise = 0 again!
-                    //! ---
-
-                    try
+                    LCCollectionVec * noiseCollectionVec  = dynamic_cast<LCCollectionVec * > ( evt->getCollection( _noiseCollectionName )) ;
+                    LCCollectionVec * statusCollectionVec = dynamic_cast<LCCollectionVec * > ( evt->getCollection( _statusCollectionName )) ;
+                    CellIDDecoder<TrackerDataImpl> noiseDecoder(noiseCollectionVec);
+
+                    int detectorPos = _ancillaryIndexMap[ summary.sensorID ];
+                    TrackerDataImpl    * noiseMatrix  = dynamic_cast<TrackerDataImpl    *> ( noiseCollectionVec->getElementAt(detectorPos) );
+                    TrackerRawDataImpl * statusMatrix = dynamic_cast<TrackerRawDataImpl *> ( statusCollectionVec->getElementAt(detectorPos) );
+                    EUTelMatrixDecoder   noiseMatrixDecoder(noiseDecoder, noiseMatrix);
+
+                    const int xSeed = summary.xCenter, ySeed = summary.yCenter;
+                    const int xClusterSize = summary.xSize, yClusterSize = summary.ySize;
+                    vector<float > noiseValues;
+                    for ( int yPixel = ySeed - ( yClusterSize / 2 ); yPixel <= ySeed + ( yClusterSize / 2 ); yPixel++ )
                     {
-                        LCCollectionVec * noiseCollectionVec  = dynamic_cast<LCCollectionVec * > ( evt->getCollection( _noiseCollectionName )) ;
-                        LCCollectionVec * statusCollectionVec = dynamic_cast<LCCollectionVec * > ( evt->getCollection( _statusCollectionName )) ;
-                        CellIDDecoder<TrackerDataImpl> noiseDecoder(noiseCollectionVec);
-
-                        int detectorID  = cluster->getDetectorID();
-                        int detectorPos = _ancillaryIndexMap[ detectorID ];
-                        TrackerDataImpl    * noiseMatrix  = dynamic_cast<TrackerDataImpl    *> ( noiseCollectionVec->getElementAt(detectorPos) );
-                        TrackerRawDataImpl * statusMatrix = dynamic_cast<TrackerRawDataImpl *> ( statusCollectionVec->getElementAt(detectorPos) );
-                        EUTelMatrixDecoder   noiseMatrixDecoder(noiseDecoder, noiseMatrix);
-
-                        int xSeed, ySeed, xClusterSize, yClusterSize;
-                        cluster->getCenterCoord(xSeed, ySeed);
-                        cluster->getClusterSize(xClusterSize, yClusterSize);
-                        vector<float > noiseValues;
-                        for ( int yPixel = ySeed - ( yClusterSize / 2 ); yPixel <= ySeed + ( yClusterSize / 2 ); yPixel++ )
+                        for ( int xPixel = xSeed - ( xClusterSize / 2 ); xPixel <= xSeed + ( xClusterSize / 2 ); xPixel++ )
                         {
-                            for ( int xPixel = xSeed - ( xClusterSize / 2 ); xPixel <= xSeed + ( xClusterSize / 2 ); xPixel++ )
-                            {
 
-                                // always check we are still within the sensor!!!
-                                if ( ( xPixel >= noiseMatrixDecoder.getMinX() )  &&  ( xPixel <= noiseMatrixDecoder.getMaxX() ) &&
-                                     ( yPixel >= noiseMatrixDecoder.getMinY() )  &&  ( yPixel <= noiseMatrixDecoder.getMaxY() ) )
+                            // always check we are still within the sensor!!!
+                            if ( ( xPixel >= noiseMatrixDecoder.getMinX() )  &&  ( xPixel <= noiseMatrixDecoder.getMaxX() ) &&
+                                 ( yPixel >= noiseMatrixDecoder.getMinY() )  &&  ( yPixel <= noiseMatrixDecoder.getMaxY() ) )
+                            {
+                                int index = noiseMatrixDecoder.getIndexFromXY(xPixel, yPixel);
+
+                                // the corresponding position in the status matrix has to be HITPIXEL
+                                // in the EUTelClusteringProcessor, we verify also that
+                                // the pixel isHit, but this cannot be done in this
+                                // processor, since the status matrix could have been reset
+                                //
+                                // bool isHit  = ( statusMatrix->getADCValues()[index] ==
+                                // EUTELESCOPE::HITPIXEL );
+                                //
+                                if( static_cast< int >( statusMatrix->getADCValues().size() ) > index )
                                 {
-                                    int index = noiseMatrixDecoder.getIndexFromXY(xPixel, yPixel);
-
-                                    // the corresponding position in the status matrix has to be HITPIXEL
-                                    // in the EUTelClusteringProcessor, we verify also that
-                                    // the pixel isHit, but this cannot be done in this
-                                    // processor, since the status matrix could have been reset
-                                    //
-                                    // bool isHit  = ( statusMatrix->getADCValues()[index] ==
-                                    // EUTELESCOPE::HITPIXEL );
-                                    //
-                                    if( static_cast< int >( statusMatrix->getADCValues().size() ) > index )
-                                    {
-                                    bool isBad  = ( statusMatrix->getADCValues()[index] == EUTELESCOPE::BADPIXEL );
-                                    if ( !isBad )
-                                    {
-                                        noiseValues.push_back( noiseMatrix->getChargeValues()[index] );
-                                    }
-                                    else
-                                    {
-                                        noiseValues.push_back( 0. );
-                                    }
-                                    }
-
+                                bool isBad  = ( statusMatrix->getADCValues()[index] == EUTELESCOPE::BADPIXEL );
+                                if ( !isBad )
+                                {
+                                    noiseValues.push_back( noiseMatrix->getChargeValues()[index] );
                                 }
                                 else
                                 {
                                     noiseValues.push_back( 0. );
                                 }
-                            }
-                        }
-                        cluster->setNoiseValues( noiseValues );
-                    }
-                    catch ( lcio::Exception& e )
-                    {
-                        streamlog_out ( ERROR1 ) << e.what() << endl << "Continuing w/o noise based cuts" << endl;
-                        _noiseRelatedCuts = false;
-                    }
-                }
-            }
-            else if ( type == kEUTelFFClusterImpl )
-            {
-                cluster = new EUTelFFClusterImpl( static_cast<TrackerDataImpl*> (pulse->getTrackerData() ) );
+                                }
 
-                if ( _noiseRelatedCuts )
-                {
-                    // the EUTelFFClusterImpl doesn't contain the noise and status
-                    // information in the TrackerData object. So this is the right
-                    // place to attach to the cluster the noise information.
-                    try
-                    {
-                        LCCollectionVec * noiseCollectionVec  = dynamic_cast<LCCollectionVec * > ( evt->getCollection( _noiseCollectionName )) ;
-                        LCCollectionVec * statusCollectionVec = dynamic_cast<LCCollectionVec * > ( evt->getCollection( _statusCollectionName )) ;
-                        CellIDDecoder<TrackerDataImpl> noiseDecoder(noiseCollectionVec);
-
-                        int detectorID  = cluster->getDetectorID();
-                        int detectorPos = _ancillaryIndexMap[ detectorID ];
-                        TrackerDataImpl    * noiseMatrix  = dynamic_cast<TrackerDataImpl    *> ( noiseCollectionVec->getElementAt(detectorPos) );
-                        TrackerRawDataImpl * statusMatrix = dynamic_cast<TrackerRawDataImpl *> ( statusCollectionVec->getElementAt(detectorPos) );
-                        EUTelMatrixDecoder   noiseMatrixDecoder(noiseDecoder, noiseMatrix);
-
-                        int xSeed, ySeed, xClusterSize, yClusterSize;
-                        cluster->getCenterCoord(xSeed, ySeed);
-                        cluster->getClusterSize(xClusterSize, yClusterSize);
-                        vector<float > noiseValues;
-                        for ( int yPixel = ySeed - ( yClusterSize / 2 ); yPixel <= ySeed + ( yClusterSize / 2 ); yPixel++ )
-                        {
-                            for ( int xPixel = xSeed - ( xClusterSize / 2 ); xPixel <= xSeed + ( xClusterSize / 2 ); xPixel++ )
+                            }
+                            else
                             {
-
-                                // always check we are still within the sensor!!!
-                                if ( ( xPixel >= noiseMatrixDecoder.getMinX() )  &&  ( xPixel <= noiseMatrixDecoder.getMaxX() ) &&
-                                     ( yPixel >= noiseMatrixDecoder.getMinY() )  &&  ( yPixel <= noiseMatrixDecoder.getMaxY() ) )
-                                {
-                                    int index = noiseMatrixDecoder.getIndexFromXY(xPixel, yPixel);
-
-                                    // the corresponding position in the status matrix has to be HITPIXEL
-                                    // in the EUTelClusteringProcessor, we verify also that
-                                    // the pixel isHit, but this cannot be done in this
-                                    // processor, since the status matrix could have been reset
-                                    //
-                                    // bool isHit  = ( statusMatrix->getADCValues()[index] ==
-                                    // EUTELESCOPE::HITPIXEL );
-                                    // 
-                                    ///
-                                    if( static_cast< int >(statusMatrix->getADCValues().size()) > index )
-                                    {
-
-                                    bool isBad  = ( statusMatrix->getADCValues()[index] == EUTELESCOPE::BADPIXEL );
-                                    if ( !isBad )
-                                    {
-                                        noiseValues.push_back( noiseMatrix->getChargeValues()[index] );
-                                    }
-                                    else
-                                    {
-                                        noiseValues.push_back( 0. );
-                                    }
-                                    }
-
-                                }
-                                else
-                                {
-                                    noiseValues.push_back( 0. );
-                                }
+                                noiseValues.push_back( 0. );
                             }
                         }
-                        cluster->setNoiseValues( noiseValues );
-                    }
-                    catch ( lcio::Exception& e )
-                    {
-                        streamlog_out ( ERROR1 ) << e.what() << endl << "Continuing w/o noise based cuts" << endl;
-                        _noiseRelatedCuts = false;
                     }
+                    cluster->setNoiseValues( noiseValues );
+                }
+                catch ( lcio::Exception& e )
+                {
+                    streamlog_out ( ERROR1 ) << e.what() << endl << "Continuing w/o noise based cuts" << endl;
+                    _noiseRelatedCuts = false;
                 }
             }
-            else if ( type == kEUTelSparseClusterImpl )
+            else if ( _noiseRelatedCuts && type == kEUTelSparseClusterImpl )
             {
-                // knowing that is a sparse cluster is not enough we need also
-                // to know also the sparse pixel type. This information is
-                // available in the "original_zsdata" collection. Let's get it!
-                LCCollectionVec * sparseClusterCollectionVec = dynamic_cast < LCCollectionVec * > (evt->getCollection("original_zsdata"));
-                TrackerDataImpl * oneCluster = dynamic_cast<TrackerDataImpl*> (sparseClusterCollectionVec->getElementAt( 0 ));
-                CellIDDecoder<TrackerDataImpl > anotherDecoder(sparseClusterCollectionVec);
-                pixelType = static_cast<SparsePixelType> ( static_cast<int> ( anotherDecoder( oneCluster )["sparsePixelType"] ));
-
-                if ( pixelType == kEUTelGenericSparsePixel )
+                // the summary decodes the sparse clusters as generic sparse
+                // pixel clusters. They don't contain any intrinsic noise
+                // information. So we need to get them from the input noise
+                // collection.
+                EUTelSparseClusterImpl<EUTelGenericSparsePixel > * recasted =
+                dynamic_cast<EUTelSparseClusterImpl<EUTelGenericSparsePixel > *> ( cluster.get() );
+                try
                 {
-                    cluster = new EUTelSparseClusterImpl<EUTelGenericSparsePixel > ( static_cast<TrackerDataImpl* > (pulse->getTrackerData() ));
+                    LCCollectionVec * noiseCollectionVec = dynamic_cast<LCCollectionVec *> ( evt->getCollection( _noiseCollectionName ));
+                    CellIDDecoder<TrackerDataImpl > noiseDecoder( noiseCollectionVec ) ;
 
-                    EUTelSparseClusterImpl<EUTelGenericSparsePixel > * recasted =
-                    dynamic_cast<EUTelSparseClusterImpl<EUTelGenericSparsePixel > *> ( cluster );
+                    int detectorPos = _ancillaryIndexMap[ summary.sensorID ];
+                    TrackerDataImpl    * noiseMatrix = dynamic_cast<TrackerDataImpl *> ( noiseCollectionVec->getElementAt( detectorPos ));
+                    EUTelMatrixDecoder   noiseMatrixDecoder( noiseDecoder, noiseMatrix ) ;
 
-                    if ( _noiseRelatedCuts )
+                    auto_ptr<EUTelGenericSparsePixel>  sparsePixel(new EUTelGenericSparsePixel);
+                    vector<float > noiseValues;
+                    for ( unsigned int iPixel = 0 ; iPixel < recasted->size() ; iPixel++ )
                     {
-                        // the EUTelSparseClusterImpl<EUTelGenericSparsePixel>
-                        // doesn't contain any intrinsic noise information. So we
-                        // need to get them from the input noise collection.
-                        try
-                        {
-                            LCCollectionVec * noiseCollectionVec = dynamic_cast<LCCollectionVec *> ( evt->getCollection( _noiseCollectionName ));
-                            CellIDDecoder<TrackerDataImpl > noiseDecoder( noiseCollectionVec ) ;
-
-                            int detectorID = cluster->getDetectorID();
-                            int detectorPos = _ancillaryIndexMap[ detectorID ];
-                            TrackerDataImpl    * noiseMatrix = dynamic_cast<TrackerDataImpl *> ( noiseCollectionVec->getElementAt( detectorPos ));
-                            EUTelMatrixDecoder   noiseMatrixDecoder( noiseDecoder, noiseMatrix ) ;
-
-                            auto_ptr<EUTelGenericSparsePixel>  sparsePixel(new EUTelGenericSparsePixel);
-                            vector<float > noiseValues;
-                            for ( unsigned int iPixel = 0 ; iPixel < recasted->size() ; iPixel++ )
-                            {
-                                recasted->getSparsePixelAt( iPixel, sparsePixel.get() ) ;
-                                int index = noiseMatrixDecoder.getIndexFromXY( sparsePixel->getXCoord(), sparsePixel->getYCoord() );
-                                noiseValues.push_back( noiseMatrix->getChargeValues()[ index ] );
-                            }
-                            cluster->setNoiseValues( noiseValues ) ;
-                        }
-                        catch ( lcio::Exception&  e )
-                        {
-                            streamlog_out ( ERROR1 )  << e.what() << "\n" << "Continuing without noise based cuts" << endl;
-                            _noiseRelatedCuts = false;
-                        }
-                        streamlog_out ( DEBUG1 ) << "Noise related cuts may be used" << endl;
+                        recasted->getSparsePixelAt( iPixel, sparsePixel.get() ) ;
+                        int index = noiseMatrixDecoder.getIndexFromXY( sparsePixel->getXCoord(), sparsePixel->getYCoord() );
+                        noiseValues.push_back( noiseMatrix->getChargeValues()[ index ] );
                     }
+                    cluster->setNoiseValues( noiseValues ) ;
                 }
-                else
+                catch ( lcio::Exception&  e )
                 {
-                  streamlog_out ( ERROR4 ) << "Unknown pixel type. Sorry for quitting" << endl;
-                  throw UnknownDataTypeException("Pixel type unknown");
+                    streamlog_out ( ERROR1 )  << e.what() << "\n" << "Continuing without noise based cuts" << endl;
+                    _noiseRelatedCuts = false;
                 }
-		}
-            else
-            {
-                streamlog_out ( ERROR4 ) << "Unknown cluster type. Sorry for quitting" << endl;
-                throw UnknownDataTypeException("Cluster type unknown");
+                streamlog_out ( DEBUG1 ) << "Noise related cuts may be used" << endl;
             }
 
             // increment the event counter
-            _totalClusterCounter[ _ancillaryIndexMap[ cluster->getDetectorID() ] ]++;
+            ClusterFeatures & features = _clusterFeatures[ iPulse ];
+            features.detectorID  = summary.sensorID;
+            features.detectorPos = _ancillaryIndexMap[ features.detectorID ];
+            features.isDFF       = ( type == kEUTelDFFClusterImpl );
+            _totalClusterCounter[ features.detectorPos ]++;
 
-            bool isAccepted = true;
+            fillClusterFeatures( summary, cluster.get(), features );
 
-            if ( type == kEUTelDFFClusterImpl )
-            {
-                isAccepted &= isAboveNumberOfHitPixel(cluster);
-            }
-            else
+        }
+
+        // ... then the switched on criteria
+        for ( int iPulse = 0; iPulse < nPulses; iPulse++ )
+        {
+            const ClusterFeatures & features = _clusterFeatures[ iPulse ];
+            const vector< ClusterCriterion > & criteria = features.isDFF ? _dffClusterCriteria : _clusterCriteria;
+
+            bool isAccepted = true;
+            for ( size_t iCriterion = 0; iCriterion < criteria.size(); iCriterion++ )
             {
-                isAccepted &= isAboveMinTotalCharge(cluster);
-                isAccepted &= isAboveMinTotalSNR(cluster);
-                isAccepted &= isAboveNMinCharge(cluster);
-                isAccepted &= isAboveNMinSNR(cluster);
-                isAccepted &= isAboveNxNMinCharge(cluster);
-                isAccepted &= isAboveNxNMinSNR(cluster);
-                isAccepted &= isAboveMinSeedCharge(cluster);
-                isAccepted &= isAboveMinSeedSNR(cluster);
-                isAccepted &= isBelowMaxClusterNoise(cluster);
+                isAccepted &= ( this->*criteria[ iCriterion ] )( features );
             }
-            isAccepted &= hasQuality(cluster);
-            isAccepted &= isInsideROI(cluster);
-            isAccepted &= isOutsideROI(cluster);
 
             if ( isAccepted )  acceptedClusterVec.push_back(iPulse);
-
-            delete cluster;
-
         }
 
         vector<int >::iterator cluIter = acceptedClusterVec.begin();
@@ -1157,18 +1130,17 @@ bool EUTelClusterFilter::hasSameNumberOfHit(std::vector<int > clusterNoVec) cons
   return hasSameNumber;
 }
 
-bool EUTelClusterFilter::isAboveNumberOfHitPixel(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isAboveNumberOfHitPixel(const ClusterFeatures & cluster) const {
   if ( !_dffnhitsswitch ) {
     return true;
   }
   streamlog_out ( DEBUG1 ) << "Filtering against number of hit pixel inside a cluster " << endl;
 
-  int detectorID = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap[ detectorID ];
+  int detectorPos = cluster.detectorPos;
 
-  if ( static_cast< int >(cluster->getTotalCharge()) >= _DFFNHitsCuts[detectorPos] ) return true;
+  if ( static_cast< int >(cluster.totalCharge) >= _DFFNHitsCuts[detectorPos] ) return true;
   else {
-    streamlog_out ( DEBUG2 )  << "Rejected cluster because the number of hit pixel is " << static_cast< int >(cluster->getTotalCharge())
+    streamlog_out ( DEBUG2 )  << "Rejected cluster because the number of hit pixel is " << static_cast< int >(cluster.totalCharge)
                               << " and the threshold is " << _DFFNHitsCuts[detectorPos] << endl;
     _rejectionMap["MinHitPixel"][detectorPos]++;
     return false;
@@ -1177,58 +1149,56 @@ bool EUTelClusterFilter::isAboveNumberOfHitPixel(EUTelVirtualCluster * cluster)
 
 
 
-bool EUTelClusterFilter::isAboveMinTotalCharge(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isAboveMinTotalCharge(const ClusterFeatures & cluster) const {
 
   if ( !_minTotalChargeSwitch ) {
     return true;
   }
   streamlog_out ( DEBUG1 ) << "Filtering against the total charge " << endl;
 
-  int detectorID  = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap[ detectorID ];
+  int detectorPos = cluster.detectorPos;
 
-  if ( cluster->getTotalCharge() > _minTotalChargeVec[detectorPos] ) return true;
+  if ( cluster.totalCharge > _minTotalChargeVec[detectorPos] ) return true;
   else {
-    streamlog_out ( DEBUG2 )  << "Rejected cluster because its charge is " << cluster->getTotalCharge()
+    streamlog_out ( DEBUG2 )  << "Rejected cluster because its charge is " << cluster.totalCharge
                               << " and the threshold is " << _minTotalChargeVec[detectorPos] << endl;
     _rejectionMap["MinTotalChargeCut"][detectorPos]++;
     return false;
   }
 }
 
-bool EUTelClusterFilter::isAboveMinTotalSNR(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isAboveMinTotalSNR(const ClusterFeatures & cluster) const {
 
-  if ( !_noiseRelatedCuts   ) return true;
+  if ( !cluster.hasNoise   ) return true;
   if ( !_minTotalSNRSwitch  ) return true;
 
-  int detectorID  = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap [ detectorID ];
+  int detectorPos = cluster.detectorPos;
 
   streamlog_out ( DEBUG1 ) << "Filtering against the minimum total SNR " << endl;
-  if  ( cluster->getClusterSNR() > _minTotalSNRVec[ detectorPos ] ) return true;
+  if  ( cluster.totalSNR > _minTotalSNRVec[ detectorPos ] ) return true;
   else {
-    streamlog_out ( DEBUG2 )  << "Rejected cluster because its SNR is " << cluster->getClusterSNR()
+    streamlog_out ( DEBUG2 )  << "Rejected cluster because its SNR is " << cluster.totalSNR
                               << " and the threshold is " << _minTotalSNRVec[ detectorPos ] << endl;
     _rejectionMap["MinTotalSNRCut"][detectorPos]++;
     return false;
   }
 }
 
-bool EUTelClusterFilter::isAboveNMinCharge(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isAboveNMinCharge(const ClusterFeatures & cluster) const {
 
   if ( !_minNChargeSwitch ) return true;
 
   streamlog_out ( DEBUG1 ) << "Filtering against the N Pixel charge " << endl;
 
-  int detectorID = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap [ detectorID ];
+  int detectorPos = cluster.detectorPos;
   vector<float >::const_iterator iter = _minNChargeVec.begin();
+  size_t iThreshold = 0;
   while ( iter != _minNChargeVec.end() ) {
-    int nPixel      = static_cast<int > (*iter);
-    float charge    = cluster->getClusterCharge(nPixel);
+    float charge    = cluster.nCharge[ iThreshold ];
     float threshold = (* (iter + detectorPos + 1) );
     if ( charge > threshold ) {
       iter += _noOfDetectors + 1;
+      ++iThreshold;
     } else {
       streamlog_out ( DEBUG2 ) << "Rejected cluster because its charge over " << (*iter) << " is " << charge
                                << " and the threshold is " << threshold << endl;
@@ -1240,22 +1210,22 @@ bool EUTelClusterFilter::isAboveNMinCharge(EUTelVirtualCluster * cluster) const
 }
 
 
-bool EUTelClusterFilter::isAboveNMinSNR(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isAboveNMinSNR(const ClusterFeatures & cluster) const {
 
-  if ( !_noiseRelatedCuts ) return true;
+  if ( !cluster.hasNoise ) return true;
   if ( !_minNSNRSwitch    ) return true;
 
   streamlog_out ( DEBUG1 ) << "Filtering against the N pixel SNR " << endl;
 
-  int detectorID = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap [ detectorID ];
+  int detectorPos = cluster.detectorPos;
   vector<float >::const_iterator iter = _minNSNRVec.begin();
+  size_t iThreshold = 0;
   while ( iter !=  _minNSNRVec.end() ) {
-    int nPixel      = static_cast<int > (*iter);
-    float SNR       = cluster->getClusterSNR(nPixel);
+    float SNR       = cluster.nSNR[ iThreshold ];
     float threshold = (* (iter + detectorPos + 1 ) );
     if ( SNR > threshold ) {
       iter += _noOfDetectors + 1;
+      ++iThreshold;
     } else {
       streamlog_out ( DEBUG2 )  << "Rejected cluster because its SNR over " << (*iter) << " is " << SNR
                                 << " and the threshold is " << threshold  << endl;
@@ -1269,21 +1239,21 @@ bool EUTelClusterFilter::isAboveNMinSNR(EUTelVirtualCluster * cluster) const {
 
 
 
-bool EUTelClusterFilter::isAboveNxNMinCharge(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isAboveNxNMinCharge(const ClusterFeatures & cluster) const {
 
   if ( !_minNxNChargeSwitch ) return true;
 
   streamlog_out ( DEBUG1 ) << "Filtering against the N x N pixel charge" << endl;
 
-  int detectorID = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap [ detectorID ];
+  int detectorPos = cluster.detectorPos;
   vector<float >::const_iterator iter = _minNxNChargeVec.begin();
+  size_t iThreshold = 0;
   while ( iter != _minNxNChargeVec.end() ) {
-    int nxnPixel    = static_cast<int > ( *iter ) ;
-    float charge    = cluster->getClusterCharge(nxnPixel, nxnPixel);
+    float charge    = cluster.nxnCharge[ iThreshold ];
     float threshold = (* ( iter + detectorPos + 1 )) ;
     if ( ( threshold <= 0) || (charge > threshold) ) {
       iter += _noOfDetectors + 1;
+      ++iThreshold;
     } else {
       streamlog_out ( DEBUG2 ) << "Rejected cluster because its charge within a " << (*iter) << " x " << (*iter)
                                << " subcluster is " << charge << " and the threshold is " << threshold << endl;
@@ -1295,22 +1265,22 @@ bool EUTelClusterFilter::isAboveNxNMinCharge(EUTelVirtualCluster * cluster) cons
 }
 
 
-bool EUTelClusterFilter::isAboveNxNMinSNR(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isAboveNxNMinSNR(const ClusterFeatures & cluster) const {
 
-  if ( !_noiseRelatedCuts  ) return true;
+  if ( !cluster.hasNoise  ) return true;
   if ( !_minNxNSNRSwitch   ) return true;
 
   streamlog_out ( DEBUG1 ) << "Filtering against the N x N pixel charge" << endl;
 
-  int detectorID = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap [ detectorID ];
+  int detectorPos = cluster.detectorPos;
   vector<float >::const_iterator iter = _minNxNSNRVec.begin();
+  size_t iThreshold = 0;
   while ( iter != _minNxNSNRVec.end() ) {
-    int nxnPixel    = static_cast<int > ( *iter ) ;
-    float snr       = cluster->getClusterSNR(nxnPixel, nxnPixel);
+    float snr       = cluster.nxnSNR[ iThreshold ];
     float threshold = (* ( iter + detectorPos + 1 )) ;
     if ( ( threshold <= 0) || (snr > threshold) ) {
       iter += _noOfDetectors + 1;
+      ++iThreshold;
     } else {
       streamlog_out ( DEBUG2 )  << "Rejected cluster because its SNR within a " << (*iter) << " x " << (*iter)
                                 << " subcluster is " << snr << " and the threshold is " << threshold << endl;
@@ -1322,35 +1292,33 @@ bool EUTelClusterFilter::isAboveNxNMinSNR(EUTelVirtualCluster * cluster) const {
 
 }
 
-bool EUTelClusterFilter::isAboveMinSeedCharge(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isAboveMinSeedCharge(const ClusterFeatures & cluster) const {
 
   if ( !_minSeedChargeSwitch ) return true;
 
   streamlog_out ( DEBUG1 ) << "Filtering against the seed charge " << endl;
 
-  int detectorID = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap [ detectorID ];
-  if ( cluster->getSeedCharge() > _minSeedChargeVec[detectorPos] ) return true;
+  int detectorPos = cluster.detectorPos;
+  if ( cluster.seedCharge > _minSeedChargeVec[detectorPos] ) return true;
   else {
-    streamlog_out ( DEBUG2 )  << "Rejected cluster because its seed charge is " << cluster->getSeedCharge()
+    streamlog_out ( DEBUG2 )  << "Rejected cluster because its seed charge is " << cluster.seedCharge
                               << " and the threshold is " <<  _minSeedChargeVec[detectorPos] << endl;
     _rejectionMap["MinSeedChargeCut"][detectorPos]++;
     return false;
   }
 }
 
-bool EUTelClusterFilter::isAboveMinSeedSNR(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isAboveMinSeedSNR(const ClusterFeatures & cluster) const {
 
-  if ( !_noiseRelatedCuts  ) return true;
+  if ( !cluster.hasNoise  ) return true;
   if ( !_minSeedSNRSwitch  ) return true;
 
   streamlog_out ( DEBUG1 ) << "Filtering against the seed SNR " << endl;
 
-  int detectorID = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap [ detectorID ];
-  if ( cluster->getSeedSNR() > _minSeedSNRVec[detectorPos] ) return true;
+  int detectorPos = cluster.detectorPos;
+  if ( cluster.seedSNR > _minSeedSNRVec[detectorPos] ) return true;
   else {
-    streamlog_out ( DEBUG2 ) << "Rejected cluster because its seed charge is " << cluster->getSeedSNR()
+    streamlog_out ( DEBUG2 ) << "Rejected cluster because its seed charge is " << cluster.seedSNR
                              << " and the threshold is " <<  _minSeedSNRVec[detectorPos] << endl;
     _rejectionMap["MinSeedSNRCut"][detectorPos]++;
     return false;
@@ -1359,15 +1327,15 @@ bool EUTelClusterFilter::isAboveMinSeedSNR(EUTelVirtualCluster * cluster) const
 
 
 
-bool EUTelClusterFilter::hasQuality(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::hasQuality(const ClusterFeatures & cluster) const {
 
   if ( !_clusterQualitySwitch ) return true;
 
-  int detectorID = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap [ detectorID ];
+  int detectorID  = cluster.detectorID;
+  int detectorPos = cluster.detectorPos;
   if ( _clusterQualityVec[detectorID] < 0 ) return true;
 
-  ClusterQuality actual = cluster->getClusterQuality();
+  ClusterQuality actual = static_cast<ClusterQuality> ( cluster.quality );
   ClusterQuality needed = static_cast<ClusterQuality> ( _clusterQualityVec[detectorPos] );
 
   if ( actual == needed ) return true;
@@ -1379,18 +1347,18 @@ bool EUTelClusterFilter::hasQuality(EUTelVirtualCluster * cluster) const {
   }
 }
 
-bool EUTelClusterFilter::isBelowMaxClusterNoise(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isBelowMaxClusterNoise(const ClusterFeatures & cluster) const {
 
-  if ( !_noiseRelatedCuts       ) return true;
+  if ( !cluster.hasNoise       ) return true;
   if ( !_maxClusterNoiseSwitch  ) return true;
 
   streamlog_out ( DEBUG1 ) << "Filtering against the maximum cluster noise"  << endl;
-  int detectorID = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap [ detectorID ];
-  if (  ( cluster->getClusterNoise() < _maxClusterNoiseVec[detectorPos] ) ||
+  int detectorID  = cluster.detectorID;
+  int detectorPos = cluster.detectorPos;
+  if (  ( cluster.clusterNoise < _maxClusterNoiseVec[detectorPos] ) ||
         ( _maxClusterNoiseVec[detectorID] < 0 ) ) return true;
   else {
-    streamlog_out ( DEBUG2 )  << "Rejected cluster because its noise is " << cluster->getClusterNoise()
+    streamlog_out ( DEBUG2 )  << "Rejected cluster because its noise is " << cluster.clusterNoise
                               << " and the threshold is " <<  _maxClusterNoiseVec[detectorPos] << endl;
     _rejectionMap["MaxClusterNoiseCut"][detectorPos]++;
     return false;
@@ -1398,14 +1366,14 @@ bool EUTelClusterFilter::isBelowMaxClusterNoise(EUTelVirtualCluster * cluster) c
 }
 
 
-bool EUTelClusterFilter::isInsideROI(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isInsideROI(const ClusterFeatures & cluster) const {
 
   if ( !_insideROISwitch ) return true;
 
-  int detectorID = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap [ detectorID ];
-  float x, y;
-  cluster->getCenterOfGravity(x, y);
+  int detectorID  = cluster.detectorID;
+  int detectorPos = cluster.detectorPos;
+  float x = cluster.xCoG;
+  float y = cluster.yCoG;
 
   bool tempAccepted = true;
   vector<EUTelROI>::const_iterator iter = _insideROIVec.begin();
@@ -1429,14 +1397,14 @@ bool EUTelClusterFilter::isInsideROI(EUTelVirtualCluster * cluster) const {
 
 }
 
-bool EUTelClusterFilter::isOutsideROI(EUTelVirtualCluster * cluster) const {
+bool EUTelClusterFilter::isOutsideROI(const ClusterFeatures & cluster) const {
 
   if ( !_outsideROISwitch ) return true;
 
-  int detectorID = cluster->getDetectorID();
-  int detectorPos = _ancillaryIndexMap [ detectorID ];
-  float x, y;
-  cluster->getCenterOfGravity(x, y);
+  int detectorID  = cluster.detectorID;
+  int detectorPos = cluster.detectorPos;
+  float x = cluster.xCoG;
+  float y = cluster.yCoG;
 
   bool tempAccepted = true;
   vector<EUTelROI>::const_iterator iter = _outsideROIVec.begin();
@@ -0,0 +1,113 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelClusterSummary.h"
+#include "EUTelVirtualCluster.h"
+#include "EUTelFFClusterImpl.h"
+#include "EUTelDFFClusterImpl.h"
+#include "EUTelBrickedClusterImpl.h"
+#include "EUTelSparseClusterImpl.h"
+#include "EUTelGenericSparsePixel.h"
+
+// lcio includes <.h>
+#include <IMPL/TrackerPulseImpl.h>
+#include <IMPL/TrackerDataImpl.h>
+#include <UTIL/CellIDDecoder.h>
+#include <Exceptions.h>
+
+// system includes <>
+#include <map>
+
+using namespace std;
+using namespace lcio;
+using namespace eutelescope;
+
+EUTelClusterSummary & EUTelClusterSummary::getInstance( const string & pulseCollectionName ) {
+  static map< string, EUTelClusterSummary > summaries;
+  map< string, EUTelClusterSummary >::iterator it = summaries.find( pulseCollectionName );
+  if ( it == summaries.end() ) {
+    it = summaries.insert( make_pair( pulseCollectionName, EUTelClusterSummary() ) ).first;
+    it->second._collectionName = pulseCollectionName;
+  }
+  return it->second;
+}
+
+EUTelClusterSummary::EUTelClusterSummary() :
+  _clusters(),
+  _runNumber(-1),
+  _eventNumber(-1),
+  _nElements(-1),
+  _collection(NULL),
+  _collectionName("")
+{
+}
+
+bool EUTelClusterSummary::update( LCEvent * event ) {
+  LCCollectionVec * collection = NULL;
+  try {
+    collection = dynamic_cast< LCCollectionVec * >( event->getCollection( _collectionName ) );
+  } catch ( lcio::DataNotAvailableException& e ) {
+    collection = NULL;
+  }
+  if ( collection == NULL ) {
+    _collection = NULL;
+    _nElements  = -1;
+    _clusters.clear();
+    return false;
+  }
+
+  // a processor may have replaced or extended the collection within the
+  // event, and the next event may get a collection at the same address
+  if ( collection == _collection && collection->getNumberOfElements() == _nElements
+       && event->getRunNumber() == _runNumber && event->getEventNumber() == _eventNumber ) {
+    return true;
+  }
+  _collection  = collection;
+  _nElements   = collection->getNumberOfElements();
+  _runNumber   = event->getRunNumber();
+  _eventNumber = event->getEventNumber();
+
+  CellIDDecoder< TrackerPulseImpl > pulseCellDecoder( _collection );
+  _clusters.resize( _nElements );
+  for ( size_t iPulse = 0; iPulse < _clusters.size(); ++iPulse ) {
+    TrackerPulseImpl * pulse = static_cast< TrackerPulseImpl * >( _collection->getElementAt( iPulse ) );
+    Cluster & summary = _clusters[iPulse];
+    summary.sensorID  = pulseCellDecoder( pulse )["sensorID"];
+    summary.type      = static_cast< ClusterType >( static_cast< int >( pulseCellDecoder( pulse )["type"] ) );
+    summary.quality   = pulse->getQuality();
+    summary.isDecoded = false;
+
+    EUTelVirtualCluster * cluster = createCluster( iPulse );
+    if ( cluster == NULL ) continue;
+
+    cluster->getSeedCoord( summary.xSeed, summary.ySeed );
+    cluster->getCenterCoord( summary.xCenter, summary.yCenter );
+    cluster->getClusterSize( summary.xSize, summary.ySize );
+    cluster->getCenterOfGravity( summary.xCoG, summary.yCoG );
+    summary.quality     = static_cast< int >( cluster->getClusterQuality() );
+    summary.totalCharge = cluster->getTotalCharge();
+    summary.seedCharge  = cluster->getSeedCharge();
+    summary.isDecoded   = true;
+    delete cluster;
+  }
+  return true;
+}
+
+EUTelVirtualCluster * EUTelClusterSummary::createCluster( size_t i ) const {
+  TrackerPulseImpl * pulse = static_cast< TrackerPulseImpl * >( _collection->getElementAt( i ) );
+  TrackerDataImpl * data = static_cast< TrackerDataImpl * >( pulse->getTrackerData() );
+  switch ( _clusters[i].type ) {
+  case kEUTelDFFClusterImpl:     return new EUTelDFFClusterImpl( data );
+  case kEUTelBrickedClusterImpl: return new EUTelBrickedClusterImpl( data );
+  case kEUTelFFClusterImpl:      return new EUTelFFClusterImpl( data );
+  case kEUTelSparseClusterImpl:  return new EUTelSparseClusterImpl< EUTelGenericSparsePixel >( data );
+  default:                       return NULL;
+  }
+}
@@ -29,6 +29,7 @@
 #include "EUTelMatrixDecoder.h"
 #include "EUTelTrackerDataInterfacerImpl.h"
 #include "EUTelSparseClusterImpl.h"
+#include "EUTelCellIDCodec.h"
 
 // gear includes <.h>
 #include <gear/GearMgr.h>
@@ -62,6 +63,7 @@
 #include <memory>
 #include <list>
 #include <cstdio>
+#include <cstring>
 #include <stdio.h>
 #include <iostream>
 
@@ -72,6 +74,43 @@ using namespace eutelescope;
 
 static const int  MAXCLUSTERSIZE = 4096;
 
+namespace {
+  //! Collects the pixels of a NZS frame passing the seed cut
+  /*! The cut is first evaluated for every pixel into flags, without
+   *  any branch so that the loop is vectorised. The flags are then
+   *  read four at a time, skipping quickly the large parts of the
+   *  frame without any candidate.
+   */
+  void findSeedPixels( const FloatVec & signalVec, const FloatVec & noiseVec, const ShortVec & statusVec, float seedCut,
+                       vector< unsigned char > & flags, vector< pair< float, unsigned int > > & candidates ) {
+    candidates.clear();
+    const size_t nPixels = signalVec.size();
+    if ( nPixels == 0 ) return;
+
+    // the padding up to a multiple of four stays zero
+    const size_t nFlags = ( nPixels + 3 ) & ~static_cast< size_t >( 3 );
+    if ( flags.size() != nFlags ) flags.assign( nFlags, 0 );
+
+    const float * signal = &signalVec[0];
+    const float * noise  = &noiseVec[0];
+    const short * status = &statusVec[0];
+    unsigned char * flag = &flags[0];
+    const short goodPixel = static_cast< short >( EUTELESCOPE::GOODPIXEL );
+    for ( size_t i = 0; i < nPixels; ++i ) {
+      flag[i] = ( status[i] == goodPixel ) & ( signal[i] > seedCut * noise[i] );
+    }
+
+    for ( size_t i = 0; i < nFlags; i += 4 ) {
+      unsigned int word;
+      memcpy( &word, flag + i, sizeof( word ) );
+      if ( word == 0 ) continue;
+      for ( size_t j = i; j < i + 4; ++j ) {
+        if ( flag[j] ) candidates.push_back( make_pair( signal[j], static_cast< unsigned int >( j ) ) );
+      }
+    }
+  }
+}
+
 
 EUTelClusteringProcessor::EUTelClusteringProcessor () 
 : Processor("EUTelClusteringProcessor"), 
@@ -98,7 +137,9 @@ EUTelClusteringProcessor::EUTelClusteringProcessor ()
   _iEvt(0),
   _fillHistos(false),
   _histoInfoFileName(""),
+  _nzsFrames(),
   _seedCandidateMap(),
+  _seedFlags(),
   _totClusterMap(),
   _noOfDetector(0),
   _ExcludedPlanes(),
@@ -831,7 +872,7 @@ void EUTelClusteringProcessor::digitalFixedFrameClustering(LCEvent * evt, LCColl
 //  LCCollectionVec * noiseCollectionVec    = dynamic_cast < LCCollectionVec * > (evt->getCollection( _noiseCollectionName ));
 
   // prepare some decoders
-  CellIDDecoder<TrackerDataImpl> cellDecoder( zsInputDataCollectionVec );
+  CellIDCodec::Reader< CellIDCodec::ZSDataEncoding > cellDecoder( zsInputDataCollectionVec );
   CellIDDecoder<TrackerDataImpl> statusDecoder( statusCollectionVec );
   CellIDDecoder<TrackerDataImpl> noiseDecoder( noiseCollectionVec );
 
@@ -871,9 +912,9 @@ void EUTelClusteringProcessor::digitalFixedFrameClustering(LCEvent * evt, LCColl
     // get the TrackerData and guess which kind of sparsified data it
     // contains.
     TrackerDataImpl * zsData = dynamic_cast< TrackerDataImpl * > ( zsInputDataCollectionVec->getElementAt( i ) );
-    SparsePixelType   type   = static_cast<SparsePixelType> ( static_cast<int> (cellDecoder( zsData )["sparsePixelType"]) );
+    SparsePixelType   type   = static_cast<SparsePixelType> ( cellDecoder.get< CellIDCodec::ZSDataEncoding::sparsePixelType >( zsData ) );
 
-    int _sensorID            = static_cast<int > ( cellDecoder( zsData )["sensorID"] );
+    int _sensorID            = cellDecoder.get< CellIDCodec::ZSDataEncoding::sensorID >( zsData );
     int sensorID            = _sensorID;
         
     //if this is an excluded sensor go to the next element
@@ -1370,7 +1411,7 @@ void EUTelClusteringProcessor::zsFixedFrameClustering(LCEvent * evt, LCCollectio
 //  LCCollectionVec * noiseCollectionVec    = dynamic_cast < LCCollectionVec * > (evt->getCollection( _noiseCollectionName ));
 //  LCCollectionVec * statusCollectionVec   = dynamic_cast < LCCollectionVec * > (evt->getCollection( _statusCollectionName ));
   // prepare some decoders
-  CellIDDecoder<TrackerDataImpl> cellDecoder( zsInputDataCollectionVec );
+  CellIDCodec::Reader< CellIDCodec::ZSDataEncoding > cellDecoder( zsInputDataCollectionVec );
   CellIDDecoder<TrackerDataImpl> noiseDecoder( noiseCollectionVec );
 
   // this is the equivalent of the dummyCollection in the fixed frame
@@ -1409,9 +1450,9 @@ void EUTelClusteringProcessor::zsFixedFrameClustering(LCEvent * evt, LCCollectio
     // get the TrackerData and guess which kind of sparsified data it
     // contains.
     TrackerDataImpl * zsData = dynamic_cast< TrackerDataImpl * > ( zsInputDataCollectionVec->getElementAt( i ) );
-    SparsePixelType   type   = static_cast<SparsePixelType> ( static_cast<int> (cellDecoder( zsData )["sparsePixelType"]) );
+    SparsePixelType   type   = static_cast<SparsePixelType> ( cellDecoder.get< CellIDCodec::ZSDataEncoding::sparsePixelType >( zsData ) );
 
-    int sensorID             = static_cast<int > ( cellDecoder( zsData )["sensorID"] );
+    int sensorID             = cellDecoder.get< CellIDCodec::ZSDataEncoding::sensorID >( zsData );
     //if this is an excluded sensor go to the next element
     bool foundexcludedsensor = false;
     for(size_t i = 0; i < _ExcludedPlanes.size(); ++i)
@@ -1672,7 +1713,7 @@ void EUTelClusteringProcessor::zsBrickedClustering(LCEvent * evt, LCCollectionVe
 //  LCCollectionVec * statusCollectionVec   = dynamic_cast < LCCollectionVec * > (evt->getCollection(_statusCollectionName));
   
   // prepare some decoders
-  CellIDDecoder<TrackerDataImpl> cellDecoder( zsInputDataCollectionVec );
+  CellIDCodec::Reader< CellIDCodec::ZSDataEncoding > cellDecoder( zsInputDataCollectionVec );
   CellIDDecoder<TrackerDataImpl> noiseDecoder( noiseCollectionVec );
 
   // this is the equivalent of the dummyCollection in the fixed frame
@@ -1711,8 +1752,8 @@ void EUTelClusteringProcessor::zsBrickedClustering(LCEvent * evt, LCCollectionVe
       // get the TrackerData and guess which kind of sparsified data it
       // contains.
       TrackerDataImpl * zsData = dynamic_cast< TrackerDataImpl * > ( zsInputDataCollectionVec->getElementAt( i ) );
-      SparsePixelType   type   = static_cast<SparsePixelType> ( static_cast<int> (cellDecoder( zsData )["sparsePixelType"]) );
-      int sensorID             = static_cast<int > ( cellDecoder( zsData )["sensorID"] );
+      SparsePixelType   type   = static_cast<SparsePixelType> ( cellDecoder.get< CellIDCodec::ZSDataEncoding::sparsePixelType >( zsData ) );
+      int sensorID             = cellDecoder.get< CellIDCodec::ZSDataEncoding::sensorID >( zsData );
 
       // now that we know which is the sensorID, we can ask to GEAR
       // which are the minX, minY, maxX and maxY.
@@ -2086,7 +2127,7 @@ void EUTelClusteringProcessor::sparseClustering(LCEvent* evt, LCCollectionVec* p
 
 
 	// prepare some decoders
-	CellIDDecoder<TrackerDataImpl> cellDecoder( zsInputDataCollectionVec );
+	CellIDCodec::Reader< CellIDCodec::ZSDataEncoding > cellDecoder( zsInputDataCollectionVec );
 
 	bool isDummyAlreadyExisting = false;
 	LCCollectionVec* sparseClusterCollectionVec = NULL;
@@ -2113,8 +2154,8 @@ void EUTelClusteringProcessor::sparseClustering(LCEvent* evt, LCCollectionVec* p
 	{
 		// get the TrackerData and guess which kind of sparsified data it contains.
 		TrackerDataImpl * zsData = dynamic_cast< TrackerDataImpl * > ( zsInputDataCollectionVec->getElementAt( idetector ) );
-		SparsePixelType type = static_cast<SparsePixelType> ( static_cast<int> (cellDecoder( zsData )["sparsePixelType"]) );
-		int sensorID = static_cast<int > ( cellDecoder( zsData )["sensorID"] );
+		SparsePixelType type = static_cast<SparsePixelType> ( cellDecoder.get< CellIDCodec::ZSDataEncoding::sparsePixelType >( zsData ) );
+		int sensorID = cellDecoder.get< CellIDCodec::ZSDataEncoding::sensorID >( zsData );
 	    
 
 		//if this is an excluded sensor go to the next element
@@ -2357,6 +2398,9 @@ void EUTelClusteringProcessor::fixedFrameClustering(LCEvent * evt, LCCollectionV
     isDummyAlreadyExisting = false;
   }
 
+  // first the sensors to be clustered, then the seed search on all of
+  // them at once
+  _nzsFrames.clear();
   for ( int i = 0; i < nzsInputDataCollectionVec->getNumberOfElements(); i++) {
 
     // get the calibrated data
@@ -2375,20 +2419,20 @@ void EUTelClusteringProcessor::fixedFrameClustering(LCEvent * evt, LCCollectionV
       continue;
     // now that we know which is the sensorID, we can ask to GEAR
     // which are the minX, minY, maxX and maxY.
-    int minX, minY, maxX, maxY;
-    minX = 0;
-    minY = 0;
+    NZSSensorFrame frame;
+    frame.nzsData  = nzsData;
+    frame.sensorID = sensorID;
 
     // this sensorID can be either a reference plane or a DUT, do it
     // differently...
     if ( _layerIndexMap.find( sensorID ) != _layerIndexMap.end() ){
       // this is a reference plane
-      maxX = _siPlanesLayerLayout->getSensitiveNpixelX( _layerIndexMap[ sensorID ] ) - 1;
-      maxY = _siPlanesLayerLayout->getSensitiveNpixelY( _layerIndexMap[ sensorID ] ) - 1;
+      frame.maxX = _siPlanesLayerLayout->getSensitiveNpixelX( _layerIndexMap[ sensorID ] ) - 1;
+      frame.maxY = _siPlanesLayerLayout->getSensitiveNpixelY( _layerIndexMap[ sensorID ] ) - 1;
     } else if ( _dutLayerIndexMap.find( sensorID ) != _dutLayerIndexMap.end() ) {
       // ok it is a DUT plane
-      maxX = _siPlanesLayerLayout->getDUTSensitiveNpixelX() - 1;
-      maxY = _siPlanesLayerLayout->getDUTSensitiveNpixelY() - 1;
+      frame.maxX = _siPlanesLayerLayout->getDUTSensitiveNpixelX() - 1;
+      frame.maxY = _siPlanesLayerLayout->getDUTSensitiveNpixelY() - 1;
     } else {
       // this is not a reference plane neither a DUT... what's that?
 //      throw  InvalidGeometryException ("Unknown sensorID " + to_string( sensorID ));
@@ -2396,48 +2440,54 @@ void EUTelClusteringProcessor::fixedFrameClustering(LCEvent * evt, LCCollectionV
       continue;
     }
 
-    streamlog_out ( DEBUG0 ) << "  Working on detector " << sensorID << endl;
+    frame.noise  = dynamic_cast<TrackerDataImpl*>   (noiseCollectionVec->getElementAt( _ancillaryIndexMap[ sensorID ] ));
+    frame.status = dynamic_cast<TrackerRawDataImpl*>(statusCollectionVec->getElementAt( _ancillaryIndexMap[ sensorID ] ));
+    _nzsFrames.push_back( frame );
+  }
 
-    TrackerDataImpl    * noise  = dynamic_cast<TrackerDataImpl*>   (noiseCollectionVec->getElementAt( _ancillaryIndexMap[ sensorID ] ));
-    TrackerRawDataImpl * status = dynamic_cast<TrackerRawDataImpl*>(statusCollectionVec->getElementAt( _ancillaryIndexMap[ sensorID ] ));
+  // reset the status and fill the seed candidate maps
+  findSeedCandidates();
+
+  for ( size_t iFrame = 0; iFrame < _nzsFrames.size(); ++iFrame ) {
+
+    const NZSSensorFrame & frame = _nzsFrames[ iFrame ];
+    TrackerDataImpl * nzsData    = frame.nzsData;
+    const int sensorID           = frame.sensorID;
+    const int minX = 0;
+    const int minY = 0;
+    const int maxX = frame.maxX;
+    const int maxY = frame.maxY;
+
+    streamlog_out ( DEBUG0 ) << "  Working on detector " << sensorID << endl;
 
     // prepare the matrix decoder
     EUTelMatrixDecoder matrixDecoder(cellDecoder, nzsData);
 
-    // reset the status
-    resetStatus(status);
-
     // initialize the cluster counter
     short clusterCounter = 0;
     short limitExceed    = 0;
 
-    _seedCandidateMap.clear();
-
-    for (unsigned int iPixel = 0; iPixel < nzsData->getChargeValues().size(); iPixel++) 
-    {
-        if (status->getADCValues()[iPixel] == EUTELESCOPE::GOODPIXEL) 
-        {
-            if ( nzsData->getChargeValues()[iPixel] > _ffSeedCut * noise->getChargeValues()[iPixel]) 
-            {
-                _seedCandidateMap.push_back(make_pair( nzsData->getChargeValues()[iPixel], iPixel));
-            }
-        }
-    }
+    const vector< pair< float, unsigned int > > & seedCandidateMap = _seedCandidateMap[ iFrame ];
 
     // continue only if seed candidate map is not empty!
-    if ( !_seedCandidateMap.empty() ) {
+    if ( !seedCandidateMap.empty() ) {
+
+      streamlog_out ( DEBUG0 ) << "There are << " << seedCandidateMap.size() << " seed candidates." << endl;
 
-      streamlog_out ( DEBUG0 ) << "There are << " << _seedCandidateMap.size() << " seed candidates." << endl;
+      // plain arrays instead of the accessors, the status is also the
+      // map of the pixels already used by a cluster
+      const float * signal       = &nzsData->getChargeValues()[0];
+      const float * noise        = &frame.noise->getChargeValues()[0];
+      short       * statusValues = &frame.status->adcValues()[0];
 
-      // now built up a cluster for each seed candidate
-      //Start by sorting the vector in order of smallest to largest seed signal
-      std::sort(_seedCandidateMap.begin(),_seedCandidateMap.end());
-      vector< pair< float, unsigned int > >::iterator mapIter = _seedCandidateMap.end();
-      while ( mapIter != _seedCandidateMap.begin() ) {
+      // now built up a cluster for each seed candidate, the map is
+      // sorted from the smallest to the largest seed signal
+      vector< pair< float, unsigned int > >::const_iterator mapIter = seedCandidateMap.end();
+      while ( mapIter != seedCandidateMap.begin() ) {
         --mapIter;
         // check if this seed candidate has not been already added to a
         // cluster
-        if ( status->adcValues()[(*mapIter).second] == EUTELESCOPE::GOODPIXEL ) {
+        if ( statusValues[(*mapIter).second] == EUTELESCOPE::GOODPIXEL ) {
           // if we enter here, this means that at least the seed pixel
           // wasn't added yet to another cluster.  Note that now we need
           // to build a candidate cluster that has to pass the
@@ -2459,8 +2509,8 @@ void EUTelClusteringProcessor::fixedFrameClustering(LCEvent * evt, LCCollectionV
                    ( yPixel >= minY )  &&  ( yPixel <= maxY ) ) {
                 int index = matrixDecoder.getIndexFromXY(xPixel, yPixel);
 
-                bool isHit  = ( status->getADCValues()[index] == EUTELESCOPE::HITPIXEL  );
-                bool isGood = ( status->getADCValues()[index] == EUTELESCOPE::GOODPIXEL );
+                bool isHit  = ( statusValues[index] == EUTELESCOPE::HITPIXEL  );
+                bool isGood = ( statusValues[index] == EUTELESCOPE::GOODPIXEL );
                 
                 if(isGood)
                   clusterCandidateIndeces.push_back(index);
@@ -2468,9 +2518,9 @@ void EUTelClusteringProcessor::fixedFrameClustering(LCEvent * evt, LCCollectionV
                   clusterCandidateIndeces.push_back(-1);
                 
                 if ( isGood && !isHit ) {
-                  clusterCandidateSignal += nzsData->getChargeValues()[index];
-                  clusterCandidateNoise2 += pow(noise->getChargeValues()[index] , 2);
-                  clusterCandidateCharges.push_back(nzsData->getChargeValues()[index]);
+                  clusterCandidateSignal += signal[index];
+                  clusterCandidateNoise2 += pow(noise[index] , 2);
+                  clusterCandidateCharges.push_back(signal[index]);
                 } else if (isHit) {
                   // this can be a good place to flag the current
                   // cluster as kMergedCluster, but it would introduce
@@ -2530,7 +2580,7 @@ void EUTelClusteringProcessor::fixedFrameClustering(LCEvent * evt, LCCollectionV
 
             while ( indexIter != clusterCandidateIndeces.end() ) {
               if (*indexIter != -1 ) {
-                status->adcValues()[(*indexIter)] = EUTELESCOPE::HITPIXEL;
+                statusValues[(*indexIter)] = EUTELESCOPE::HITPIXEL;
               }
               ++indexIter;
             }
@@ -2640,32 +2690,34 @@ void EUTelClusteringProcessor::nzsBrickedClustering(LCEvent * evt, LCCollectionV
     }
 
 
+  // first the sensors to be clustered, then the seed search on all of
+  // them at once
+  _nzsFrames.clear();
   for ( int i = 0; i < nzsInputDataCollectionVec->getNumberOfElements(); i++)
     {
       // get the calibrated data
       TrackerDataImpl    * nzsData = dynamic_cast<TrackerDataImpl*>  (nzsInputDataCollectionVec->getElementAt( i ) );
-      EUTelMatrixDecoder matrixDecoder(cellDecoder, nzsData);
       int sensorID                 = static_cast<int > ( cellDecoder( nzsData )["sensorID"] );
 
       // now that we know which is the sensorID, we can ask to GEAR
       // which are the minX, minY, maxX and maxY.
-      int minX, minY, maxX, maxY;
-      minX = 0;
-      minY = 0;
+      NZSSensorFrame frame;
+      frame.nzsData  = nzsData;
+      frame.sensorID = sensorID;
 
       // this sensorID can be either a reference plane or a DUT, do it
       // differently...
       if ( _layerIndexMap.find( sensorID ) != _layerIndexMap.end() )
         {
           // this is a reference plane
-          maxX = _siPlanesLayerLayout->getSensitiveNpixelX( _layerIndexMap[ sensorID ] ) - 1;
-          maxY = _siPlanesLayerLayout->getSensitiveNpixelY( _layerIndexMap[ sensorID ] ) - 1;
+          frame.maxX = _siPlanesLayerLayout->getSensitiveNpixelX( _layerIndexMap[ sensorID ] ) - 1;
+          frame.maxY = _siPlanesLayerLayout->getSensitiveNpixelY( _layerIndexMap[ sensorID ] ) - 1;
         }
       else if ( _dutLayerIndexMap.find( sensorID ) != _dutLayerIndexMap.end() )
         {
           // ok it is a DUT plane
-          maxX = _siPlanesLayerLayout->getDUTSensitiveNpixelX() - 1;
-          maxY = _siPlanesLayerLayout->getDUTSensitiveNpixelY() - 1;
+          frame.maxX = _siPlanesLayerLayout->getDUTSensitiveNpixelX() - 1;
+          frame.maxY = _siPlanesLayerLayout->getDUTSensitiveNpixelY() - 1;
         }
       else
         {
@@ -2676,58 +2728,57 @@ void EUTelClusteringProcessor::nzsBrickedClustering(LCEvent * evt, LCCollectionV
         }
 
       // get the noise and the status matrix with the right detectorID
-      TrackerDataImpl    * noise  = dynamic_cast<TrackerDataImpl*>   (noiseCollectionVec->getElementAt( _ancillaryIndexMap[ sensorID ] ));
-      TrackerRawDataImpl * status = dynamic_cast<TrackerRawDataImpl*>(statusCollectionVec->getElementAt( _ancillaryIndexMap[ sensorID ] ));
+      frame.noise  = dynamic_cast<TrackerDataImpl*>   (noiseCollectionVec->getElementAt( _ancillaryIndexMap[ sensorID ] ));
+      frame.status = dynamic_cast<TrackerRawDataImpl*>(statusCollectionVec->getElementAt( _ancillaryIndexMap[ sensorID ] ));
+      _nzsFrames.push_back( frame );
+    }
 
-      // reset the cluster counter for the clusterID
-      int clusterID = 0;
+  // reset the status and fill the seed candidate maps
+  findSeedCandidates();
 
-      // reset the status
-      resetStatus(status);
+  for ( size_t iFrame = 0; iFrame < _nzsFrames.size(); ++iFrame )
+    {
+      const NZSSensorFrame & frame = _nzsFrames[ iFrame ];
+      TrackerDataImpl * nzsData    = frame.nzsData;
+      EUTelMatrixDecoder matrixDecoder(cellDecoder, nzsData);
+      const int sensorID           = frame.sensorID;
+      const int minX = 0;
+      const int minY = 0;
+      const int maxX = frame.maxX;
+      const int maxY = frame.maxY;
 
-      // prepare a multimap for the seed candidates
-      vector< pair <float, int> > seedCandidateMap;
+      // reset the cluster counter for the clusterID
+      int clusterID = 0;
 
-      // fill the seed candidate map
-      for (unsigned int iPixel = 0; iPixel < nzsData->getChargeValues().size(); iPixel++)
-        {
-          if (status->getADCValues()[iPixel] == EUTELESCOPE::GOODPIXEL)
-            {
-              //! CUT 1
-              if ( nzsData->getChargeValues()[iPixel] > _ffSeedCut * noise->getChargeValues()[iPixel])
-                {
-                  seedCandidateMap.push_back(make_pair( nzsData->getChargeValues()[iPixel], iPixel));
-                  streamlog_out ( MESSAGE2 )
-                    << "Added pixel at (index=" << iPixel
-                    << ") with signal " << nzsData->getChargeValues()[iPixel]
-                    << " to the seedCandidateMap" << endl;
-
-                  if ( noise->getChargeValues()[ iPixel ] < 0.01 )
-                    {
-                      streamlog_out ( ERROR2 )    << "ZERO NOISE SEED PIXEL ADDED (nszBrickedClustering)!"
-                                                  << "\n index=" << iPixel
-                                                  << "\n amp=" << nzsData->getChargeValues()[ iPixel ]
-                                                  << "\n status=" << status->getADCValues()[ iPixel ]
-                                                  <<    " GOODP   =  0,"
-                                                  <<    " BAD     =  1,"
-                                                  <<    " HIT     = -1,"
-                                                  <<    " MISSING =  2,"
-                                                  <<    " FIRING  =  3.";
-                    }
-                }
-            }
-        }
+      const vector< pair< float, unsigned int > > & seedCandidateMap = _seedCandidateMap[ iFrame ];
 
       streamlog_out ( DEBUG0 ) << "The number of seed candidates is: " << seedCandidateMap.size() << endl;
-      std::sort(seedCandidateMap.begin(),seedCandidateMap.end());
       if ( !seedCandidateMap.empty() )
         {
+          // plain arrays instead of the accessors, the status is also the
+          // map of the pixels already used by a cluster
+          const float * signal       = &nzsData->getChargeValues()[0];
+          const float * noise        = &frame.noise->getChargeValues()[0];
+          short       * statusValues = &frame.status->adcValues()[0];
+
           // now build up a cluster for each seed candidate
-          vector< pair<float, int> >::iterator rMapIter = seedCandidateMap.end();
+          vector< pair< float, unsigned int > >::const_iterator rMapIter = seedCandidateMap.end();
           while ( rMapIter != seedCandidateMap.begin() )
             {
               rMapIter--;
-              if ( status->adcValues()[ (*rMapIter).second ] == EUTELESCOPE::GOODPIXEL )
+              if ( noise[ (*rMapIter).second ] < 0.01 )
+                {
+                  streamlog_out ( ERROR2 )    << "ZERO NOISE SEED PIXEL ADDED (nszBrickedClustering)!"
+                                              << "\n index=" << (*rMapIter).second
+                                              << "\n amp=" << (*rMapIter).first
+                                              << "\n status=" << statusValues[ (*rMapIter).second ]
+                                              <<    " GOODP   =  0,"
+                                              <<    " BAD     =  1,"
+                                              <<    " HIT     = -1,"
+                                              <<    " MISSING =  2,"
+                                              <<    " FIRING  =  3.";
+                }
+              if ( statusValues[ (*rMapIter).second ] == EUTELESCOPE::GOODPIXEL )
                 {
                   // if we enter here, this means that at least the seed pixel
                   // wasn't added yet to another cluster.  Note that now we need
@@ -2764,14 +2815,14 @@ void EUTelClusteringProcessor::nzsBrickedClustering(LCEvent * evt, LCCollectionV
                               int index = matrixDecoder.getIndexFromXY(xPixel, yPixel);
 
                               //get noise for each and every pixel! (because it's available)
-                              noiseValueVec.push_back(noise->getChargeValues()[ index ]);
+                              noiseValueVec.push_back(noise[ index ]);
 
-                              bool isHit  = ( status->getADCValues()[index] == EUTELESCOPE::HITPIXEL  ); //this is set for pixels already used for another cluster
-                              bool isGood = ( status->getADCValues()[index] == EUTELESCOPE::GOODPIXEL );
+                              bool isHit  = ( statusValues[index] == EUTELESCOPE::HITPIXEL  ); //this is set for pixels already used for another cluster
+                              bool isGood = ( statusValues[index] == EUTELESCOPE::GOODPIXEL );
 
                               if ( isGood ) //normal case
                                 {
-                                  clusterCandidateCharges.push_back( nzsData->getChargeValues()[index] );
+                                  clusterCandidateCharges.push_back( signal[index] );
                                   clusterCandidateIndeces.push_back( index ); //used to flag used pixels afterwards!
 
                                   //no need to check the signal presence here
@@ -2906,7 +2957,7 @@ void EUTelClusteringProcessor::nzsBrickedClustering(LCEvent * evt, LCCollectionV
                             {
                               if ( (*indexIter) != -1 )
                                 {
-                                  status->adcValues()[(*indexIter)] = EUTELESCOPE::HITPIXEL;
+                                  statusValues[(*indexIter)] = EUTELESCOPE::HITPIXEL;
                                 }
                             }
                           ++indexIter;
@@ -2989,6 +3040,27 @@ void EUTelClusteringProcessor::end() {
 
 
 
+void EUTelClusteringProcessor::findSeedCandidates() {
+
+  const int nFrames = static_cast< int >( _nzsFrames.size() );
+  if ( static_cast< int >( _seedCandidateMap.size() ) < nFrames ) {
+    _seedCandidateMap.resize( nFrames );
+    _seedFlags.resize( nFrames );
+  }
+
+  // every frame has its own status, candidate and flag vectors
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if(nFrames > 1)
+#endif
+  for ( int iFrame = 0; iFrame < nFrames; ++iFrame ) {
+    const NZSSensorFrame & frame = _nzsFrames[ iFrame ];
+    resetStatus( frame.status );
+    findSeedPixels( frame.nzsData->getChargeValues(), frame.noise->getChargeValues(), frame.status->getADCValues(),
+                    _ffSeedCut, _seedFlags[ iFrame ], _seedCandidateMap[ iFrame ] );
+    std::sort( _seedCandidateMap[ iFrame ].begin(), _seedCandidateMap[ iFrame ].end() );
+  }
+}
+
 void EUTelClusteringProcessor::resetStatus(IMPL::TrackerRawDataImpl * status) {
 
     int i = 0;
@@ -3033,7 +3105,7 @@ void EUTelClusteringProcessor::fillHistos (LCEvent * evt) {
   try {
 
     LCCollectionVec * pulseCollectionVec = dynamic_cast<LCCollectionVec*>  (evt->getCollection(_pulseCollectionName));
-    CellIDDecoder<TrackerPulseImpl > cellDecoder(pulseCollectionVec);
+    CellIDCodec::Reader< CellIDCodec::PulseEncoding > cellDecoder(pulseCollectionVec);
 
     // I also need the noise collection too fill in the SNR histograms
     LCCollectionVec * noiseCollectionVec    = dynamic_cast < LCCollectionVec * > (evt->getCollection(_noiseCollectionName));
@@ -3044,7 +3116,7 @@ void EUTelClusteringProcessor::fillHistos (LCEvent * evt) {
 
     for ( int iPulse = _initialPulseCollectionSize; iPulse < pulseCollectionVec->getNumberOfElements(); iPulse++ ) {
       TrackerPulseImpl * pulse = dynamic_cast<TrackerPulseImpl*> ( pulseCollectionVec->getElementAt(iPulse) );
-      ClusterType        type  = static_cast<ClusterType> ( static_cast<int> ( cellDecoder(pulse)["type"] ));
+      ClusterType        type  = static_cast<ClusterType> ( cellDecoder.get< CellIDCodec::PulseEncoding::type >( pulse ) );
       SparsePixelType    pixelType = static_cast<SparsePixelType> (0);
       EUTelVirtualCluster * cluster;
 
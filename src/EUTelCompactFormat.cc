@@ -0,0 +1,583 @@
+// Version $Id$
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelCompactFormat.h"
+
+// lcio includes <.h>
+#include <Exceptions.h>
+
+// system includes <>
+#include <cstring>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace std;
+using namespace eutelescope;
+using namespace eutelescope::compact;
+
+namespace {
+
+  //! Layout of the file header, 16 bytes
+  struct FileHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int byteOrder;
+  };
+
+  //! Layout of a record header, 24 bytes
+  struct RecordHeader {
+    unsigned int type;
+    unsigned int flags;
+    unsigned long long int rawSize;
+    unsigned long long int storedSize;
+  };
+
+  const char fileMagic[8] = { 'E', 'U', 'T', 'C', 'M', 'P', 'C', 'T' };
+  const unsigned int byteOrderMark = 0x01020304;
+
+  //! Record flag: the payload is compressed with zlib
+  const unsigned int compressedFlag = 1;
+
+  inline size_t padded( size_t size ) {
+    return ( size + 7 ) & ~static_cast< size_t >( 7 );
+  }
+
+  //! Appends values to a record payload
+  class PayloadWriter {
+  public:
+    explicit PayloadWriter( vector< char > & payload ) : _payload( payload ) { }
+
+    void putBytes( const void * data, size_t size ) {
+      const char * bytes = static_cast< const char * >( data );
+      _payload.insert( _payload.end(), bytes, bytes + size );
+    }
+
+    template< class T > void put( const T value ) {
+      putBytes( &value, sizeof( T ) );
+    }
+
+    void putString( const string & value ) {
+      put( static_cast< unsigned int >( value.size() ) );
+      putBytes( value.data(), value.size() );
+    }
+
+    void pad() {
+      _payload.resize( padded( _payload.size() ), 0 );
+    }
+
+    //! A column: element count, element size, the values, padding to 8 bytes
+    template< class T > void operator()( const vector< T > & column ) {
+      put( static_cast< unsigned long long int >( column.size() ) );
+      put( static_cast< unsigned int >( sizeof( T ) ) );
+      put( static_cast< unsigned int >( 0 ) );
+      if ( !column.empty() ) putBytes( &column[0], column.size() * sizeof( T ) );
+      pad();
+    }
+
+  private:
+    vector< char > & _payload;
+  };
+
+  //! Reads values back from a record payload
+  class PayloadReader {
+  public:
+    PayloadReader( const char * begin, const char * end, const string & fileName ) :
+      _current( begin ), _begin( begin ), _end( end ), _fileName( fileName ) { }
+
+    void getBytes( void * data, size_t size ) {
+      check( size );
+      memcpy( data, _current, size );
+      _current += size;
+    }
+
+    template< class T > T get() {
+      T value;
+      getBytes( &value, sizeof( T ) );
+      return value;
+    }
+
+    string getString() {
+      const unsigned int size = get< unsigned int >();
+      check( size );
+      string value( _current, size );
+      _current += size;
+      return value;
+    }
+
+    void pad() {
+      // the writer pads every column, so the padding is part of the record
+      const size_t offset = padded( _current - _begin );
+      if ( offset > static_cast< size_t >( _end - _begin ) ) fail( "record too short" );
+      _current = _begin + offset;
+    }
+
+    template< class T > void operator()( vector< T > & column ) {
+      const unsigned long long int size = get< unsigned long long int >();
+      const unsigned int elementSize = get< unsigned int >();
+      get< unsigned int >();
+      if ( elementSize != sizeof( T ) ) fail( "unexpected column type" );
+      if ( size > static_cast< unsigned long long int >( _end - _current ) / sizeof( T ) ) fail( "column beyond the end of the record" );
+      // one copy per column, whatever its length
+      column.resize( size );
+      if ( size != 0 ) getBytes( &column[0], size * sizeof( T ) );
+      pad();
+    }
+
+    void fail( const string & what ) const {
+      throw lcio::IOException( "Compact file " + _fileName + " is corrupted: " + what );
+    }
+
+  private:
+    void check( size_t size ) const {
+      if ( size > static_cast< size_t >( _end - _current ) ) fail( "record too short" );
+    }
+
+    const char * _current;
+    const char * _begin;
+    const char * _end;
+    const string & _fileName;
+  };
+
+  //! Number of columns in an event block
+  const unsigned int nBlockColumns = 32;
+
+  //! All the columns of an event block, in file order
+  template< class Block, class Visitor >
+  void visitColumns( Block & block, Visitor & visitor ) {
+    visitor( block.eventNumber );
+    visitor( block.timeStamp );
+    visitor( block.eventType );
+    visitor( block.collectionSize );
+
+    visitor( block.hitCellID0 );
+    visitor( block.hitCellID1 );
+    visitor( block.hitType );
+    visitor( block.hitQuality );
+    visitor( block.hitX );
+    visitor( block.hitY );
+    visitor( block.hitZ );
+    visitor( block.hitEDep );
+    visitor( block.hitEDepError );
+    visitor( block.hitTime );
+    visitor( block.hitCov );
+
+    visitor( block.trackType );
+    visitor( block.trackNdf );
+    visitor( block.trackD0 );
+    visitor( block.trackPhi );
+    visitor( block.trackOmega );
+    visitor( block.trackZ0 );
+    visitor( block.trackTanLambda );
+    visitor( block.trackChi2 );
+    visitor( block.trackdEdx );
+    visitor( block.trackdEdxError );
+    visitor( block.trackRadiusOfInnermostHit );
+    visitor( block.trackCov );
+    visitor( block.trackReferencePoint );
+    visitor( block.trackNHits );
+    visitor( block.trackNSubTracks );
+    visitor( block.trackHitIndex );
+    visitor( block.trackSubTrackIndex );
+  }
+
+  //! Sum of the column sizes, to reserve the payload
+  struct ColumnSize {
+    ColumnSize() : bytes( 0 ) { }
+    template< class T > void operator()( const vector< T > & column ) { bytes += 16 + padded( column.size() * sizeof( T ) ); }
+    size_t bytes;
+  };
+
+  //! Empties a column, keeping its capacity
+  struct ColumnClearer {
+    template< class T > void operator()( vector< T > & column ) { column.clear(); }
+  };
+
+  template< class T > bool hasSize( const vector< T > & column, size_t size ) {
+    return column.size() == size;
+  }
+
+  long long sum( const vector< int > & values ) {
+    long long total = 0;
+    for ( size_t i = 0; i < values.size(); ++i ) total += values[i] > 0 ? values[i] : 0;
+    return total;
+  }
+
+}
+
+
+void RunDictionary::clear() {
+  runNumber = 0;
+  detectorName.clear();
+  description.clear();
+  collections.clear();
+  parameters.clear();
+}
+
+
+EventBlock::EventBlock() :
+  eventNumber(), timeStamp(), eventType(), collectionSize(),
+  hitCellID0(), hitCellID1(), hitType(), hitQuality(), hitX(), hitY(), hitZ(),
+  hitEDep(), hitEDepError(), hitTime(), hitCov(),
+  trackType(), trackNdf(), trackD0(), trackPhi(), trackOmega(), trackZ0(), trackTanLambda(),
+  trackChi2(), trackdEdx(), trackdEdxError(), trackRadiusOfInnermostHit(), trackCov(),
+  trackReferencePoint(), trackNHits(), trackNSubTracks(), trackHitIndex(), trackSubTrackIndex() {
+}
+
+
+void EventBlock::clear() {
+  // the capacity is kept: a block object is reused for the whole file
+  ColumnClearer clearer;
+  visitColumns( *this, clearer );
+}
+
+
+bool EventBlock::isConsistent( size_t nCollections ) const {
+  const size_t nEvents = eventNumber.size();
+  if ( !hasSize( timeStamp, nEvents ) || !hasSize( eventType, nEvents ) ||
+       !hasSize( collectionSize, nEvents * nCollections ) ) return false;
+
+  const size_t nHits = hitCellID0.size();
+  if ( !hasSize( hitCellID1, nHits ) || !hasSize( hitType, nHits ) || !hasSize( hitQuality, nHits ) ||
+       !hasSize( hitX, nHits ) || !hasSize( hitY, nHits ) || !hasSize( hitZ, nHits ) ||
+       !hasSize( hitEDep, nHits ) || !hasSize( hitEDepError, nHits ) || !hasSize( hitTime, nHits ) ||
+       !hasSize( hitCov, 6 * nHits ) ) return false;
+
+  const size_t nTracks = trackType.size();
+  if ( !hasSize( trackNdf, nTracks ) || !hasSize( trackD0, nTracks ) || !hasSize( trackPhi, nTracks ) ||
+       !hasSize( trackOmega, nTracks ) || !hasSize( trackZ0, nTracks ) || !hasSize( trackTanLambda, nTracks ) ||
+       !hasSize( trackChi2, nTracks ) || !hasSize( trackdEdx, nTracks ) || !hasSize( trackdEdxError, nTracks ) ||
+       !hasSize( trackRadiusOfInnermostHit, nTracks ) || !hasSize( trackCov, 15 * nTracks ) ||
+       !hasSize( trackReferencePoint, 3 * nTracks ) || !hasSize( trackNHits, nTracks ) ||
+       !hasSize( trackNSubTracks, nTracks ) ) return false;
+
+  return sum( collectionSize ) == static_cast< long long >( nHits + nTracks ) &&
+    sum( trackNHits ) == static_cast< long long >( trackHitIndex.size() ) &&
+    sum( trackNSubTracks ) == static_cast< long long >( trackSubTrackIndex.size() );
+}
+
+
+CompactFileWriter::CompactFileWriter() :
+  _file(), _fileName(), _compressionLevel( 0 ), _payload(), _compressed(), _rawBytes( 0 ), _storedBytes( 0 ) {
+}
+
+CompactFileWriter::~CompactFileWriter() {
+  if ( _file.is_open() ) _file.close();
+}
+
+void CompactFileWriter::open( const string & fileName, int compressionLevel ) {
+  if ( _file.is_open() ) close();
+
+  _fileName = fileName;
+#ifdef USE_ZLIB
+  _compressionLevel = compressionLevel > 9 ? 9 : compressionLevel;
+#else
+  // without zlib all records are stored uncompressed
+  _compressionLevel = 0;
+  (void) compressionLevel;
+#endif
+  _rawBytes = _storedBytes = 0;
+
+  _file.open( fileName.c_str(), ios::binary | ios::trunc );
+  if ( !_file ) throw lcio::IOException( "Cannot open compact file " + fileName + " for writing" );
+
+  FileHeader header;
+  memset( &header, 0, sizeof( header ) );
+  memcpy( header.magic, fileMagic, sizeof( fileMagic ) );
+  header.version = formatVersion;
+  header.byteOrder = byteOrderMark;
+  _file.write( reinterpret_cast< const char * >( &header ), sizeof( header ) );
+}
+
+void CompactFileWriter::close() {
+  if ( !_file.is_open() ) return;
+  _file.close();
+  if ( !_file ) throw lcio::IOException( "Writing compact file " + _fileName + " failed" );
+}
+
+void CompactFileWriter::write( const RunDictionary & dictionary ) {
+  _payload.clear();
+  PayloadWriter out( _payload );
+
+  out.put( dictionary.runNumber );
+  out.putString( dictionary.detectorName );
+  out.putString( dictionary.description );
+
+  out.put( static_cast< unsigned int >( dictionary.collections.size() ) );
+  for ( size_t i = 0; i < dictionary.collections.size(); ++i ) {
+    const CollectionEntry & entry = dictionary.collections[i];
+    out.putString( entry.name );
+    out.put( entry.kind );
+    out.put( entry.flag );
+    out.putString( entry.cellIDEncoding );
+  }
+
+  out.put( static_cast< unsigned int >( dictionary.parameters.size() ) );
+  for ( size_t i = 0; i < dictionary.parameters.size(); ++i ) {
+    const ParameterEntry & entry = dictionary.parameters[i];
+    out.put( entry.type );
+    out.putString( entry.key );
+    out( entry.intValues );
+    out( entry.floatValues );
+    out.put( static_cast< unsigned int >( entry.stringValues.size() ) );
+    for ( size_t j = 0; j < entry.stringValues.size(); ++j ) out.putString( entry.stringValues[j] );
+  }
+  out.pad();
+
+  writeRecord( kRunDictionaryRecord );
+}
+
+void CompactFileWriter::writeCollectionUpdate( const RunDictionary & dictionary, const vector< unsigned int > & collections ) {
+  _payload.clear();
+  PayloadWriter out( _payload );
+
+  out.put( static_cast< unsigned int >( collections.size() ) );
+  for ( size_t i = 0; i < collections.size(); ++i ) {
+    const CollectionEntry & entry = dictionary.collections.at( collections[i] );
+    out.put( collections[i] );
+    out.put( entry.flag );
+    out.putString( entry.cellIDEncoding );
+  }
+  out.pad();
+
+  writeRecord( kCollectionUpdateRecord );
+}
+
+void CompactFileWriter::write( const EventBlock & block ) {
+  ColumnSize size;
+  visitColumns( block, size );
+
+  _payload.clear();
+  _payload.reserve( size.bytes + 8 );
+  PayloadWriter out( _payload );
+  out.put( nBlockColumns );
+  out.put( static_cast< unsigned int >( 0 ) );
+  visitColumns( block, out );
+
+  writeRecord( kEventBlockRecord );
+}
+
+void CompactFileWriter::writeRecord( unsigned int type ) {
+  if ( !_file.is_open() ) throw lcio::IOException( "Compact file is not open" );
+
+  RecordHeader header;
+  header.type = type;
+  header.flags = 0;
+  header.rawSize = _payload.size();
+  header.storedSize = _payload.size();
+
+  const char * stored = _payload.empty() ? 0 : &_payload[0];
+
+#ifdef USE_ZLIB
+  if ( _compressionLevel > 0 && !_payload.empty() ) {
+    uLongf compressedSize = compressBound( _payload.size() );
+    _compressed.resize( compressedSize );
+    if ( compress2( reinterpret_cast< Bytef * >( &_compressed[0] ), &compressedSize,
+                    reinterpret_cast< const Bytef * >( &_payload[0] ), _payload.size(), _compressionLevel ) == Z_OK &&
+         compressedSize < _payload.size() ) {
+      header.flags |= compressedFlag;
+      header.storedSize = compressedSize;
+      stored = &_compressed[0];
+    }
+  }
+#endif
+
+  _file.write( reinterpret_cast< const char * >( &header ), sizeof( header ) );
+  if ( header.storedSize != 0 ) _file.write( stored, header.storedSize );
+  static const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  _file.write( zeros, padded( header.storedSize ) - header.storedSize );
+  if ( !_file ) throw lcio::IOException( "Writing compact file " + _fileName + " failed" );
+
+  _rawBytes += header.rawSize;
+  _storedBytes += header.storedSize;
+}
+
+
+CompactFileReader::CompactFileReader() :
+  _fileName(), _mapped( 0 ), _size( 0 ), _position( 0 ),
+  _recordType( kEndOfFile ), _recordFlags( 0 ), _recordPayload( 0 ), _recordRawSize( 0 ), _recordStoredSize( 0 ),
+  _uncompressed() {
+}
+
+CompactFileReader::~CompactFileReader() {
+  close();
+}
+
+void CompactFileReader::open( const string & fileName ) {
+  close();
+  _fileName = fileName;
+
+  int fd = ::open( fileName.c_str(), O_RDONLY );
+  if ( fd < 0 ) throw lcio::IOException( "Cannot open compact file " + fileName );
+
+  struct stat fileStat;
+  if ( fstat( fd, &fileStat ) != 0 || static_cast< size_t >( fileStat.st_size ) < sizeof( FileHeader ) ) {
+    ::close( fd );
+    throw lcio::IOException( "Compact file " + fileName + " is too short" );
+  }
+
+  void * mapped = mmap( 0, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  ::close( fd );
+  if ( mapped == MAP_FAILED ) throw lcio::IOException( "Cannot map compact file " + fileName );
+
+  // the file is read once from the beginning to the end
+  madvise( mapped, fileStat.st_size, MADV_SEQUENTIAL );
+
+  _mapped = static_cast< const char * >( mapped );
+  _size = fileStat.st_size;
+
+  FileHeader header;
+  memcpy( &header, _mapped, sizeof( header ) );
+  if ( memcmp( header.magic, fileMagic, sizeof( fileMagic ) ) != 0 ) {
+    close();
+    throw lcio::IOException( "File " + fileName + " is not a compact file" );
+  }
+  if ( header.byteOrder != byteOrderMark ) {
+    close();
+    throw lcio::IOException( "Compact file " + fileName + " was written on a machine with a different byte order" );
+  }
+  if ( header.version == 0 || header.version > formatVersion ) {
+    close();
+    stringstream ss;
+    ss << "Compact file " << fileName << " has format version " << header.version << ", expected " << formatVersion;
+    throw lcio::IOException( ss.str() );
+  }
+  _position = sizeof( FileHeader );
+}
+
+void CompactFileReader::close() {
+  if ( _mapped ) munmap( const_cast< char * >( _mapped ), _size );
+  _mapped = 0;
+  _size = 0;
+  _position = 0;
+  _recordType = kEndOfFile;
+  _recordPayload = 0;
+}
+
+int CompactFileReader::nextRecord() {
+  if ( !_mapped || _position == _size ) {
+    _recordType = kEndOfFile;
+    return _recordType;
+  }
+  if ( _size - _position < sizeof( RecordHeader ) ) throw lcio::IOException( "Compact file " + _fileName + " is truncated" );
+
+  RecordHeader header;
+  memcpy( &header, _mapped + _position, sizeof( header ) );
+  _position += sizeof( header );
+  if ( header.storedSize > _size - _position ) throw lcio::IOException( "Compact file " + _fileName + " is truncated" );
+
+  _recordType = header.type;
+  _recordFlags = header.flags;
+  _recordRawSize = header.rawSize;
+  _recordStoredSize = header.storedSize;
+  _recordPayload = _mapped + _position;
+
+  _position += padded( header.storedSize );
+  if ( _position > _size ) _position = _size;
+  return _recordType;
+}
+
+void CompactFileReader::getPayload( const char *& begin, const char *& end ) {
+  if ( ( _recordFlags & compressedFlag ) == 0 ) {
+    begin = _recordPayload;
+    end = _recordPayload + _recordStoredSize;
+    return;
+  }
+#ifdef USE_ZLIB
+  _uncompressed.resize( _recordRawSize );
+  uLongf rawSize = _recordRawSize;
+  if ( _recordRawSize == 0 ||
+       uncompress( reinterpret_cast< Bytef * >( &_uncompressed[0] ), &rawSize,
+                   reinterpret_cast< const Bytef * >( _recordPayload ), _recordStoredSize ) != Z_OK ||
+       rawSize != _recordRawSize ) {
+    throw lcio::IOException( "Compact file " + _fileName + " is corrupted: cannot uncompress a record" );
+  }
+  begin = &_uncompressed[0];
+  end = begin + rawSize;
+#else
+  begin = end = 0;
+  throw lcio::IOException( "Compact file " + _fileName + " is compressed, but Eutelescope was built without zlib" );
+#endif
+}
+
+void CompactFileReader::read( RunDictionary & dictionary ) {
+  if ( _recordType != kRunDictionaryRecord ) throw lcio::IOException( "The current record is not a run dictionary" );
+
+  const char * begin;
+  const char * end;
+  getPayload( begin, end );
+  PayloadReader in( begin, end, _fileName );
+
+  dictionary.clear();
+  dictionary.runNumber = in.get< int >();
+  dictionary.detectorName = in.getString();
+  dictionary.description = in.getString();
+
+  const unsigned int nCollections = in.get< unsigned int >();
+  for ( unsigned int i = 0; i < nCollections; ++i ) {
+    CollectionEntry entry;
+    entry.name = in.getString();
+    entry.kind = in.get< int >();
+    entry.flag = in.get< int >();
+    entry.cellIDEncoding = in.getString();
+    dictionary.collections.push_back( entry );
+  }
+
+  const unsigned int nParameters = in.get< unsigned int >();
+  for ( unsigned int i = 0; i < nParameters; ++i ) {
+    dictionary.parameters.push_back( ParameterEntry() );
+    ParameterEntry & entry = dictionary.parameters.back();
+    entry.type = in.get< int >();
+    entry.key = in.getString();
+    in( entry.intValues );
+    in( entry.floatValues );
+    const unsigned int nStrings = in.get< unsigned int >();
+    for ( unsigned int j = 0; j < nStrings; ++j ) entry.stringValues.push_back( in.getString() );
+  }
+}
+
+void CompactFileReader::readCollectionUpdate( RunDictionary & dictionary ) {
+  if ( _recordType != kCollectionUpdateRecord ) throw lcio::IOException( "The current record is not a collection update" );
+
+  const char * begin;
+  const char * end;
+  getPayload( begin, end );
+  PayloadReader in( begin, end, _fileName );
+
+  const unsigned int nCollections = in.get< unsigned int >();
+  for ( unsigned int i = 0; i < nCollections; ++i ) {
+    const unsigned int index = in.get< unsigned int >();
+    if ( index >= dictionary.collections.size() ) in.fail( "collection update for an unknown collection" );
+    CollectionEntry & entry = dictionary.collections[index];
+    entry.flag = in.get< int >();
+    entry.cellIDEncoding = in.getString();
+  }
+}
+
+void CompactFileReader::read( EventBlock & block ) {
+  if ( _recordType != kEventBlockRecord ) throw lcio::IOException( "The current record is not an event block" );
+
+  const char * begin;
+  const char * end;
+  getPayload( begin, end );
+  PayloadReader in( begin, end, _fileName );
+
+  if ( in.get< unsigned int >() != nBlockColumns ) in.fail( "unexpected number of columns" );
+  in.get< unsigned int >();
+  visitColumns( block, in );
+}
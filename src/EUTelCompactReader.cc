@@ -0,0 +1,244 @@
+// Version $Id$
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelCompactReader.h"
+#include "EUTELESCOPE.h"
+#include "EUTelRunHeaderImpl.h"
+#include "EUTelEventImpl.h"
+
+// marlin includes ".h"
+#include "marlin/Processor.h"
+#include "marlin/DataSourceProcessor.h"
+#include "marlin/ProcessorMgr.h"
+
+// lcio includes <.h>
+#include <IMPL/LCCollectionVec.h>
+#include <Exceptions.h>
+
+// system includes <>
+#include <memory>
+#include <cstdlib>
+
+using namespace std;
+using namespace lcio;
+using namespace marlin;
+using namespace eutelescope;
+
+EUTelCompactReader::EUTelCompactReader() : DataSourceProcessor("EUTelCompactReader"),
+  _fileName("input.cmp"),
+  _nextHit(0),
+  _nextTrack(0),
+  _nextHitIndex(0),
+  _nextSubTrackIndex(0),
+  _eventHits(),
+  _eventTracks(),
+  _runNumber(0),
+  _nEvents(0)
+{
+  _description =
+    "Reads a compact intermediate file written by EUTelCompactWriter.\n"
+    "Make sure to not specify any LCIOInputFiles in the steering in order to read compact files.";
+
+  registerProcessorParameter("CompactFileName", "Input file", _fileName, string("input.cmp"));
+}
+
+EUTelCompactReader * EUTelCompactReader::newProcessor() {
+  return new EUTelCompactReader;
+}
+
+void EUTelCompactReader::init() {
+  printParameters();
+}
+
+
+void EUTelCompactReader::readDataSource( int numEvents ) {
+
+  compact::CompactFileReader reader;
+  try {
+    reader.open( _fileName );
+  } catch ( lcio::IOException& e ) {
+    streamlog_out ( ERROR5 ) << e.what() << ". Exiting." << endl;
+    exit(-1);
+  }
+
+  compact::RunDictionary dictionary;
+  compact::EventBlock block;
+  auto_ptr< IMPL::LCRunHeaderImpl > runHeader;
+  bool runOpen = false;
+  _nEvents = 0;
+
+  int recordType;
+  while ( ( recordType = reader.nextRecord() ) != compact::kEndOfFile ) {
+
+    if ( numEvents > 0 && _nEvents >= numEvents ) break;
+
+    if ( recordType == compact::kRunDictionaryRecord ) {
+      reader.read( dictionary );
+      runHeader.reset( processDictionary( dictionary ) );
+      runOpen = true;
+
+    } else if ( recordType == compact::kCollectionUpdateRecord ) {
+      if ( !runOpen ) throw lcio::IOException( "Compact file " + _fileName + ": collection update before the first run dictionary" );
+      reader.readCollectionUpdate( dictionary );
+
+    } else if ( recordType == compact::kEventBlockRecord ) {
+      if ( !runOpen ) throw lcio::IOException( "Compact file " + _fileName + ": event block before the first run dictionary" );
+      reader.read( block );
+      if ( !block.isConsistent( dictionary.collections.size() ) ) {
+        throw lcio::IOException( "Compact file " + _fileName + " is corrupted: inconsistent event block" );
+      }
+
+      _nextHit = _nextTrack = _nextHitIndex = _nextSubTrackIndex = 0;
+      for ( int iEvent = 0; iEvent < block.getNumberOfEvents(); ++iEvent ) {
+        if ( numEvents > 0 && _nEvents >= numEvents ) break;
+        processBlockEvent( dictionary, block, iEvent );
+      }
+
+    } else {
+      streamlog_out ( WARNING2 ) << "Unknown record type " << recordType << " in " << _fileName << ", skipped" << endl;
+    }
+  }
+
+  EUTelEventImpl * event = new EUTelEventImpl;
+  event->setDetectorName( dictionary.detectorName );
+  event->setRunNumber( _runNumber );
+  event->setEventNumber( _nEvents );
+  event->setEventType( kEORE );
+  ProcessorMgr::instance()->processEvent( static_cast<LCEventImpl*> (event) );
+  delete event;
+
+  reader.close();
+}
+
+
+IMPL::LCRunHeaderImpl * EUTelCompactReader::processDictionary( const compact::RunDictionary & dictionary ) {
+  IMPL::LCRunHeaderImpl * lcHeader = new IMPL::LCRunHeaderImpl;
+  lcHeader->setRunNumber( dictionary.runNumber );
+  lcHeader->setDetectorName( dictionary.detectorName );
+  lcHeader->setDescription( dictionary.description );
+
+  for ( size_t i = 0; i < dictionary.parameters.size(); ++i ) {
+    const compact::ParameterEntry & entry = dictionary.parameters[i];
+    if ( entry.type == 0 ) {
+      IntVec values( entry.intValues );
+      lcHeader->parameters().setValues( entry.key, values );
+    } else if ( entry.type == 1 ) {
+      FloatVec values( entry.floatValues );
+      lcHeader->parameters().setValues( entry.key, values );
+    } else {
+      StringVec values( entry.stringValues );
+      lcHeader->parameters().setValues( entry.key, values );
+    }
+  }
+
+  auto_ptr<EUTelRunHeaderImpl> runHeader ( new EUTelRunHeaderImpl( lcHeader ) );
+  runHeader->addIntermediateFile( _fileName );
+  runHeader->addProcessor( type() );
+
+  _runNumber = dictionary.runNumber;
+  streamlog_out ( MESSAGE5 ) << "Reading run " << _runNumber << " from " << _fileName << endl;
+
+  ProcessorMgr::instance()->processRunHeader( lcHeader );
+  return lcHeader;
+}
+
+
+void EUTelCompactReader::processBlockEvent( const compact::RunDictionary & dictionary, const compact::EventBlock & block, int iEvent ) {
+
+  EUTelEventImpl * event = new EUTelEventImpl;
+  event->setDetectorName( dictionary.detectorName );
+  event->setRunNumber( _runNumber );
+  event->setEventNumber( block.eventNumber[iEvent] );
+  event->setTimeStamp( block.timeStamp[iEvent] );
+  event->setEventType( block.eventType[iEvent] );
+
+  _eventHits.clear();
+  _eventTracks.clear();
+  const size_t firstTrack = _nextTrack;
+
+  const size_t nCollections = dictionary.collections.size();
+  for ( size_t iCollection = 0; iCollection < nCollections; ++iCollection ) {
+    const int nElements = block.collectionSize[ iEvent * nCollections + iCollection ];
+    if ( nElements < 0 ) continue;
+
+    const compact::CollectionEntry & entry = dictionary.collections[iCollection];
+    const bool isHitCollection = ( entry.kind == compact::kHitCollection );
+    LCCollectionVec * collection = new LCCollectionVec( isHitCollection ? LCIO::TRACKERHIT : LCIO::TRACK );
+    collection->setFlag( entry.flag );
+    if ( !entry.cellIDEncoding.empty() ) collection->parameters().setValue( LCIO::CellIDEncoding, entry.cellIDEncoding );
+    collection->reserve( nElements );
+
+    if ( isHitCollection ) {
+      for ( int iElement = 0; iElement < nElements; ++iElement ) {
+        const size_t h = _nextHit++;
+        TrackerHitImpl * hit = new TrackerHitImpl;
+        hit->setCellID0( block.hitCellID0[h] );
+        hit->setCellID1( block.hitCellID1[h] );
+        hit->setType( block.hitType[h] );
+        hit->setQuality( block.hitQuality[h] );
+        const double position[3] = { block.hitX[h], block.hitY[h], block.hitZ[h] };
+        hit->setPosition( position );
+        hit->setEDep( block.hitEDep[h] );
+        hit->setEDepError( block.hitEDepError[h] );
+        hit->setTime( block.hitTime[h] );
+        hit->setCovMatrix( &block.hitCov[ 6 * h ] );
+        collection->push_back( hit );
+        _eventHits.push_back( hit );
+      }
+    } else {
+      for ( int iElement = 0; iElement < nElements; ++iElement ) {
+        const size_t t = _nextTrack++;
+        TrackImpl * track = new TrackImpl;
+        for ( int bit = 0; bit < 32; ++bit ) track->setTypeBit( bit, ( block.trackType[t] >> bit ) & 1 );
+        track->setNdf( block.trackNdf[t] );
+        track->setD0( block.trackD0[t] );
+        track->setPhi( block.trackPhi[t] );
+        track->setOmega( block.trackOmega[t] );
+        track->setZ0( block.trackZ0[t] );
+        track->setTanLambda( block.trackTanLambda[t] );
+        track->setChi2( block.trackChi2[t] );
+        track->setdEdx( block.trackdEdx[t] );
+        track->setdEdxError( block.trackdEdxError[t] );
+        track->setRadiusOfInnermostHit( block.trackRadiusOfInnermostHit[t] );
+        track->setCovMatrix( &block.trackCov[ 15 * t ] );
+        track->setReferencePoint( &block.trackReferencePoint[ 3 * t ] );
+        collection->push_back( track );
+        _eventTracks.push_back( track );
+      }
+    }
+
+    event->addCollection( collection, entry.name );
+  }
+
+  // relations, once all the objects of the event exist
+  for ( size_t i = 0; i < _eventTracks.size(); ++i ) {
+    const size_t t = firstTrack + i;
+    for ( int j = 0; j < block.trackNHits[t]; ++j ) {
+      const int index = block.trackHitIndex[ _nextHitIndex++ ];
+      if ( index >= 0 && static_cast< size_t >( index ) < _eventHits.size() ) _eventTracks[i]->addHit( _eventHits[index] );
+    }
+    for ( int j = 0; j < block.trackNSubTracks[t]; ++j ) {
+      const int index = block.trackSubTrackIndex[ _nextSubTrackIndex++ ];
+      if ( index >= 0 && static_cast< size_t >( index ) < _eventTracks.size() ) _eventTracks[i]->addTrack( _eventTracks[index] );
+    }
+  }
+
+  ++_nEvents;
+  if ( _nEvents % 1000 == 0 ) streamlog_out ( MESSAGE4 ) << "Reading event " << _nEvents << endl;
+
+  ProcessorMgr::instance()->processEvent( static_cast<LCEventImpl*> (event) );
+  delete event;
+}
+
+
+void EUTelCompactReader::end() {
+  streamlog_out ( MESSAGE5 ) << "Read " << _nEvents << " events from " << _fileName << endl;
+}
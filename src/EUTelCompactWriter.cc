@@ -0,0 +1,318 @@
+// Version $Id$
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelCompactWriter.h"
+#include "EUTelRunHeaderImpl.h"
+#include "EUTelEventImpl.h"
+#include "EUTELESCOPE.h"
+
+// marlin includes ".h"
+#include "marlin/Processor.h"
+
+// lcio includes <.h>
+#include <EVENT/LCIO.h>
+#include <EVENT/LCParameters.h>
+#include <Exceptions.h>
+
+// system includes <>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+
+using namespace std;
+using namespace lcio;
+using namespace marlin;
+using namespace eutelescope;
+
+EUTelCompactWriter::EUTelCompactWriter() : Processor("EUTelCompactWriter"),
+  _fileName("output.cmp"),
+  _hitCollectionNames(),
+  _trackCollectionNames(),
+  _stateCollectionNames(),
+  _eventsPerBlock(1000),
+  _compressionLevel(1),
+  _writer(),
+  _dictionary(),
+  _dictionaryWritten(false),
+  _collectionSeen(),
+  _collectionsToUpdate(),
+  _block(),
+  _eventCollections(),
+  _hitIndex(),
+  _trackIndex(),
+  _runOpen(false),
+  _nEvents(0),
+  _nLostRelations(0)
+{
+  _description = "Writes hits, tracks and states to a compact intermediate file, to be read with EUTelCompactReader";
+
+  registerInputCollections(LCIO::TRACKERHIT, "HitCollectionNames", "Hit collections to be written",
+                           _hitCollectionNames, StringVec());
+  registerInputCollections(LCIO::TRACK, "TrackCollectionNames", "Track collections to be written",
+                           _trackCollectionNames, StringVec());
+  registerInputCollections(LCIO::TRACK, "StateCollectionNames", "Collections of track states to be written",
+                           _stateCollectionNames, StringVec());
+
+  registerProcessorParameter("CompactFileName", "Name of the output file", _fileName, string("output.cmp"));
+  registerOptionalParameter("EventsPerBlock", "Number of events stored (and compressed) together", _eventsPerBlock, 1000);
+  registerOptionalParameter("CompressionLevel", "zlib compression level of the blocks (0 = no compression)", _compressionLevel, 1);
+}
+
+
+void EUTelCompactWriter::init() {
+  printParameters();
+
+  if ( _eventsPerBlock < 1 ) _eventsPerBlock = 1;
+
+  _writer.open( _fileName, _compressionLevel );
+#ifndef USE_ZLIB
+  if ( _compressionLevel > 0 ) {
+    streamlog_out ( WARNING2 ) << "Eutelescope was built without zlib: " << _fileName << " will not be compressed" << endl;
+  }
+#endif
+
+  _runOpen = false;
+  _nEvents = 0;
+  _nLostRelations = 0;
+}
+
+
+void EUTelCompactWriter::processRunHeader( LCRunHeader * run ) {
+  auto_ptr<EUTelRunHeaderImpl> runHeader ( new EUTelRunHeaderImpl( run ) ) ;
+  runHeader->addProcessor( type() );
+
+  // the events of the previous run go into its own blocks
+  if ( _runOpen ) flushBlock();
+
+  _dictionary.clear();
+  _dictionary.runNumber = run->getRunNumber();
+  _dictionary.detectorName = run->getDetectorName();
+  _dictionary.description = run->getDescription();
+
+  const LCParameters & parameters = run->getParameters();
+  StringVec keys;
+  parameters.getIntKeys( keys );
+  for ( size_t i = 0; i < keys.size(); ++i ) {
+    compact::ParameterEntry entry;
+    entry.type = 0;
+    entry.key = keys[i];
+    parameters.getIntVals( keys[i], entry.intValues );
+    _dictionary.parameters.push_back( entry );
+  }
+  keys.clear();
+  parameters.getFloatKeys( keys );
+  for ( size_t i = 0; i < keys.size(); ++i ) {
+    compact::ParameterEntry entry;
+    entry.type = 1;
+    entry.key = keys[i];
+    parameters.getFloatVals( keys[i], entry.floatValues );
+    _dictionary.parameters.push_back( entry );
+  }
+  keys.clear();
+  parameters.getStringKeys( keys );
+  for ( size_t i = 0; i < keys.size(); ++i ) {
+    compact::ParameterEntry entry;
+    entry.type = 2;
+    entry.key = keys[i];
+    parameters.getStringVals( keys[i], entry.stringValues );
+    _dictionary.parameters.push_back( entry );
+  }
+
+  // flag and encoding are taken from the first event with the collection
+  const std::vector< std::string > * names[3] = { &_hitCollectionNames, &_trackCollectionNames, &_stateCollectionNames };
+  const int kinds[3] = { compact::kHitCollection, compact::kTrackCollection, compact::kStateCollection };
+  for ( int k = 0; k < 3; ++k ) {
+    for ( size_t i = 0; i < names[k]->size(); ++i ) {
+      compact::CollectionEntry entry;
+      entry.name = ( *names[k] )[i];
+      entry.kind = kinds[k];
+      entry.flag = 0;
+      _dictionary.collections.push_back( entry );
+    }
+  }
+  _collectionSeen.assign( _dictionary.collections.size(), false );
+  _collectionsToUpdate.clear();
+  _eventCollections.assign( _dictionary.collections.size(), 0 );
+
+  _dictionaryWritten = false;
+  _runOpen = true;
+}
+
+
+void EUTelCompactWriter::processEvent( LCEvent * event ) {
+  EUTelEventImpl * evt = static_cast<EUTelEventImpl*> (event);
+  if ( evt->getEventType() == kEORE ) {
+    // the reader adds its own end of run event
+    streamlog_out ( DEBUG4 ) << "EORE found: nothing else to do." << endl;
+    return;
+  }
+
+  if ( !_runOpen ) {
+    streamlog_out ( ERROR5 ) << "Event " << evt->getEventNumber() << " without run header, not written" << endl;
+    return;
+  }
+
+  const size_t nCollections = _dictionary.collections.size();
+  for ( size_t i = 0; i < nCollections; ++i ) {
+    try {
+      _eventCollections[i] = evt->getCollection( _dictionary.collections[i].name );
+    } catch ( lcio::DataNotAvailableException& e ) {
+      _eventCollections[i] = 0;
+    }
+    if ( _eventCollections[i] && !_collectionSeen[i] ) {
+      _dictionary.collections[i].flag = _eventCollections[i]->getFlag();
+      _dictionary.collections[i].cellIDEncoding = _eventCollections[i]->getParameters().getStringVal( LCIO::CellIDEncoding );
+      _collectionSeen[i] = true;
+      // too late for the dictionary, written before the next block
+      if ( _dictionaryWritten ) _collectionsToUpdate.push_back( i );
+    }
+  }
+
+  indexEvent();
+
+  _block.eventNumber.push_back( evt->getEventNumber() );
+  _block.timeStamp.push_back( evt->getTimeStamp() );
+  _block.eventType.push_back( evt->getEventType() );
+
+  for ( size_t i = 0; i < nCollections; ++i ) {
+    LCCollection * collection = _eventCollections[i];
+    if ( !collection ) {
+      _block.collectionSize.push_back( -1 );
+      continue;
+    }
+    const int nElements = collection->getNumberOfElements();
+    _block.collectionSize.push_back( nElements );
+    if ( _dictionary.collections[i].kind == compact::kHitCollection ) {
+      for ( int iElement = 0; iElement < nElements; ++iElement ) {
+        addHit( static_cast< TrackerHit * >( collection->getElementAt( iElement ) ) );
+      }
+    } else {
+      for ( int iElement = 0; iElement < nElements; ++iElement ) {
+        addTrack( static_cast< Track * >( collection->getElementAt( iElement ) ) );
+      }
+    }
+  }
+
+  ++_nEvents;
+  if ( _block.getNumberOfEvents() >= _eventsPerBlock ) flushBlock();
+}
+
+
+void EUTelCompactWriter::indexEvent() {
+  // relations may point to a collection stored later in the event,
+  // so all the positions are known before the first element is added
+  _hitIndex.clear();
+  _trackIndex.clear();
+  int nHits = 0;
+  int nTracks = 0;
+  for ( size_t i = 0; i < _eventCollections.size(); ++i ) {
+    LCCollection * collection = _eventCollections[i];
+    if ( !collection ) continue;
+    const int nElements = collection->getNumberOfElements();
+    if ( _dictionary.collections[i].kind == compact::kHitCollection ) {
+      for ( int iElement = 0; iElement < nElements; ++iElement ) {
+        _hitIndex[ static_cast< TrackerHit * >( collection->getElementAt( iElement ) ) ] = nHits++;
+      }
+    } else {
+      for ( int iElement = 0; iElement < nElements; ++iElement ) {
+        _trackIndex[ static_cast< Track * >( collection->getElementAt( iElement ) ) ] = nTracks++;
+      }
+    }
+  }
+}
+
+
+void EUTelCompactWriter::addHit( const TrackerHit * hit ) {
+  _block.hitCellID0.push_back( hit->getCellID0() );
+  _block.hitCellID1.push_back( hit->getCellID1() );
+  _block.hitType.push_back( hit->getType() );
+  _block.hitQuality.push_back( hit->getQuality() );
+  const double * position = hit->getPosition();
+  _block.hitX.push_back( position[0] );
+  _block.hitY.push_back( position[1] );
+  _block.hitZ.push_back( position[2] );
+  _block.hitEDep.push_back( hit->getEDep() );
+  _block.hitEDepError.push_back( hit->getEDepError() );
+  _block.hitTime.push_back( hit->getTime() );
+  const FloatVec & cov = hit->getCovMatrix();
+  for ( size_t i = 0; i < 6; ++i ) _block.hitCov.push_back( i < cov.size() ? cov[i] : 0. );
+}
+
+
+void EUTelCompactWriter::addTrack( const Track * track ) {
+  _block.trackType.push_back( track->getType() );
+  _block.trackNdf.push_back( track->getNdf() );
+  _block.trackD0.push_back( track->getD0() );
+  _block.trackPhi.push_back( track->getPhi() );
+  _block.trackOmega.push_back( track->getOmega() );
+  _block.trackZ0.push_back( track->getZ0() );
+  _block.trackTanLambda.push_back( track->getTanLambda() );
+  _block.trackChi2.push_back( track->getChi2() );
+  _block.trackdEdx.push_back( track->getdEdx() );
+  _block.trackdEdxError.push_back( track->getdEdxError() );
+  _block.trackRadiusOfInnermostHit.push_back( track->getRadiusOfInnermostHit() );
+  const FloatVec & cov = track->getCovMatrix();
+  for ( size_t i = 0; i < 15; ++i ) _block.trackCov.push_back( i < cov.size() ? cov[i] : 0. );
+  const float * referencePoint = track->getReferencePoint();
+  for ( int i = 0; i < 3; ++i ) _block.trackReferencePoint.push_back( referencePoint[i] );
+
+  const TrackerHitVec & hits = track->getTrackerHits();
+  _block.trackNHits.push_back( hits.size() );
+  for ( size_t i = 0; i < hits.size(); ++i ) {
+    map< const TrackerHit *, int >::const_iterator it = _hitIndex.find( hits[i] );
+    if ( it == _hitIndex.end() ) ++_nLostRelations;
+    _block.trackHitIndex.push_back( it == _hitIndex.end() ? -1 : it->second );
+  }
+
+  const TrackVec & subTracks = track->getTracks();
+  _block.trackNSubTracks.push_back( subTracks.size() );
+  for ( size_t i = 0; i < subTracks.size(); ++i ) {
+    map< const Track *, int >::const_iterator it = _trackIndex.find( subTracks[i] );
+    if ( it == _trackIndex.end() ) ++_nLostRelations;
+    _block.trackSubTrackIndex.push_back( it == _trackIndex.end() ? -1 : it->second );
+  }
+}
+
+
+void EUTelCompactWriter::flushBlock() {
+  if ( !_dictionaryWritten ) {
+    _writer.write( _dictionary );
+    _dictionaryWritten = true;
+  }
+  if ( _block.getNumberOfEvents() == 0 ) return;
+
+  if ( !_collectionsToUpdate.empty() ) {
+    _writer.writeCollectionUpdate( _dictionary, _collectionsToUpdate );
+    _collectionsToUpdate.clear();
+  }
+
+  _writer.write( _block );
+  streamlog_out ( DEBUG4 ) << "Written a block of " << _block.getNumberOfEvents() << " events, "
+                           << _block.hitX.size() << " hits and " << _block.trackType.size() << " tracks" << endl;
+  _block.clear();
+}
+
+
+void EUTelCompactWriter::end() {
+  if ( _runOpen ) flushBlock();
+  _writer.close();
+
+  streamlog_out ( MESSAGE4 ) << "Written " << _nEvents << " events to " << _fileName << endl;
+  if ( _writer.getStoredBytes() > 0 ) {
+    streamlog_out ( MESSAGE4 ) << "Payload " << _writer.getRawBytes() << " bytes, stored " << _writer.getStoredBytes()
+                               << " bytes (ratio " << setprecision(3)
+                               << static_cast< double >( _writer.getRawBytes() ) / _writer.getStoredBytes() << ")" << endl;
+  }
+  if ( _nLostRelations > 0 ) {
+    streamlog_out ( WARNING2 ) << _nLostRelations << " track relations point to hits or tracks not written to "
+                               << _fileName << " and were lost" << endl;
+  }
+}
@@ -26,6 +26,7 @@
 #include "EUTelDFFClusterImpl.h"
 #include "EUTelBrickedClusterImpl.h"
 #include "EUTelSparseClusterImpl.h"
+#include "EUTelClusterSummary.h"
 #include "EUTelExceptions.h"
 #include "EUTelAlignmentConstant.h"
 
@@ -320,119 +321,51 @@ void EUTelCorrelator::processEvent (LCEvent * event) {
 
     if ( _hasClusterCollection && !_hasHitCollection) {
 
-      for( size_t eCol = 0; eCol < _clusterCollectionVec.size() ; eCol++ )
+      // every cluster is decoded once per event, not once per pair
+      std::vector< EUTelClusterSummary * > clusterSummaries;
+      for( size_t iCol = 0; iCol < _clusterCollectionVec.size() ; iCol++ )
       {
-         std::string _ExternalInputClusterCollectionName = _clusterCollectionVec[eCol];
+        EUTelClusterSummary & summary = EUTelClusterSummary::getInstance( _clusterCollectionVec[iCol] );
+        if ( summary.update( event ) ) clusterSummaries.push_back( &summary );
+      }
 
-         LCCollectionVec * externalInputClusterCollection   = static_cast<LCCollectionVec*>   (event->getCollection( _ExternalInputClusterCollectionName ));
-         CellIDDecoder<TrackerPulseImpl>  pulseCellDecoder( externalInputClusterCollection );
+      for( size_t eCol = 0; eCol < clusterSummaries.size() ; eCol++ )
+      {
+         const EUTelClusterSummary & externalSummary = *clusterSummaries[eCol];
 
       // we have an external detector where we consider a cluster each
       // time (external cluster) that is correlated with another
       // detector's clusters (internal cluster)
 
-      for ( size_t iExt = 0 ; iExt < externalInputClusterCollection->size() ; ++iExt ) {
-
-        TrackerPulseImpl * externalPulse = static_cast< TrackerPulseImpl * >   ( externalInputClusterCollection->getElementAt( iExt ) );
+      for ( size_t iExt = 0 ; iExt < externalSummary.size() ; ++iExt ) {
 
-        EUTelVirtualCluster  * externalCluster;
-
-        ClusterType type = static_cast<ClusterType>  (static_cast<int>((pulseCellDecoder(externalPulse)["type"])));
+        const EUTelClusterSummary::Cluster & externalCluster = externalSummary[iExt];
 
         // we check that the type of cluster is ok
-        
-        if ( type == kEUTelDFFClusterImpl ) 
-        {
-          externalCluster = new EUTelDFFClusterImpl( static_cast<TrackerDataImpl*>     ( externalPulse->getTrackerData()) );
-        }
-        else if ( type == kEUTelBrickedClusterImpl ) 
-        {
-          externalCluster = new EUTelBrickedClusterImpl( static_cast<TrackerDataImpl*> ( externalPulse->getTrackerData()) );
-        }
-        else if ( type == kEUTelFFClusterImpl ) 
-        {
-          externalCluster = new EUTelFFClusterImpl( static_cast<TrackerDataImpl*>      ( externalPulse->getTrackerData()) );
-            
-        }
-        else if ( type == kEUTelSparseClusterImpl ) 
-        {
-           externalCluster = new EUTelSparseClusterImpl< EUTelGenericSparsePixel > ( static_cast<TrackerDataImpl *> ( externalPulse->getTrackerData()  ) );
-
-           if( externalCluster != 0 && externalCluster->getTotalCharge() < _clusterChargeMin ) 
-           {
-              delete externalCluster; 
-              continue;
-           }
-        }
-	else  continue;
+        if ( !externalCluster.isDecoded || externalCluster.totalCharge <= _clusterChargeMin ) continue;
 
-        int externalSensorID = pulseCellDecoder( externalPulse ) [ "sensorID" ] ;
+        int externalSensorID = externalCluster.sensorID;
  
-        streamlog_out ( DEBUG1 ) << "externalSensorID : " << externalSensorID << " externalCluster=" << externalCluster << std::endl;
-
-        float externalXCenter = 0.;
-        float externalYCenter = 0.;
+        streamlog_out ( DEBUG1 ) << "externalSensorID : " << externalSensorID << std::endl;
 
         // we catch the coordinates of the external seed
 
-        externalCluster->getCenterOfGravity( externalXCenter, externalYCenter ) ;
-        if( externalCluster->getTotalCharge() <= _clusterChargeMin ) 
-        {
-            delete externalCluster; 
-            continue;
-        }
+        float externalXCenter = externalCluster.xCoG;
+        float externalYCenter = externalCluster.yCoG;
 
-        for( size_t iCol = 0; iCol < _clusterCollectionVec.size() ; iCol++ )
+        for( size_t iCol = 0; iCol < clusterSummaries.size() ; iCol++ )
         {
-          std::string _InternalInputClusterCollectionName = _clusterCollectionVec[iCol];
-
-          LCCollectionVec * internalInputClusterCollection   = static_cast<LCCollectionVec*>   (event->getCollection( _InternalInputClusterCollectionName ));
-          CellIDDecoder<TrackerPulseImpl>  pulseCellDecoder( internalInputClusterCollection );
+          const EUTelClusterSummary & internalSummary = *clusterSummaries[iCol];
 
-
-        for ( size_t iInt = 0;  iInt <  internalInputClusterCollection->size() ; ++iInt ) 
+        for ( size_t iInt = 0;  iInt <  internalSummary.size() ; ++iInt ) 
         {
 
-          TrackerPulseImpl * internalPulse = static_cast< TrackerPulseImpl * >  ( internalInputClusterCollection->getElementAt( iInt ) );
-
-          EUTelVirtualCluster  * internalCluster;
-
-          ClusterType type = static_cast<ClusterType>  (static_cast<int>((pulseCellDecoder(internalPulse)["type"])));
+          const EUTelClusterSummary::Cluster & internalCluster = internalSummary[iInt];
 
           // we check that the type of cluster is ok
-          if ( type == kEUTelDFFClusterImpl ) {
-            internalCluster = new EUTelDFFClusterImpl( static_cast<TrackerDataImpl*>
-                                                       (internalPulse->getTrackerData()) );
-
-          } else if ( type == kEUTelBrickedClusterImpl ) {
-            internalCluster = new EUTelBrickedClusterImpl( static_cast<TrackerDataImpl*>
-                                                       (internalPulse->getTrackerData()) );
-
-          } else if ( type == kEUTelFFClusterImpl ) {
-            internalCluster = new EUTelFFClusterImpl( static_cast<TrackerDataImpl*>
-                                                      (internalPulse->getTrackerData()) );
-
-          } else if ( type == kEUTelSparseClusterImpl ) {
-
-            internalCluster = new EUTelSparseClusterImpl< EUTelGenericSparsePixel > ( static_cast<TrackerDataImpl *> ( internalPulse->getTrackerData()  ) );
-
-            if( internalCluster != 0 && internalCluster->getTotalCharge() < _clusterChargeMin )
-            {
-                delete internalCluster;
-                continue;
-            }
- 
-          }
-	   else  continue;
+          if ( !internalCluster.isDecoded || internalCluster.totalCharge < _clusterChargeMin ) continue;
 
-          if( internalCluster->getTotalCharge() < _clusterChargeMin )
-          {
-             delete internalCluster;
-             continue;
-          }
-          
-
-          int internalSensorID = pulseCellDecoder( internalPulse ) [ "sensorID" ] ;
+          int internalSensorID = internalCluster.sensorID;
 
 
           if ( ( internalSensorID != getFixedPlaneID() && externalSensorID == getFixedPlaneID() )
@@ -441,12 +374,10 @@ void EUTelCorrelator::processEvent (LCEvent * event) {
                   ) 
           {
 
-              float internalXCenter = 0. ;
-              float internalYCenter = 0. ;
-
             // we catch the coordinates of the internal seed
 
-            internalCluster->getCenterOfGravity( internalXCenter, internalYCenter ) ;
+            float internalXCenter = internalCluster.xCoG;
+            float internalYCenter = internalCluster.yCoG;
 
             streamlog_out ( DEBUG5 ) << "Filling histo " << externalSensorID << " " << internalSensorID << endl;
 
@@ -463,12 +394,9 @@ void EUTelCorrelator::processEvent (LCEvent * event) {
 
           } // endif
 
-          delete internalCluster;
-
         } // internal loop
-        } // internal loop of collections 
+        } // internal loop of collections
 
-        delete externalCluster; 
       } // external loop
       } // external loop of collections
 
@@ -74,6 +74,7 @@
 #include <vector>
 #include <map>
 #include <cstdlib>
+#include <algorithm>
 
 using namespace std;
 using namespace lcio ;
@@ -133,6 +134,15 @@ EUTelDUTHistograms::EUTelDUTHistograms()
   _bgfittedX(),
   _bgfittedY(),
   _DUTalign(),
+  _hitGridX0(0.0),
+  _hitGridY0(0.0),
+  _hitGridCell(0.0),
+  _hitGridNX(0),
+  _hitGridNY(0),
+  _hitCell(),
+  _hitCellStart(),
+  _hitCellIndex(),
+  _hitMatched(),
 _ClusterSizeHistos(),
 _ShiftHistos(),
 _MeasuredHistos(),
@@ -462,47 +472,20 @@ void EUTelDUTHistograms::processEvent( LCEvent * event ) {
 
   // Match measured and fitted positions
 
+  buildHitIndex();
+
   int nMatch=0;
-  double distmin;
 
   for(int itrack=0; itrack< _maptrackid; itrack++)
   {
     int bestfit=-1;
     int besthit=-1;
 
-    distmin = _distMax*_distMax + 10. ;
- 
     if( static_cast<int>(_fittedX[itrack].size()) < 1 ) continue;
- 
-    for(int ifit=0;ifit<static_cast<int>(_fittedX[itrack].size()); ifit++)
-    {
-      if( _measuredX.empty() ) continue;
-
-      for(int ihit=0; ihit< static_cast<int>(_measuredX.size()) ; ihit++)
-        {
-
-          double dist2rd=
-            (_measuredX[ihit]-_fittedX[itrack][ifit])*(_measuredX[ihit]-_fittedX[itrack][ifit])
-            + (_measuredY[ihit]-_fittedY[itrack][ifit])*(_measuredY[ihit]-_fittedY[itrack][ifit]);
 
-	  if(streamlog_level(DEBUG5)){
-	    message<DEBUG5> ( log() << "Fit ["<< itrack << ":" << _maptrackid <<"], ifit= " << ifit << " ["<< _fittedX[itrack][ifit] << ":" << _fittedY[itrack][ifit] << "]" << endl) ;
-	    message<DEBUG5> ( log() << "rec " << ihit << " ["<< _measuredX[ihit] << ":" << _measuredY[ihit] << "]" << endl) ;
-	    message<DEBUG5> ( log() << "distance : " << TMath::Sqrt( dist2rd )  << endl) ;
-	  }
-          if(dist2rd<distmin)
-            {
-              distmin = dist2rd;
-              besthit = ihit;
-              bestfit = ifit;
-            }
-        }
- 
-    }
- 
     // Match found:
 
-    if( distmin < _distMax*_distMax  )
+    if( findClosestHit( itrack, bestfit, besthit ) )
       {
 
         nMatch++;
@@ -628,18 +611,8 @@ void EUTelDUTHistograms::processEvent( LCEvent * event ) {
 
 #endif
 
-        // Remove matched entries from the list (so the next matching pair
-        // can be looked for)
-
-        _fittedX[itrack].erase(_fittedX[itrack].begin()+bestfit);
-        _fittedY[itrack].erase(_fittedY[itrack].begin()+bestfit);
-
-        _measuredX.erase(_measuredX.begin()+besthit);
-        _measuredY.erase(_measuredY.begin()+besthit);
-
-        _localX[itrack].erase(_localX[itrack].begin()+bestfit);
-        _localY[itrack].erase(_localY[itrack].begin()+bestfit);
-
+        // The matched hit can not be matched to another track
+        _hitMatched[besthit] = true;
 
      }
 
@@ -647,8 +620,8 @@ void EUTelDUTHistograms::processEvent( LCEvent * event ) {
 
     if(streamlog_level(DEBUG5)){
       message<DEBUG5> ( log() << nMatch << " DUT hits matched to fitted tracks ");
-      message<DEBUG5> ( log() << _measuredX.size() << " DUT hits not matched to any track ");
-      message<DEBUG5> ( log() << "track "<<itrack<<" has " << _fittedX[itrack].size() << " _fittedX[itrack].size() not matched to any DUT hit ");
+      message<DEBUG5> ( log() << _measuredX.size() - nMatch << " DUT hits not matched to any track ");
+      message<DEBUG5> ( log() << "track "<<itrack<<" has " << _fittedX[itrack].size() - ( bestfit < 0 ? 0 : 1 ) << " _fittedX[itrack].size() not matched to any DUT hit ");
     }
 
   // Efficiency plots - unmatched tracks
@@ -657,11 +630,13 @@ void EUTelDUTHistograms::processEvent( LCEvent * event ) {
 
   for(int ifit=0;ifit<static_cast<int>(_localX[itrack].size()); ifit++)
     {
+      if( ifit == bestfit ) continue;
       _PixelEfficiencyHisto->fill(_localX[itrack][ ifit ]*1000.,_localY[itrack][ ifit ]*1000.,0.);
     }
 
   for(int ifit=0;ifit<static_cast<int>(_fittedX[itrack].size()); ifit++)
     {
+      if( ifit == bestfit ) continue;
       (dynamic_cast<AIDA::IProfile1D*> ( _EfficiencyHistos.at(projX)))->fill(_fittedX[itrack][ifit],0.);
       (dynamic_cast<AIDA::IProfile1D*> ( _EfficiencyHistos.at(projY)))->fill(_fittedY[itrack][ifit],0.);
       (dynamic_cast<AIDA::IProfile2D*> ( _EfficiencyHistos.at(projXY)))->fill(_fittedX[itrack][ifit],_fittedY[itrack][ifit],0.);
@@ -675,6 +650,7 @@ void EUTelDUTHistograms::processEvent( LCEvent * event ) {
   // Noise plots - unmatched hits
 
   for(int ihit=0;ihit<static_cast<int>(_measuredX.size()); ihit++){
+      if( _hitMatched[ihit] ) continue;
       (dynamic_cast<AIDA::IProfile1D*> ( _NoiseHistos.at(projX)))->fill(_measuredX[ihit],1.);
       (dynamic_cast<AIDA::IProfile1D*> ( _NoiseHistos.at(projY)))->fill(_measuredY[ihit],1.);
       (dynamic_cast<AIDA::IProfile2D*> ( _NoiseHistos.at(projXY)))->fill(_measuredX[ihit],_measuredY[ihit],1.);
@@ -1873,6 +1849,161 @@ int EUTelDUTHistograms::getSubMatrix(int detectorID, float xlocal)
 }  
 
 // -------------------------------------------------------------------------------------------
+namespace {
+  // Empties the vectors of a table but keeps them and their memory for the next event
+  template <class T> void clearTable( std::map< int, std::vector<T> >& table )
+  {
+    for( typename std::map< int, std::vector<T> >::iterator it = table.begin(); it != table.end(); ++it )
+      it->second.clear();
+  }
+}
+
+void EUTelDUTHistograms::clearTrackTables()
+{
+  // Clear local fit storage tables
+  // only entries below _maptrackid are used, so the vectors of earlier
+  // events are emptied instead of being deleted and allocated again
+
+  clearTable(_fittedX);
+  clearTable(_fittedY);
+
+  clearTable(_bgfittedX);
+  clearTable(_bgfittedY);
+
+  clearTable(_localX);
+  clearTable(_localY);
+
+  clearTable(_trackhitposX);
+  clearTable(_trackhitposY);
+  clearTable(_trackhitsizeX);
+  clearTable(_trackhitsizeY);
+  clearTable(_trackhitsubM);
+  clearTable(_trackhitsensorID);
+
+  // Clear local tables with measured position
+  _clusterSizeX.clear();
+  _clusterSizeY.clear();
+  _subMatrix.clear();
+
+  _measuredX.clear();
+  _measuredY.clear();
+
+  _bgmeasuredX.clear();
+  _bgmeasuredY.clear();
+}
+
+
+void EUTelDUTHistograms::buildHitIndex()
+{
+  const int nHits = static_cast<int>(_measuredX.size());
+
+  _hitMatched.assign( nHits, false );
+  _hitGridNX = 0;
+  _hitGridNY = 0;
+
+  if( nHits == 0 || !( _distMax > 0. ) ) return;
+
+  double maxX = _measuredX[0];
+  double maxY = _measuredY[0];
+  _hitGridX0 = maxX;
+  _hitGridY0 = maxY;
+  for(int ihit=1; ihit<nHits; ihit++)
+    {
+      _hitGridX0 = std::min( _hitGridX0, _measuredX[ihit] );
+      _hitGridY0 = std::min( _hitGridY0, _measuredY[ihit] );
+      maxX = std::max( maxX, _measuredX[ihit] );
+      maxY = std::max( maxY, _measuredY[ihit] );
+    }
+
+  // cells of the size of the matching distance, made larger if the hits
+  // are spread so far that most of the cells would stay empty
+  _hitGridCell = _distMax;
+  const double maxCells = 4. * nHits + 16.;
+  while( ( std::floor( (maxX-_hitGridX0)/_hitGridCell ) + 1. ) * ( std::floor( (maxY-_hitGridY0)/_hitGridCell ) + 1. ) > maxCells )
+    _hitGridCell *= 2.;
+  _hitGridNX = static_cast<int>( (maxX-_hitGridX0)/_hitGridCell ) + 1;
+  _hitGridNY = static_cast<int>( (maxY-_hitGridY0)/_hitGridCell ) + 1;
+
+  // counting sort of the hits by cell, hits keep their order inside a cell
+  _hitCell.resize( nHits );
+  _hitCellStart.assign( _hitGridNX*_hitGridNY + 1, 0 );
+  for(int ihit=0; ihit<nHits; ihit++)
+    {
+      const int cellX = std::min( static_cast<int>( (_measuredX[ihit]-_hitGridX0)/_hitGridCell ), _hitGridNX-1 );
+      const int cellY = std::min( static_cast<int>( (_measuredY[ihit]-_hitGridY0)/_hitGridCell ), _hitGridNY-1 );
+      _hitCell[ihit] = cellY*_hitGridNX + cellX;
+      _hitCellStart[ _hitCell[ihit] + 1 ]++;
+    }
+  for(size_t icell=1; icell<_hitCellStart.size(); icell++) _hitCellStart[icell] += _hitCellStart[icell-1];
+
+  _hitCellIndex.resize( nHits );
+  for(int ihit=0; ihit<nHits; ihit++)
+    {
+      // _hitCellStart[cell] is the next free position of the cell until it is moved back below
+      _hitCellIndex[ _hitCellStart[ _hitCell[ihit] ]++ ] = ihit;
+    }
+  for(size_t icell=_hitCellStart.size()-1; icell>0; icell--) _hitCellStart[icell] = _hitCellStart[icell-1];
+  _hitCellStart[0] = 0;
+}
+
+
+bool EUTelDUTHistograms::findClosestHit(int itrack, int& bestfit, int& besthit) const
+{
+  bestfit = -1;
+  besthit = -1;
+
+  if( _hitGridNX == 0 ) return false;
+
+  const std::vector<double>& fittedX = _fittedX.find(itrack)->second;
+  const std::vector<double>& fittedY = _fittedY.find(itrack)->second;
+
+  // only pairs closer than the matching distance are accepted
+  double distmin = _distMax*_distMax;
+
+  for(int ifit=0; ifit<static_cast<int>(fittedX.size()); ifit++)
+    {
+      // cells next to the fitted position, in doubles as the fit can be far off the hits
+      const double cellX = std::floor( (fittedX[ifit]-_hitGridX0)/_hitGridCell );
+      const double cellY = std::floor( (fittedY[ifit]-_hitGridY0)/_hitGridCell );
+      if( cellX < -1. || cellX > _hitGridNX || cellY < -1. || cellY > _hitGridNY ) continue;
+
+      const int minX = std::max( static_cast<int>(cellX) - 1, 0 );
+      const int maxX = std::min( static_cast<int>(cellX) + 1, _hitGridNX-1 );
+      const int minY = std::max( static_cast<int>(cellY) - 1, 0 );
+      const int maxY = std::min( static_cast<int>(cellY) + 1, _hitGridNY-1 );
+
+      for(int iy=minY; iy<=maxY; iy++)
+        for(int ix=minX; ix<=maxX; ix++)
+          {
+            const int icell = iy*_hitGridNX + ix;
+            for(int i=_hitCellStart[icell]; i<_hitCellStart[icell+1]; i++)
+              {
+                const int ihit = _hitCellIndex[i];
+                if( _hitMatched[ihit] ) continue;
+
+                const double dist2rd =
+                  (_measuredX[ihit]-fittedX[ifit])*(_measuredX[ihit]-fittedX[ifit])
+                  + (_measuredY[ihit]-fittedY[ifit])*(_measuredY[ihit]-fittedY[ifit]);
+
+                streamlog_out( DEBUG5 ) << "Fit ["<< itrack << ":" << _maptrackid <<"], ifit= " << ifit << " ["<< fittedX[ifit] << ":" << fittedY[ifit] << "]"
+                                        << " rec " << ihit << " ["<< _measuredX[ihit] << ":" << _measuredY[ihit] << "]"
+                                        << " distance : " << std::sqrt( dist2rd ) << std::endl;
+
+                // the cells are not visited in the order of the hits
+                if( dist2rd < distmin || ( dist2rd == distmin && ifit == bestfit && ihit < besthit ) )
+                  {
+                    distmin = dist2rd;
+                    besthit = ihit;
+                    bestfit = ifit;
+                  }
+              }
+          }
+    }
+
+  return besthit >= 0;
+}
+
+
 int EUTelDUTHistograms::read_track_from_collections(LCEvent *event)
 {
   // Clear local fit storage tables
@@ -1906,21 +2037,7 @@ int EUTelDUTHistograms::read_track_from_collections(LCEvent *event)
 
   if(nTrack == 0 ) return 1;
 
-  _fittedX.clear();
-  _fittedY.clear();
-
-  _bgfittedX.clear();
-  _bgfittedY.clear();
-
-  _localX.clear();
-  _localY.clear();
-
-  _trackhitposX.clear();   
-  _trackhitposY.clear();
-  _trackhitsizeX.clear();
-  _trackhitsizeY.clear();
-  _trackhitsubM.clear();
-  _trackhitsensorID.clear();
+  clearTrackTables();
 
   LCCollection* fit__col;
   try {
@@ -2040,17 +2157,6 @@ int EUTelDUTHistograms::read_track_from_collections(LCEvent *event)
 
   message<DEBUG5> ( log() << "rechits " << endl );
 
-   // Clear local tables with measured position
-  _clusterSizeX.clear();
-  _clusterSizeY.clear();
-  _subMatrix.clear();
-
-
-  _measuredX.clear();
-  _measuredY.clear();
-
-  _bgmeasuredX.clear();
-  _bgmeasuredY.clear();
          // look at reconstructed hits only for all planes (excluding DUT !)       
           // hits that belong to track "_maptrackid"
           for(int ihit=0; ihit< nRecHits ; ihit++)
@@ -2124,21 +2230,7 @@ int EUTelDUTHistograms::read_track(LCEvent *event)
   // 'fitted' table used for comparison with measured hits
   // 'bgfitted' used for comparison with hits from previous event
 
-  _fittedX.clear();
-  _fittedY.clear();
-
-  _bgfittedX.clear();
-  _bgfittedY.clear();
-
-  _localX.clear();
-  _localY.clear();
-
-  _trackhitposX.clear();   
-  _trackhitposY.clear();
-  _trackhitsizeX.clear();
-  _trackhitsizeY.clear();
-  _trackhitsubM.clear();
-  _trackhitsensorID.clear();
+  clearTrackTables();
 
  //
   // Get input collections
@@ -2256,17 +2348,6 @@ int EUTelDUTHistograms::read_track(LCEvent *event)
       _maptrackid++; 
    }
 
-   // Clear local tables with measured position
-  _clusterSizeX.clear();
-  _clusterSizeY.clear();
-  _subMatrix.clear();
-
-
-  _measuredX.clear();
-  _measuredY.clear();
-
-  _bgmeasuredX.clear();
-  _bgmeasuredY.clear();
  
   LCCollection* hitcol = NULL;
   try {
@@ -92,8 +92,10 @@ using namespace eutelescope;
 EUTelDafAlign::EUTelDafAlign ()
 : EUTelDafBase("EUTelDafAlign"),
   _runPede(false), 
+  _executePede(true),
   _pedeSteerfileName(""),
   _binaryFilename(""),
+  _additionalBinaryFilenames(),
   _alignmentConstantLCIOFile(""),
   _alignmentConstantCollectionName(""),
   _translate(),
@@ -123,6 +125,8 @@ void EUTelDafAlign::dafParams(){
   registerOptionalParameter("RunPede","Build steering file, binary input file, and execute the pede program.",_runPede, static_cast <bool> (true));
   registerOptionalParameter("PedeSteerfileName","Name of the steering file for the pede program.",_pedeSteerfileName, string("steer_mille.txt"));
   registerOptionalParameter("BinaryFilename","Name of binary input file for Millepede.",_binaryFilename, string ("mille.bin"));
+  registerOptionalParameter("ExecutePede","Execute the pede program at the end. Set it to false in jobs processing a part of a run, which only write their binary file.",_executePede, static_cast <bool> (true));
+  registerOptionalParameter("AdditionalBinaryFilenames","Binary files of other jobs, e.g. the split jobs of the same run, given to pede together with BinaryFilename.",_additionalBinaryFilenames, std::vector<std::string>());
   registerOptionalParameter("AlignmentConstantLCIOFile","Name of LCIO db file where alignment constantds will be stored", 
 			    _alignmentConstantLCIOFile, std::string( "alignment.slcio" ) );
   registerOptionalParameter("AlignmentConstantCollectionName", "This is the name of the alignment collection to be saved into the slcio file",
@@ -331,7 +335,13 @@ void EUTelDafAlign::generatePedeSteeringFile(){
     throw runtime_error("Unable to open file " + _pedeSteerfileName);
   }
   steerFile << "Cfiles" << endl;
-  steerFile << _binaryFilename << endl;
+  // a merge job processing no event has an empty binary file
+  if( _nTracks > 0 or _additionalBinaryFilenames.empty() ){
+    steerFile << _binaryFilename << endl;
+  }
+  for(size_t ii = 0; ii < _additionalBinaryFilenames.size(); ii++){
+    steerFile << _additionalBinaryFilenames.at(ii) << endl;
+  }
   steerFile << endl;
   steerFile << "Parameter" << endl;
   for(size_t ii = 0; ii < _system.planes.size(); ii++){
@@ -488,6 +498,10 @@ void EUTelDafAlign::dafEnd() {
   if(not _runPede){ return; }
   delete _mille;
   generatePedeSteeringFile();
+  if(not _executePede){
+    streamlog_out ( MESSAGE5 ) << "Pede not executed, " << _nTracks << " tracks written to " << _binaryFilename << endl;
+    return;
+  }
   runPede();
 }
 #endif // USE_GEAR
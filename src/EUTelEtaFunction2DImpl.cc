@@ -0,0 +1,46 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelEtaFunction2DImpl.h"
+
+// lcio includes <.h>
+#include <lcio.h>
+#include <IMPL/LCGenericObjectImpl.h>
+
+// system includes <>
+#include <vector>
+
+using namespace lcio;
+using namespace eutelescope;
+using namespace std;
+
+EUTelEtaFunction2DImpl::EUTelEtaFunction2DImpl(int sensorID, int nBinX, int nBinY, double xFirst, double xLast, double yFirst, double yLast,
+                                               const vector<double > & xEta, const vector<double > & yEta) :
+  IMPL::LCGenericObjectImpl(3, 0, 4 + 2 * nBinX * nBinY) {
+  _typeName        = "Eta map";
+  _dataDescription = "The integer values are the sensor ID and the number of bins along x and y. The first four double values are the first"
+    " and last bin centers along x and y, followed by the nBinX * nBinY eta values along x and the nBinX * nBinY eta values along y";
+  _isFixedSize     = true;
+
+  setIntVal( 0, sensorID );
+  setIntVal( 1, nBinX );
+  setIntVal( 2, nBinY );
+
+  setDoubleVal( 0, xFirst );
+  setDoubleVal( 1, xLast );
+  setDoubleVal( 2, yFirst );
+  setDoubleVal( 3, yLast );
+
+  const unsigned int nBin = nBinX * nBinY;
+  for ( unsigned int iBin = 0; iBin < nBin && iBin < xEta.size() && iBin < yEta.size(); iBin++ ) {
+    setDoubleVal( 4 + iBin,        xEta[iBin] );
+    setDoubleVal( 4 + nBin + iBin, yEta[iBin] );
+  }
+}
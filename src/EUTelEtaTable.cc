@@ -0,0 +1,121 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelEtaTable.h"
+
+// marlin includes ".h"
+#include "marlin/VerbosityLevels.h"
+
+// lcio includes <.h>
+#include <Exceptions.h>
+
+// system includes <>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace lcio;
+using namespace eutelescope;
+
+namespace {
+  //! Largest distance of a bin center from the uniform grid, relative to the bin width
+  const double uniformTolerance = 1e-6;
+
+  //! Linear interpolation between the bin centers around x, as in EUTelEtaFunctionImpl::getEtaFromCoG
+  double interpolate( const vector< double > & center, const vector< double > & value, double x ) {
+    if ( x <= center.front() ) return value.front();
+    if ( x >= center.back() )  return value.back();
+    const size_t iRight = lower_bound( center.begin(), center.end(), x ) - center.begin();
+    const size_t iLeft  = iRight - 1;
+    return value[iLeft] + ( value[iLeft] - value[iRight] ) / ( center[iLeft] - center[iRight] ) * ( x - center[iLeft] );
+  }
+}
+
+EUTelEtaTable::EUTelEtaTable( const LCGenericObject * etaFunction ) :
+  _sensorID( etaFunction->getNInt() > 0 ? etaFunction->getIntVal( 0 ) : -1 ),
+  _first(0.),
+  _invStep(0.),
+  _lastIndex(0.),
+  _value(),
+  _slope()
+{
+  const int nBin = etaFunction->getNDouble() / 2;
+  if ( nBin < 1 ) throw lcio::Exception( "EUTelEtaTable: the Eta function has no bins" );
+
+  vector< double > center( nBin );
+  vector< double > value( nBin );
+  for ( int iBin = 0; iBin < nBin; ++iBin ) {
+    center[iBin] = etaFunction->getDoubleVal( iBin );
+    value[iBin]  = etaFunction->getDoubleVal( nBin + iBin );
+  }
+
+  _first     = center.front();
+  _lastIndex = nBin - 1;
+  const double step = nBin > 1 ? ( center.back() - _first ) / ( nBin - 1 ) : 0.;
+  if ( nBin > 1 ) {
+    if ( !( step > 0. ) ) throw lcio::Exception( "EUTelEtaTable: the bin centers of the Eta function are not sorted" );
+    _invStep = 1. / step;
+  }
+
+  bool isUniform = true;
+  for ( int iBin = 1; iBin < nBin && isUniform; ++iBin ) {
+    isUniform = fabs( center[iBin] - ( _first + iBin * step ) ) <= uniformTolerance * step;
+  }
+
+  if ( isUniform ) {
+    _value.swap( value );
+  } else {
+    streamlog_out ( WARNING2 ) << "The Eta function of sensor " << _sensorID << " has non uniform bins, it is resampled at "
+                               << nBin << " uniform bins" << endl;
+    _value.resize( nBin );
+    for ( int iBin = 0; iBin < nBin; ++iBin ) _value[iBin] = interpolate( center, value, _first + iBin * step );
+  }
+
+  _slope.resize( nBin, 0. );
+  for ( int iBin = 0; iBin + 1 < nBin; ++iBin ) _slope[iBin] = _value[iBin + 1] - _value[iBin];
+}
+
+EUTelEtaTable2D::EUTelEtaTable2D( const LCGenericObject * etaFunction ) :
+  _sensorID(-1),
+  _nBinX(0),
+  _nBinY(0),
+  _xFirst(0.),
+  _xInvStep(0.),
+  _yFirst(0.),
+  _yInvStep(0.),
+  _xEta(),
+  _yEta()
+{
+  if ( etaFunction->getNInt() < 3 ) throw lcio::Exception( "EUTelEtaTable2D: the object is not an Eta map" );
+  _sensorID = etaFunction->getIntVal( 0 );
+  _nBinX    = etaFunction->getIntVal( 1 );
+  _nBinY    = etaFunction->getIntVal( 2 );
+  if ( _nBinX < 1 || _nBinY < 1 || etaFunction->getNDouble() != 4 + 2 * _nBinX * _nBinY ) {
+    throw lcio::Exception( "EUTelEtaTable2D: the number of bins of the Eta map does not match its values" );
+  }
+
+  _xFirst = etaFunction->getDoubleVal( 0 );
+  _yFirst = etaFunction->getDoubleVal( 2 );
+  const double xLast = etaFunction->getDoubleVal( 1 );
+  const double yLast = etaFunction->getDoubleVal( 3 );
+  if ( ( _nBinX > 1 && !( xLast > _xFirst ) ) || ( _nBinY > 1 && !( yLast > _yFirst ) ) ) {
+    throw lcio::Exception( "EUTelEtaTable2D: the bin centers of the Eta map are not sorted" );
+  }
+  if ( _nBinX > 1 ) _xInvStep = ( _nBinX - 1 ) / ( xLast - _xFirst );
+  if ( _nBinY > 1 ) _yInvStep = ( _nBinY - 1 ) / ( yLast - _yFirst );
+
+  const int nBin = _nBinX * _nBinY;
+  _xEta.resize( nBin );
+  _yEta.resize( nBin );
+  for ( int iBin = 0; iBin < nBin; ++iBin ) {
+    _xEta[iBin] = etaFunction->getDoubleVal( 4 + iBin );
+    _yEta[iBin] = etaFunction->getDoubleVal( 4 + nBin + iBin );
+  }
+}
@@ -0,0 +1,190 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelEventTransfer.h"
+
+// lcio includes <.h>
+#include <EVENT/LCCollection.h>
+#include <EVENT/LCParameters.h>
+#include <EVENT/TrackerData.h>
+#include <EVENT/TrackerRawData.h>
+#include <EVENT/LCGenericObject.h>
+#include <IMPL/LCCollectionVec.h>
+#include <IMPL/TrackerDataImpl.h>
+#include <IMPL/TrackerRawDataImpl.h>
+#include <IMPL/LCGenericObjectImpl.h>
+
+// system includes <>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace lcio;
+using namespace eutelescope;
+
+namespace {
+  //! Gives access to the collections an event does not own
+  /*! LCEventImpl::takeCollection only records the collection as not
+   *  owned, there is no way to ask for it. The event is accessed as
+   *  the derived class in the same way as EUTelEventImpl accesses the
+   *  event parameters.
+   */
+  class EventOwnership : public IMPL::LCEventImpl {
+  public:
+    static bool ownsCollection( const IMPL::LCEventImpl * evt, const LCCollection * col ) {
+      const set< LCCollection * > & notOwned = static_cast< const EventOwnership * >( evt )->_notOwned;
+      return notOwned.find( const_cast< LCCollection * >( col ) ) == notOwned.end();
+    }
+  };
+
+  void copyParameters( const LCParameters & from, LCParameters & to ) {
+    StringVec intKeys;
+    from.getIntKeys( intKeys );
+    for ( size_t i = 0; i < intKeys.size(); ++i ) {
+      IntVec values;
+      from.getIntVals( intKeys[i], values );
+      to.setValues( intKeys[i], values );
+    }
+    StringVec floatKeys;
+    from.getFloatKeys( floatKeys );
+    for ( size_t i = 0; i < floatKeys.size(); ++i ) {
+      FloatVec values;
+      from.getFloatVals( floatKeys[i], values );
+      to.setValues( floatKeys[i], values );
+    }
+    StringVec stringKeys;
+    from.getStringKeys( stringKeys );
+    for ( size_t i = 0; i < stringKeys.size(); ++i ) {
+      StringVec values;
+      from.getStringVals( stringKeys[i], values );
+      to.setValues( stringKeys[i], values );
+    }
+  }
+
+  //! New event without collections and with the header and parameters of evt
+  IMPL::LCEventImpl * copyEventHeader( const LCEvent * evt ) {
+    IMPL::LCEventImpl * event = new IMPL::LCEventImpl;
+    event->setRunNumber( evt->getRunNumber() );
+    event->setEventNumber( evt->getEventNumber() );
+    event->setDetectorName( evt->getDetectorName() );
+    event->setTimeStamp( evt->getTimeStamp() );
+    event->setWeight( evt->getWeight() );
+    copyParameters( evt->getParameters(), event->parameters() );
+    return event;
+  }
+
+  //! Generic object keeping the type name and description of the original
+  class GenericObjectCopy : public IMPL::LCGenericObjectImpl {
+  public:
+    explicit GenericObjectCopy( const LCGenericObject * object ) :
+      IMPL::LCGenericObjectImpl(),
+      _fixedSize( object->isFixedSize() ),
+      _typeName( object->getTypeName() ),
+      _dataDescription( object->getDataDescription() )
+    {
+      for ( int i = 0; i < object->getNInt(); ++i )    setIntVal( i, object->getIntVal( i ) );
+      for ( int i = 0; i < object->getNFloat(); ++i )  setFloatVal( i, object->getFloatVal( i ) );
+      for ( int i = 0; i < object->getNDouble(); ++i ) setDoubleVal( i, object->getDoubleVal( i ) );
+    }
+    virtual bool isFixedSize() const { return _fixedSize; }
+    virtual const std::string getTypeName() const { return _typeName; }
+    virtual const std::string getDataDescription() const { return _dataDescription; }
+  private:
+    bool _fixedSize;
+    std::string _typeName;
+    std::string _dataDescription;
+  };
+
+  bool isCopyable( const LCCollection * col ) {
+    const string & type = col->getTypeName();
+    return !col->isSubset() && ( type == LCIO::TRACKERDATA || type == LCIO::TRACKERRAWDATA || type == LCIO::LCGENERICOBJECT );
+  }
+
+  LCCollection * copyCollection( const LCCollection * col ) {
+    IMPL::LCCollectionVec * copy = new IMPL::LCCollectionVec( col->getTypeName() );
+    copy->setFlag( col->getFlag() );
+    copyParameters( col->getParameters(), copy->parameters() );
+    const string & type = col->getTypeName();
+    for ( int i = 0; i < col->getNumberOfElements(); ++i ) {
+      if ( type == LCIO::TRACKERDATA ) {
+        const TrackerData * data = dynamic_cast< const TrackerData * >( col->getElementAt( i ) );
+        IMPL::TrackerDataImpl * dataCopy = new IMPL::TrackerDataImpl;
+        dataCopy->setCellID0( data->getCellID0() );
+        dataCopy->setCellID1( data->getCellID1() );
+        dataCopy->setTime( data->getTime() );
+        dataCopy->setChargeValues( data->getChargeValues() );
+        copy->push_back( dataCopy );
+      } else if ( type == LCIO::TRACKERRAWDATA ) {
+        const TrackerRawData * data = dynamic_cast< const TrackerRawData * >( col->getElementAt( i ) );
+        IMPL::TrackerRawDataImpl * dataCopy = new IMPL::TrackerRawDataImpl;
+        dataCopy->setCellID0( data->getCellID0() );
+        dataCopy->setCellID1( data->getCellID1() );
+        dataCopy->setTime( data->getTime() );
+        dataCopy->setADCValues( data->getADCValues() );
+        copy->push_back( dataCopy );
+      } else {
+        copy->push_back( new GenericObjectCopy( dynamic_cast< const LCGenericObject * >( col->getElementAt( i ) ) ) );
+      }
+    }
+    return copy;
+  }
+}
+
+LCRunHeaderImpl * eutelescope::copyRunHeader( const LCRunHeader * run ) {
+  LCRunHeaderImpl * copy = new LCRunHeaderImpl;
+  copy->setRunNumber( run->getRunNumber() );
+  copy->setDetectorName( run->getDetectorName() );
+  copy->setDescription( run->getDescription() );
+  const vector< string > * activeSubdetectors = run->getActiveSubdetectors();
+  for ( size_t i = 0; i < activeSubdetectors->size(); ++i ) copy->addActiveSubdetector( ( *activeSubdetectors )[i] );
+  copyParameters( run->getParameters(), copy->parameters() );
+  return copy;
+}
+
+LCEventImpl * eutelescope::takeEvent( LCEvent * evt ) {
+  LCEventImpl * source = static_cast< LCEventImpl * >( evt );
+  LCEventImpl * event  = copyEventHeader( evt );
+
+  const StringVec * names = evt->getCollectionNames();
+  for ( size_t i = 0; i < names->size(); ++i ) {
+    const string & name = ( *names )[i];
+    LCCollection * col = evt->getCollection( name );
+    const bool owned = EventOwnership::ownsCollection( source, col );
+    if ( owned ) evt->takeCollection( name );
+    event->addCollection( col, name );
+    if ( !owned ) event->takeCollection( name );
+  }
+  return event;
+}
+
+LCEventImpl * eutelescope::takeEventCopy( LCEvent * evt, const set< string > & skipNames ) {
+  LCEventImpl * source = static_cast< LCEventImpl * >( evt );
+  const StringVec * names = evt->getCollectionNames();
+  for ( size_t i = 0; i < names->size(); ++i ) {
+    const string & name = ( *names )[i];
+    const LCCollection * col = evt->getCollection( name );
+    if ( !EventOwnership::ownsCollection( source, col ) && skipNames.find( name ) == skipNames.end() && !isCopyable( col ) ) return NULL;
+  }
+
+  LCEventImpl * event = copyEventHeader( evt );
+
+  for ( size_t i = 0; i < names->size(); ++i ) {
+    const string & name = ( *names )[i];
+    LCCollection * col = evt->getCollection( name );
+    if ( EventOwnership::ownsCollection( source, col ) ) {
+      evt->takeCollection( name );
+      event->addCollection( col, name );
+    } else if ( skipNames.find( name ) == skipNames.end() ) {
+      event->addCollection( copyCollection( col ), name );
+    }
+  }
+  return event;
+}
@@ -118,6 +118,28 @@ EUTelFitTuple::EUTelFitTuple() : Processor("EUTelFitTuple") {
                               "Alignment corrections for DUT: shift in X, Y and rotation around Z",
                               _DUTalign, initAlign);
 
+  registerOptionalParameter ("RootFileName",
+                             "If not empty, the n-tuple is written as ROOT tree to this file instead of the AIDA tuple",
+                             _rootFileName, std::string(""));
+
+  registerOptionalParameter ("BasketSize",
+                             "Basket size in bytes of the ROOT tree branches, 0 for the ROOT default",
+                             _basketSize, static_cast < int > (0));
+
+  registerOptionalParameter ("AutoFlush",
+                             "Cluster size of the ROOT tree (TTree::SetAutoFlush): >0 entries, <0 bytes, 0 for the ROOT default",
+                             _autoFlush, static_cast < int > (0));
+
+  registerOptionalParameter ("CompressionLevel",
+                             "Compression level of the ROOT file, -1 for the ROOT default",
+                             _compressionLevel, static_cast < int > (-1));
+
+  registerOptionalParameter ("WriterQueueDepth",
+                             "Number of rows buffered for a background writer thread of the ROOT tree, 0 to write in the processing thread",
+                             _writerQueueDepth, static_cast < int > (0));
+
+  _writeRootTuple = false;
+
 }
 
 
@@ -495,22 +517,22 @@ void EUTelFitTuple::processEvent( LCEvent * event ) {
       // Fill n-tuple
 
       int icol=0;
-      _FitTuple->fill(icol++,_nEvt);
-      _FitTuple->fill(icol++,_runNr);
-      _FitTuple->fill(icol++,_evtNr);
-      _FitTuple->fill(icol++,_tluTimeStamp); // new! TLU timestamp
-      _FitTuple->fill(icol++,nTrack); // new! TLU timestamp
-      _FitTuple->fill(icol++,fittrack->getNdf());
-      _FitTuple->fill(icol++,fittrack->getChi2());
+      fillColumn(icol++,_nEvt);
+      fillColumn(icol++,_runNr);
+      fillColumn(icol++,_evtNr);
+      fillColumn(icol++,_tluTimeStamp); // new! TLU timestamp
+      fillColumn(icol++,nTrack); // new! TLU timestamp
+      fillColumn(icol++,fittrack->getNdf());
+      fillColumn(icol++,fittrack->getChi2());
 
       for(int ipl=0; ipl<_nTelPlanes;ipl++)
         {
-          _FitTuple->fill(icol++,_measuredX[ipl]);
-          _FitTuple->fill(icol++,_measuredY[ipl]);
-          _FitTuple->fill(icol++,_measuredZ[ipl]);
-          _FitTuple->fill(icol++,_measuredQ[ipl]);
-          _FitTuple->fill(icol++,_fittedX[ipl]);
-          _FitTuple->fill(icol++,_fittedY[ipl]);
+          fillColumn(icol++,_measuredX[ipl]);
+          fillColumn(icol++,_measuredY[ipl]);
+          fillColumn(icol++,_measuredZ[ipl]);
+          fillColumn(icol++,_measuredQ[ipl]);
+          fillColumn(icol++,_fittedX[ipl]);
+          fillColumn(icol++,_fittedY[ipl]);
         }
 
       //  Look for closest DUT hit
@@ -591,11 +613,15 @@ void EUTelFitTuple::processEvent( LCEvent * event ) {
         }
 
 
-      _FitTuple->fill(icol++,dutX);
-      _FitTuple->fill(icol++,dutY);
-      _FitTuple->fill(icol++,dutR);
-      _FitTuple->fill(icol++,dutQ);
+      fillColumn(icol++,dutX);
+      fillColumn(icol++,dutY);
+      fillColumn(icol++,dutR);
+      fillColumn(icol++,dutQ);
 
+#if defined(USE_ROOT) || defined(MARLIN_USE_ROOT)
+      if ( _writeRootTuple ) _rootTuple.fill();
+      else
+#endif
       _FitTuple->addRow();
 
       // End of loop over tracks
@@ -619,6 +645,13 @@ void EUTelFitTuple::end(){
   //        << std::endl ;
 
 
+#if defined(USE_ROOT) || defined(MARLIN_USE_ROOT)
+  if ( _writeRootTuple ) {
+    message<MESSAGE5> ( log() << "N-tuple with "
+                       << _rootTuple.getNumberOfRows() << " rows written to " << _rootFileName );
+    _rootTuple.close();
+  } else
+#endif
   message<MESSAGE5> ( log() << "N-tuple with "
                      << _FitTuple->rows() << " rows created" );
 
@@ -700,6 +733,27 @@ void EUTelFitTuple::bookHistos()
   _columnType.push_back("double");
 
 
+#if defined(USE_ROOT) || defined(MARLIN_USE_ROOT)
+  if ( !_rootFileName.empty() ) {
+    // same columns, in the same order, as flat branches of one tree
+    _rootTuple.open( _rootFileName, _compressionLevel, _basketSize, _autoFlush, _writerQueueDepth );
+    const int tree = _rootTuple.addTree( _FitTupleName, _FitTupleName );
+    for ( size_t icol = 0; icol < _columnNames.size(); ++icol ) {
+      EUTelRootTupleWriter::ColumnType type = EUTelRootTupleWriter::kDouble;
+      if ( _columnType[icol] == "int" ) type = EUTelRootTupleWriter::kInt;
+      else if ( _columnType[icol] == "long int" ) type = EUTelRootTupleWriter::kLong;
+      else if ( _columnType[icol] == "float" ) type = EUTelRootTupleWriter::kFloat;
+      _rootTuple.addColumn( tree, _columnNames[icol], type );
+    }
+    _rootTuple.book();
+    _writeRootTuple = true;
+    message<DEBUG5> ( log() << "Booking completed, n-tuple written to " << _rootFileName << "\n\n");
+    return;
+  }
+#else
+  if ( !_rootFileName.empty() ) message<WARNING5> ( log() << "Eutelescope built without ROOT, RootFileName ignored" );
+#endif
+
   _FitTuple=AIDAProcessor::tupleFactory(this)->create(_FitTupleName, _FitTupleName, _columnNames, _columnType, "");
 
 
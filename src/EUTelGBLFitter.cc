@@ -24,6 +24,9 @@
 #error *** You need ROOT to compile this code.  *** 
 #endif
 
+//Eigen (inverse of the fixed-size Jacobians)
+#include <Eigen/LU>
+
 // GBL
 #include "include/GblTrajectory.h"
 #include "include/GblPoint.h"
@@ -46,6 +49,11 @@ namespace eutelescope {
 
 	EUTelGBLFitter::EUTelGBLFitter() :
 	_alignmentMode(0),
+	_omegaCorrections(0.),
+	_intersectionLocalXZCorrections(0.),
+	_intersectionLocalYZCorrections(0.),
+	_localPosXCorrections(0.),
+	_localPosYCorrections(0.),
 	_beamQ(-1),
 	_eBeam(4.),
 	_mEstimatorType(),
@@ -56,8 +64,11 @@ namespace eutelescope {
 	_parameterIdXRotationsMap(),
 	_parameterIdYRotationsMap(),
 	_parameterIdZRotationsMap(),
-	_counter_num_pointer(1)
-	{}
+	_counter_num_pointer(1),
+	_useRadLengthMap(false)
+	{
+		_scattererJacobians.resize(3, TMatrixD(5,5));//Always two scatterers and the next plane between two states
+	}
 
 	EUTelGBLFitter::~EUTelGBLFitter() {
 	}
@@ -104,7 +115,7 @@ namespace eutelescope {
 	}
 	//This will add measurement information to the GBL point
 	//Note that if we have a strip sensor then y will be ignored using projection matrix.
-	void EUTelGBLFitter::setMeasurementGBL(gbl::GblPoint& point, const double *hitPos,  double statePos[3], double combinedCov[4], TMatrixD projection){
+	void EUTelGBLFitter::setMeasurementGBL(gbl::GblPoint& point, const double *hitPos,  double statePos[3], double combinedCov[4], const TMatrixD& projection){
 		streamlog_out(DEBUG1) << " setMeasurementGBL ------------- BEGIN --------------- " << std::endl;
 		TVectorD meas(2);//Remember we need to pass the same 5 since gbl expects this due to jacobian
 		meas.Zero();
@@ -128,7 +139,7 @@ namespace eutelescope {
 	//This function calculates the alignment jacobian and labels and attaches this to the point
 	void EUTelGBLFitter::setAlignmentToMeasurementJacobian(EUTelTrack& track, std::vector< gbl::GblPoint >& pointList ){
 		for (size_t i = 0;i<_vectorOfPairsMeasurementStatesAndLabels.size() ;++i ){
-			if(_vectorOfPairsMeasurementStatesAndLabels.at(i).first.getTrackerHits().empty()){
+			if(!_vectorOfPairsMeasurementStatesAndLabels.at(i).first.getIsThereAHit()){
 				throw(lcio::Exception("One of the points on the list of measurements states has no hit."));
 			}
 			for(size_t j = 0; j < pointList.size(); ++j){
@@ -277,12 +288,13 @@ namespace eutelescope {
 	//As a track passes through a scatterer it will be kinked. The initial guessed trajectory has to provide GBL this information from pattern recognition. These come effectively from the states at each plane and can be calculated from these. However we store these number in the lcio file since the calculation is rather arduous
 	void EUTelGBLFitter::setKinkInformationToTrack(gbl::GblTrajectory* traj, std::vector< gbl::GblPoint >& pointList,EUTelTrack &track){
 		streamlog_out ( DEBUG4 ) << " EUTelGBLFitter::setKinkInformationToTrack-- BEGIN " << endl;
-		for(size_t i=0;i < track.getStatesPointers().size(); i++){//We get the pointers no since we want to change the track state contents		
-			EUTelState* state = track.getStatesPointers().at(i);
+		std::vector<EUTelState>& states = track.getStates();//By reference since we want to change the track state contents
+		for(size_t i=0;i < states.size(); i++){
+			EUTelState& state = states.at(i);
 			TVectorD corrections(5);
 			TMatrixDSym correctionsCov(5,5);
 			for(size_t j=0 ; j< _vectorOfPairsStatesAndLabels.size();++j){
-				if(_vectorOfPairsStatesAndLabels.at(j).first == *state){
+				if(_vectorOfPairsStatesAndLabels.at(j).first == state){
 					streamlog_out(DEBUG0)<<"The loop number for states with measurements for kink update is: " << j << ". The label is: " << _vectorOfPairsStatesAndLabels.at(j).second <<endl; 
 					if(getLabelToPoint(pointList,_vectorOfPairsStatesAndLabels.at(j).second).hasMeasurement() == 0){//TO DO: Some states will not have hits in the future so should remove. Leave for now to test
 						throw(lcio::Exception("This point does not contain a measurements. So can not add kink information. Labeling of the state must be wrong"));
@@ -295,14 +307,14 @@ namespace eutelescope {
 					TVectorD aDownWeightsKink(2); 
 					traj->getMeasResults(_vectorOfPairsMeasurementStatesAndLabels.at(j).second, numData, aResidualsKink, aMeasErrorsKink, aResErrorsKink, aDownWeightsKink);
 					streamlog_out(DEBUG3) << endl << "State before we have added corrections: " << std::endl;
-					state->print();
-					TVectorD kinks = state->getKinks();	
+					if(streamlog_level(DEBUG3)) state.print();
+					TVectorD kinks = state.getKinks();	
 					TVectorD updateKinks(2);
 					updateKinks(0) = kinks(0);
 					updateKinks(1) = kinks(1);
-					state->setKinks(updateKinks);
+					state.setKinks(updateKinks);
 					streamlog_out(DEBUG3) << endl << "State after we have added corrections: " << std::endl;
-					state->print();
+					if(streamlog_level(DEBUG3)) state.print();
 					break;
 				}
 			}//END of loop of all states with hits	
@@ -315,18 +327,15 @@ namespace eutelescope {
 		streamlog_out(DEBUG4)<<"EUTelGBLFitter::setInformationForGBLPointList-------------------------------------BEGIN"<<endl;
 		TMatrixD jacPointToPoint(5, 5);
 		jacPointToPoint.UnitMatrix();
-		for(size_t i=0;i < track.getStates().size(); i++){		
-			streamlog_out(DEBUG3) << "The jacobian to get to this state jacobian on state number: " << i<<" Out of a total of states "<<track.getStates().size() << std::endl;
+		std::vector<EUTelState>& states = track.getStates();
+		for(size_t i=0;i < states.size(); i++){		
+			streamlog_out(DEBUG3) << "The jacobian to get to this state jacobian on state number: " << i<<" Out of a total of states "<<states.size() << std::endl;
 			streamlog_message( DEBUG0, jacPointToPoint.Print();, std::endl; );
 			gbl::GblPoint point(jacPointToPoint);
-			EUTelState state = track.getStates().at(i);
-			EUTelState nextState;
-			if(i != (track.getStates().size()-1)){//Since we don't want to propagate from the last state.
-				nextState = track.getStates().at(i+1);
-			}
+			EUTelState state = states.at(i);//Copy, since the measurement covariance is set on it
 			setScattererGBL(point,state);//Every sensor will have scattering due to itself. 
 			_statesInOrder.push_back(state);//This is list of measurements states in the correct order. This is used later to associate ANY states with point labels
-			if(state.getTrackerHits().size() == 0 ){
+			if(!state.getIsThereAHit()){
 				streamlog_out(DEBUG3)  << "This state does not have a hit."<<std::endl;
 				setPointVec(pointList, point);//This creates the vector of points and keeps a link between states and the points they created
 			}else{
@@ -334,12 +343,13 @@ namespace eutelescope {
 				setMeasurementCov(state);
 				double cov[4] ;
 				state.getCombinedHitAndStateCovMatrixInLocalFrame(cov);
-				setMeasurementGBL(point, state.getTrackerHits()[0]->getPosition(),  localPositionForState,  cov, state.getProjectionMatrix());
+				setMeasurementGBL(point, state.getHit()->getPosition(),  localPositionForState,  cov, state.getProjectionMatrix());
 				_measurementStatesInOrder.push_back(state);//This is list of measurements states in the correct order. This is used later to associate MEASUREMENT states with point labels in alignment
 				setPointVec(pointList, point);
 			}//End of else statement if there is a hit.
 
-			if(i != (track.getStates().size()-1)){//We do not produce scatterers after the last plane
+			if(i != (states.size()-1)){//We do not produce scatterers after the last plane
+				EUTelState& nextState = states.at(i+1);
 				//Note here to determine the scattering we use a straight line approximation between the two points the particle will travel through. However to determine were to place the scatterer we use the exact arc length. We do this since to change the TGeo radiation length would be a lot of work for a very small change. 
 				const double stateReferencePoint[] = {state.getPosition()[0], state.getPosition()[1],state.getPosition()[2]};
 				double globalPosSensor1[3];
@@ -348,7 +358,7 @@ namespace eutelescope {
 				double globalPosSensor2[3];
 				geo::gGeometry().local2Master(nextState.getLocation(),nextStateReferencePoint , globalPosSensor2 );
 				testDistanceBetweenPoints(globalPosSensor1,globalPosSensor2);
-				float percentageRadiationLength  = geo::gGeometry().findRadLengthIntegral(globalPosSensor1,globalPosSensor2, false );//TO DO: This adds the radiation length of the plane again. If you chose true the some times it returns 0. The could be the reason for the slightly small residuals. 
+				float percentageRadiationLength  = _useRadLengthMap ? geo::gGeometry().findRadLengthIntegralInGap(state.getLocation(), nextState.getLocation(), globalPosSensor1, globalPosSensor2) : geo::gGeometry().findRadLengthIntegral(globalPosSensor1,globalPosSensor2, false );//TO DO: This adds the radiation length of the plane again. If you chose true the some times it returns 0. The could be the reason for the slightly small residuals. 
 				if(percentageRadiationLength == 0){
 					streamlog_out(MESSAGE9)<<"The positions between the scatterers are: "<<endl;
 					streamlog_out(MESSAGE9)<<"Start: "<<globalPosSensor1[0]<<" "<<globalPosSensor1[1]<<" "<<globalPosSensor1[2]<<endl;
@@ -367,7 +377,7 @@ namespace eutelescope {
 	}
 
 	//THIS IS THE GETTERS
-	gbl::GblPoint EUTelGBLFitter::getLabelToPoint(std::vector<gbl::GblPoint> & pointList, int label)
+	const gbl::GblPoint& EUTelGBLFitter::getLabelToPoint(const std::vector<gbl::GblPoint> & pointList, int label)
 	{
 		for(size_t i = 0; i< pointList.size();++i)
 		{
@@ -381,13 +391,13 @@ namespace eutelescope {
 		throw(lcio::Exception("There is no point with this label"));
 	}
 	//This used after trackfit will fill a map between (sensor ID and residualx/y). 
-	void EUTelGBLFitter::getResidualOfTrackandHits(gbl::GblTrajectory* traj, std::vector< gbl::GblPoint > pointList,EUTelTrack& track, map< int, map< float, float > > &  SensorResidual, map< int, map< float, float > >& sensorResidualError ){
+	void EUTelGBLFitter::getResidualOfTrackandHits(gbl::GblTrajectory* traj, const std::vector< gbl::GblPoint >& pointList,EUTelTrack& track, map< int, map< float, float > > &  SensorResidual, map< int, map< float, float > >& sensorResidualError ){
 		for(size_t j=0 ; j< _vectorOfPairsMeasurementStatesAndLabels.size();j++){
-			EUTelState state = _vectorOfPairsMeasurementStatesAndLabels.at(j).first;
+			const EUTelState& state = _vectorOfPairsMeasurementStatesAndLabels.at(j).first;
 			if(getLabelToPoint(pointList,_vectorOfPairsMeasurementStatesAndLabels.at(j).second).hasMeasurement() == 0){
 				throw(lcio::Exception("This point does not contain a measurements. Labeling of the state must be wrong "));
 			} 
-			streamlog_out(DEBUG0) << endl << "There is a hit on the state. Hit pointer: "<< state.getTrackerHits()[0]<<" Find updated Residuals!" << std::endl;
+			streamlog_out(DEBUG0) << endl << "There is a hit on the state. Hit pointer: "<< state.getHit()<<" Find updated Residuals!" << std::endl;
 			unsigned int numData; //Not sure what this is used for??????
 			TVectorD aResiduals(2);
 			TVectorD aMeasErrors(2);
@@ -420,12 +430,7 @@ namespace eutelescope {
 		if ( !_mEstimatorType.empty( ) ) ierr = traj->fit( *chi2, *ndf, loss, _mEstimatorType );
 		else ierr = traj->fit( *chi2, *ndf, loss );
 
-		if( ierr != 0 ){
-			streamlog_out(MESSAGE0) << "Fit failed!" << " Track error: "<< ierr << " and chi2: " << *chi2 << std::endl;
-		}
-		else{
-		streamlog_out(MESSAGE0) << "Fit Successful!" << " Track error; "<< ierr << " and chi2: " << *chi2 << std::endl;
-		}
+		//The result is reported by the caller. The fit may run in one of several threads.
 		streamlog_out ( DEBUG4 ) << " EUTelGBLFitter::computeTrajectoryAndFit -- END " << endl;
 	}
 	//TEST
@@ -443,6 +448,8 @@ namespace eutelescope {
 			throw(lcio::Exception("The number of states is zero."));
 		}
 		///Note we do not use excluded planes here. This should be dealt with in pattern recognition.
+		//This may run in several threads outside the critical section around setInformationForGBLPointList. That is fine: the geometry is set up before the first event,
+		//gGeometry() does not change it once set up and nPlanes() reads a plain member. Only the TGeo navigation (local2Master, radiation length) changes state and needs the critical section.
 		if (track.getNumberOfHitsOnTrack() > geo::gGeometry().nPlanes() ){
 			throw(lcio::Exception("The number of hits on the track is greater than the number of planes.")); 	
 		}
@@ -467,8 +474,10 @@ namespace eutelescope {
 
 	//OTHER FUNCTIONS
 	//We want to create a jacobain from (Plane1 -> scatterer1) then (scatterer1->scatterer2) then (scatter2->plane2). We return the last jacobain
-	TMatrixD EUTelGBLFitter::findScattersJacobians(EUTelState state, EUTelState nextState){
-		_scattererJacobians.clear();
+	const TMatrixD& EUTelGBLFitter::findScattersJacobians(EUTelState& state, EUTelState& nextState){
+		if(_scattererPositions.size() != _scattererJacobians.size()){
+			throw(lcio::Exception("There are not 3 jacobians produced by scatterers!")); 	
+		}
 		TVector3 position = state.getPositionGlobal();
 		TVector3 momentum = state.computeCartesianMomentum();
 		TVector3 newMomentum;
@@ -483,31 +492,33 @@ namespace eutelescope {
 		B[0]=Bx; B[1]=By; B[2]=Bz;
 		for(size_t i=0;i<_scattererPositions.size();i++){
 			newMomentum = geo::gGeometry().getXYZMomentumfromArcLength(momentum, position,state.getBeamCharge(), _scattererPositions[i] );
-			TMatrixD curvilinearJacobian = geo::gGeometry().getPropagationJacobianCurvilinear(_scattererPositions[i], state.getOmega(), momentum.Unit(),newMomentum.Unit());
+			//Fixed-size matrices, nothing is allocated for each scatterer. Only the result is copied to the matrix GBL takes
+			geo::Jacobian5d curvilinearJacobian;
+			geo::gGeometry().getPropagationJacobianCurvilinear(_scattererPositions[i], state.getOmega(), momentum.Unit(),newMomentum.Unit(), curvilinearJacobian);
 			streamlog_out(DEBUG0)<<"This is the curvilinear jacobian at sensor : " << location << " or scatter: "<< i << std::endl; 
-			streamlog_message( DEBUG0, curvilinearJacobian.Print();, std::endl; );
-			TMatrixD localToCurvilinearJacobianStart =  geo::gGeometry().getLocalToCurvilinearTransformMatrix(momentum, location ,state.getBeamCharge() );
+			streamlog_out(DEBUG0)<< curvilinearJacobian << std::endl;
+			geo::Jacobian5d localToCurvilinearJacobianStart;
+			geo::gGeometry().getLocalToCurvilinearTransformMatrix(momentum, location ,state.getBeamCharge(), localToCurvilinearJacobianStart);
 			streamlog_out(DEBUG0)<<"This is the local to curvilinear jacobian at sensor : " << location << " or scatter: "<< i << std::endl; 
-			streamlog_message( DEBUG0, localToCurvilinearJacobianStart.Print();, std::endl; );
-			TMatrixD localToCurvilinearJacobianEnd =  geo::gGeometry().getLocalToCurvilinearTransformMatrix(newMomentum,locationEnd ,state.getBeamCharge() );
+			streamlog_out(DEBUG0)<< localToCurvilinearJacobianStart << std::endl;
+			geo::Jacobian5d localToCurvilinearJacobianEnd;
+			geo::gGeometry().getLocalToCurvilinearTransformMatrix(newMomentum,locationEnd ,state.getBeamCharge(), localToCurvilinearJacobianEnd);
 			streamlog_out(DEBUG0)<<"This is the local to curvilinear jacobian at sensor : " << locationEnd << " or scatter: "<< i << std::endl; 
-			streamlog_message( DEBUG0, localToCurvilinearJacobianEnd.Print();, std::endl; );
-			TMatrixD curvilinearToLocalJacobianEnd = localToCurvilinearJacobianEnd.Invert();
+			streamlog_out(DEBUG0)<< localToCurvilinearJacobianEnd << std::endl;
+			const geo::Jacobian5d curvilinearToLocalJacobianEnd = localToCurvilinearJacobianEnd.inverse();
 			streamlog_out(DEBUG0)<<"This is the curvilinear to local jacobian at sensor : " << locationEnd << " or scatter: "<< i << std::endl; 
-			streamlog_message( DEBUG0, curvilinearToLocalJacobianEnd.Print();, std::endl; );
-			TMatrixD localToNextLocalJacobian = curvilinearToLocalJacobianEnd*curvilinearJacobian*localToCurvilinearJacobianStart;
+			streamlog_out(DEBUG0)<< curvilinearToLocalJacobianEnd << std::endl;
+			const geo::Jacobian5d localToNextLocal = curvilinearToLocalJacobianEnd * curvilinearJacobian * localToCurvilinearJacobianStart;
+			TMatrixD& localToNextLocalJacobian = _scattererJacobians[i];//To DO if scatter then plane is always parallel to z axis
+			geo::EUTelGeometryTelescopeGeoDescription::copyJacobian(localToNextLocal, localToNextLocalJacobian);
 			streamlog_out(DEBUG0)<<"This is the full jacobian : " << locationEnd << " or scatter: "<< i << std::endl; 
 			streamlog_message( DEBUG0, localToNextLocalJacobian.Print();, std::endl; );
-			_scattererJacobians.push_back(localToNextLocalJacobian);//To DO if scatter then plane is always parallel to z axis
 			momentum[0]=newMomentum[0]; momentum[1]=newMomentum[1];	momentum[2]=newMomentum[2];
 			location = 314;//location will always be a scatter after first loop.  
 			if(i == (_scattererPositions.size()-2)){//On the last loop we want to create the jacobain to the next plane
 				locationEnd = nextState.getLocation();
 			}
 		}
-		if(_scattererJacobians.size() != 3){
-			throw(lcio::Exception("There are not 3 jacobians produced by scatterers!")); 	
-		}
 		return _scattererJacobians.back();//return the last jacobian so the next state can use this
 	}
 	//The distance from the first state to the next scatterer and then from that scatterer to the next all the way to the next state. 
@@ -533,12 +544,13 @@ namespace eutelescope {
 	//This function will take the estimate track from pattern recognition and add a correction to it. This estimated track + correction is you final GBL track.
 	void EUTelGBLFitter::updateTrackFromGBLTrajectory (gbl::GblTrajectory* traj, std::vector< gbl::GblPoint >& pointList,EUTelTrack &track, map<int, vector<double> > &  mapSensorIDToCorrectionVec){
 		streamlog_out ( DEBUG4 ) << " EUTelGBLFitter::UpdateTrackFromGBLTrajectory-- BEGIN " << endl;
-		for(size_t i=0;i < track.getStatesPointers().size(); i++){//We get the pointers no since we want to change the track state contents		
-			EUTelState* state = track.getStatesPointers().at(i);
+		std::vector<EUTelState>& states = track.getStates();//By reference since we want to change the track state contents
+		for(size_t i=0;i < states.size(); i++){
+			EUTelState& state = states.at(i);
 			TVectorD corrections(5);
 			TMatrixDSym correctionsCov(5,5);
 			for(size_t j=0 ; j< _vectorOfPairsStatesAndLabels.size();++j){
-				if(_vectorOfPairsStatesAndLabels.at(j).first == *state){
+				if(_vectorOfPairsStatesAndLabels.at(j).first == state){
 					streamlog_out(DEBUG0)<<"The loop number for states with measurements is: " << j << ". The label is: " << _vectorOfPairsStatesAndLabels.at(j).second <<endl; 
 		//				if(getLabelToPoint(pointList,_vectorOfPairsStatesAndLabels.at(j).second).hasMeasurement() == 0){//TO DO: Some states will not have hits in the future so should remove. Leave for now to test
 		//					throw(lcio::Exception("This point does not contain a measurements. Labeling of the state must be wrong "));
@@ -546,13 +558,13 @@ namespace eutelescope {
 					streamlog_out(DEBUG0)<<"To update track we use label: "<<_vectorOfPairsStatesAndLabels.at(j).second<<std::endl; 
 					traj->getResults(_vectorOfPairsStatesAndLabels.at(j).second, corrections, correctionsCov );
 					streamlog_out(DEBUG3) << endl << "State before we have added corrections: " << std::endl;
-					state->print();
+					if(streamlog_level(DEBUG3)) state.print();
 					TVectorD newStateVec(5);
-					newStateVec[0] = state->getOmega() + corrections[0];
-					newStateVec[1] = state->getIntersectionLocalXZ()+corrections[1];
-					newStateVec[2] = state->getIntersectionLocalYZ()+corrections[2];
-					newStateVec[3] = state->getPosition()[0]+corrections[3];
-					newStateVec[4] = state->getPosition()[1]+corrections[4]; 
+					newStateVec[0] = state.getOmega() + corrections[0];
+					newStateVec[1] = state.getIntersectionLocalXZ()+corrections[1];
+					newStateVec[2] = state.getIntersectionLocalYZ()+corrections[2];
+					newStateVec[3] = state.getPosition()[0]+corrections[3];
+					newStateVec[4] = state.getPosition()[1]+corrections[4]; 
 					//Here we collect the total correction for every track and state. This we use to work out an average to make sure that on each iteration the track corrections are reducing
 					_omegaCorrections = _omegaCorrections + corrections[0];	
 					_intersectionLocalXZCorrections= _intersectionLocalXZCorrections+ corrections[1];	
@@ -567,10 +579,10 @@ namespace eutelescope {
 					correctionVec.push_back(corrections[3]);	
 					correctionVec.push_back(corrections[4]);	
 
-					mapSensorIDToCorrectionVec[state->getLocation()] = correctionVec;
-					state->setStateVec(newStateVec);
+					mapSensorIDToCorrectionVec[state.getLocation()] = correctionVec;
+					state.setStateVec(newStateVec);
 					streamlog_out(DEBUG3) << endl << "State after we have added corrections: " << std::endl;
-					state->print();
+					if(streamlog_level(DEBUG3)) state.print();
 					break;
 				}
 			}//END of loop of all states with hits	
@@ -9,6 +9,7 @@
 #include <string>
 #include <cstring>
 #include <sstream>
+#include <cmath>
 
 // MARLIN
 #include "marlin/Global.h"
@@ -34,6 +35,7 @@
 #include "TVector3.h"
 #include "TMath.h"
 #include "TError.h"
+#include "TRandom3.h"
 
 // lcio includes <.h>
 #include <UTIL/CellIDDecoder.h>
@@ -54,9 +56,10 @@ EUTelGeometryTelescopeGeoDescription& EUTelGeometryTelescopeGeoDescription::getI
 	{
 		instance.setGearManager(_g);
 		instance.readGear();
+		//Only counted once, so that later calls (also from the track fit threads) do not write
+		instance.counter();
 	}
 	
-	instance.counter();
 
 	return instance;
 }
@@ -384,6 +387,10 @@ _sensorZOrderToIDMap(),
 _sensorIDtoZOrderMap(),
 _nPlanes(0),
 _isGeoInitialized(false),
+_radLengthMaps(),
+_radLengthMapPositionStep(1.),
+_radLengthMapMaxSlope(0.02),
+_radLengthMapSlopeBins(4),
 _geoManager(0)
 {
 	//Set ROOTs verbosity to only display error messages or higher (so info will not be streamed to stderr)
@@ -1138,6 +1145,110 @@ float EUTelGeometryTelescopeGeoDescription::findRadLengthIntegral( const double
     return rad;
 }
 
+void EUTelGeometryTelescopeGeoDescription::setRadLengthMapBinning( double positionStep, double maxSlope, int nSlopeBins ) {
+	_radLengthMapPositionStep = positionStep;
+	_radLengthMapMaxSlope = maxSlope;
+	_radLengthMapSlopeBins = nSlopeBins;
+	_radLengthMaps.clear();
+}
+
+//The radLengthMap covers the sensor area of the first plane and the slope range around the beam (z) axis.
+EUTelRadLengthMap& EUTelGeometryTelescopeGeoDescription::getRadLengthMap( int sensorID, int nextSensorID ) {
+	const std::pair<int, int> gap( sensorID, nextSensorID );
+	std::map< std::pair<int, int>, EUTelRadLengthMap >::iterator it = _radLengthMaps.find( gap );
+	if ( it != _radLengthMaps.end() ) return it->second;
+
+	EUTelRadLengthMap& radLengthMap = _radLengthMaps[ gap ];
+	const double halfSize = 0.5 * std::max( siPlaneXSize( sensorID ), siPlaneYSize( sensorID ) );
+	const int nPositionBins = std::max( 1, static_cast< int >( std::ceil( 2. * halfSize / _radLengthMapPositionStep ) ) );
+	const double minimum[EUTelRadLengthMap::nDim] = { siPlaneXPosition( sensorID ) - halfSize, siPlaneYPosition( sensorID ) - halfSize, -_radLengthMapMaxSlope, -_radLengthMapMaxSlope };
+	const double maximum[EUTelRadLengthMap::nDim] = { siPlaneXPosition( sensorID ) + halfSize, siPlaneYPosition( sensorID ) + halfSize, _radLengthMapMaxSlope, _radLengthMapMaxSlope };
+	const int nBins[EUTelRadLengthMap::nDim] = { nPositionBins, nPositionBins, _radLengthMapSlopeBins, _radLengthMapSlopeBins };
+	radLengthMap.setBinning( minimum, maximum, nBins );
+	streamlog_out( DEBUG5 ) << "Material map for planes " << sensorID << " -> " << nextSensorID << " with " << radLengthMap.getNumberOfNodes() << " nodes" << std::endl;
+	return radLengthMap;
+}
+
+//Intersections of the line with the planes through the sensor centres.
+void EUTelGeometryTelescopeGeoDescription::getRadLengthMapLinePoints( int sensorID, int nextSensorID, const double line[], double globalPosStart[], double globalPosFinish[] ) {
+	const double point[3] = { line[0], line[1], siPlaneZPosition( sensorID ) };
+	const double dir[3] = { line[2], line[3], 1. };
+	const int planes[2] = { sensorID, nextSensorID };
+	double* positions[2] = { globalPosStart, globalPosFinish };
+	for ( int ipl = 0; ipl < 2; ++ipl ) {
+		const TVector3 normal = siPlaneNormal( planes[ipl] );
+		const double centre[3] = { siPlaneXPosition( planes[ipl] ), siPlaneYPosition( planes[ipl] ), siPlaneZPosition( planes[ipl] ) };
+		double numerator = 0.;
+		double denominator = 0.;
+		for ( int i = 0; i < 3; ++i ) {
+			numerator += normal[i] * ( centre[i] - point[i] );
+			denominator += normal[i] * dir[i];
+		}
+		const double t = numerator / denominator;
+		for ( int i = 0; i < 3; ++i ) positions[ipl][i] = point[i] + t * dir[i];
+	}
+}
+
+float EUTelGeometryTelescopeGeoDescription::findRadLengthIntegralInGap( int sensorID, int nextSensorID, const double globalPosStart[], const double globalPosFinish[] ) {
+	const double dz = globalPosFinish[2] - globalPosStart[2];
+	if ( std::fabs( dz ) < 1.e-9 ) return findRadLengthIntegral( globalPosStart, globalPosFinish, false );
+
+	// Line parameters at the z of the first sensor centre
+	double line[EUTelRadLengthMap::nDim];
+	line[2] = ( globalPosFinish[0] - globalPosStart[0] ) / dz;
+	line[3] = ( globalPosFinish[1] - globalPosStart[1] ) / dz;
+	line[0] = globalPosStart[0] + line[2] * ( siPlaneZPosition( sensorID ) - globalPosStart[2] );
+	line[1] = globalPosStart[1] + line[3] * ( siPlaneZPosition( sensorID ) - globalPosStart[2] );
+
+	EUTelRadLengthMap& radLengthMap = getRadLengthMap( sensorID, nextSensorID );
+	if ( !radLengthMap.contains( line ) ) return findRadLengthIntegral( globalPosStart, globalPosFinish, false );
+
+	int nodes[EUTelRadLengthMap::nCorners];
+	double weights[EUTelRadLengthMap::nCorners];
+	radLengthMap.getCorners( line, nodes, weights );
+
+	double rad = 0.;
+	for ( int corner = 0; corner < EUTelRadLengthMap::nCorners; ++corner ) {
+		if ( weights[corner] == 0. ) continue;
+		if ( !radLengthMap.isNodeFilled( nodes[corner] ) ) {
+			double nodeLine[EUTelRadLengthMap::nDim];
+			double nodeStart[3], nodeFinish[3];
+			radLengthMap.getNodeLine( nodes[corner], nodeLine );
+			getRadLengthMapLinePoints( sensorID, nextSensorID, nodeLine, nodeStart, nodeFinish );
+			radLengthMap.setNodeValue( nodes[corner], findRadLengthIntegral( nodeStart, nodeFinish, false ) );
+		}
+		rad += weights[corner] * radLengthMap.getNodeValue( nodes[corner] );
+	}
+	return rad;
+}
+
+float EUTelGeometryTelescopeGeoDescription::checkRadLengthMaps( int nSamples ) {
+	TRandom3 random( 4357 );
+	float maxDeviation = 0.;
+	for ( size_t iz = 0; iz + 1 < _sensorZOrderToIDMap.size(); ++iz ) {
+		const int sensorID = sensorZOrderToID( static_cast< int >( iz ) );
+		const int nextSensorID = sensorZOrderToID( static_cast< int >( iz + 1 ) );
+		const double halfSize = 0.5 * std::min( siPlaneXSize( sensorID ), siPlaneYSize( sensorID ) );
+		float maxGapDeviation = 0.;
+		for ( int i = 0; i < nSamples; ++i ) {
+			const double line[EUTelRadLengthMap::nDim] = {
+				siPlaneXPosition( sensorID ) + random.Uniform( -halfSize, halfSize ),
+				siPlaneYPosition( sensorID ) + random.Uniform( -halfSize, halfSize ),
+				random.Uniform( -_radLengthMapMaxSlope, _radLengthMapMaxSlope ),
+				random.Uniform( -_radLengthMapMaxSlope, _radLengthMapMaxSlope ) };
+			double start[3], finish[3];
+			getRadLengthMapLinePoints( sensorID, nextSensorID, line, start, finish );
+			const float exact = findRadLengthIntegral( start, finish, false );
+			const float interpolated = findRadLengthIntegralInGap( sensorID, nextSensorID, start, finish );
+			if ( exact > 0. ) maxGapDeviation = std::max( maxGapDeviation, std::fabs( interpolated - exact ) / exact );
+		}
+		streamlog_out( MESSAGE4 ) << "Material map for planes " << sensorID << " -> " << nextSensorID << ": largest relative deviation from the exact integral "
+		                          << maxGapDeviation << " (" << nSamples << " lines)" << std::endl;
+		maxDeviation = std::max( maxDeviation, maxGapDeviation );
+	}
+	return maxDeviation;
+}
+
 //
 // straight line - shashlyk plane assembler
 //
@@ -1449,7 +1560,7 @@ TVector3 EUTelGeometryTelescopeGeoDescription::getXYZfromArcLength(TVector3 pos
 //Within the function this will be clearly labelled
 //This is a simple transform our x becomes their(curvilinear y), our y becomes their z and z becomes x
 //However this is ok since we never directly access the curvilinear system. It is only a bridge between two local systems. 
-TMatrixD EUTelGeometryTelescopeGeoDescription::getLocalToCurvilinearTransformMatrix(TVector3 globalMomentum, int  planeID, float charge){
+void EUTelGeometryTelescopeGeoDescription::getLocalToCurvilinearTransformMatrix(const TVector3& globalMomentum, int  planeID, float charge, Jacobian5d& jacobian){
 	const gear::BField&   Bfield = geo::gGeometry().getMagneticField();
 	gear::Vector3D vectorGlobal(0.1,0.1,0.1);//Since field is homogeneous this seems silly but we need to specify a position to geometry to get B-field.
 	//Magnetic field must be changed to curvilinear coordinate system. Since this is used in the curvilinear jacobian/////////////////////////////////////////////////////////////////////////////////////////
@@ -1532,15 +1643,21 @@ TMatrixD EUTelGeometryTelescopeGeoDescription::getLocalToCurvilinearTransformMat
 	const double UDotJ = U.Dot(J);
 	const double UDotK = U.Dot(K);
 	const double UDotN = U.Dot(N);
-	TMatrix jacobian(5,5);
-	jacobian.Zero();
-	jacobian[0][0]=1; 
-	                 jacobian[1][1]=TDotI*VDotJ;             jacobian[1][2]=TDotI*VDotK;             jacobian[1][3]=-alpha*Q*TDotJ*VDotN;             jacobian[1][4]=-alpha*Q*TDotK*VDotN;
-	                 jacobian[2][1]=(TDotI*UDotJ)/cosLambda; jacobian[2][2]=(TDotI*UDotK)/cosLambda; jacobian[2][3]=(-alpha*Q*TDotJ*UDotN)/cosLambda; jacobian[2][4]=(-alpha*Q*TDotK*UDotN)/cosLambda;
-																																																   jacobian[3][3]=UDotJ;													  jacobian[3][4]=UDotK;
-																																																   jacobian[4][3]=VDotJ;													  jacobian[4][4]=VDotK;
-	return jacobian;
+	jacobian.setZero();
+	jacobian(0,0)=1; 
+	                 jacobian(1,1)=TDotI*VDotJ;             jacobian(1,2)=TDotI*VDotK;             jacobian(1,3)=-alpha*Q*TDotJ*VDotN;             jacobian(1,4)=-alpha*Q*TDotK*VDotN;
+	                 jacobian(2,1)=(TDotI*UDotJ)/cosLambda; jacobian(2,2)=(TDotI*UDotK)/cosLambda; jacobian(2,3)=(-alpha*Q*TDotJ*UDotN)/cosLambda; jacobian(2,4)=(-alpha*Q*TDotK*UDotN)/cosLambda;
+																																																   jacobian(3,3)=UDotJ;													  jacobian(3,4)=UDotK;
+																																																   jacobian(4,3)=VDotJ;													  jacobian(4,4)=VDotK;
 }
+TMatrixD EUTelGeometryTelescopeGeoDescription::getLocalToCurvilinearTransformMatrix(TVector3 globalMomentum, int  planeID, float charge){
+	Jacobian5d jacobian;
+	getLocalToCurvilinearTransformMatrix(globalMomentum, planeID, charge, jacobian);
+	TMatrixD matrix(5,5);
+	copyJacobian(jacobian, matrix);
+	return matrix;
+}
+
 //This is described in Derivations of Jacobians for the propagation of covariance matrices of track parameters in homogeneous magnetic fields. A satrandie, W Wittek
 //This papaer describes the one letter variables. 
 //s must be in metres
@@ -1661,7 +1778,7 @@ TMatrix EUTelGeometryTelescopeGeoDescription::getPropagationJacobianCurvilinear(
 //We therefore have to change to the coordinate system used in paper before we apply this jacobian.
 //This is ok since we never access the curvilinear system directly but always through the local system which is defined in the local frame of the telescope
 //I.e Telescope x becomes y, y becomes z and z becomes x.
-TMatrixD EUTelGeometryTelescopeGeoDescription::getPropagationJacobianCurvilinear(float ds , float  qbyp,  TVector3 t1w, TVector3 t2w) {
+void EUTelGeometryTelescopeGeoDescription::getPropagationJacobianCurvilinear(float ds , float  qbyp,  const TVector3& t1w, const TVector3& t2w, Jacobian5d& ajac) {
 	TVector3 t1(t1w[2],t1w[1],t1w[0]);//This is need to change to claus's coordinate system
 	TVector3 t2(t2w[2],t2w[1],t2w[0]);
 	t1.Unit();
@@ -1690,15 +1807,14 @@ TMatrixD EUTelGeometryTelescopeGeoDescription::getPropagationJacobianCurvilinear
 	streamlog_message( DEBUG0, t2.Print();, std::endl; );
 	streamlog_out(DEBUG0)<<"The unit Magnetic field  "<< std::endl; 
 	streamlog_message( DEBUG0, b.Print();, std::endl; );
-	TMatrixD ajac(5, 5);
 	TVector3  bc  = b;//This is b*c. speed of light in 1 nanosecond
-	ajac.UnitMatrix(); 
+	ajac.setIdentity(); 
 	const double qp = -bc.Mag(); // -|B*c|
 	const double q = qp * qbyp; // Q
 	if (q == 0.) {
 		// line
- 		ajac[3][2] = ds * sqrt(t1[0] * t1[0] + t1[1] * t1[1]);
-		ajac[4][1] = ds;
+ 		ajac(3,2) = ds * sqrt(t1[0] * t1[0] + t1[1] * t1[1]);
+		ajac(4,1) = ds;
 	} else {
 		// helix
 		// at start
@@ -1747,39 +1863,52 @@ TMatrixD EUTelGeometryTelescopeGeoDescription::getPropagationJacobianCurvilinear
 		const double an2u1 = an2.Dot(u1), an2v1 = an2.Dot(v1);
 		// jacobian
 		// 1/P
-		ajac[0][0] = 1.;
+		ajac(0,0) = 1.;
 		// Lambda
-		ajac[1][0] = -qp * anv * t2dx;
-		ajac[1][1] = cost * v1v2 + sint * hv1v2 + omcost * hnv1 * hnv2 + anv * (-sint * t2v1 + omcost * an2v1 - gamma * tmsint * hnv1);
-		ajac[1][2] = cosl1
+		ajac(1,0) = -qp * anv * t2dx;
+		ajac(1,1) = cost * v1v2 + sint * hv1v2 + omcost * hnv1 * hnv2 + anv * (-sint * t2v1 + omcost * an2v1 - gamma * tmsint * hnv1);
+		ajac(1,2) = cosl1
 		* (cost * u1v2 + sint * hu1v2 + omcost * hnu1 * hnv2 + anv * (-sint * t2u1 + omcost * an2u1 - gamma * tmsint * hnu1));
-		ajac[1][3] = -q * anv * t2u1;
-		ajac[1][4] = -q * anv * t2v1;
+		ajac(1,3) = -q * anv * t2u1;
+		ajac(1,4) = -q * anv * t2v1;
 		// Phi
-		ajac[2][0] = -qp * anu * t2dx * cosl2Inv;
-		ajac[2][1] = cosl2Inv
+		ajac(2,0) = -qp * anu * t2dx * cosl2Inv;
+		ajac(2,1) = cosl2Inv
 		* (cost * v1u2 + sint * hv1u2 + omcost * hnv1 * hnu2 + anu * (-sint * t2v1 + omcost * an2v1 - gamma * tmsint * hnv1));
-		ajac[2][2] = cosl2Inv * cosl1
+		ajac(2,2) = cosl2Inv * cosl1
 		* (cost * u1u2 + sint * hu1u2 + omcost * hnu1 * hnu2 + anu * (-sint * t2u1 + omcost * an2u1 - gamma * tmsint * hnu1));
-		ajac[2][3] = -q * anu * t2u1 * cosl2Inv;
-		ajac[2][4] = -q * anu * t2v1 * cosl2Inv;
+		ajac(2,3) = -q * anu * t2u1 * cosl2Inv;
+		ajac(2,4) = -q * anu * t2v1 * cosl2Inv;
 		// Xt
-		ajac[3][0] = pav * u2dx;
-		ajac[3][1] = (sint * v1u2 + omcost * hv1u2 + tmsint * hnu2 * hnv1) / q;
-		ajac[3][2] = (sint * u1u2 + omcost * hu1u2 + tmsint * hnu2 * hnu1) * cosl1 / q;
-		ajac[3][3] = u1u2;
-		ajac[3][4] = v1u2;
+		ajac(3,0) = pav * u2dx;
+		ajac(3,1) = (sint * v1u2 + omcost * hv1u2 + tmsint * hnu2 * hnv1) / q;
+		ajac(3,2) = (sint * u1u2 + omcost * hu1u2 + tmsint * hnu2 * hnu1) * cosl1 / q;
+		ajac(3,3) = u1u2;
+		ajac(3,4) = v1u2;
 		// Yt
-		ajac[4][0] = pav * v2dx;
-		ajac[4][1] = (sint * v1v2 + omcost * hv1v2 + tmsint * hnv2 * hnv1) / q;
-		ajac[4][2] = (sint * u1v2 + omcost * hu1v2 + tmsint * hnv2 * hnu1) * cosl1 / q;
-		ajac[4][3] = u1v2;
-		ajac[4][4] = v1v2;
+		ajac(4,0) = pav * v2dx;
+		ajac(4,1) = (sint * v1v2 + omcost * hv1v2 + tmsint * hnv2 * hnv1) / q;
+		ajac(4,2) = (sint * u1v2 + omcost * hu1v2 + tmsint * hnv2 * hnu1) * cosl1 / q;
+		ajac(4,3) = u1v2;
+		ajac(4,4) = v1v2;
 	}
 	streamlog_out( DEBUG2 ) << "EUTelGeometryTelescopeGeoDescription::getPropagationJacobianCurvilinear()------END" << std::endl;
-
-		return ajac;
 }
+TMatrixD EUTelGeometryTelescopeGeoDescription::getPropagationJacobianCurvilinear(float ds , float  qbyp,  TVector3 t1w, TVector3 t2w) {
+	Jacobian5d ajac;
+	getPropagationJacobianCurvilinear(ds, qbyp, t1w, t2w, ajac);
+	TMatrixD matrix(5,5);
+	copyJacobian(ajac, matrix);
+	return matrix;
+}
+void EUTelGeometryTelescopeGeoDescription::copyJacobian(const Jacobian5d& jacobian, TMatrixD& matrix){
+	for(int i = 0; i < 5; i++){
+		for(int j = 0; j < 5; j++){
+			matrix[i][j] = jacobian(i,j);
+		}
+	}
+}
+
 //This function given position/momentum of a particle. Will give you the approximate jacobian at any point along the track. This effectively relates changes in the particle position/momentum at the original to some distant point. 
 //So if I change the initial position by x amount how much will all the other variables position/momentum at the new position change? This is what the Jacobian tells you.
 
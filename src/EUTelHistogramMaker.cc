@@ -13,6 +13,7 @@
 #include "EUTelEventImpl.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTelVirtualCluster.h"
+#include "EUTelClusterSummary.h"
 #include "EUTelFFClusterImpl.h"
 #include "EUTelDFFClusterImpl.h"
 #include "EUTelBrickedClusterImpl.h"
@@ -243,64 +244,42 @@ void EUTelHistogramMaker::processEvent (LCEvent * evt) {
 
   try {
 
-    LCCollectionVec * pulseCollectionVec = dynamic_cast<LCCollectionVec*>  (evt->getCollection(_pulseCollectionName));
-    CellIDDecoder<TrackerPulseImpl> cellDecoder(pulseCollectionVec);
+    // the clusters are decoded once per event and shared with the
+    // other processors reading the same pulse collection
+    EUTelClusterSummary & clusterSummary = EUTelClusterSummary::getInstance( _pulseCollectionName );
+    if ( !clusterSummary.update( evt ) ) throw DataNotAvailableException( _pulseCollectionName );
+
+    // the cluster objects are needed only for the N pixel spectra and the noise
+    const bool needsCluster = _noiseHistoSwitch || !_clusterSpectraNVector.empty() || !_clusterSpectraNxNVector.empty();
 
     // prepare and reset the hit counter
     map<int, int> eventCounterMap;
-    for ( int iPulse = 0; iPulse < pulseCollectionVec->getNumberOfElements(); iPulse++ ) {
-      TrackerPulseImpl * pulse = dynamic_cast<TrackerPulseImpl*> ( pulseCollectionVec->getElementAt(iPulse) );
-      ClusterType        type  = static_cast<ClusterType> ( static_cast<int> ( cellDecoder(pulse)["type"] ));
-      SparsePixelType    pixelType = static_cast<SparsePixelType> (0);
-
-      EUTelVirtualCluster * cluster;
-      if ( type == kEUTelDFFClusterImpl ) {
-        cluster = new EUTelDFFClusterImpl ( static_cast<TrackerDataImpl*> ( pulse->getTrackerData() ) );
-      }
-      else if ( type == kEUTelBrickedClusterImpl ) {
-        cluster = new EUTelBrickedClusterImpl ( static_cast<TrackerDataImpl*> ( pulse->getTrackerData() ) );
-      }
-      else if ( type == kEUTelFFClusterImpl ) {
-        
-        cluster = new EUTelFFClusterImpl ( static_cast<TrackerDataImpl*> ( pulse->getTrackerData() ) );
-        
-      } else if ( type == kEUTelSparseClusterImpl ) {
-        LCCollectionVec * sparseClusterCollectionVec = dynamic_cast < LCCollectionVec * > (evt->getCollection("original_zsdata"));
-        TrackerDataImpl * oneCluster = dynamic_cast<TrackerDataImpl*> (sparseClusterCollectionVec->getElementAt( 0 ));
-        CellIDDecoder<TrackerDataImpl > anotherDecoder(sparseClusterCollectionVec);
-        pixelType = static_cast<SparsePixelType> ( static_cast<int> ( anotherDecoder( oneCluster )["sparsePixelType"] ));
-
-        if ( pixelType == kEUTelGenericSparsePixel ) {
-          cluster = new EUTelSparseClusterImpl<EUTelGenericSparsePixel >
-            ( static_cast<TrackerDataImpl *> ( pulse->getTrackerData() ) );
-        } else {
-          streamlog_out ( ERROR4 ) << "Unknown pixel type. Sorry for quitting." << endl;
-          throw UnknownDataTypeException("Pixel type unknown");
-        }
+    for ( size_t iPulse = 0; iPulse < clusterSummary.size(); iPulse++ ) {
+      const EUTelClusterSummary::Cluster & summary = clusterSummary[ iPulse ];
+      ClusterType        type  = summary.type;
 
-        
-      }
-        else {
+      if ( !summary.isDecoded ) {
 
         streamlog_out ( ERROR4) << "Unknown cluster type. Sorry for quitting" << endl;
         throw UnknownDataTypeException("Cluster type unknown");
 
       }
+      auto_ptr<EUTelVirtualCluster> cluster( needsCluster ? clusterSummary.createCluster( iPulse ) : 0 );
 
-      int detectorID = cluster->getDetectorID();
+      int detectorID = summary.sensorID;
       // increment of one unit the event counter for this plane
       eventCounterMap[detectorID]++;
 
       string tempHistoName = _clusterSignalHistoName + "_d" + to_string( detectorID );
-      (dynamic_cast<AIDA::IHistogram1D*> (_aidaHistoMap[tempHistoName]))->fill(cluster->getTotalCharge());
+      (dynamic_cast<AIDA::IHistogram1D*> (_aidaHistoMap[tempHistoName]))->fill(summary.totalCharge);
 
       if(type == kEUTelDFFClusterImpl ) {
         tempHistoName = _clusterNumberOfHitPixelName + "_d" + to_string( detectorID );
-        (dynamic_cast<AIDA::IHistogram1D*> (_aidaHistoMap[tempHistoName]))->fill(cluster->getTotalCharge());
+        (dynamic_cast<AIDA::IHistogram1D*> (_aidaHistoMap[tempHistoName]))->fill(summary.totalCharge);
       }
 
       tempHistoName = _seedSignalHistoName + "_d" + to_string( detectorID );
-      (dynamic_cast<AIDA::IHistogram1D*> (_aidaHistoMap[tempHistoName]))->fill(cluster->getSeedCharge());
+      (dynamic_cast<AIDA::IHistogram1D*> (_aidaHistoMap[tempHistoName]))->fill(summary.seedCharge);
 
       vector<int >::iterator iter = _clusterSpectraNVector.begin();
       while ( iter != _clusterSpectraNVector.end() ) {
@@ -318,8 +297,7 @@ void EUTelHistogramMaker::processEvent (LCEvent * evt) {
 
 
       tempHistoName = _hitMapHistoName + "_d" + to_string(detectorID);
-      int xSeed, ySeed;
-      cluster->getCenterCoord(xSeed, ySeed);
+      int xSeed = summary.xCenter, ySeed = summary.yCenter;
       (dynamic_cast<AIDA::IHistogram2D*> (_aidaHistoMap[tempHistoName]))->fill(static_cast<double >(xSeed), static_cast<double >(ySeed), 1.);
 
       if ( _noiseHistoSwitch ) 
@@ -432,18 +410,15 @@ void EUTelHistogramMaker::processEvent (LCEvent * evt) {
               }
             } else if ( type == kEUTelSparseClusterImpl ) {
               
-              if ( pixelType == kEUTelGenericSparsePixel ) {
-                
-                EUTelSparseClusterImpl<EUTelGenericSparsePixel > * recasted =
-                  dynamic_cast< EUTelSparseClusterImpl<EUTelGenericSparsePixel > * > ( cluster );
-                
-                auto_ptr<EUTelGenericSparsePixel> sparsePixel( new EUTelGenericSparsePixel );
-                for ( unsigned int iPixel = 0; iPixel < recasted->size() ; iPixel++ ) {
-                  recasted->getSparsePixelAt( iPixel, sparsePixel.get() ) ;
-                  int index = noiseMatrixDecoder.getIndexFromXY( sparsePixel->getXCoord(), sparsePixel->getYCoord() );
-                  noiseValues.push_back( noiseMatrix->getChargeValues()[ index ] );
-                }
+              // the summary decodes the sparse clusters as generic sparse pixel clusters
+              EUTelSparseClusterImpl<EUTelGenericSparsePixel > * recasted =
+                dynamic_cast< EUTelSparseClusterImpl<EUTelGenericSparsePixel > * > ( cluster.get() );
                 
+              auto_ptr<EUTelGenericSparsePixel> sparsePixel( new EUTelGenericSparsePixel );
+              for ( unsigned int iPixel = 0; iPixel < recasted->size() ; iPixel++ ) {
+                recasted->getSparsePixelAt( iPixel, sparsePixel.get() ) ;
+                int index = noiseMatrixDecoder.getIndexFromXY( sparsePixel->getXCoord(), sparsePixel->getYCoord() );
+                noiseValues.push_back( noiseMatrix->getChargeValues()[ index ] );
               }
               
             }
@@ -503,8 +478,6 @@ void EUTelHistogramMaker::processEvent (LCEvent * evt) {
           }
         }
       }
-
-      delete cluster;
     }
 
 
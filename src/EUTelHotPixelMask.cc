@@ -0,0 +1,223 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelHotPixelMask.h"
+#include "EUTELESCOPE.h"
+#include "EUTelGenericSparsePixel.h"
+
+// marlin includes ".h"
+#include "marlin/VerbosityLevels.h"
+
+// lcio includes <.h>
+#include <IMPL/LCCollectionVec.h>
+#include <UTIL/CellIDDecoder.h>
+#include <Exceptions.h>
+
+// system includes <>
+#include <algorithm>
+
+using namespace std;
+using namespace lcio;
+using namespace eutelescope;
+
+namespace {
+  //! Number of floats per pixel of kEUTelGenericSparsePixel data: x, y, signal, time
+  const unsigned int genericPixelElements = 4;
+}
+
+EUTelHotPixelMask & EUTelHotPixelMask::getInstance( const string & hotPixelCollectionName ) {
+  static map< string, EUTelHotPixelMask > masks;
+  map< string, EUTelHotPixelMask >::iterator it = masks.find( hotPixelCollectionName );
+  if ( it == masks.end() ) {
+    it = masks.insert( make_pair( hotPixelCollectionName, EUTelHotPixelMask() ) ).first;
+    it->second._collectionName = hotPixelCollectionName;
+  }
+  return it->second;
+}
+
+EUTelHotPixelMask::EUTelHotPixelMask() :
+  _pixels(),
+  _nPixels(0),
+  _sensors(),
+  _dirty(false),
+  _runNumber(-1),
+  _collectionFound(false),
+  _collectionName("")
+{
+}
+
+bool EUTelHotPixelMask::update( LCEvent * event ) {
+  if ( _runNumber == event->getRunNumber() ) return _collectionFound;
+
+  _runNumber = event->getRunNumber();
+  _collectionFound = false;
+  clear();
+  if ( _collectionName.empty() ) return false;
+
+  LCCollectionVec * hotPixelCollectionVec = 0;
+  try {
+    hotPixelCollectionVec = static_cast< LCCollectionVec * >( event->getCollection( _collectionName ) );
+  } catch ( lcio::DataNotAvailableException& e ) {
+    streamlog_out ( WARNING2 ) << "Hot pixel collection " << _collectionName << " not found in run " << _runNumber
+                               << ", no pixel is masked" << endl;
+    return false;
+  }
+  _collectionFound = true;
+
+  CellIDDecoder< TrackerDataImpl > cellDecoder( hotPixelCollectionVec );
+  for ( int i = 0; i < hotPixelCollectionVec->getNumberOfElements(); ++i ) {
+    TrackerDataImpl * hotPixelData = dynamic_cast< TrackerDataImpl * >( hotPixelCollectionVec->getElementAt( i ) );
+    const int sensorID = cellDecoder( hotPixelData )["sensorID"];
+    const int type     = cellDecoder( hotPixelData )["sparsePixelType"];
+    if ( type != kEUTelGenericSparsePixel ) {
+      streamlog_out ( WARNING2 ) << "Hot pixels of sensor " << sensorID << " are of an unsupported sparse pixel type and are not masked" << endl;
+      continue;
+    }
+    const FloatVec & values = hotPixelData->getChargeValues();
+    for ( size_t iValue = 0; iValue + genericPixelElements <= values.size(); iValue += genericPixelElements ) {
+      addPixel( sensorID, static_cast< int >( values[iValue] ), static_cast< int >( values[iValue + 1] ) );
+    }
+  }
+
+  for ( map< int, vector< pair< int, int > > >::const_iterator it = _pixels.begin(); it != _pixels.end(); ++it ) {
+    streamlog_out ( MESSAGE4 ) << "Masking " << it->second.size() << " hot pixels on sensor " << it->first << endl;
+  }
+  build();
+  return true;
+}
+
+void EUTelHotPixelMask::clear() {
+  _pixels.clear();
+  _nPixels = 0;
+  _sensors.clear();
+  _dirty = false;
+}
+
+void EUTelHotPixelMask::addPixel( int sensorID, int x, int y ) {
+  if ( sensorID < 0 ) {
+    streamlog_out ( WARNING2 ) << "Hot pixel with invalid sensor ID " << sensorID << " ignored" << endl;
+    return;
+  }
+  _pixels[ sensorID ].push_back( make_pair( x, y ) );
+  ++_nPixels;
+  _dirty = true;
+}
+
+size_t EUTelHotPixelMask::getNumberOfPixels( int sensorID ) const {
+  map< int, vector< pair< int, int > > >::const_iterator it = _pixels.find( sensorID );
+  return it == _pixels.end() ? 0 : it->second.size();
+}
+
+void EUTelHotPixelMask::build() const {
+  _sensors.clear();
+  _dirty = false;
+  if ( _pixels.empty() ) return;
+
+  _sensors.resize( _pixels.rbegin()->first + 1 );
+  for ( size_t i = 0; i < _sensors.size(); ++i ) {
+    _sensors[i].x0 = _sensors[i].y0 = 0;
+    _sensors[i].nX = _sensors[i].nY = _sensors[i].nWords = 0;
+  }
+
+  for ( map< int, vector< pair< int, int > > >::const_iterator it = _pixels.begin(); it != _pixels.end(); ++it ) {
+    const vector< pair< int, int > > & pixels = it->second;
+    if ( pixels.empty() ) continue;
+    SensorMask & sensor = _sensors[ it->first ];
+
+    int xMax = pixels[0].first;
+    int yMax = pixels[0].second;
+    sensor.x0 = xMax;
+    sensor.y0 = yMax;
+    for ( size_t i = 1; i < pixels.size(); ++i ) {
+      sensor.x0 = min( sensor.x0, pixels[i].first );
+      sensor.y0 = min( sensor.y0, pixels[i].second );
+      xMax = max( xMax, pixels[i].first );
+      yMax = max( yMax, pixels[i].second );
+    }
+    sensor.nX = xMax - sensor.x0 + 1;
+    sensor.nY = yMax - sensor.y0 + 1;
+    sensor.nWords = ( sensor.nX + 31 ) / 32;
+    sensor.words.assign( static_cast< size_t >( sensor.nWords ) * sensor.nY, 0u );
+
+    for ( size_t i = 0; i < pixels.size(); ++i ) {
+      const int ix = pixels[i].first - sensor.x0;
+      const int iy = pixels[i].second - sensor.y0;
+      sensor.words[ iy * sensor.nWords + ( ix >> 5 ) ] |= 1u << ( ix & 31 );
+    }
+  }
+}
+
+bool EUTelHotPixelMask::rowTouchesMask( const SensorMask & sensor, int iy, int ixMin, int ixMax ) {
+  const unsigned int * row = &sensor.words[ iy * sensor.nWords ];
+  const int firstWord = ixMin >> 5;
+  const int lastWord  = ixMax >> 5;
+  for ( int iWord = firstWord; iWord <= lastWord; ++iWord ) {
+    unsigned int word = row[ iWord ];
+    if ( iWord == firstWord ) word &= ~0u << ( ixMin & 31 );
+    if ( iWord == lastWord )  word &= ~0u >> ( 31 - ( ixMax & 31 ) );
+    if ( word ) return true;
+  }
+  return false;
+}
+
+bool EUTelHotPixelMask::clusterTouchesMask( int sensorID, const TrackerDataImpl * zsCluster ) const {
+  if ( _dirty ) build();
+  if ( sensorID < 0 || sensorID >= static_cast< int >( _sensors.size() ) ) return false;
+  const SensorMask & sensor = _sensors[ sensorID ];
+  if ( sensor.nX == 0 ) return false;
+
+  const FloatVec & values = zsCluster->getChargeValues();
+  if ( values.size() < genericPixelElements ) return false;
+
+  // bounding box of the cluster in bitmap coordinates
+  int ixMin = static_cast< int >( values[0] ) - sensor.x0;
+  int iyMin = static_cast< int >( values[1] ) - sensor.y0;
+  int ixMax = ixMin;
+  int iyMax = iyMin;
+  for ( size_t iValue = genericPixelElements; iValue + genericPixelElements <= values.size(); iValue += genericPixelElements ) {
+    const int ix = static_cast< int >( values[iValue] ) - sensor.x0;
+    const int iy = static_cast< int >( values[iValue + 1] ) - sensor.y0;
+    ixMin = min( ixMin, ix );
+    ixMax = max( ixMax, ix );
+    iyMin = min( iyMin, iy );
+    iyMax = max( iyMax, iy );
+  }
+  ixMin = max( ixMin, 0 );
+  iyMin = max( iyMin, 0 );
+  ixMax = min( ixMax, sensor.nX - 1 );
+  iyMax = min( iyMax, sensor.nY - 1 );
+  if ( ixMin > ixMax || iyMin > iyMax ) return false;
+
+  // no hot pixel in the bounding box: nothing to check pixel by pixel
+  bool boxTouchesMask = false;
+  for ( int iy = iyMin; iy <= iyMax && !boxTouchesMask; ++iy ) {
+    boxTouchesMask = rowTouchesMask( sensor, iy, ixMin, ixMax );
+  }
+  if ( !boxTouchesMask ) return false;
+
+  for ( size_t iValue = 0; iValue + genericPixelElements <= values.size(); iValue += genericPixelElements ) {
+    if ( isMasked( sensorID, static_cast< int >( values[iValue] ), static_cast< int >( values[iValue + 1] ) ) ) return true;
+  }
+  return false;
+}
+
+bool EUTelHotPixelMask::hitTouchesMask( const TrackerHitImpl * hit ) const {
+  if ( isEmpty() ) return false;
+  if ( hit->getType() != kEUTelSparseClusterImpl ) return false;
+
+  const LCObjectVec & clusterVector = hit->getRawHits();
+  if ( clusterVector.empty() ) return false;
+  TrackerDataImpl * clusterFrame = dynamic_cast< TrackerDataImpl * >( clusterVector[0] );
+  if ( clusterFrame == 0 ) return false;
+
+  // parsing the encoding string is more expensive than the lookup
+  static CellIDDecoder< TrackerDataImpl > cellDecoder( EUTELESCOPE::ZSCLUSTERDEFAULTENCODING );
+  return clusterTouchesMask( cellDecoder( clusterFrame )["sensorID"], clusterFrame );
+}
@@ -0,0 +1,300 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelLCIOReadAhead.h"
+#include "EUTelEventTransfer.h"
+
+// marlin includes ".h"
+#include "marlin/Processor.h"
+#include "marlin/DataSourceProcessor.h"
+#include "marlin/ProcessorMgr.h"
+#include "marlin/Global.h"
+
+// lcio includes <.h>
+#include <lcio.h>
+#include <IO/LCReader.h>
+#include <Exceptions.h>
+
+// system includes <>
+#include <memory>
+#include <exception>
+
+using namespace std;
+using namespace lcio;
+using namespace marlin;
+using namespace eutelescope;
+
+namespace {
+  //! Thrown by the listener to leave LCReader::readStream once the processing thread stopped reading
+  class ReadStopped : public lcio::Exception {
+  public:
+    ReadStopped() : lcio::Exception( "EUTelLCIOReadAhead: reading stopped" ) { }
+  };
+}
+
+EUTelLCIOReadAhead::EUTelLCIOReadAhead() : DataSourceProcessor("EUTelLCIOReadAhead"),
+  _fileNames(),
+  _readAheadDepth(16),
+  _maxRecords(0),
+  _skipEvents(0),
+  _nEvents(0),
+  _readError(),
+  _readWarning(),
+  _background(false),
+  _queue()
+#ifdef USE_PTHREAD
+  ,_thread(),
+  _mutex(),
+  _recordQueued(),
+  _recordTaken(),
+  _nQueued(0),
+  _producerSlot(0),
+  _consumerSlot(0),
+  _stop(false)
+#endif
+{
+  _description =
+    "Reads LCIO files on a helper thread, ahead of the processors.\n"
+    "Make sure to not specify any LCIOInputFiles in the steering in order to read the files with this processor.";
+
+  StringVec fileNamesExample;
+  fileNamesExample.push_back( "input.slcio" );
+  registerProcessorParameter("InputFiles", "LCIO files to be read, in this order", _fileNames, fileNamesExample);
+
+  registerOptionalParameter("ReadAheadDepth", "Number of records read ahead by the helper thread, 0 to read in the processing thread",
+                            _readAheadDepth, static_cast< int >( 16 ));
+}
+
+EUTelLCIOReadAhead * EUTelLCIOReadAhead::newProcessor() {
+  return new EUTelLCIOReadAhead;
+}
+
+void EUTelLCIOReadAhead::init() {
+  printParameters();
+}
+
+
+void EUTelLCIOReadAhead::readDataSource( int numEvents ) {
+
+  // numEvents is the MaxRecordNumber global parameter, counting run
+  // headers and events as when Marlin reads the input files itself
+  _maxRecords = numEvents;
+  _skipEvents = Global::parameters->getIntVal( "SkipNEvents" );
+  _nEvents    = 0;
+  _readError.clear();
+  _readWarning.clear();
+
+  if ( _readAheadDepth > 0 ) {
+#if defined(USE_PTHREAD) && defined(EUTEL_SIO_THREAD_SAFE)
+    Record noRecord = { NULL, NULL };
+    _queue.assign( _readAheadDepth, noRecord );
+    _nQueued = _producerSlot = _consumerSlot = 0;
+    _stop = false;
+    pthread_mutex_init( &_mutex, NULL );
+    pthread_cond_init( &_recordQueued, NULL );
+    pthread_cond_init( &_recordTaken, NULL );
+    // set before the thread starts: the listener asks for it
+    _background = true;
+    if ( pthread_create( &_thread, NULL, readerThread, this ) != 0 ) {
+      _background = false;
+      streamlog_out ( WARNING2 ) << "Unable to start the LCIO reader thread, the files are read in the processing thread" << endl;
+      pthread_cond_destroy( &_recordTaken );
+      pthread_cond_destroy( &_recordQueued );
+      pthread_mutex_destroy( &_mutex );
+    }
+#else
+    streamlog_out ( WARNING2 ) << "Reading ahead needs pthreads and LCIO v02-13, the files are read in the processing thread" << endl;
+#endif
+  }
+
+  if ( !_background ) {
+    readFiles();
+    return;
+  }
+
+#ifdef USE_PTHREAD
+  try {
+    for ( ;; ) {
+      Record record = nextRecord();
+      if ( record.runHeader ) {
+        auto_ptr< LCRunHeaderImpl > runHeader( record.runHeader );
+        passRunHeader( runHeader.get() );
+      } else if ( record.event ) {
+        auto_ptr< LCEventImpl > event( record.event );
+        passEvent( event.get() );
+      } else {
+        break;
+      }
+    }
+  } catch ( ... ) {
+    // e.g. a StopProcessingException: the helper thread must not outlive the processing
+    stopReader();
+    throw;
+  }
+  stopReader();
+
+  if ( !_readWarning.empty() ) streamlog_out ( WARNING2 ) << _readWarning << endl;
+  if ( !_readError.empty() ) {
+    streamlog_out ( ERROR5 ) << "Reading stopped after " << _nEvents << " events: " << _readError << endl;
+  }
+#endif
+}
+
+
+void EUTelLCIOReadAhead::readFiles() {
+
+  auto_ptr< LCReader > reader( LCFactory::getInstance()->createLCReader() );
+  StreamListener listener( this );
+  reader->registerLCRunListener( &listener );
+  reader->registerLCEventListener( &listener );
+  reader->open( _fileNames );
+  // skipped events are not passed on and not counted as records
+  if ( _skipEvents > 0 ) reader->skipNEvents( _skipEvents );
+  try {
+    if ( _maxRecords > 0 ) reader->readStream( _maxRecords );
+    else reader->readStream();
+  } catch ( ReadStopped& ) {
+    // the processing thread stopped reading
+  } catch ( EndOfDataException& e ) {
+    // fewer records than MaxRecordNumber
+    if ( _background ) _readWarning = e.what();
+    else streamlog_out ( WARNING2 ) << e.what() << endl;
+  }
+  reader->close();
+
+}
+
+
+void EUTelLCIOReadAhead::StreamListener::processRunHeader( LCRunHeader * run ) {
+  _reader->deliverRunHeader( run );
+}
+
+void EUTelLCIOReadAhead::StreamListener::processEvent( LCEvent * evt ) {
+  _reader->deliverEvent( evt );
+}
+
+
+void EUTelLCIOReadAhead::passRunHeader( LCRunHeader * run ) {
+  ProcessorMgr::instance()->modifyRunHeader( run );
+  ProcessorMgr::instance()->processRunHeader( run );
+}
+
+void EUTelLCIOReadAhead::passEvent( LCEvent * evt ) {
+  ++_nEvents;
+  if ( _nEvents % 1000 == 0 ) streamlog_out ( MESSAGE4 ) << "Reading event " << _nEvents << endl;
+  // the event modifiers run first, as when LCReader calls the ProcessorMgr
+  ProcessorMgr::instance()->modifyEvent( evt );
+  ProcessorMgr::instance()->processEvent( evt );
+}
+
+
+void EUTelLCIOReadAhead::deliverRunHeader( LCRunHeader * run ) {
+
+#ifdef USE_PTHREAD
+  if ( _background ) {
+    Record record;
+    record.runHeader = copyRunHeader( run );
+    record.event     = NULL;
+    if ( !queueRecord( record ) ) {
+      delete record.runHeader;
+      throw ReadStopped();
+    }
+    return;
+  }
+#endif
+  passRunHeader( run );
+
+}
+
+void EUTelLCIOReadAhead::deliverEvent( LCEvent * evt ) {
+
+#ifdef USE_PTHREAD
+  if ( _background ) {
+    Record record;
+    record.runHeader = NULL;
+    record.event     = takeEvent( evt );
+    if ( !queueRecord( record ) ) {
+      delete record.event;
+      throw ReadStopped();
+    }
+    return;
+  }
+#endif
+  passEvent( evt );
+
+}
+
+
+#ifdef USE_PTHREAD
+void * EUTelLCIOReadAhead::readerThread( void * processor ) {
+  EUTelLCIOReadAhead * reader = static_cast< EUTelLCIOReadAhead * >( processor );
+  try {
+    reader->readFiles();
+  } catch ( lcio::Exception& e ) {
+    reader->_readError = e.what();
+  } catch ( std::exception& e ) {
+    reader->_readError = e.what();
+  }
+  // the end of the input, dropped if the processing thread stopped reading
+  Record endOfInput = { NULL, NULL };
+  reader->queueRecord( endOfInput );
+  return NULL;
+}
+
+bool EUTelLCIOReadAhead::queueRecord( const Record & record ) {
+  pthread_mutex_lock( &_mutex );
+  while ( _nQueued == _queue.size() && !_stop ) pthread_cond_wait( &_recordTaken, &_mutex );
+  if ( _stop ) {
+    pthread_mutex_unlock( &_mutex );
+    return false;
+  }
+  _queue[_producerSlot] = record;
+  _producerSlot = ( _producerSlot + 1 ) % _queue.size();
+  ++_nQueued;
+  pthread_cond_signal( &_recordQueued );
+  pthread_mutex_unlock( &_mutex );
+  return true;
+}
+
+EUTelLCIOReadAhead::Record EUTelLCIOReadAhead::nextRecord() {
+  pthread_mutex_lock( &_mutex );
+  while ( _nQueued == 0 ) pthread_cond_wait( &_recordQueued, &_mutex );
+  const Record record = _queue[_consumerSlot];
+  _consumerSlot = ( _consumerSlot + 1 ) % _queue.size();
+  --_nQueued;
+  pthread_cond_signal( &_recordTaken );
+  pthread_mutex_unlock( &_mutex );
+  return record;
+}
+
+void EUTelLCIOReadAhead::stopReader() {
+  pthread_mutex_lock( &_mutex );
+  _stop = true;
+  pthread_cond_signal( &_recordTaken );
+  pthread_mutex_unlock( &_mutex );
+  pthread_join( _thread, NULL );
+
+  // records read ahead but not processed any more
+  for ( ; _nQueued > 0; --_nQueued ) {
+    delete _queue[_consumerSlot].runHeader;
+    delete _queue[_consumerSlot].event;
+    _consumerSlot = ( _consumerSlot + 1 ) % _queue.size();
+  }
+  pthread_cond_destroy( &_recordTaken );
+  pthread_cond_destroy( &_recordQueued );
+  pthread_mutex_destroy( &_mutex );
+  _background = false;
+}
+#endif
+
+
+void EUTelLCIOReadAhead::end() {
+  streamlog_out ( MESSAGE5 ) << "Read " << _nEvents << " events" << endl;
+}
@@ -369,97 +369,25 @@ void EUTelLineFit::processEvent (LCEvent * event) {
     // ++++++++++++ See Blobel Page 226 !!! +++++++++++++++++
     // ++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-    int counter;
-
-    float S1[2]   = {0,0};
-    float Sx[2]   = {0,0};
-    float Xbar[2] = {0,0};
-
-    float * Zbar_X = new float[_nPlanes];
-    float * Zbar_Y = new float[_nPlanes];
-    for (counter = 0; counter < _nPlanes; counter++){
-      Zbar_X[counter] = 0.;
-      Zbar_Y[counter] = 0.;
-    }
-
-    float Sy[2]     = {0,0};
-    float Ybar[2]   = {0,0};
-    float Sxybar[2] = {0,0};
-    float Sxxbar[2] = {0,0};
-    float A2[2]     = {0,0};
-    float Chiquare[2] = {0,0};
-    float angle[2] = {0,0};
-
-    // define S1
-    for( counter = 0; counter < _nPlanes; counter++ ){
-      S1[0] = S1[0] + 1/pow(_intrResolX[counter],2);
-      S1[1] = S1[1] + 1/pow(_intrResolY[counter],2);
-    }
-
-    // define Sx
-    for( counter = 0; counter < _nPlanes; counter++ ){
-      Sx[0] = Sx[0] + _zPos[counter]/pow(_intrResolX[counter],2);
-      Sx[1] = Sx[1] + _zPos[counter]/pow(_intrResolY[counter],2);
-    }
-
-    // define Xbar
-    Xbar[0]=Sx[0]/S1[0];
-    Xbar[1]=Sx[1]/S1[1];
-
-    // coordinate transformation !! -> bar
-    for( counter=0; counter < _nPlanes; counter++ ){
-      Zbar_X[counter] = _zPos[counter]-Xbar[0];
-      Zbar_Y[counter] = _zPos[counter]-Xbar[1];
-    }
-
-    // define Sy
-    for( counter = 0; counter < _nPlanes; counter++ ){
-      Sy[0] = Sy[0] + _xPos[counter]/pow(_intrResolX[counter],2);
-      Sy[1] = Sy[1] + _yPos[counter]/pow(_intrResolY[counter],2);
-    }
+    // Straight line fit, see EUTelStraightLineFitter
 
-    // define Ybar
-    Ybar[0]=Sy[0]/S1[0];
-    Ybar[1]=Sy[1]/S1[1];
-
-    // define Sxybar
-    for( counter = 0; counter < _nPlanes; counter++ ){
-      Sxybar[0] = Sxybar[0] + Zbar_X[counter] * _xPos[counter]/pow(_intrResolX[counter],2);
-      Sxybar[1] = Sxybar[1] + Zbar_Y[counter] * _yPos[counter]/pow(_intrResolY[counter],2);
-    }
+    int counter;
 
-    // define Sxxbar
+    _lineFitter.reset( _nPlanes, 1 );
     for( counter = 0; counter < _nPlanes; counter++ ){
-      Sxxbar[0] = Sxxbar[0] + Zbar_X[counter] * Zbar_X[counter]/pow(_intrResolX[counter],2);
-      Sxxbar[1] = Sxxbar[1] + Zbar_Y[counter] * Zbar_Y[counter]/pow(_intrResolX[counter],2);
+      _lineFitter.setPlaneResolution( counter, _intrResolX[counter], _intrResolY[counter] );
+      _lineFitter.setHit( 0, counter, _xPos[counter], _yPos[counter], _zPos[counter] );
     }
+    _lineFitter.fit();
 
-    // define A2
-
-    A2[0]=Sxybar[0]/Sxxbar[0];
-    A2[1]=Sxybar[1]/Sxxbar[1];
-
-    // Calculate chi sqaured
-    // Chi^2 for X and Y coordinate for hits in all planes
+    const float Chiquare[2] = { static_cast< float >( _lineFitter.getChi2X( 0 ) ), static_cast< float >( _lineFitter.getChi2Y( 0 ) ) };
+    const float angle[2] = { static_cast< float >( atan( _lineFitter.getSlopeX( 0 ) ) ), static_cast< float >( atan( _lineFitter.getSlopeY( 0 ) ) ) };
 
     for( counter = 0; counter < _nPlanes; counter++ ){
-      Chiquare[0] += pow(-_zPos[counter]*A2[0]
-                         +_xPos[counter]-Ybar[0]+Xbar[0]*A2[0],2)/pow(_intrResolX[counter],2);
-      Chiquare[1] += pow(-_zPos[counter]*A2[1]
-                         +_yPos[counter]-Ybar[1]+Xbar[1]*A2[1],2)/pow(_intrResolY[counter],2);
+      _waferResidX[counter] = _lineFitter.getResidualX( 0, counter );
+      _waferResidY[counter] = _lineFitter.getResidualY( 0, counter );
     }
 
-    for( counter = 0; counter < _nPlanes; counter++ ){
-      _waferResidX[counter] = (Ybar[0]-Xbar[0]*A2[0]+_zPos[counter]*A2[0])-_xPos[counter];
-      _waferResidY[counter] = (Ybar[1]-Xbar[1]*A2[1]+_zPos[counter]*A2[1])-_yPos[counter];
-    }
-
-    // define angle
-
-
-    angle[0] = atan(A2[0]);
-    angle[1] = atan(A2[1]);
-
 
     // Define output track and hit collections
     LCCollectionVec     * fittrackvec = new LCCollectionVec(LCIO::TRACK);
@@ -497,8 +425,8 @@ void EUTelLineFit::processEvent (LCEvent * event) {
 
     for( counter = 0; counter < _nPlanes; counter++ ){
 
-      _xFitPos[counter] = Ybar[0]-Xbar[0]*A2[0]+_zPos[counter]*A2[0];
-      _yFitPos[counter] = Ybar[1]-Xbar[1]*A2[1]+_zPos[counter]*A2[1];
+      _xFitPos[counter] = _lineFitter.getInterceptX( 0 ) + _lineFitter.getSlopeX( 0 ) * _zPos[counter];
+      _yFitPos[counter] = _lineFitter.getInterceptY( 0 ) + _lineFitter.getSlopeY( 0 ) * _zPos[counter];
 
       TrackerHitImpl * fitpoint = new TrackerHitImpl;
 
@@ -621,9 +549,6 @@ void EUTelLineFit::processEvent (LCEvent * event) {
 
 #endif
 
-    delete [] Zbar_X;
-    delete [] Zbar_Y;
-
 
   } catch (DataNotAvailableException& e) {
 
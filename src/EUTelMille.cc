@@ -83,6 +83,7 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <climits>
 #include <map>
 #include <memory>
 #include <cmath>
@@ -330,6 +331,8 @@ EUTelMille::EUTelMille () : Processor("EUTelMille") {
 
 void EUTelMille::init() {
 
+    _hotPixelMask = 0;
+
     // Getting access to geometry description
     std::string name("test.root");
     geo::gGeometry().initializeTGeoDescription(name,false);
@@ -527,6 +530,13 @@ void EUTelMille::init() {
   _nMilleDataPoints = 0;
   _nMilleTracks = 0;
 
+  _nTrackSearchEvents = 0;
+  _nTrackSearchCapReached = 0;
+  _trackSearchCapHit = false;
+  _trackSearchIndices.reserve( _nPlanes );
+  _trackSearchSortedX.resize( _nPlanes );
+  _trackSearchAccepted.resize( _nPlanes );
+
   _waferResidX = new double[_nPlanes];
   _waferResidY = new double[_nPlanes];
   _waferResidZ = new double[_nPlanes];
@@ -686,161 +696,141 @@ void EUTelMille::processRunHeader (LCRunHeader * rdr) {
 
 
 
-void EUTelMille::findtracks2(
-                            int missinghits,
+bool EUTelMille::passTrackSearchResidualCuts( int e, double residualX, double residualY ) const
+{
+  return !(
+           residualX < _residualsXMin[e] || residualX > _residualsXMax[e] ||
+           residualY < _residualsYMin[e] || residualY > _residualsYMax[e]
+          );
+}
+
+bool EUTelMille::findTrackCandidates(
                             std::vector<IntVec > &indexarray,
-                            IntVec vec,
-                            std::vector<std::vector<EUTelMille::HitsInPlane> > &_allHitsArray,
-                            unsigned int i,
-                            int y
+                            const std::vector<std::vector<EUTelMille::HitsInPlane> > &allHitsArray
                             )
 {
- if(y==-1) missinghits++;
- streamlog_out(DEBUG9) << "Missing hits:" << missinghits << std::endl;
-
- if( missinghits > getAllowedMissingHits() ) 
- {
-   // recursive chain is dropped here;
-   streamlog_out(DEBUG9) << "indexarray size:" << indexarray.size() << std::endl;
-   return;
- }
-
- if(i>0)
- { 
-    vec.push_back(y); // recall hit id from the plane (i-1)
- }
+  _trackSearchCapHit = false;
+  ++_nTrackSearchEvents;
 
+  if( allHitsArray.empty() || _maxTrackCandidates <= 0 ) return true;
 
- if( (_allHitsArray[i].size() == 0) && (i <_allHitsArray.size()-1) )
- {
-    findtracks2(missinghits,indexarray,vec, _allHitsArray, i+1, -1 ); 
- } 
-
- for(size_t j =0; j < _allHitsArray[i].size(); j++)
+  // the buffers keep their capacity from one event to the next
+  _trackSearchIndices.assign( allHitsArray.size(), -1 );
+  _trackSearchSortedX.resize( allHitsArray.size() );
+  _trackSearchAccepted.resize( allHitsArray.size() );
+  for(size_t i = 0; i < allHitsArray.size(); i++)
     {
-      int ihit = static_cast< int >(j);
-      streamlog_out(DEBUG5) << "ihit:" << ihit << std::endl;
-
-      //if we are not in the last plane, call this method again
-      if(i < _allHitsArray.size()-1)
+      std::vector< std::pair< double, int > > & sorted = _trackSearchSortedX[i];
+      sorted.clear();
+      for(size_t j = 0; j < allHitsArray[i].size(); j++)
         {
-          vec.push_back( ihit); //index of the cluster in the last plane
-         
-          //track candidate requirements
-          bool taketrack = true;
-          const int e = vec.size()-2;
-          if(e >= 0)
-            {
-              double residualX  = -999999.;
-              double residualY  = -999999.;
-              double residualZ  = -999999.;
+          sorted.push_back( std::make_pair( allHitsArray[i][j].measuredX, static_cast< int >(j) ) );
+        }
+      std::sort( sorted.begin(), sorted.end() );
+    }
 
-              // ACTIVE
-              // stop on the last non-zero hit
+  extendTrackCandidate( indexarray, allHitsArray, 0, 0 );
 
-              // now loop through all hits on a track candidate "vec"
-              // start at the end, stop on the first non-zero hit
-              for(int ivec=e; ivec>=e; --ivec)                  //     <-> OFF
-              {
-                if(vec[ivec]>=0) // non zero hit has id vec[ivec]>=0 {otherwise -1}
-                {
-                  double x = _allHitsArray[ivec][vec[ivec]].measuredX;
-                  double y = _allHitsArray[ivec][vec[ivec]].measuredY;
-                  double z = _allHitsArray[ivec][vec[ivec]].measuredZ;
-                  residualX  = abs(x - _allHitsArray[e+1][vec[e+1]].measuredX);
-                  residualY  = abs(y - _allHitsArray[e+1][vec[e+1]].measuredY);
-                  residualZ  = abs(z - _allHitsArray[e+1][vec[e+1]].measuredZ);
-		  streamlog_out(DEBUG9) << "residuals:" << std::endl;
-		  streamlog_out(DEBUG9) << residualX << std::endl;
-		  streamlog_out(DEBUG9) << residualY << std::endl;
-		  streamlog_out(DEBUG9) << residualZ << std::endl;
-
-                  break; 
-                }   
-              }
-           
-             if ( 
-                   residualX < _residualsXMin[e] || residualX > _residualsXMax[e] ||
-                   residualY < _residualsYMin[e] || residualY > _residualsYMax[e] 
-                 )
-                 taketrack = false;
+  if( _trackSearchCapHit )
+    {
+      ++_nTrackSearchCapReached;
+      streamlog_out( DEBUG5 ) << "Track search stopped at MaxTrackCandidates = " << _maxTrackCandidates
+                              << " in event " << _iEvt << std::endl;
+    }
+  return !_trackSearchCapHit;
+}
 
-              if( taketrack == false )
-              {
-                taketrack = true; 
-                ihit=-1;
-              } 
-            }
-          vec.pop_back(); 
+void EUTelMille::extendTrackCandidate(
+                            std::vector<IntVec > &indexarray,
+                            const std::vector<std::vector<EUTelMille::HitsInPlane> > &allHitsArray,
+                            unsigned int plane,
+                            int missinghits
+                            )
+{
+  if( _trackSearchCapHit ) return;
 
-          if(taketrack)
-          { 
-              findtracks2(missinghits, indexarray, vec, _allHitsArray, i+1, ihit );
-          }
+  const std::vector<EUTelMille::HitsInPlane> & hits = allHitsArray[plane];
+  const bool lastPlane = ( plane + 1 == allHitsArray.size() );
+
+  if( lastPlane )
+    {
+      // the last plane is not subject to the residual cuts and an
+      // empty last plane does not count as a missing hit
+      if( hits.empty() )
+        {
+          _trackSearchIndices[plane] = -1;
+          indexarray.push_back( _trackSearchIndices );
         }
-      else
+      for(size_t j = 0; j < hits.size(); j++)
         {
-          //we are in the last plane
-          vec.push_back( ihit ); //index of the cluster in the last plane
+          if( static_cast< int >(indexarray.size()) >= _maxTrackCandidates ) break;
+          _trackSearchIndices[plane] = static_cast< int >(j);
+          indexarray.push_back( _trackSearchIndices );
+        }
+      _trackSearchCapHit = ( static_cast< int >(indexarray.size()) >= _maxTrackCandidates );
+      return;
+    }
 
-          //track candidate requirements
-          bool taketrack = true;
-          const int e = vec.size()-2;
-          if(e >= 0)
-            {
-              double residualX  = -999999.;
-              double residualY  = -999999.;
-              //double residualZ  = -999999.;
+  // hits continuing the candidate, in increasing hit index
+  IntVec & accepted = _trackSearchAccepted[plane];
+  accepted.clear();
 
-              // now loop through all hits on a track candidate "vec"
-              // start at the end, stop on the first non-zero hit
-              for(int ivec=e; ivec>=e; --ivec)                        //   <-> OFF
-              {
-                if(vec[ivec]>=0) // non zero hit has id vec[ivec]>=0 {otherwise -1}
-                {
-                  double x = _allHitsArray[ivec][vec[ivec]].measuredX;
-                  double y = _allHitsArray[ivec][vec[ivec]].measuredY;
-                  //double z = _allHitsArray[ivec][vec[ivec]].measuredZ;
-                  residualX  = abs(x - _allHitsArray[e+1][vec[e+1]].measuredX);
-                  residualY  = abs(y - _allHitsArray[e+1][vec[e+1]].measuredY);
-                  //residualZ  = abs(z - _allHitsArray[e+1][vec[e+1]].measuredZ);
-                  break; 
-                }   
-              }
-           
-              if ( 
-                   residualX < _residualsXMin[e] || residualX > _residualsXMax[e] ||
-                   residualY < _residualsYMin[e] || residualY > _residualsYMax[e] 
-                 )
-                 taketrack = false;
- 
-              if( taketrack == false )
-              {
-                taketrack = true; 
-                ihit=-1;
-              } 
-            }
+  if( plane == 0 )
+    {
+      for(size_t j = 0; j < hits.size(); j++) accepted.push_back( static_cast< int >(j) );
+    }
+  else if( _trackSearchIndices[plane - 1] < 0 )
+    {
+      // no reference hit on the previous plane: the hit was compared
+      // against the -999999 placeholder, which the cuts normally reject
+      if( passTrackSearchResidualCuts( plane - 1, -999999., -999999. ) )
+        {
+          for(size_t j = 0; j < hits.size(); j++) accepted.push_back( static_cast< int >(j) );
+        }
+    }
+  else
+    {
+      const EUTelMille::HitsInPlane & previous = allHitsArray[plane - 1][_trackSearchIndices[plane - 1]];
+      // widened by a few ulps so that rounding of x +- road cannot drop
+      // a hit exactly on the cut, which is applied below
+      const double road = _residualsXMax[plane - 1] + 1e-9 * ( abs( previous.measuredX ) + _residualsXMax[plane - 1] );
 
-          if(static_cast< int >(indexarray.size()) >= _maxTrackCandidates)
-            taketrack = false;
- 
-          if(taketrack)
-            {
-               indexarray.push_back(vec);
-	       streamlog_out(DEBUG9) << "indexarray size at last plane:" << indexarray.size() << std::endl;
-            }
-          vec.pop_back(); //last element must be removed because the
-                          //vector is still used -> we are in a last plane hit loop!
+      const std::vector< std::pair< double, int > > & sorted = _trackSearchSortedX[plane];
+      std::vector< std::pair< double, int > >::const_iterator begin =
+        std::lower_bound( sorted.begin(), sorted.end(), std::make_pair( previous.measuredX - road, INT_MIN ) );
 
+      for( std::vector< std::pair< double, int > >::const_iterator it = begin;
+           it != sorted.end() && it->first <= previous.measuredX + road; ++it )
+        {
+          const EUTelMille::HitsInPlane & candidate = hits[it->second];
+          const double residualX = abs( previous.measuredX - candidate.measuredX );
+          const double residualY = abs( previous.measuredY - candidate.measuredY );
+          if( passTrackSearchResidualCuts( plane - 1, residualX, residualY ) ) accepted.push_back( it->second );
         }
+      // the candidates come out in the order of the hit indices, as
+      // they did with the recursive search over all hits
+      std::sort( accepted.begin(), accepted.end() );
     }
 
-  if( (_allHitsArray[i].size() == 0) && (i >= _allHitsArray.size()-1) )
-  {
-               indexarray.push_back(vec);
-  } 
-}
+  // an empty plane or any hit outside the road continues the candidate
+  // with a missing hit on this plane, at the place of the first
+  // rejected hit: the first hit index missing from the accepted ones
+  size_t firstRejected = 0;
+  while( firstRejected < accepted.size() && accepted[firstRejected] == static_cast< int >(firstRejected) ) ++firstRejected;
+  const bool withMissingHit = ( hits.empty() || accepted.size() < hits.size() ) && missinghits + 1 <= getAllowedMissingHits();
 
+  for(size_t k = 0; k <= accepted.size(); k++)
+    {
+      if( k == firstRejected && withMissingHit )
+        {
+          _trackSearchIndices[plane] = -1;
+          extendTrackCandidate( indexarray, allHitsArray, plane + 1, missinghits + 1 );
+        }
+      if( k == accepted.size() ) break;
+      _trackSearchIndices[plane] = accepted[k];
+      extendTrackCandidate( indexarray, allHitsArray, plane + 1, missinghits );
+    }
+}
 
 
 void EUTelMille::findtracks(
@@ -939,195 +929,47 @@ void EUTelMille::findtracks(
 void EUTelMille::FitTrack(unsigned int nPlanesFitter, double xPosFitter[], double yPosFitter[], double zPosFitter[], double xResFitter[], double yResFitter[], double chi2Fit[2], double residXFit[], 
 double residYFit[], double angleFit[2]) {
 
-  int sizearray;
-
-  if (_nExcludePlanes > 0) {
-    sizearray = nPlanesFitter - _nExcludePlanes;
-  } else {
-    sizearray = nPlanesFitter;
-  }
-
-  double * xPosFit = new double[sizearray];
-  double * yPosFit = new double[sizearray];
-  double * zPosFit = new double[sizearray];
-  double * xResFit = new double[sizearray];
-  double * yResFit = new double[sizearray];
-
-  int nPlanesFit = 0;
-
+  setupLineFitter(nPlanesFitter, 1, xResFitter, yResFitter);
   for (unsigned int help = 0; help < nPlanesFitter; help++) {
-
-    int excluded = 0;
-
-    // check if actual plane is excluded
-    if (_nExcludePlanes > 0) {
-      for (int helphelp = 0; helphelp < _nExcludePlanes; helphelp++) {
-        if (help == _excludePlanes[helphelp]) {
-          excluded = 1;
-        }
-      }
-    }
-
-    if (excluded == 1) {
-      // do noting
-    } else {
-      xPosFit[nPlanesFit] = xPosFitter[help];
-      yPosFit[nPlanesFit] = yPosFitter[help];
-      zPosFit[nPlanesFit] = zPosFitter[help];
-      xResFit[nPlanesFit] = xResFitter[help];
-      yResFit[nPlanesFit] = yResFitter[help];
-      nPlanesFit++;
-    }
-  }
-
-  int counter;
-
-  float S1[2]   = {0,0};
-  float Sx[2]   = {0,0};
-  float Xbar[2] = {0,0};
-
-  float * Zbar_X = new float[nPlanesFit];
-  float * Zbar_Y = new float[nPlanesFit];
-  for (counter = 0; counter < nPlanesFit; counter++){
-    Zbar_X[counter] = 0.;
-    Zbar_Y[counter] = 0.;
-  }
-
-  float Sy[2]     = {0,0};
-  float Ybar[2]   = {0,0};
-  float Sxybar[2] = {0,0};
-  float Sxxbar[2] = {0,0};
-  float A2[2]     = {0,0};
-
-  // define S1
-  for( counter = 0; counter < nPlanesFit; counter++ ){
-    S1[0] = S1[0] + 1/pow(xResFit[counter],2);
-    S1[1] = S1[1] + 1/pow(yResFit[counter],2);
+    _lineFitter.setHit(0, help, xPosFitter[help], yPosFitter[help], zPosFitter[help]);
   }
+  _lineFitter.fit();
+  getLineFitResult(0, chi2Fit, residXFit, residYFit, angleFit);
 
-  // define Sx
-  for( counter = 0; counter < nPlanesFit; counter++ ){
-    Sx[0] = Sx[0] + zPosFit[counter]/pow(xResFit[counter],2);
-    Sx[1] = Sx[1] + zPosFit[counter]/pow(yResFit[counter],2);
-  }
+}
 
-  // define Xbar
-  Xbar[0]=Sx[0]/S1[0];
-  Xbar[1]=Sx[1]/S1[1];
+void EUTelMille::setupLineFitter(unsigned int nPlanesFitter, int nTracksFitter, const double xResFitter[], const double yResFitter[]) {
 
-  // coordinate transformation !! -> bar
-  for( counter = 0; counter < nPlanesFit; counter++ ){
-    Zbar_X[counter] = zPosFit[counter]-Xbar[0];
-    Zbar_Y[counter] = zPosFit[counter]-Xbar[1];
+  _lineFitter.reset(nPlanesFitter, nTracksFitter);
+  for (unsigned int help = 0; help < nPlanesFitter; help++) {
+    _lineFitter.setPlaneResolution(help, xResFitter[help], yResFitter[help]);
   }
-
-  // define Sy
-  for( counter = 0; counter < nPlanesFit; counter++ ){
-    Sy[0] = Sy[0] + xPosFit[counter]/pow(xResFit[counter],2);
-    Sy[1] = Sy[1] + yPosFit[counter]/pow(yResFit[counter],2);
+  for (int helphelp = 0; helphelp < _nExcludePlanes; helphelp++) {
+    if (_excludePlanes[helphelp] < nPlanesFitter) _lineFitter.excludePlane(_excludePlanes[helphelp]);
   }
 
-  // define Ybar
-  Ybar[0]=Sy[0]/S1[0];
-  Ybar[1]=Sy[1]/S1[1];
-
-  // define Sxybar
-  for( counter = 0; counter < nPlanesFit; counter++ ){
-    Sxybar[0] = Sxybar[0] + Zbar_X[counter] * xPosFit[counter]/pow(xResFit[counter],2);
-    Sxybar[1] = Sxybar[1] + Zbar_Y[counter] * yPosFit[counter]/pow(yResFit[counter],2);
-  }
+}
 
-  // define Sxxbar
-  for( counter = 0; counter < nPlanesFit; counter++ ){
-    Sxxbar[0] = Sxxbar[0] + Zbar_X[counter] * Zbar_X[counter]/pow(xResFit[counter],2);
-    Sxxbar[1] = Sxxbar[1] + Zbar_Y[counter] * Zbar_Y[counter]/pow(yResFit[counter],2);
-  }
+void EUTelMille::getLineFitResult(int track, double chi2Fit[2], double residXFit[], double residYFit[], double angleFit[2]) const {
 
-  // define A2
-  A2[0]=Sxybar[0]/Sxxbar[0];
-  A2[1]=Sxybar[1]/Sxxbar[1];
-
-  // Calculate chi sqaured
-  // Chi^2 for X and Y coordinate for hits in all planes
-  for( counter = 0; counter < nPlanesFit; counter++ ){
-    chi2Fit[0] += pow(-zPosFit[counter]*A2[0]
-                      +xPosFit[counter]-Ybar[0]+Xbar[0]*A2[0],2)/pow(xResFit[counter],2);
-    chi2Fit[1] += pow(-zPosFit[counter]*A2[1]
-                      +yPosFit[counter]-Ybar[1]+Xbar[1]*A2[1],2)/pow(yResFit[counter],2);
-  }
+  chi2Fit[0] += _lineFitter.getChi2X(track);
+  chi2Fit[1] += _lineFitter.getChi2Y(track);
 
-  for( counter = 0; counter < static_cast< int >(nPlanesFitter); counter++ ) {
-    residXFit[counter] = (Ybar[0]-Xbar[0]*A2[0]+zPosFitter[counter]*A2[0])-xPosFitter[counter];
-    residYFit[counter] = (Ybar[1]-Xbar[1]*A2[1]+zPosFitter[counter]*A2[1])-yPosFitter[counter];
+  for (int help = 0; help < _lineFitter.getNumberOfPlanes(); help++) {
+    residXFit[help] = _lineFitter.getResidualX(track, help);
+    residYFit[help] = _lineFitter.getResidualY(track, help);
   }
 
-  // define angle
-  angleFit[0] = atan(A2[0]);
-  angleFit[1] = atan(A2[1]);
-
-  // clean up
-  delete [] zPosFit;
-  delete [] yPosFit;
-  delete [] xPosFit;
-  delete [] yResFit;
-  delete [] xResFit;
-
-  delete [] Zbar_X;
-  delete [] Zbar_Y;
+  angleFit[0] = atan(_lineFitter.getSlopeX(track));
+  angleFit[1] = atan(_lineFitter.getSlopeY(track));
 
 }
 
 void  EUTelMille::FillHotPixelMap(LCEvent *event)
 {
-    LCCollectionVec *hotPixelCollectionVec = 0;
-    try 
-    {
-      hotPixelCollectionVec = static_cast< LCCollectionVec* > ( event->getCollection( _hotPixelCollectionName  ) );
-    }
-    catch (...)
-    {
-      if (!_hotPixelCollectionName.empty())
-	streamlog_out ( WARNING ) << "_hotPixelCollectionName " << _hotPixelCollectionName.c_str() << " not found" << endl; 
-      return;
-    }
-
-        CellIDDecoder<TrackerDataImpl> cellDecoder( hotPixelCollectionVec );
-	
-        for(int i=0; i<  hotPixelCollectionVec->getNumberOfElements(); i++)
-        {
-           TrackerDataImpl* hotPixelData = dynamic_cast< TrackerDataImpl *> ( hotPixelCollectionVec->getElementAt( i ) );
-	   SparsePixelType  type         = static_cast<SparsePixelType> (static_cast<int> (cellDecoder( hotPixelData )["sparsePixelType"]));
-
-	   int sensorID              = static_cast<int > ( cellDecoder( hotPixelData )["sensorID"] );
-
-           if( type  ==  kEUTelGenericSparsePixel )
-           {  
-              auto_ptr<EUTelSparseClusterImpl< EUTelGenericSparsePixel > > m26Data( new EUTelSparseClusterImpl< EUTelGenericSparsePixel >   ( hotPixelData ) );
-
-              std::vector<EUTelGenericSparsePixel*> m26PixelVec;
-	      EUTelGenericSparsePixel m26Pixel;
-  	      //Push all single Pixels of one plane in the m26PixelVec
-
-             for ( unsigned int iPixel = 0; iPixel < m26Data->size(); iPixel++ ) 
-             {
-              IntVec m26ColVec();
-              m26Data->getSparsePixelAt( iPixel, &m26Pixel);
-              streamlog_out ( DEBUG3 ) << iPixel << " of " << m26Data->size() << " HotPixelInfo:  " << m26Pixel.getXCoord() << " " << m26Pixel.getYCoord() << " " << m26Pixel.getSignal() << endl;
-              try
-              {
-                 char ix[100];
-                 sprintf(ix, "%d,%d,%d", sensorID, m26Pixel.getXCoord(), m26Pixel.getYCoord() ); 
-                 _hotPixelMap[ix] = true;             
-              }
-              catch(...)
-              {
-                 std::cout << "can not add pixel " << std::endl;
-                 std::cout << sensorID << " " << m26Pixel.getXCoord() << " " << m26Pixel.getYCoord() << " " << std::endl;   
-              }
-             }
-           }
-       }
-
+  // the mask is shared with the other processors and only loaded once per run
+  _hotPixelMask = &EUTelHotPixelMask::getInstance( _hotPixelCollectionName );
+  _hotPixelMask->update( event );
 }
 
 void  EUTelMille::findMatchedHits(int& _ntrack, Track* TrackHere) {
@@ -1213,10 +1055,7 @@ void  EUTelMille::findMatchedHits(int& _ntrack, Track* TrackHere) {
 
 void EUTelMille::processEvent (LCEvent * event) {
 
-  if ( isFirstEvent() )
-  {
-    FillHotPixelMap(event);
-  }
+  FillHotPixelMap(event);
 
   CellIDDecoder<TrackerHit>  hitDecoder(EUTELESCOPE::HITENCODING);
 
@@ -1366,7 +1205,7 @@ void EUTelMille::processEvent (LCEvent * event) {
     std::vector<IntVec > indexarray;
 
     streamlog_out( DEBUG5 ) << "Event #" << _iEvt << std::endl;
-    findtracks2(0, indexarray, IntVec(), _allHitsArray, 0, 0);
+    findTrackCandidates(indexarray, _allHitsArray);
     for(size_t i = 0; i < indexarray.size(); i++)
       {
         for(size_t j = 0; j <  _nPlanes; j++)
@@ -1554,6 +1393,17 @@ void EUTelMille::processEvent (LCEvent * event) {
     double Chiquare[2] = {0,0};
     double angle[2] = {0,0};
 
+    // straight line fit of all track candidates at once
+    if (_alignMode != 3 && _nTracks > 0) {
+      setupLineFitter(_nPlanes, _nTracks, _telescopeResolX, _telescopeResolY);
+      for (int track = 0; track < _nTracks; track++) {
+        for (unsigned int help = 0; help < _nPlanes; help++) {
+          _lineFitter.setHit(track, help, _xPos[track][help], _yPos[track][help], _zPos[track][help]);
+        }
+      }
+      _lineFitter.fit();
+    }
+
     // loop over all track candidates
     for (int track = 0; track < _nTracks; track++) {
 
@@ -1849,17 +1699,8 @@ void EUTelMille::processEvent (LCEvent * event) {
       else
         {
           streamlog_out(MESSAGE1) << " AlignMode = " << _alignMode << " _inputMode = " << _inputMode << std::endl;
-          // Calculate residuals
-          FitTrack(_nPlanes,
-                   _xPosHere,
-                   _yPosHere,
-                   _zPosHere,
-                   _telescopeResolX,
-                   _telescopeResolY,
-                   Chiquare,
-                   _waferResidX,
-                   _waferResidY,
-                   angle);
+          // Residuals from the fit of all candidates above
+          getLineFitResult(track, Chiquare, _waferResidX, _waferResidY, angle);
         }
 
       }
@@ -2480,85 +2321,23 @@ TVector3 EUTelMille::Line2Plane(int iplane, const TVector3& lpoint, const TVecto
       
 bool EUTelMille::hitContainsHotPixels( TrackerHitImpl   * hit) 
 {
-  bool skipHit = false;
-
-  try
-    {
-      try{
-	LCObjectVec clusterVector = hit->getRawHits();
-
-	if ( hit->getType() == kEUTelSparseClusterImpl ) 
-	  {
-      
-	    TrackerDataImpl * clusterFrame = dynamic_cast<TrackerDataImpl*> ( clusterVector[0] );
-	    if (clusterFrame == 0){
-	      // found invalid result from cast
-	      throw UnknownDataTypeException("Invalid hit found in method hitContainsHotPixels()");
-	    }
-		
-	    eutelescope::EUTelSparseClusterImpl< eutelescope::EUTelGenericSparsePixel > *cluster = new eutelescope::EUTelSparseClusterImpl< eutelescope::EUTelGenericSparsePixel >(clusterFrame);
-	    int sensorID = cluster->getDetectorID();
- 
-	    for ( unsigned int iPixel = 0; iPixel < cluster->size(); iPixel++ ) 
-              {
-                EUTelGenericSparsePixel m26Pixel;
-                cluster->getSparsePixelAt( iPixel, &m26Pixel);
-                int pixelX, pixelY;
-                pixelX = m26Pixel.getXCoord();
-                pixelY = m26Pixel.getYCoord();
-
-		{                       
-		    char ix[100];
-		    sprintf(ix, "%d,%d,%d", sensorID, pixelX, pixelY ); 
-		    std::map<std::string, bool >::const_iterator z = _hotPixelMap.find(ix);
-		    if(z!=_hotPixelMap.end() && _hotPixelMap[ix] == true  )
-		      { 
-			skipHit = true;
-			streamlog_out(DEBUG3) << "Skipping hit as it was found in the hot pixel map." << endl;
-			return true; // if TRUE  this hit will be skipped
-		      }
-		    else
-		      { 
-			skipHit = false; 	      
-		      } 
-		} 
-	      }
-
-	  } else if ( hit->getType() == kEUTelBrickedClusterImpl ) {
-
-	  // fixed cluster implementation. Remember it
-	  //  can come from
-	  //  both RAW and ZS data
-                   
-	} else if ( hit->getType() == kEUTelDFFClusterImpl ) {
-              
-	  // fixed cluster implementation. Remember it can come from
-	  // both RAW and ZS data
-	} else if ( hit->getType() == kEUTelFFClusterImpl ) {
-              
-	  // fixed cluster implementation. Remember it can come from
-	  // both RAW and ZS data
-	} 
-      }
-      catch(lcio::Exception e){
-	// catch specific exceptions
-          streamlog_out ( ERROR5 ) << "Exception occured in hitContainsHotPixels(): " << e.what() << endl;
-      }
-    }
-  catch(...)
-    { 
-      // if anything went wrong in the above return FALSE, meaning do not skip this hit
-      return 0;
-    }
-
-  // if none of the above worked return FALSE, meaning do not skip this hit
-  return 0;
-
+  // if TRUE  this hit will be skipped
+  return _hotPixelMask != 0 && _hotPixelMask->hitTouchesMask( hit );
 }
 
 
 void EUTelMille::end() {
 
+  if ( _nTrackSearchEvents > 0 ) {
+    streamlog_out ( MESSAGE4 ) << "Track candidate search: " << _nTrackSearchEvents << " events searched, "
+                               << _nTrackSearchCapReached << " stopped at MaxTrackCandidates = " << _maxTrackCandidates << endl;
+    if ( _nTrackSearchCapReached > 0 ) {
+      streamlog_out ( WARNING2 ) << "The track candidate cap was reached in "
+                                 << 100.0 * _nTrackSearchCapReached / _nTrackSearchEvents
+                                 << "% of the events: consider tighter ResidualsXMin/Max, ResidualsYMin/Max cuts" << endl;
+    }
+  }
+
   delete [] _telescopeResolY;
   delete [] _telescopeResolX;
   delete [] _telescopeResolZ;
@@ -14,6 +14,7 @@
 #include "EUTelEventImpl.h"
 #include "EUTelRunHeaderImpl.h"
 #include "EUTELESCOPE.h"
+#include "EUTelEventTransfer.h"
 
 // marlin includes ".h"
 #include "marlin/LCIOOutputProcessor.h"
@@ -21,16 +22,43 @@
 // lcio includes <.h>
 #include <UTIL/LCTOOLS.h>
 #include <UTIL/LCTime.h>
+#include <Exceptions.h>
 
 // system includes <>
 #include <memory>
+#include <sstream>
+#include <iomanip>
+#include <set>
+#include <utility>
 
 using namespace std;
 using namespace marlin;
 using namespace eutelescope;
 
- 
-EUTelOutputProcessor::EUTelOutputProcessor() : LCIOOutputProcessor("EUTelOutputProcessor")  {
+EUTelOutputProcessor::EUTelOutputProcessor() : LCIOOutputProcessor("EUTelOutputProcessor"),
+  _eventType(kUNKNOWN),
+  _skipIntermediateEORESwitch(true),
+  _writerQueueDepth(0),
+  _splitEventCount(0),
+  _nEventInFile(0),
+  _nFile(0),
+  _lastWrittenType(kUNKNOWN),
+  _lastRunHeader(NULL),
+  _nWriteErrors(0),
+  _background(false),
+  _queue(),
+  _writerReports()
+#ifdef USE_PTHREAD
+  ,_thread(),
+  _mutex(),
+  _recordQueued(),
+  _recordWritten(),
+  _nQueued(0),
+  _producerSlot(0),
+  _consumerSlot(0),
+  _stop(false)
+#endif
+{
     
   _description = "Writes the current event to the specified LCIO outputfile."
     " Eventually it adds a EORE at the of the file if it was missing"
@@ -82,6 +110,13 @@ EUTelOutputProcessor::EUTelOutputProcessor() : LCIOOutputProcessor("EUTelOutputP
 			     "Set it to true to remove intermediate EORE in merged runs",
 			     _skipIntermediateEORESwitch, static_cast< bool > ( true ) );
 
+  registerOptionalParameter("WriterQueueDepth",
+			    "Number of events buffered for a background writer thread, 0 to write in the processing thread",
+			    _writerQueueDepth, static_cast< int > ( 0 ) );
+
+  registerOptionalParameter("SplitEventCount",
+			    "Maximum number of events per output file, 0 not to split the output",
+			    _splitEventCount, static_cast< int > ( 0 ) );
 
 }
 
@@ -91,16 +126,50 @@ void EUTelOutputProcessor::init() {
   // LCIOOutputProcessor
   LCIOOutputProcessor::init();
 
-}
-
+  _nEventInFile    = 0;
+  _nFile           = 0;
+  _lastWrittenType = kUNKNOWN;
+  _nWriteErrors    = 0;
+  _background      = false;
+
+  if ( _writerQueueDepth <= 0 ) return;
+#if defined(USE_PTHREAD) && defined(EUTEL_SIO_THREAD_SAFE)
+  _queue.resize( _writerQueueDepth );
+  _nQueued = _producerSlot = _consumerSlot = 0;
+  _stop = false;
+  pthread_mutex_init( &_mutex, NULL );
+  pthread_cond_init( &_recordQueued, NULL );
+  pthread_cond_init( &_recordWritten, NULL );
+  if ( pthread_create( &_thread, NULL, writerThread, this ) == 0 ) {
+    _background = true;
+  } else {
+    message<WARNING> ( "Unable to start the LCIO writer thread, events are written in the processing thread" );
+    pthread_cond_destroy( &_recordWritten );
+    pthread_cond_destroy( &_recordQueued );
+    pthread_mutex_destroy( &_mutex );
+  }
+#else
+  message<WARNING> ( "Background LCIO writing needs pthreads and LCIO v02-13, events are written in the processing thread" );
+#endif
 
+}
 
 void EUTelOutputProcessor::processRunHeader( LCRunHeader* run) { 
 
   auto_ptr<EUTelRunHeaderImpl> runHeader ( new EUTelRunHeaderImpl( run ) ) ;
   runHeader->addProcessor( type() );
 
-  LCIOOutputProcessor::processRunHeader(run);
+  logWriterReports();
+  if ( !_background ) {
+    writeRunHeader( run );
+    return;
+  }
+#ifdef USE_PTHREAD
+  Record record;
+  record.runHeader = copyRunHeader( run );
+  record.event     = NULL;
+  queueRecord( record );
+#endif
 
 } 
 
@@ -118,34 +187,222 @@ void EUTelOutputProcessor::processEvent( LCEvent * evt ) {
     return ;
   }
 
-  LCIOOutputProcessor::processEvent(evt);
   _eventType = eutelEvt->getEventType();
+  logWriterReports();
+  if ( !_background ) {
+    writeEvent( evt );
+    return;
+  }
+#ifdef USE_PTHREAD
+  // the collections the event does not own may change as soon as
+  // this event is done, so they are copied. The ones that are not
+  // written anyway are left out
+  set< string > skipNames( _dropCollectionNames.begin(), _dropCollectionNames.end() );
+  const StringVec * names = evt->getCollectionNames();
+  for ( size_t i = 0; i < names->size(); ++i ) {
+    if ( evt->getCollection( ( *names )[i] )->isTransient() ) skipNames.insert( ( *names )[i] );
+  }
+
+  Record record;
+  record.runHeader = NULL;
+  record.event     = takeEventCopy( evt, skipNames );
+  if ( record.event == NULL ) {
+    // a collection that cannot be copied: write it before it changes
+    waitForWriter();
+    logWriterReports();
+    writeEvent( evt );
+    return;
+  }
+  queueRecord( record );
+#endif
 
 }
 
-void EUTelOutputProcessor::end(){ 
+void EUTelOutputProcessor::writeRunHeader( LCRunHeader * run ) {
 
-  if ( _eventType != kEORE ) {
+  LCIOOutputProcessor::processRunHeader( run );
+  if ( _splitEventCount > 0 ) {
+    delete _lastRunHeader;
+    _lastRunHeader = copyRunHeader( run );
+  }
 
-    message<WARNING> ( "Adding a EORE because was missing" );
+}
+
+void EUTelOutputProcessor::writeEvent( LCEvent * evt ) {
+
+  const EventType type = static_cast< EUTelEventImpl * >( evt )->getEventType();
+  if ( _splitEventCount > 0 && _nEventInFile >= _splitEventCount && type != kEORE ) openNextFile();
 
-    EUTelEventImpl * event = new EUTelEventImpl;
-    event->setDetectorName("kEORE fix by EUTelOutputProcessor");
-    event->setEventType(kEORE);
-    event->setEventNumber( _nEvt + 1 );
+  LCIOOutputProcessor::processEvent( evt );
+  ++_nEventInFile;
+  _lastWrittenType = type;
+
+}
+
+void EUTelOutputProcessor::writeEORE() {
+
+  EUTelEventImpl * event = new EUTelEventImpl;
+  event->setDetectorName("kEORE fix by EUTelOutputProcessor");
+  event->setEventType(kEORE);
+  event->setEventNumber( _nEvt + 1 );
     
-    LCTime * now = new LCTime;
-    event->setTimeStamp(now->timeStamp());
-    delete now;
+  LCTime * now = new LCTime;
+  event->setTimeStamp(now->timeStamp());
+  delete now;
+
+  _lcWrt->writeEvent( static_cast<LCEventImpl*> (event) );
+  delete event;
+
+}
+
+void EUTelOutputProcessor::openNextFile() {
 
-    _lcWrt->writeEvent( static_cast<LCEventImpl*> (event) );
-    delete event;
+  if ( _lastWrittenType != kEORE ) writeEORE();
+  _lcWrt->close();
 
+  ++_nFile;
+  string fileName = _lcioOutputFile;
+  const string extension( ".slcio" );
+  if ( fileName.size() >= extension.size() && fileName.compare( fileName.size() - extension.size(), extension.size(), extension ) == 0 ) {
+    fileName.erase( fileName.size() - extension.size() );
   }
+  stringstream name;
+  name << fileName << "_" << setw( 3 ) << setfill( '0' ) << _nFile << extension;
 
-  message<MESSAGE5> ( log() << "Writing the output file " << _lcioOutputFile );
-  _lcWrt->close() ;
+  report( false, "Continuing the output in " + name.str() );
+  _lcWrt->open( name.str(), LCIO::WRITE_NEW );
+  if ( _lastRunHeader ) _lcWrt->writeRunHeader( _lastRunHeader );
+  _nEventInFile    = 0;
+  _lastWrittenType = kUNKNOWN;
+
+}
+
+void EUTelOutputProcessor::writeRecord( Record & record ) {
+
+  try {
+    if ( record.runHeader ) writeRunHeader( record.runHeader );
+    if ( record.event ) writeEvent( record.event );
+  } catch ( lcio::Exception & e ) {
+    // the writer thread has nobody to pass the exception to
+    report( true, "Unable to write to " + _lcioOutputFile + ": " + e.what() );
+    ++_nWriteErrors;
+  }
+  delete record.runHeader;
+  delete record.event;
+  record.runHeader = NULL;
+  record.event     = NULL;
 
 }
 
+void EUTelOutputProcessor::report( bool isError, const std::string & text ) {
 
+#ifdef USE_PTHREAD
+  // the log stream is not thread safe, the writer thread leaves the
+  // text to the processing thread
+  if ( _background && pthread_equal( pthread_self(), _thread ) ) {
+    pthread_mutex_lock( &_mutex );
+    _writerReports.push_back( make_pair( isError, text ) );
+    pthread_mutex_unlock( &_mutex );
+    return;
+  }
+#endif
+  if ( isError ) streamlog_out ( ERROR5 ) << text << endl;
+  else streamlog_out ( MESSAGE5 ) << text << endl;
+
+}
+
+void EUTelOutputProcessor::logWriterReports() {
+
+  vector< pair< bool, string > > reports;
+#ifdef USE_PTHREAD
+  if ( _background ) pthread_mutex_lock( &_mutex );
+  reports.swap( _writerReports );
+  if ( _background ) pthread_mutex_unlock( &_mutex );
+#else
+  reports.swap( _writerReports );
+#endif
+  for ( size_t i = 0; i < reports.size(); ++i ) {
+    if ( reports[i].first ) streamlog_out ( ERROR5 ) << reports[i].second << endl;
+    else streamlog_out ( MESSAGE5 ) << reports[i].second << endl;
+  }
+
+}
+
+#ifdef USE_PTHREAD
+void * EUTelOutputProcessor::writerThread( void * processor ) {
+  static_cast< EUTelOutputProcessor * >( processor )->writeQueue();
+  return NULL;
+}
+
+void EUTelOutputProcessor::writeQueue() {
+  for ( ;; ) {
+    pthread_mutex_lock( &_mutex );
+    while ( _nQueued == 0 && !_stop ) pthread_cond_wait( &_recordQueued, &_mutex );
+    if ( _nQueued == 0 ) {
+      pthread_mutex_unlock( &_mutex );
+      return;
+    }
+    Record & record = _queue[_consumerSlot];
+    pthread_mutex_unlock( &_mutex );
+
+    writeRecord( record );
+
+    pthread_mutex_lock( &_mutex );
+    _consumerSlot = ( _consumerSlot + 1 ) % _queue.size();
+    --_nQueued;
+    pthread_cond_signal( &_recordWritten );
+    pthread_mutex_unlock( &_mutex );
+  }
+}
+
+void EUTelOutputProcessor::queueRecord( const Record & record ) {
+  pthread_mutex_lock( &_mutex );
+  while ( _nQueued == _queue.size() ) pthread_cond_wait( &_recordWritten, &_mutex );
+  _queue[_producerSlot] = record;
+  _producerSlot = ( _producerSlot + 1 ) % _queue.size();
+  ++_nQueued;
+  pthread_cond_signal( &_recordQueued );
+  pthread_mutex_unlock( &_mutex );
+}
+
+void EUTelOutputProcessor::waitForWriter() {
+  pthread_mutex_lock( &_mutex );
+  while ( _nQueued > 0 ) pthread_cond_wait( &_recordWritten, &_mutex );
+  pthread_mutex_unlock( &_mutex );
+}
+#endif
+
+void EUTelOutputProcessor::end(){ 
+
+#ifdef USE_PTHREAD
+  if ( _background ) {
+    pthread_mutex_lock( &_mutex );
+    _stop = true;
+    pthread_cond_signal( &_recordQueued );
+    pthread_mutex_unlock( &_mutex );
+    pthread_join( _thread, NULL );
+    pthread_cond_destroy( &_recordWritten );
+    pthread_cond_destroy( &_recordQueued );
+    pthread_mutex_destroy( &_mutex );
+    _background = false;
+  }
+#endif
+  logWriterReports();
+  if ( _nWriteErrors > 0 ) {
+    streamlog_out ( ERROR5 ) << _nWriteErrors << " records could not be written to " << _lcioOutputFile << endl;
+  }
+
+  if ( _eventType != kEORE ) {
+
+    message<WARNING> ( "Adding a EORE because was missing" );
+    writeEORE();
+
+  }
+
+  message<MESSAGE5> ( log() << "Writing the output file " << _lcioOutputFile );
+  _lcWrt->close() ;
+
+  delete _lastRunHeader;
+  _lastRunHeader = NULL;
+
+}
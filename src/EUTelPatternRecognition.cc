@@ -30,17 +30,14 @@ void EUTelPatternRecognition::clearEveryRun(){
 void EUTelPatternRecognition::testTrackCandidates(){
 	for(size_t i=0; i < _tracks.size(); ++i){
 		int idBefore=-999;
-		for(size_t j = 0; j<_tracks.at(i).getTracks().size();++j){
-			if(_tracks.at(i).getTracks().at(j)->getTrackerHits().size() > 1){
-				throw(lcio::Exception( "The number of hits for each state is greater than 1"));
-			}
-			if(!_tracks.at(i).getTracks().at(j)->getTrackerHits().empty()){//Since some states will have not hits
-				const EVENT::TrackerHit* hit =  _tracks.at(i).getTracks().at(j)->getTrackerHits().at(0);
+		const std::vector<EUTelState>& states = _tracks.at(i).getStates();
+		for(size_t j = 0; j<states.size();++j){
+			if(states.at(j).getIsThereAHit()){//Since some states will have not hits
+				const EVENT::TrackerHit* hit =  states.at(j).getHit();
 				int id = hit->id();
 				if(j>1 and id == idBefore){
 					streamlog_out(MESSAGE5) << "The IDs of the hits are: " <<id <<" and before  "<<idBefore<<std::endl; 
-					//note z0 stores the position of the state.
-					streamlog_out(MESSAGE5) << "The state locations are " << _tracks.at(i).getTracks().at(j)->getZ0() <<" and  "<<_tracks.at(i).getTracks().at(j-1)->getZ0()<<std::endl; 
+					streamlog_out(MESSAGE5) << "The state locations are " << states.at(j).getLocation() <<" and  "<<states.at(j-1).getLocation()<<std::endl; 
 					throw(lcio::Exception( "Some states have the same hits. "));
 				}
 				idBefore=id;
@@ -50,30 +47,20 @@ void EUTelPatternRecognition::testTrackCandidates(){
 }
 //This is the work horse of the class. Using seeds it propagates the track forward using equations of motion. This can be with or without magnetic field.
 void EUTelPatternRecognition::propagateForwardFromSeedState( EUTelState& stateInput, EUTelTrack & track    ){
-	EUTelState *state = &stateInput;//Make it a pointer so we can change this to newState after.
 	streamlog_out ( DEBUG1 ) << "EUTelPatternRecognition::propagateForwardFromSeedState-----BEGIN "<< endl;
-	//TO DO: To delete this in smart way. 
-	EUTelState *firstState = new EUTelState(stateInput);//Need to create an initial state that will not be deleted outside this scope  
-	streamlog_out(DEBUG2) << "This is the memory location of the state: "<< firstState << std::endl;
-	track.addTrack(static_cast<EVENT::Track*>(firstState));//Note we do not have to create new since this object State is saved in class member scope
+	track.addState(stateInput);//The track keeps its own copy of the seed. We always propagate from the last state added to the track.
 	//Here we loop through all the planes not excluded. We begin at the seed which might not be the first. Then we stop before the last plane, since we do not want to propagate anymore
-	bool firstLoop =true;//TO DO:: This works but is very stupid. Must fix
-	for(int i = geo::gGeometry().sensorIDToZOrderWithoutExcludedPlanes().at(state->getLocation()); i < (geo::gGeometry().sensorZOrderToIDWithoutExcludedPlanes().size()-1); ++i){
+	for(int i = geo::gGeometry().sensorIDToZOrderWithoutExcludedPlanes().at(stateInput.getLocation()); i < (geo::gGeometry().sensorZOrderToIDWithoutExcludedPlanes().size()-1); ++i){
 	
 		float globalIntersection[3];
 		TVector3 momentumAtIntersection;
 		float arcLength;
-		int newSensorID = state->findIntersectionWithCertainID(geo::gGeometry().sensorZOrderToIDWithoutExcludedPlanes().at(i+1), globalIntersection, momentumAtIntersection, arcLength);
+		EUTelState& state = track.getStates().back();//Only valid until the next state is added to the track
+		int newSensorID = state.findIntersectionWithCertainID(geo::gGeometry().sensorZOrderToIDWithoutExcludedPlanes().at(i+1), globalIntersection, momentumAtIntersection, arcLength);
 		if(arcLength <= 0 ){ 
 			throw(lcio::Exception( "The arc length is less than or equal to zero. ")); 
 		}
-		if(firstLoop){
-			firstState->setArcLengthToNextState(arcLength); 
-			firstLoop =false;
-		}else{
-			state->setArcLengthToNextState(arcLength);
-		}
-		//cout<<"HERE1: "<<state->getPosition()[0]<<","<<state->getPosition()[1]<<","<<state->getPosition()[2]<<","<<state->getLocation()<<endl;
+		state.setArcLengthToNextState(arcLength);
 		int sensorIntersection = geo::gGeometry( ).getSensorID(globalIntersection);
 		if(newSensorID < 0 or sensorIntersection < 0 ){
 			streamlog_out ( DEBUG5 ) << "INTERSECTION NOT FOUND! Intersection point on infinite plane: " <<  globalIntersection[0]<<" , "<<globalIntersection[1] <<" , "<<globalIntersection[2]<<std::endl;
@@ -89,51 +76,44 @@ void EUTelPatternRecognition::propagateForwardFromSeedState( EUTelState& stateIn
 		streamlog_out ( DEBUG5 ) << "Momentum on next plane: " <<  momentumAtIntersection[0]<<" , "<<momentumAtIntersection[1] <<" , "<<momentumAtIntersection[2]<<std::endl;
 
 		//So we have intersection lets create a new state
-		EUTelState *newState = new EUTelState();//Need to create this since we save the pointer and we would be out of scope when we leave this function. Destroying this object. 
-		newState->setDimensionSize(_planeDimensions[newSensorID]);//We set this since we need this information for later processors
-		newState->setBeamCharge(_beamQ);
-		newState->setLocation(newSensorID);
-		newState->setPositionGlobal(globalIntersection);
-		newState->setLocalXZAndYZIntersectionAndCurvatureUsingGlobalMomentum(momentumAtIntersection);
+		EUTelState newState;
+		newState.setDimensionSize(_planeDimensions[newSensorID]);//We set this since we need this information for later processors
+		newState.setBeamCharge(_beamQ);
+		newState.setLocation(newSensorID);
+		newState.setPositionGlobal(globalIntersection);
+		newState.setLocalXZAndYZIntersectionAndCurvatureUsingGlobalMomentum(momentumAtIntersection);
 		if(_mapHitsVecPerPlane[geo::gGeometry().sensorZOrderToIDWithoutExcludedPlanes().at(i+1)].size() == 0){
 			streamlog_out(DEBUG5) << "There are no hits on the plane with this state. Add state to track as it is and move on ";
-			track.addTrack(static_cast<EVENT::Track*>(newState));//Need to return this to LCIO object. Loss functionality but retain information 
-			state = newState;
+			track.addState(newState);
 			continue;
 		}
-		EVENT::TrackerHit* closestHit = const_cast< EVENT::TrackerHit* > ( findClosestHit( *newState )); //This will look for the closest hit but not if it is within the excepted range		
+		EVENT::TrackerHit* closestHit = const_cast< EVENT::TrackerHit* > ( findClosestHit( newState )); //This will look for the closest hit but not if it is within the excepted range		
 		double distance;
-		if(newState->getDimensionSize() == 2){
-			distance = sqrt(computeResidual( *newState, closestHit ).Norm2Sqr());//This distance could be 2D or 1D depending on if you have a strip or pixel sensor. Norm2Sqr does not square toot for some reason.
-		}else if(newState->getDimensionSize() == 1){
-			distance = computeResidual( *newState, closestHit )[0];//If strip sensor then use only displacement along strips. Which should be x axis.
+		if(newState.getDimensionSize() == 2){
+			distance = sqrt(computeResidual( newState, closestHit ).Norm2Sqr());//This distance could be 2D or 1D depending on if you have a strip or pixel sensor. Norm2Sqr does not square toot for some reason.
+		}else if(newState.getDimensionSize() == 1){
+			distance = computeResidual( newState, closestHit )[0];//If strip sensor then use only displacement along strips. Which should be x axis.
 		}else{
 			throw(lcio::Exception( "The closest hit is not on a pixel or strip sensor. Since the dimensionality if less than 1 or greater than 2."));
 		}
-		const double DCA = getXYPredictionPrecision( *newState ); //This does nothing but return a number specified by user. In the future this should use convariance matrix information TO DO: FIX
-		streamlog_out ( DEBUG1 ) <<"At plane: "<<newState->getLocation() << ". Distance between state and hit: "<< distance <<" Must be less than: "<<DCA<< endl;
+		const double DCA = getXYPredictionPrecision( newState ); //This does nothing but return a number specified by user. In the future this should use convariance matrix information TO DO: FIX
+		streamlog_out ( DEBUG1 ) <<"At plane: "<<newState.getLocation() << ". Distance between state and hit: "<< distance <<" Must be less than: "<<DCA<< endl;
 		streamlog_out(DEBUG0) <<"Closest hit position: " << closestHit->getPosition()[0]<<" "<< closestHit->getPosition()[1]<<"  "<< closestHit->getPosition()[2]<<endl;
 		if ( distance > DCA ) {
 			streamlog_out ( DEBUG1 ) << "Closest hit is outside of search window." << std::endl;
-			track.addTrack(static_cast<EVENT::Track*>(newState));//Need to return this to LCIO object. Loss functionality but retain information 
-			state = newState;
+			track.addState(newState);
 			continue;
 		}	
 		if(closestHit == NULL){
 			throw(lcio::Exception( "The closest hit you are trying to add is NULL. This can not be correct"));
 		}
 		streamlog_out ( DEBUG1 ) << "Found a hit with memory address: " << closestHit<<" and ID of " <<closestHit->id() <<" At a Distance: "<< distance<<" from state." << endl;
-		newState->addHit(closestHit);
+		newState.setHit(closestHit);
 		_totalNumberOfHits++;//This is used for test of the processor later.   
-		streamlog_out(DEBUG2) << "This is the memory location of the state: "<< newState << std::endl;
 
-		track.addTrack(static_cast<EVENT::Track*>(newState));//Need to return this to LCIO object. Loss functionality but retain information 
+		track.addState(newState);
 		track.print();
 		streamlog_out ( DEBUG1 ) << "The number of hits on the track now is "<< track.getNumberOfHitsOnTrack()<< endl;
-		//cout<<"HERE3: "<<newState->getPosition()[0]<<","<<newState->getPosition()[1]<<","<<newState->getPosition()[2]<<","<<newState->getLocation()<<endl;
-		//cout<<"HERE5: "<<state->getPosition()[0]<<","<<state->getPosition()[1]<<","<<state->getPosition()[2]<<","<<state->getLocation()<<endl;
-		state = newState;
-		//cout<<"HERE4: "<<state->getPosition()[0]<<","<<state->getPosition()[1]<<","<<state->getPosition()[2]<<","<<state->getLocation()<<endl;
 		streamlog_out ( DEBUG1 ) << "End of loop "<< endl;
 
 	}
@@ -201,18 +181,18 @@ void EUTelPatternRecognition::findTrackCandidatesWithSameHitsAndRemove(){
 	streamlog_out(MESSAGE1) << "EUTelPatternRecognition::findTrackCandidatesWithSameHitsAndRemove----BEGIN" << std::endl;
 	for(size_t i =0; i < _tracksAfterEnoughHitsCut.size();++i){//LOOP through all tracks 
 		streamlog_out(DEBUG1) <<  "Loop at track number: " <<  i <<". Must loop over " << _tracksAfterEnoughHitsCut.size()<<" tracks in total."   << std::endl;
-		std::vector<EUTelState> iStates = _tracksAfterEnoughHitsCut.at(i).getStates();
+		const std::vector<EUTelState>& iStates = _tracksAfterEnoughHitsCut.at(i).getStates();
 		//Now loop through all tracks one ahead of the original track itTrk. This is done since we want to compare all the track to each other to if they have similar hits     
 		for(size_t j =i+1; j < _tracksAfterEnoughHitsCut.size();++j){ //LOOP over all track again.
 	//		cout<<"Increase track to: "<<j <<endl;
 			int hitscount=0;
-			std::vector<EUTelState> jStates = _tracksAfterEnoughHitsCut[j].getStates();
+			const std::vector<EUTelState>& jStates = _tracksAfterEnoughHitsCut[j].getStates();
 			for(size_t i=0;i<iStates.size();i++){
 		//		cout<<"I top states "<< i<<endl;
 			
 				EVENT::TrackerHit* ihit;
-				if(!iStates[i].getTrackerHits().empty()){//Need since we could have tracks that have a state but no hits here.
-					ihit = iStates[i].getTrackerHits()[0];
+				if(iStates[i].getIsThereAHit()){//Need since we could have tracks that have a state but no hits here.
+					ihit = iStates[i].getHit();
 				}else{
 					continue;
 				}
@@ -221,8 +201,8 @@ void EUTelPatternRecognition::findTrackCandidatesWithSameHitsAndRemove(){
 		//		cout<<"I bottom states "<< j<<endl;
 
 					EVENT::TrackerHit* jhit;
-					if(!jStates[j].getTrackerHits().empty()){//Need since we could have tracks that have a state but no hits here.
-						jhit = jStates[j].getTrackerHits()[0];
+					if(jStates[j].getIsThereAHit()){//Need since we could have tracks that have a state but no hits here.
+						jhit = jStates[j].getHit();
 					}else{
 						continue;
 					}
@@ -323,7 +303,7 @@ void EUTelPatternRecognition::initialiseSeeds() {
 			state.setBeamCharge(_beamQ);//this is set for each state. to do: is there a more efficient way of doing this since we only need this stored once?
 			TVector3 momentum = computeInitialMomentumGlobal(); 
 			state.setLocalXZAndYZIntersectionAndCurvatureUsingGlobalMomentum(momentum); 
-			state.addHit(*itHit);
+			state.setHit(*itHit);
 			_totalNumberOfHits++;//This is used for test of the processor later.   
 			state.setDimensionSize(_planeDimensions[state.getLocation()]);
 			stateVec.push_back(state);
@@ -350,7 +330,7 @@ void EUTelPatternRecognition::testInitialSeeds(){
 	for(size_t i = 0 ; i < _mapSensorIDToSeedStatesVec.size(); ++i){
 		std::vector<EUTelState> StatesVec =  _mapSensorIDToSeedStatesVec[_createSeedsFromPlanes[i]]; 	
 		for(size_t j = 0 ; j < StatesVec.size() ; ++j){
-			if(StatesVec[j].getTrackerHits()[0] == NULL ){
+			if(StatesVec[j].getHit() == NULL ){
 				throw(lcio::Exception("The hit is NULL. All seeds must have hits.")); 	
 			}
 		}
@@ -379,13 +359,8 @@ void EUTelPatternRecognition::findTrackCandidates() {
 	streamlog_out(MESSAGE1) << "EUTelPatternRecognition::findTrackCandidates()------END" << std::endl;
 }
 
-//We need to delete the states AND the track. Since we have allocated memory to store the state.
+//The tracks own their states, so clearing the vector frees everything.
 void EUTelPatternRecognition::clearTrackAndTrackStates(){
-	for(size_t i=0; i < _tracks.size(); ++i){
-		for(size_t j=0; j< _tracks.at(i).getTracks().size(); ++j){   
-		//	delete [] _tracks.at(i).getTracks().at(j); TO DO: Delete memory properly 
-		}
-	}
 	_tracks.clear();
 }
 
@@ -568,7 +543,6 @@ void EUTelPatternRecognition::findHitsOrderVec(LCCollection* lcCollection,EVENT:
 	for (int iHit = 0; iHit < lcCollection->getNumberOfElements(); iHit++) {
 		TrackerHitImpl * hit = static_cast<TrackerHitImpl*> (lcCollection->getElementAt(iHit));
 
-		//TO DO:The determination of HitID is inefficient. Since you create a decoder for each event.
 		const int localSensorID = Utility::getSensorIDfromHit( static_cast<IMPL::TrackerHitImpl*> (hit) );
 		if ( localSensorID >= 0 ) hitsOrderVec.push_back( hit );
 
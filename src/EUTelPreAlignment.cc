@@ -10,6 +10,7 @@
 #include "EUTelDFFClusterImpl.h"
 #include "EUTelBrickedClusterImpl.h"
 #include "EUTelSparseClusterImpl.h"
+#include "EUTelExceptions.h"
 
 // marlin includes ".h"
 #include "marlin/Processor.h"
@@ -58,6 +59,17 @@ using namespace marlin;
 using namespace eutelescope;
 using namespace gear;
 
+namespace {
+  // extends a per plane residual cut to nPlanes entries, repeating its last value
+  void padResidualCuts( vector< float > & cuts, size_t nPlanes, float defaultValue, const string & name ) {
+    if( cuts.size() >= nPlanes ) return;
+    const float value = cuts.empty() ? defaultValue : cuts.back();
+    streamlog_out( WARNING2 ) << name << " has " << cuts.size() << " entries for " << nPlanes
+			      << " planes, the missing ones are set to " << value << endl;
+    cuts.resize( nPlanes, value );
+  }
+}
+
 EUTelPreAlign::EUTelPreAlign () :Processor("EUTelPreAlign") {
   _description = "Apply alignment constants to hit collection";
 
@@ -108,6 +120,7 @@ void EUTelPreAlign::init () {
   _iRun = 0;  _iEvt = 0;
 
   _UsefullHotPixelCollectionFound = 0; 
+  _hotPixelMask = 0;
 
   _referenceHitVec = 0;
 
@@ -198,6 +211,43 @@ void EUTelPreAlign::init () {
   }
 #endif
 
+  // correlation band and histograms of every prealigner, looked up once instead of for every hit
+  _sensorIDToPreAligner.clear();
+  _preAlignerXMin.clear();
+  _preAlignerXMax.clear();
+  _preAlignerYMin.clear();
+  _preAlignerYMax.clear();
+  size_t nPlanes = 0;
+  for( size_t ii = 0; ii < _preAligners.size(); ii++ )
+    {
+      nPlanes = max( nPlanes, static_cast< size_t >( _sensorIDtoZOrderMap[ _preAligners[ii].getIden() ] ) + 1 );
+    }
+  padResidualCuts( _residualsXMin, nPlanes, -10., "ResidualsXMin" );
+  padResidualCuts( _residualsXMax, nPlanes,  10., "ResidualsXMax" );
+  padResidualCuts( _residualsYMin, nPlanes, -10., "ResidualsYMin" );
+  padResidualCuts( _residualsYMax, nPlanes,  10., "ResidualsYMax" );
+  for( size_t ii = 0; ii < _preAligners.size(); ii++ )
+    {
+      const int sensorID = _preAligners[ii].getIden();
+      const size_t idZ = _sensorIDtoZOrderMap[ sensorID ];
+      _sensorIDToPreAligner.insert( make_pair( sensorID, static_cast< int >( ii ) ) );
+      _preAlignerXMin.push_back( _residualsXMin[idZ] );
+      _preAlignerXMax.push_back( _residualsXMax[idZ] );
+      _preAlignerYMin.push_back( _residualsYMin[idZ] );
+      _preAlignerYMax.push_back( _residualsYMax[idZ] );
+    }
+
+#if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
+  _preAlignerXCorr.assign( _preAligners.size(), static_cast< AIDA::IHistogram1D * >( 0 ) );
+  _preAlignerYCorr.assign( _preAligners.size(), static_cast< AIDA::IHistogram1D * >( 0 ) );
+  if( _fillHistos ) {
+    for( size_t ii = 0; ii < _preAligners.size(); ii++ ) {
+      _preAlignerXCorr[ii] = dynamic_cast<AIDA::IHistogram1D*> ( _hitXCorr[ _preAligners[ii].getIden() ] );
+      _preAlignerYCorr[ii] = dynamic_cast<AIDA::IHistogram1D*> ( _hitYCorr[ _preAligners[ii].getIden() ] );
+    }
+  }
+#endif
+
 }
 
 void EUTelPreAlign::processRunHeader (LCRunHeader * rdr) {
@@ -209,68 +259,17 @@ void EUTelPreAlign::processRunHeader (LCRunHeader * rdr) {
 
 void  EUTelPreAlign::FillHotPixelMap(LCEvent *event)
 {
-
-  if( _hotPixelCollectionName.empty()) return;
-
-  LCCollectionVec *hotPixelCollectionVec = 0;
-  try 
-    {
-      hotPixelCollectionVec = static_cast< LCCollectionVec* > ( event->getCollection( _hotPixelCollectionName  ) );
-      streamlog_out ( DEBUG5 ) << "Hotpixel database " << _hotPixelCollectionName.c_str() << " found" << endl; 
-    }
-  catch (...)
-    {
-      streamlog_out ( WARNING5 ) << "Hotpixel database " << _hotPixelCollectionName.c_str() << " not found" << endl; 
-      return;
-    }
-
-  CellIDDecoder<TrackerDataImpl> cellDecoder( hotPixelCollectionVec );
-	
-  for(int i=0; i<  hotPixelCollectionVec->getNumberOfElements(); i++)
-    {
-      TrackerDataImpl* hotPixelData = dynamic_cast< TrackerDataImpl *> ( hotPixelCollectionVec->getElementAt( i ) );
-      SparsePixelType  type         = static_cast<SparsePixelType> (static_cast<int> (cellDecoder( hotPixelData )["sparsePixelType"]));
-
-      int sensorID              = static_cast<int > ( cellDecoder( hotPixelData )["sensorID"] );
-
-      if( type  ==  kEUTelGenericSparsePixel )
-	{  
-	  auto_ptr<EUTelSparseClusterImpl< EUTelGenericSparsePixel > > m26Data( new EUTelSparseClusterImpl< EUTelGenericSparsePixel >   ( hotPixelData ) );
-
-	  std::vector<EUTelGenericSparsePixel*> m26PixelVec;
-	  EUTelGenericSparsePixel m26Pixel;
-	  //Push all single Pixels of one plane in the m26PixelVec
-
-	  for(  unsigned int iPixel = 0; iPixel < m26Data->size(); iPixel++ ) 
-	    {
-              std::vector<int> m26ColVec();
-              m26Data->getSparsePixelAt( iPixel, &m26Pixel);
-
-              try
-		{
-		  _hotPixelMap[sensorID].push_back(std::make_pair(m26Pixel.getXCoord(), m26Pixel.getYCoord()));
-		}
-              catch(...)
-		{
-		  streamlog_out ( ERROR5 ) << " cannot add pixel to hotpixel map! SensorID: "  << sensorID << ", X:" << m26Pixel.getXCoord() << ", Y:" << m26Pixel.getYCoord() << endl; 
-		  abort();
-		}
-	    }
-	}          
-      else
-	{
-	  _UsefullHotPixelCollectionFound = 0;
-	}  	
-    }
+  // the mask is shared with the other processors and only loaded once per run
+  _hotPixelMask = &EUTelHotPixelMask::getInstance( _hotPixelCollectionName );
+  _UsefullHotPixelCollectionFound = _hotPixelMask->update( event );
 }
 
 void EUTelPreAlign::processEvent (LCEvent * event) {
 
+  FillHotPixelMap(event);
+
   if(  isFirstEvent() )
     {
-
-      FillHotPixelMap(event);
-
       if(  _useReferenceHitCollection ) 
 	{
 	  try{
@@ -301,78 +300,51 @@ void EUTelPreAlign::processEvent (LCEvent * event) {
 
   try {
     LCCollectionVec * inputCollectionVec = dynamic_cast < LCCollectionVec * > (evt->getCollection(_inputHitCollectionName));
-    UTIL::CellIDDecoder<TrackerHitImpl> hitDecoder ( EUTELESCOPE::HITENCODING );
-    
-    std::vector<float> residX;
-    std::vector<float> residY;
-    std::vector<PreAligner*> prealign;
-
-    //Loop over hits in fixed plane:
-
-    for( size_t ref = 0; ref < inputCollectionVec->size(); ref++ )  {
 
-      TrackerHitImpl * refHit = dynamic_cast< TrackerHitImpl * >  ( inputCollectionVec->getElementAt( ref ) ) ;
-      const double * refPos = refHit->getPosition();
+    // decode every hit once, not once per hit in the fixed plane
+    prepareHits( inputCollectionVec );
 
-      int sensorID = hitDecoder(refHit)["sensorID"];
-
-      // identify fixed plane
-      if( sensorID != _fixedID ) continue;
-
-      residX.clear();
-      residY.clear();
-      prealign.clear();
-
-      for( size_t iHit = 0; iHit < inputCollectionVec->size(); iHit++) {
-
-	TrackerHitImpl * hit = dynamic_cast< TrackerHitImpl * >  ( inputCollectionVec->getElementAt( iHit ) ) ;
-        if( hitContainsHotPixels(hit) ) continue;
-        
-        const double * pos = hit->getPosition();
-        int iHitID = hitDecoder(hit)["sensorID"]; 
-
-        if( iHitID == _fixedID ) continue;
-        bool gotIt(false);
+    //Loop over hits in fixed plane:
 
-	for(size_t ii = 0; ii < _preAligners.size(); ii++)
-	  {
+    for( size_t ref = 0; ref < _refHitX.size(); ref++ )  {
 
-	    PreAligner& pa = _preAligners.at(ii);
+      _correlationX.clear();
+      _correlationY.clear();
+      _correlationPreAligner.clear();
 
-	    if( pa.getIden() != iHitID  ) { continue; }
+      for( size_t ii = 0; ii < _preAligners.size(); ii++ ) {
 
-	    gotIt = true;
+	const float xMin = _preAlignerXMin[ii];
+	const float xMax = _preAlignerXMax[ii];
+	const float yMin = _preAlignerYMin[ii];
+	const float yMax = _preAlignerYMax[ii];
 
-	    double correlationX =  refPos[0] - pos[0] ;
-	    double correlationY =  refPos[1] - pos[1] ;
+	for( int iHit = _preAlignerHitStart[ii]; iHit < _preAlignerHitStart[ii + 1]; iHit++ ) {
 
-	    int idZ = _sensorIDtoZOrderMap[ iHitID ];
+	  double correlationX =  _refHitX[ref] - _preAlignerHitX[iHit] ;
+	  double correlationY =  _refHitY[ref] - _preAlignerHitY[iHit] ;
 
-	    if( 
-	       (_residualsXMin[idZ] < correlationX ) && ( correlationX < _residualsXMax[idZ]) &&
-	       (_residualsYMin[idZ] < correlationY ) && ( correlationY < _residualsYMax[idZ]) 
-		) {
-	      residX.push_back( correlationX );
-	      residY.push_back( correlationY );
-	      prealign.push_back(&pa);
-	    }
-	    break;
-	  }
-	if( not gotIt ) 
-	  {
-	    streamlog_out ( ERROR5 ) << "Mismatched hit at " << pos[2] << endl;
+	  if( 
+	     ( xMin < correlationX ) && ( correlationX < xMax ) &&
+	     ( yMin < correlationY ) && ( correlationY < yMax ) 
+	      ) {
+	    _correlationX.push_back( correlationX );
+	    _correlationY.push_back( correlationY );
+	    _correlationPreAligner.push_back( ii );
 	  }
+	}
       }
 
-      if( prealign.size() > static_cast< unsigned int >(_minNumberOfCorrelatedHits) && residX.size() == residY.size() ) {
-	for( unsigned int ii = 0 ;ii < prealign.size(); ii++ ) {
+      if( _correlationPreAligner.size() > static_cast< unsigned int >(_minNumberOfCorrelatedHits) ) {
+	for( unsigned int ii = 0 ;ii < _correlationPreAligner.size(); ii++ ) {
 
-	  prealign[ii]->addPoint( residX[ii], residY[ii] );
+	  const int iPreAligner = _correlationPreAligner[ii];
+	  _preAligners[ iPreAligner ].addPoint( _correlationX[ii], _correlationY[ii] );
 
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
 	  if( _fillHistos ) {
-	    ( dynamic_cast<AIDA::IHistogram1D*> (_hitXCorr[ prealign[ii]->getIden() ] ) )->fill( residX[ii] );
-	    ( dynamic_cast<AIDA::IHistogram1D*> (_hitYCorr[ prealign[ii]->getIden() ] ) )->fill( residY[ii] );
+	    _preAlignerXCorr[ iPreAligner ]->fill( _correlationX[ii] );
+	    _preAlignerYCorr[ iPreAligner ]->fill( _correlationY[ii] );
 	  }
 #endif
 	}
@@ -388,92 +360,60 @@ void EUTelPreAlign::processEvent (LCEvent * event) {
 
 }
 
-bool EUTelPreAlign::hitContainsHotPixels( TrackerHitImpl   * hit) 
+void EUTelPreAlign::prepareHits( LCCollectionVec * inputCollectionVec )
 {
-  bool skipHit = false;
-
-  // if no hot pixel map was loaded, just return here
-  if( _hotPixelMap.size() == 0) return 0;
-
-  try
-    {
-      LCObjectVec clusterVector = hit->getRawHits();
-
-      if ( hit->getType() == kEUTelSparseClusterImpl ) 
-	{
-	  TrackerDataImpl * clusterFrame = static_cast<TrackerDataImpl*> ( clusterVector[0] );
-	  eutelescope::EUTelSparseClusterImpl< eutelescope::EUTelGenericSparsePixel > *cluster = new eutelescope::EUTelSparseClusterImpl< eutelescope::EUTelGenericSparsePixel >(clusterFrame);
-
-	  int sensorID = cluster->getDetectorID();
-
-	  for ( unsigned int iPixel = 0; iPixel < cluster->size(); iPixel++ ) 
-	    {
-	      EUTelGenericSparsePixel m26Pixel;
-	      cluster->getSparsePixelAt( iPixel, &m26Pixel);
-	      {
-		try{
-		  if( std::find(_hotPixelMap.at(sensorID).begin(), 
-				_hotPixelMap.at(sensorID).end(),
-				std::make_pair(m26Pixel.getXCoord(),m26Pixel.getYCoord()))
-		      != _hotPixelMap.at(sensorID).end()){ 
-		    skipHit = true; 	      
-		    delete cluster;                        			  
-		    return true; // if TRUE  this hit will be skipped
-		  }
-		}
-		catch(const std::out_of_range& oor){
-		  streamlog_out(DEBUG0) << " Could not find hot pixel map for sensor ID " 
-					<< sensorID << ": " << oor.what() << endl;
-		}
-	      }
-	    }
+  UTIL::CellIDDecoder<TrackerHitImpl> hitDecoder ( EUTELESCOPE::HITENCODING );
+
+  _refHitX.clear();
+  _refHitY.clear();
+  _hitPreAligner.clear();
+  _hitX.clear();
+  _hitY.clear();
+  _preAlignerHitStart.assign( _preAligners.size() + 1, 0 );
+
+  for( size_t iHit = 0; iHit < inputCollectionVec->size(); iHit++ ) {
+
+    TrackerHitImpl * hit = dynamic_cast< TrackerHitImpl * >  ( inputCollectionVec->getElementAt( iHit ) ) ;
+    const double * pos = hit->getPosition();
+    int sensorID = hitDecoder(hit)["sensorID"];
+
+    // hits in the fixed plane are the reference, they are not checked for hot pixels
+    if( sensorID == _fixedID ) {
+      _refHitX.push_back( pos[0] );
+      _refHitY.push_back( pos[1] );
+      continue;
+    }
 
-	  delete cluster;
-	  return 0;
-	} 
-      else if ( hit->getType() == kEUTelBrickedClusterImpl ) 
-	{
+    std::map< int, int >::const_iterator preAligner = _sensorIDToPreAligner.find( sensorID );
+    if( preAligner == _sensorIDToPreAligner.end() ) {
+      streamlog_out ( ERROR5 ) << "Mismatched hit at " << pos[2] << endl;
+      continue;
+    }
 
-	  // fixed cluster implementation. Remember it
-	  //  can come from
-	  //  both RAW and ZS data
-   
-	  streamlog_out ( WARNING5 ) << " Hit type kEUTelBrickedClusterImpl is not implemented in hotPixel finder method, all pixels are considered for PreAlignment." <<  endl;
+    if( hitContainsHotPixels(hit) ) continue;
 
-	} 
-      else if ( hit->getType() == kEUTelDFFClusterImpl ) 
-	{
-
-	  // fixed cluster implementation. Remember it can come from
-	  // both RAW and ZS data
-	  streamlog_out ( WARNING5 ) << " Hit type kEUTelDFFClusterImpl is not implemented in hotPixel finder method, all pixels are considered for PreAlignment." <<  endl;
-	} 
-      else if ( hit->getType() == kEUTelFFClusterImpl ) 
-	{
+    _hitPreAligner.push_back( preAligner->second );
+    _hitX.push_back( pos[0] );
+    _hitY.push_back( pos[1] );
+    _preAlignerHitStart[ preAligner->second + 1 ]++;
+  }
 
-	  // fixed cluster implementation. Remember it can come from
-	  // both RAW and ZS data
-	  streamlog_out ( WARNING5 ) << " Hit type kEUTelFFClusterImpl is not implemented in hotPixel finder method, all pixels are considered for PreAlignment." <<  endl;
-	} 
-      else
-	{
-	  streamlog_out ( WARNING5 ) << " Hit type is not known and is not implemented in hotPixel finder method, all pixels are considered for PreAlignment." <<  endl;
-	}
-    }
-  catch (exception& e)
-    {
-      streamlog_out(ERROR4) << "something went wrong in EUTelPreAlign::hitContainsHotPixels: " << e.what() << endl;
-    }
-  catch(...)
-    { 
-      // if anything went wrong in the above return FALSE, meaning do not skip this hit
-    
-      streamlog_out(ERROR4) << "something went wrong in EUTelPreAlign::hitContainsHotPixels " << endl;
-      return 0;
-    }
+  // group the hits by prealigner, keeping their order in the collection
+  for( size_t ii = 1; ii < _preAlignerHitStart.size(); ii++ ) _preAlignerHitStart[ii] += _preAlignerHitStart[ii - 1];
+  _preAlignerHitFill.assign( _preAlignerHitStart.begin(), _preAlignerHitStart.end() - 1 );
+  _preAlignerHitX.resize( _hitX.size() );
+  _preAlignerHitY.resize( _hitY.size() );
+  for( size_t iHit = 0; iHit < _hitX.size(); iHit++ ) {
+    const int index = _preAlignerHitFill[ _hitPreAligner[iHit] ]++;
+    _preAlignerHitX[index] = _hitX[iHit];
+    _preAlignerHitY[index] = _hitY[iHit];
+  }
+}
 
-  // if none of the above worked return FALSE, meaning do not skip this hit
-  return 0;
+bool EUTelPreAlign::hitContainsHotPixels( TrackerHitImpl   * hit) 
+{
+  // only sparse clusters can be checked, all pixels of other clusters are considered for PreAlignment
+  return _hotPixelMask != 0 && _hotPixelMask->hitTouchesMask( hit );
 }
       
 void EUTelPreAlign::end() {
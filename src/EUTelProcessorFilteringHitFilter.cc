@@ -48,7 +48,8 @@ EUTelProcessorFilteringHitFilter::EUTelProcessorFilteringHitFilter( ) :
  Processor( "EUTelProcessorFilteringHitFilter" ),
  _hitInputCollectionName( "HitCollection" ),
  _nProcessedRuns( 0 ),
- _nProcessedEvents( 0 ) {
+ _nProcessedEvents( 0 ),
+ _hotPixelMask( 0 ) {
 
     // Processor description
     _description = "EUTelProcessorFilteringHitFilter selects hits that fulfill all specified requirements from input collection.";
@@ -81,7 +82,8 @@ void EUTelProcessorFilteringHitFilter::init( ) {
 
     _nProcessedRuns = 0;
     _nProcessedEvents = 0;
-    
+
+    _hotPixelMask = &EUTelHotPixelMask::getInstance( _hotpixelCollectionName );
 
 }
 
@@ -95,10 +97,8 @@ void EUTelProcessorFilteringHitFilter::processEvent( LCEvent * event ) {
 
 //cout << " processEvent : " << endl;
 
-     if ( isFirstEvent() )
-    {
-      _hotPixelMap = Utility::FillHotPixelMap(event, _hotpixelCollectionName );
-    }
+    // the mask is shared with the other processors and only loaded once per run
+    _hotPixelMask->update( event );
 
 //cout << " processEvent continue: " << endl;
 
@@ -138,7 +138,7 @@ void EUTelProcessorFilteringHitFilter::processEvent( LCEvent * event ) {
           {
             TrackerHitImpl * hit = static_cast<TrackerHitImpl*> ( hitInputCollection->getElementAt(iHit) );
              
-            if( Utility::HitContainsHotPixels(  hit,  _hotPixelMap )  ) 
+            if( _hotPixelMask->hitTouchesMask( hit ) ) 
             {
               streamlog_out ( MESSAGE5 ) << "Hit " << iHit << " contains hot pixels; skip this one. " << std::endl;
               continue;
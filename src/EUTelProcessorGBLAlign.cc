@@ -176,7 +176,7 @@ void EUTelProcessorGBLAlign::processEvent(LCEvent * evt){
 				for (int iTrack = 0; iTrack < eventCollection->getNumberOfElements(); ++iTrack) {
 					_totalTrackCount++;
 					_trackFitter->resetPerTrack(); //Here we reset the label that connects state to GBL point to 1 again. Also we set the list of states->labels to 0
-					EUTelTrack track = *(static_cast<EUTelTrack*> (eventCollection->getElementAt(iTrack)));
+					EUTelTrack track(static_cast<EVENT::Track*> (eventCollection->getElementAt(iTrack)));
 					float chi = track.getChi2();
 					float ndf = static_cast<float>(track.getNdf());
 					if(chi == 0 or ndf == 0){
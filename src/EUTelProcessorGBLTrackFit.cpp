@@ -2,6 +2,10 @@
 //contact alexander.morton975@gmail.com
 #ifdef USE_GBL   
 #include "EUTelProcessorGBLTrackFit.h"
+#include <ctime>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 using namespace eutelescope;
 //TO DO:
 //This way of making histograms makes no sense to me. We should have a class that when called will book any histograms in xml file automatically. So you dont have to book in every processor. It should also return a vector of names to access these histograms. I began this but have not finished. Therefore the silly way of doing the residuals
@@ -45,7 +49,17 @@ _beamQ(-1),
 _eBeam(4),
 _trackCandidatesInputCollectionName("Default_input"),
 _tracksOutputCollectionName("Default_output"),
-_mEstimatorType() //This is used by the GBL software for outliers down weighting
+_mEstimatorType(), //This is used by the GBL software for outliers down weighting
+_useRadLengthMap(false),
+_radLengthMapPositionStep(1.),
+_radLengthMapMaxSlope(0.02),
+_radLengthMapSlopeBins(4),
+_radLengthMapCheckSamples(100),
+_nFitThreads(1),
+_trackFitters(),
+_pointLists(),
+_fitTime(0.),
+_nFittedTracks(0)
 {
 	// Processor description
 	_description = "EUTelProcessorGBLTrackFit this will fit gbl tracks and output them into LCIO file.";
@@ -64,6 +78,14 @@ _mEstimatorType() //This is used by the GBL software for outliers down weighting
 	//This is the estimated resolution of the planes and DUT in x/y direction
   registerOptionalParameter("xResolutionPlane", "x resolution of planes given in Planes", _SteeringxResolutions, FloatVec());
   registerOptionalParameter("yResolutionPlane", "y resolution of planes given in Planes", _SteeringyResolutions, FloatVec());
+	//The material between two planes hardly depends on the track. So it is interpolated in a map of each plane gap, filled with the exact TGeo integrals when needed.
+  registerOptionalParameter("UseRadLengthMap", "Take the radiation length between planes from interpolated material maps instead of integrating it for every track (changes the scattering and fit results slightly)", _useRadLengthMap, static_cast<bool>(false));
+  registerOptionalParameter("RadLengthMapPositionStep", "Bin size of the material maps in position [mm]", _radLengthMapPositionStep, static_cast<float>(1.));
+  registerOptionalParameter("RadLengthMapMaxSlope", "Range of the material maps in track slope dx/dz and dy/dz", _radLengthMapMaxSlope, static_cast<float>(0.02));
+  registerOptionalParameter("RadLengthMapSlopeBins", "Number of bins of the material maps in each track slope", _radLengthMapSlopeBins, static_cast<int>(4));
+  registerOptionalParameter("RadLengthMapCheckSamples", "Number of random lines per plane gap used to check the material maps against the exact integral at init (0: no check)", _radLengthMapCheckSamples, static_cast<int>(100));
+	//The tracks of one event are independent, so they can be fitted in parallel. Each thread has its own fitter. Only with OpenMP.
+  registerOptionalParameter("NumberOfFitThreads", "Number of threads fitting the tracks of one event (needs OpenMP). With DEBUG verbosity the tracks are fitted in one thread", _nFitThreads, static_cast<int>(1));
 }
 
 void EUTelProcessorGBLTrackFit::init() {
@@ -76,15 +98,42 @@ void EUTelProcessorGBLTrackFit::init() {
 		//Create TGeo description from the gear.
 		std::string name("test.root");
 		geo::gGeometry().initializeTGeoDescription(name,false);
+#ifndef _OPENMP
+		if(_nFitThreads > 1){
+			streamlog_out(WARNING5) << "NumberOfFitThreads is " << _nFitThreads << " but the processor is compiled without OpenMP. Tracks will be fitted in one thread." << std::endl;
+			_nFitThreads = 1;
+		}
+#endif
+		if(_nFitThreads < 1) _nFitThreads = 1;
+		//A non positive step would give no or infinitely many position bins in the material maps.
+		if(_useRadLengthMap && (_radLengthMapPositionStep <= 0. || _radLengthMapMaxSlope < 0. || _radLengthMapSlopeBins < 1)){
+			throw InvalidParameterException("RadLengthMapPositionStep must be positive, RadLengthMapMaxSlope not negative and RadLengthMapSlopeBins at least 1.");
+		}
 		// Initialize GBL fitter. This is the class that does all the work. Seems to me a good practice for the most part create a class that does the work. Since then you can use the same functions in another processor.
-		EUTelGBLFitter* Fitter = new EUTelGBLFitter();
-		Fitter->setBeamCharge(_beamQ);
-		Fitter->setBeamEnergy(_eBeam);
-		Fitter->setMEstimatorType(_mEstimatorType);//As said before this is to do with how we deal with outliers and the function we use to weight them.
-		Fitter->setParamterIdXResolutionVec(_SteeringxResolutions);
-		Fitter->setParamterIdYResolutionVec(_SteeringyResolutions);
-		Fitter->testUserInput();
-		_trackFitter = Fitter;
+		// Each fitting thread needs its own fitter, since the fitter keeps the state to label links of the track being fitted.
+		_pointLists.resize(_nFitThreads);
+		for(int iThread = 0; iThread < _nFitThreads; ++iThread){
+			EUTelGBLFitter* Fitter = new EUTelGBLFitter();
+			Fitter->setBeamCharge(_beamQ);
+			Fitter->setBeamEnergy(_eBeam);
+			Fitter->setMEstimatorType(_mEstimatorType);//As said before this is to do with how we deal with outliers and the function we use to weight them.
+			Fitter->setParamterIdXResolutionVec(_SteeringxResolutions);
+			Fitter->setParamterIdYResolutionVec(_SteeringyResolutions);
+			Fitter->testUserInput();
+			Fitter->setUseRadLengthMap(_useRadLengthMap);
+			_trackFitters.push_back(Fitter);
+			_pointLists.at(iThread).reserve(3*geo::gGeometry().nPlanes());//One point per plane and two scatterers in between.
+		}
+		_trackFitter = _trackFitters.front();
+		if(_useRadLengthMap){
+			geo::gGeometry().setRadLengthMapBinning(_radLengthMapPositionStep, _radLengthMapMaxSlope, _radLengthMapSlopeBins);
+			if(_radLengthMapCheckSamples > 0){
+				const float deviation = geo::gGeometry().checkRadLengthMaps(_radLengthMapCheckSamples);
+				if(deviation > 0.01){
+					streamlog_out(WARNING5) << "The material maps deviate up to " << 100.*deviation << "% from the exact radiation length integral. Consider a finer binning." << std::endl;
+				}
+			}
+		}
 		if (!_trackFitter) {
 			throw(lcio::Exception("Could not create instance of fitter class."));
 		}
@@ -145,53 +194,54 @@ void EUTelProcessorGBLTrackFit::processEvent(LCEvent * evt){
 			throw marlin::SkipEventException(this);
 		}
 		std::vector<EUTelTrack> allTracksForThisEvent;//GBL will analysis the track one at a time. However we want to save to lcio per event.
-		for (int iCol = 0; iCol < col->getNumberOfElements(); iCol++) {
-			//TO DO: Make sure that the original input collection is not changed by this.
-			EUTelTrack track =  EUTelTrack(*(static_cast<EUTelTrack*> (col->getElementAt(iCol))));//TO DO: Is there a more elegant way to copy this?
-			_trackFitter->resetPerTrack(); //Here we reset the label that connects state to GBL point to 1 again. Also we set the list of states->labels to 0
-			track.print();//Print the track use for debugging
-			_trackFitter->testTrack(track);//Check the track has states and hits  
-			std::vector< gbl::GblPoint > pointList;
-			_trackFitter->setInformationForGBLPointList(track, pointList);//Here we describe the whole setup. Geometry, scattering, data...
-			const gear::BField& B = geo::gGeometry().getMagneticField();//We need this to determine if we should fit a curve or a straight line.
-			const double Bmag = B.at( TVector3(0.,0.,0.) ).r2();
-			_trackFitter->setPairMeasurementStateAndPointLabelVec(pointList);//This will create a link between the states that have a hit associated with them and the GBL label that is associated with the state.
-			gbl::GblTrajectory* traj = 0;
-			//Here we create the trajectory from the points created by setInformationForGBLPointList. This will take the points and propagation jacobian and split this into smaller matrices to describe the problem in terms of offsets. Here is the difference between GBL and other fitting algorithms.  
-			if ( Bmag < 1.E-6 ) {
-				traj = new gbl::GblTrajectory( pointList, false ); 
-			}else {
-				traj = new gbl::GblTrajectory( pointList, true );
+		const gear::BField& B = geo::gGeometry().getMagneticField();//We need this to determine if we should fit a curve or a straight line.
+		const double Bmag = B.at( TVector3(0.,0.,0.) ).r2();
+		const int nTracks = col->getNumberOfElements();
+		//The tracks are copied out of the collection, so the input collection is not changed by the fit.
+		std::vector<EUTelTrack> tracks;
+		tracks.reserve(nTracks);
+		for (int iCol = 0; iCol < nTracks; iCol++) {
+			tracks.push_back(EUTelTrack(static_cast<EVENT::Track*> (col->getElementAt(iCol))));
+		}
+		std::vector<TrackFitResult> results(nTracks);
+		const clock_t fitStart = clock();
+		//Tracks are independent. With more than one thread each thread uses its own fitter and point list.
+		//The debug output of the fit goes to the shared log stream, which is not thread safe. So with any DEBUG level active only one thread is used.
+		//Messages at higher levels are written only inside the critical section below or in the loop over the results.
+		const bool fitInThreads = _nFitThreads > 1 && nTracks > 1 && !streamlog_level(DEBUG9);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(_nFitThreads) if(fitInThreads)
+#endif
+		for (int iCol = 0; iCol < nTracks; iCol++) {
+#ifdef _OPENMP
+			const int iThread = omp_get_thread_num();
+#else
+			const int iThread = 0;
+#endif
+			fitTrack(_trackFitters[iThread], _pointLists[iThread], tracks[iCol], Bmag >= 1.E-6, results[iCol]);
+		}
+		_fitTime += static_cast<double>(clock() - fitStart) / CLOCKS_PER_SEC;
+		_nFittedTracks += nTracks;
+		//Results are used in the original order of the tracks
+		allTracksForThisEvent.reserve(nTracks);
+		for (int iCol = 0; iCol < nTracks; iCol++) {
+			TrackFitResult& result = results[iCol];
+			if(!result.error.empty()){
+				throw(lcio::Exception(result.error));
 			}
-			_trackFitter->setPairAnyStateAndPointLabelVec(pointList,traj);//This will create a link between any state and it's GBL point label. 
-			double  chi2=0; 
-			int ndf=0;
-			int ierr=0;
-			_trackFitter->computeTrajectoryAndFit(pointList,traj, &chi2,&ndf, ierr);//This will do the minimisation of the chi2 and produce the most probable trajectory.
-			if(ierr == 0 ){
-				streamlog_out(DEBUG5) << "Ierr is: " << ierr << " Entering loop to update track information " << endl;
-				static_cast < AIDA::IHistogram1D* > ( _aidaHistoMap1D[ _histName::_chi2CandidateHistName ] ) -> fill( (chi2)/(ndf));
+			if(result.ierr == 0 ){
+				streamlog_out(MESSAGE0) << "Fit Successful!" << " Track error; "<< result.ierr << " and chi2: " << result.chi2 << std::endl;
+				static_cast < AIDA::IHistogram1D* > ( _aidaHistoMap1D[ _histName::_chi2CandidateHistName ] ) -> fill( (result.chi2)/(result.ndf));
 				static_cast < AIDA::IHistogram1D* > ( _aidaHistoMap1D[ _histName::_fitsuccessHistName ] ) -> fill(1.0);
-				if(chi2 ==0 or ndf ==0){
-				throw(lcio::Exception("Your fitted track has zero degrees of freedom or a chi2 of 0.")); 	
-				}
-
-				track.setChi2(chi2);
-				track.setNdf(ndf);
-				_chi2NdfVec.push_back(chi2/static_cast<float>(ndf));
-				map<int, vector<double> >  mapSensorIDToCorrectionVec;//This is not used now. However it maybe useful to be able to access the corrections that GBL makes to the original track. Since if this is too large then GBL may give th wrong trajectory. Since all the equations are only to first order. 
-				_trackFitter->updateTrackFromGBLTrajectory(traj, pointList,track,mapSensorIDToCorrectionVec);
-				map< int, map< float, float > >  SensorResidual; 
-				map< int, map< float, float > >  SensorResidualError; 
-				_trackFitter->getResidualOfTrackandHits(traj, pointList,track, SensorResidual, SensorResidualError);
-				plotResidual(SensorResidual,SensorResidualError, _first_time);//TO DO: Need to fix how we histogram.
+				_chi2NdfVec.push_back(result.chi2/static_cast<float>(result.ndf));
+				plotResidual(result.residual,result.residualError, _first_time);//TO DO: Need to fix how we histogram.
 				_first_time = false;
 			}else{
-				streamlog_out(DEBUG5) << "Ierr is: " << ierr << " Do not update track information " << endl;
+				streamlog_out(MESSAGE0) << "Fit failed!" << " Track error: "<< result.ierr << " and chi2: " << result.chi2 << std::endl;
 				static_cast < AIDA::IHistogram1D* > ( _aidaHistoMap1D[ _histName::_fitsuccessHistName ] ) -> fill(0.0);
 				continue;//We continue so we don't add an empty track
 			}	
-			allTracksForThisEvent.push_back(track);
+			allTracksForThisEvent.push_back(tracks[iCol]);
 			}//END OF LOOP FOR ALL TRACKS IN AN EVENT
 			outputLCIO(evt, allTracksForThisEvent); 
 			allTracksForThisEvent.clear();//We clear this so we don't add the same track twice
@@ -218,6 +268,69 @@ void EUTelProcessorGBLTrackFit::processEvent(LCEvent * evt){
 }
 
 
+//Fit of a single track. This may run in one of several threads, so it only uses the given fitter and point list and does not touch the histograms.
+//Exceptions are not thrown but returned in the result, they can not leave a parallel loop.
+void EUTelProcessorGBLTrackFit::fitTrack(EUTelGBLFitter* fitter, std::vector< gbl::GblPoint >& pointList, EUTelTrack& track, bool curved, TrackFitResult& result){
+	try{
+		fitter->resetPerTrack(); //Here we reset the label that connects state to GBL point to 1 again. Also we set the list of states->labels to 0
+		if(streamlog_level(DEBUG1)){
+			track.print();//Print the track use for debugging
+		}
+		fitter->testTrack(track);//Check the track has states and hits  
+		pointList.clear();//Keeps the memory of the previous tracks
+		//The TGeo navigation used to describe the setup is not thread safe. So only one thread at a time.
+		bool pointListSet = false;
+#ifdef _OPENMP
+#pragma omp critical (EUTelGeometry)
+#endif
+		{
+			try{
+				fitter->setInformationForGBLPointList(track, pointList);//Here we describe the whole setup. Geometry, scattering, data...
+				pointListSet = true;
+			}
+			catch(std::string &e){
+				result.error = e;
+			}
+			catch(lcio::Exception& e){
+				result.error = e.what();
+			}
+			catch(...){
+				result.error = "Unknown exception in setInformationForGBLPointList of EUTelGBLFitter";
+			}
+		}
+		if(!pointListSet){
+			return;
+		}
+		fitter->setPairMeasurementStateAndPointLabelVec(pointList);//This will create a link between the states that have a hit associated with them and the GBL label that is associated with the state.
+		//Here we create the trajectory from the points created by setInformationForGBLPointList. This will take the points and propagation jacobian and split this into smaller matrices to describe the problem in terms of offsets. Here is the difference between GBL and other fitting algorithms.  
+		gbl::GblTrajectory traj( pointList, curved );
+		fitter->setPairAnyStateAndPointLabelVec(pointList,&traj);//This will create a link between any state and it's GBL point label. 
+		fitter->computeTrajectoryAndFit(pointList,&traj, &result.chi2,&result.ndf, result.ierr);//This will do the minimisation of the chi2 and produce the most probable trajectory.
+		if(result.ierr == 0 ){
+			streamlog_out(DEBUG5) << "Ierr is: " << result.ierr << " Entering loop to update track information " << endl;
+			if(result.chi2 ==0 or result.ndf ==0){
+				throw(lcio::Exception("Your fitted track has zero degrees of freedom or a chi2 of 0.")); 	
+			}
+			track.setChi2(result.chi2);
+			track.setNdf(result.ndf);
+			map<int, vector<double> >  mapSensorIDToCorrectionVec;//This is not used now. However it maybe useful to be able to access the corrections that GBL makes to the original track. Since if this is too large then GBL may give th wrong trajectory. Since all the equations are only to first order. 
+			fitter->updateTrackFromGBLTrajectory(&traj, pointList,track,mapSensorIDToCorrectionVec);
+			fitter->getResidualOfTrackandHits(&traj, pointList,track, result.residual, result.residualError);
+		}else{
+			streamlog_out(DEBUG5) << "Ierr is: " << result.ierr << " Do not update track information " << endl;
+		}
+	}
+	catch(std::string &e){
+		result.error = e;
+	}
+	catch(lcio::Exception& e){
+		result.error = e.what();
+	}
+	catch(...){
+		result.error = "Unknown exception in fitTrack function of EUTelProcessorGBLTrackFit";
+	}
+}
+
 //TO DO:This is a very stupid way to histogram but will add new class to do this is long run 
 void EUTelProcessorGBLTrackFit::plotResidual(map< int, map<float, float > >  & sensorResidual, map< int, map<float, float > >  & sensorResidualError, bool &first_time){
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////Residual plot
@@ -293,6 +406,10 @@ void EUTelProcessorGBLTrackFit::end() {
 	}
 	//TO DO: We really should have a better way to look track per track	and see if the correction is too large. 
 	std::vector<double> correctionTotal = _trackFitter->getCorrectionsTotal();
+	for(size_t iThread = 1; iThread < _trackFitters.size(); ++iThread){//Sum the corrections of all fitting threads
+		const std::vector<double> correctionThread = _trackFitters[iThread]->getCorrectionsTotal();
+		for(size_t i = 0; i < correctionTotal.size(); ++i) correctionTotal[i] += correctionThread[i];
+	}
 	streamlog_out(MESSAGE9)<<"This is the average correction for omega: " <<correctionTotal.at(0)/sizeFittedTracks<<endl;	
 	streamlog_out(MESSAGE9)<<"This is the average correction for local xz inclination: " <<correctionTotal.at(1)/sizeFittedTracks<<endl;	
 	streamlog_out(MESSAGE9)<<"This is the average correction for local yz inclination: " <<correctionTotal.at(2)/sizeFittedTracks<<endl;	
@@ -301,6 +418,9 @@ void EUTelProcessorGBLTrackFit::end() {
 
   float average = total/sizeFittedTracks;
 	streamlog_out(MESSAGE9) << "This is the average chi2 -"<< average <<std::endl;
+	if(_nFittedTracks > 0 && _fitTime > 0.){
+		streamlog_out(MESSAGE9) << "GBL track fit throughput: " << _nFittedTracks/_fitTime << " tracks/s of CPU time (" << _nFittedTracks << " tracks, " << 1000.*_fitTime/_nFittedTracks << " ms per track, " << _nFitThreads << " threads)" << std::endl;
+	}
 
 }
 
@@ -327,15 +447,16 @@ void EUTelProcessorGBLTrackFit::outputLCIO(LCEvent* evt, std::vector<EUTelTrack>
 
 	//Loop through all tracks
 	for (size_t i = 0 ; i < tracks.size(); ++i){
-		EUTelTrack* trackheap = new  EUTelTrack(tracks.at(i), false); //We dont want to copy contents so set to false. We only want the track object but not the states or hits. Since the states should have there own place in memory before saving.
-		trackheap->print();
-		//For every track add this to the collection
-		for( size_t j = 0;j < tracks.at(i).getStates().size();++j){
-			EUTelState* stateheap = new EUTelState(tracks.at(i).getStates().at(j));
-			trackheap->addTrack(stateheap);
-			stateCandCollection->push_back(static_cast<EVENT::Track*>(stateheap));
+		EUTelTrack& track = tracks.at(i);
+		if( track.getChi2()== 0 or track.getNdf() == 0){
+			streamlog_out(MESSAGE5)<<"Chi: "<<track.getChi2() <<" ndf: "<<track.getNdf() <<endl;
+			throw(lcio::Exception("You are trying to create a track that is empty. With another track that has not chi2 or degrees of freedom.")); 	
+		}
+		if(streamlog_level(DEBUG1)){
+			track.print();
 		}
-		trkCandCollection->push_back(static_cast<EVENT::Track*>(trackheap));
+		//For every track add this to the collection. The states go to their own collection.
+		trkCandCollection->push_back(static_cast<EVENT::Track*>(track.createLCIOTrack(stateCandCollection)));
 	}//END TRACK LOOP
 
 	//Now add this collection to the 
@@ -27,6 +27,7 @@
 #include "EUTelDFFClusterImpl.h"
 #include "EUTelBrickedClusterImpl.h"
 #include "EUTelSparseClusterImpl.h"
+#include "EUTelClusterSummary.h"
 #include "EUTelExceptions.h"
 #include "EUTelAlignmentConstant.h"
 #include "EUTelReferenceHit.h"
@@ -54,6 +55,7 @@
 #include <IMPL/TrackerPulseImpl.h>
 //#include <TrackerHitImpl2.h>
 #include <IMPL/TrackerHitImpl.h>
+#include <EVENT/LCGenericObject.h>
 #include <UTIL/CellIDDecoder.h>
 #include <UTIL/LCTime.h>
 
@@ -88,13 +90,21 @@ _referenceHitCollectionName("referenceHit"),
 _referenceHitCollectionVec(),
 _wantLocalCoordinates(false),
 _referenceHitLCIOFile("reference.slcio"),
+_etaCorrection(false),
+_etaCollectionNames(),
+_eta2DCollectionName(""),
 _iRun(0),
 _iEvt(0),
 _conversionIdMap(),
 _alreadyBookedSensorID(),
 _aidaHistoMap(),
 _histogramSwitch(true),
-_orderedSensorIDVec()
+_orderedSensorIDVec(),
+_etaXTables(),
+_etaYTables(),
+_eta2DTables(),
+_etaCollections(),
+_noEtaSensorID()
 {
   // modify processor description
   _description =  "EUTelProcessorHitMaker is responsible to translate cluster centers from the local frame of reference \nto the external frame of reference using the GEAR geometry description";
@@ -108,6 +118,16 @@ _orderedSensorIDVec()
   registerOptionalParameter("ReferenceCollection","This is the name of the reference hit collection initialized in this processor. This collection provides the reference vector to correctly determine a plane corresponding to a global hit coordiante.", _referenceHitCollectionName, static_cast<string>("referenceHit") );
  
   registerOptionalParameter("ReferenceHitFile","This is the file where the reference hit collection is stored", _referenceHitLCIOFile, std::string("reference.slcio") );
+
+  registerOptionalParameter("EtaSwitch","Correct the cluster center with the Eta functions loaded as conditions", _etaCorrection, static_cast<bool>(false) );
+
+  EVENT::StringVec etaCollectionNamesExample;
+  etaCollectionNamesExample.push_back("xEtaCondition");
+  etaCollectionNamesExample.push_back("yEtaCondition");
+
+  registerOptionalParameter("EtaCollectionName","The name of the Eta function collections along x and y", _etaCollectionNames, etaCollectionNamesExample );
+
+  registerOptionalParameter("Eta2DCollectionName","The name of the 2D Eta map collection. If set, the maps are used instead of the Eta functions along x and y", _eta2DCollectionName, std::string("") );
 }
 
 
@@ -145,6 +165,10 @@ void EUTelProcessorHitMaker::init() {
 
   _histogramSwitch = true;
 
+  if ( _etaCorrection && _eta2DCollectionName.empty() && _etaCollectionNames.size() != 2 ) {
+    throw InvalidParameterException("EtaCollectionName must contain the Eta collection along x and y");
+  }
+
   DumpReferenceHitDB();
  
 #endif
@@ -282,11 +306,97 @@ void EUTelProcessorHitMaker::processRunHeader (LCRunHeader * rdr) {
 
 
 
+  // the conditions may change with the run
+  _etaCollections.clear();
+
   // increment the run counter
   ++_iRun;
 }
 
 
+namespace {
+  // the Eta tables are stored as LCGenericObject, anything else means a wrong collection name
+  LCGenericObject * getEtaObject( const LCCollection * collection, int iElement, const string & collectionName ) {
+    LCGenericObject * object = dynamic_cast< LCGenericObject * >( collection->getElementAt( iElement ) );
+    if ( object == NULL ) {
+      throw InvalidParameterException( "The Eta collection " + collectionName + " does not contain LCGenericObject elements" );
+    }
+    return object;
+  }
+}
+
+void EUTelProcessorHitMaker::loadEtaTables (LCEvent * event) {
+
+  vector< string > names;
+  if ( _eta2DCollectionName.empty() ) names = _etaCollectionNames;
+  else names.push_back( _eta2DCollectionName );
+
+  vector< const LCCollection * > collections;
+  for ( size_t iName = 0; iName < names.size(); ++iName ) {
+    try {
+      collections.push_back( event->getCollection( names[iName] ) );
+    } catch ( DataNotAvailableException& e ) {
+      streamlog_out ( ERROR4 ) << "The Eta collection " << names[iName] << " is not available, load it with a condition processor"
+                               << " before " << name() << " or switch off EtaSwitch" << endl;
+      throw;
+    }
+  }
+
+  if ( collections == _etaCollections ) return;
+
+  _etaXTables.clear();
+  _etaYTables.clear();
+  _eta2DTables.clear();
+
+  if ( _eta2DCollectionName.empty() ) {
+    // Eta functions without a sensor ID follow the order of the collection
+    for ( int iElement = 0; iElement < collections[0]->getNumberOfElements(); ++iElement ) {
+      EUTelEtaTable table( getEtaObject( collections[0], iElement, names[0] ) );
+      _etaXTables.insert( make_pair( table.getSensorID() < 0 ? iElement : table.getSensorID(), table ) );
+    }
+    for ( int iElement = 0; iElement < collections[1]->getNumberOfElements(); ++iElement ) {
+      EUTelEtaTable table( getEtaObject( collections[1], iElement, names[1] ) );
+      _etaYTables.insert( make_pair( table.getSensorID() < 0 ? iElement : table.getSensorID(), table ) );
+    }
+  } else {
+    for ( int iElement = 0; iElement < collections[0]->getNumberOfElements(); ++iElement ) {
+      EUTelEtaTable2D table( getEtaObject( collections[0], iElement, names[0] ) );
+      _eta2DTables.insert( make_pair( table.getSensorID(), table ) );
+    }
+  }
+
+  _etaCollections.swap( collections );
+  streamlog_out ( DEBUG4 ) << "Eta tables loaded for run " << event->getRunNumber() << " event " << event->getEventNumber() << endl;
+}
+
+
+void EUTelProcessorHitMaker::applyEta (int sensorID, int xSeed, int ySeed, float & xCoG, float & yCoG) {
+
+  if ( !_eta2DCollectionName.empty() ) {
+    map< int, EUTelEtaTable2D >::const_iterator table = _eta2DTables.find( sensorID );
+    if ( table != _eta2DTables.end() ) {
+      double xEta, yEta;
+      table->second.getEta( xCoG - xSeed, yCoG - ySeed, xEta, yEta );
+      xCoG = xSeed + xEta;
+      yCoG = ySeed + yEta;
+      return;
+    }
+  } else {
+    map< int, EUTelEtaTable >::const_iterator xTable = _etaXTables.find( sensorID );
+    map< int, EUTelEtaTable >::const_iterator yTable = _etaYTables.find( sensorID );
+    if ( xTable != _etaXTables.end() && yTable != _etaYTables.end() ) {
+      xCoG = xSeed + xTable->second.getEta( xCoG - xSeed );
+      yCoG = ySeed + yTable->second.getEta( yCoG - ySeed );
+      return;
+    }
+  }
+
+  if ( _noEtaSensorID.insert( sensorID ).second ) {
+    streamlog_out ( WARNING2 ) << "No Eta function for sensor " << sensorID << ", its cluster centers are not corrected" << endl;
+  }
+}
+
+
 void EUTelProcessorHitMaker::processEvent (LCEvent * event) {
 
     ++_iEvt;
@@ -315,6 +425,15 @@ void EUTelProcessorHitMaker::processEvent (LCEvent * event) {
       return ;
     }
 
+    // the clusters are decoded once per event and shared with the
+    // other processors reading the same pulse collection
+    EUTelClusterSummary & clusterSummary = EUTelClusterSummary::getInstance( _pulseCollectionName );
+    if ( !clusterSummary.update( event ) || clusterSummary.getCollection() != pulseCollection
+         || static_cast< int >( clusterSummary.size() ) != pulseCollection->getNumberOfElements() )
+    {
+      throw lcio::Exception( "The cluster summary of " + _pulseCollectionName + " does not match the pulse collection of event "
+                             + to_string( event->getEventNumber() ) + " in run " + to_string( event->getRunNumber() ) );
+    }
 
     try
     {
@@ -329,9 +448,6 @@ void EUTelProcessorHitMaker::processEvent (LCEvent * event) {
     // prepare an encoder for the hit collection
     CellIDEncoder<TrackerHitImpl> idHitEncoder(EUTELESCOPE::HITENCODING, hitCollection);
 
-    CellIDDecoder<TrackerPulseImpl>  clusterCellDecoder(pulseCollection);
-    CellIDDecoder<TrackerDataImpl>   cellDecoder( pulseCollection );
-
     int oldDetectorID = -100;
 
     double xZero = 0., yZero = 0., zZero = 0. ;
@@ -340,17 +456,23 @@ void EUTelProcessorHitMaker::processEvent (LCEvent * event) {
     double xPitch = 0., yPitch = 0.;
     int xNpixels = 0, yNpixels = 0;
 
+    if ( _etaCorrection ) loadEtaTables( event );
+
     for ( int iCluster = 0; iCluster < pulseCollection->getNumberOfElements(); iCluster++ ) 
     {
  	TrackerPulseImpl * clusterFrame = dynamic_cast<TrackerPulseImpl*> ( pulseCollection->getElementAt( iCluster ) ); // actual cluster
+	const EUTelClusterSummary::Cluster & cluster = clusterSummary[ iCluster ];
     
-	int sensorID    = clusterCellDecoder(clusterFrame)["sensorID"];
-	SparsePixelType clusterType = static_cast<SparsePixelType> ( static_cast<int> (clusterCellDecoder(clusterFrame)["type"] ) );
-
+	int sensorID    = cluster.sensorID;
+	SparsePixelType clusterType = static_cast<SparsePixelType> ( static_cast<int> ( cluster.type ) );
+
+	if ( !cluster.isDecoded )
+	{
+	  streamlog_out ( WARNING2 ) << "Cluster " << iCluster << " on sensor " << sensorID << " is of unknown type " << cluster.type << ", skipped" << endl;
+	  continue;
+	}
 	
         TrackerDataImpl  * channelList  = dynamic_cast<TrackerDataImpl*> ( clusterFrame->getTrackerData() ); // list of pixels ?
-		
-        EUTelVirtualCluster * cluster   = new EUTelSparseClusterImpl< EUTelGenericSparsePixel > (static_cast<TrackerDataImpl *> ( channelList ));
 
       // there could be several clusters belonging to the same
       // detector. So update the geometry information only if this new
@@ -395,54 +517,13 @@ void EUTelProcessorHitMaker::processEvent (LCEvent * event) {
       // LOCAL coordinate system !!!!!!
       //
 
-      // get the position of the seed pixel. This is in pixel number.
-      int xCluSeed = 0;
-      int yCluSeed = 0;
-      cluster->getSeedCoord(xCluSeed, yCluSeed);
-
-
-
-      // with the charge center of gravity calculation, we get a shift
-      // from the seed pixel center due to the charge distribution. Those
-      // two numbers are the correction values in the case the Eta
-      // correction is not applied.
-
-
-
-      //!HACK TAKI:
-      //! In case of a bricked cluster, we have to make sure to get the normal CoG first.
-      //! The one without the global seed coordinate correction (caused by pixel rows being skewed).
-      //! That one has to be eta-corrected and the global coordinate correction has to be applied on top of that!
-      //! So prepare a brickedCluster pointer now:
-
-      EUTelBrickedClusterImpl* p_tmpBrickedCluster = NULL;
-      if ( clusterType == kEUTelBrickedClusterImpl )
-      {
-            p_tmpBrickedCluster = dynamic_cast< EUTelBrickedClusterImpl* >(cluster);
-            if (p_tmpBrickedCluster == NULL)
-            {
-                streamlog_out ( ERROR4 ) << " .COULD NOT CREATE EUTelBrickedClusterImpl* !!!" << endl;
-                throw UnknownDataTypeException("COULD NOT CREATE EUTelBrickedClusterImpl* !!!");
-            }
-      }
-
-      float xShift = 0.;
-      float yShift = 0.;
-
-      cluster->getCenterOfGravityShift( xShift, yShift );
-    
-      double xCorrection = static_cast<double> (xShift) ;
-      double yCorrection = static_cast<double> (yShift) ;
-
-      // rescale the pixel number in millimeter
-      double xDet = ( static_cast<double> (xCluSeed) + xCorrection + 0.5 ) * xPitch ;
-      double yDet = ( static_cast<double> (yCluSeed) + yCorrection + 0.5 ) * yPitch ;
-
-// check the hack from Havard:
-      float xCoG(0.0f), yCoG(0.0f);
-      cluster->getCenterOfGravity(xCoG, yCoG);
-      xDet = (xCoG + 0.5) * xPitch;
-      yDet = (yCoG + 0.5) * yPitch; 
+      // the center of gravity is in pixel number, rescale it in
+      // millimeter
+      float xCoG = cluster.xCoG;
+      float yCoG = cluster.yCoG;
+      if ( _etaCorrection ) applyEta( sensorID, cluster.xSeed, cluster.ySeed, xCoG, yCoG );
+      double xDet = (xCoG + 0.5) * xPitch;
+      double yDet = (yCoG + 0.5) * yPitch; 
 
       streamlog_out(DEBUG1) << "cluster[" << setw(4) << iCluster << "] on sensor[" << setw(3) << sensorID 
                             << "] at [" << setw(8) << setprecision(3) << xCoG << ":" << setw(8) << setprecision(3) << yCoG << "]"
@@ -537,9 +618,6 @@ void EUTelProcessorHitMaker::processEvent (LCEvent * event) {
 
       // add the new hit to the hit collection
       hitCollection->push_back( hit );
- 
-      // delete the eutel cluster
-      delete cluster;
     }
 
     try
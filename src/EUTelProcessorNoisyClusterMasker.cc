@@ -52,7 +52,8 @@ EUTelProcessorNoisyClusterMasker::EUTelProcessorNoisyClusterMasker():
   _iEvt(0),
   _firstEvent(true),
   _dataFormatChecked(false),
-  _wrongDataFormat(false)
+  _wrongDataFormat(false),
+  _hotPixelMask(NULL)
 {
   _description ="EUTelProcessorNoisyClusterMasker masks pulses which contain hot pixels. For this, the quality field of pulses is used to encode the kNoisyCluster enum provided by EUTelescope.";
 
@@ -70,6 +71,8 @@ void EUTelProcessorNoisyClusterMasker::init ()
   // set to zero the run and event counters
   _iRun = 0;
   _iEvt = 0;
+
+  _hotPixelMask = &EUTelHotPixelMask::getInstance( _hotPixelCollectionName );
 }
 
 void EUTelProcessorNoisyClusterMasker::processRunHeader(LCRunHeader* rdr){
@@ -84,13 +87,12 @@ void EUTelProcessorNoisyClusterMasker::processRunHeader(LCRunHeader* rdr){
 
 void EUTelProcessorNoisyClusterMasker::processEvent(LCEvent * event) 
 {
-	if(_firstEvent)
+	//The hot pixel collection is shared with the other processors and only loaded once per run
+	if( !_hotPixelMask->update(event) && _firstEvent && !_hotPixelCollectionName.empty() )
 	{
-		//The hot pixel collection stores all thot pixels in event #1
-		//Thus we have to read it in in that case
-		readHotPixelList(event);
-		_firstEvent = false;
+		streamlog_out ( WARNING1 ) << "READ CAREFULLY: This means that no hot pixels will be removed, despite the processor successfully running!" << endl;
 	}
+	_firstEvent = false;
 
  	// get the collection of interest from the event.
 	LCCollectionVec* pulseInputCollectionVec = NULL;
@@ -119,43 +121,14 @@ void EUTelProcessorNoisyClusterMasker::processEvent(LCEvent * event)
         	TrackerPulseImpl* pulseData = dynamic_cast<TrackerPulseImpl*> ( pulseInputCollectionVec->getElementAt( iPulse ) );
 		int sensorID = cellDecoder(pulseData)["sensorID"];		
 	
-	        //get the noise vector for the given plane
-		std::vector<int>* noiseVector = &(_hotPixelMap[sensorID]);
-		
 		//each pulse has the tracker data attached to it
 		TrackerDataImpl* trackerData = dynamic_cast<TrackerDataImpl*>( pulseData->getTrackerData() );
 		//decoder for tracker data
 		CellIDDecoder<TrackerDataImpl> trackerDecoder ( EUTELESCOPE::ZSCLUSTERDEFAULTENCODING );
 		int pixelType = trackerDecoder(trackerData)["sparsePixelType"];
 
-		//interface to sparsified data
-                auto_ptr<EUTelTrackerDataInterfacer> sparseData = auto_ptr<EUTelTrackerDataInterfacer>();
-
-		if( pixelType == kEUTelGenericSparsePixel )
-		{
-			sparseData =  auto_ptr<EUTelTrackerDataInterfacer>( new EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel>(trackerData) );
-		}
-		else
-                {
-		}
-
-		bool noisy = false;
-
-		//IMPORTANT: if we pass a nullptr to EUTelBaseSparsePixel* getSparsePixelAt( int index, EUTelBaseSparsePixel* pixel)
-		//where pixel=NULL, this method will return a pointer to a new pixel of derived type. YOU have to delete it!
-		EUTelBaseSparsePixel* pixel = NULL;
-
-		//Loop over all hits!
-		for ( unsigned int iPixel = 0; iPixel < sparseData->size(); iPixel++ )
-       		{
-			//IF pixel=NULL this yields a new pixel
-		        pixel = sparseData->getSparsePixelAt( iPixel, pixel );
-			if(std::binary_search( noiseVector->begin(), noiseVector->end(), encode(pixel->getXCoord(), pixel->getYCoord()) ))
-			{
-				noisy=true;
-				break;
-			}
-		}
+		//the bitmap is first checked word by word over the cluster area, then pixel by pixel
+		bool noisy = ( pixelType == kEUTelGenericSparsePixel ) && _hotPixelMask->clusterTouchesMask( sensorID, trackerData );
 
 		if(noisy)
 		{
@@ -169,10 +142,7 @@ void EUTelProcessorNoisyClusterMasker::processEvent(LCEvent * event)
 			cellReencoder.setCellID(pulseData);
 			_maskedNoisyClusters[sensorID]++;
 		}
-	
-		delete pixel;
         }
-//rest of memory cleaned up by auto_ptrs
 }
 
 void EUTelProcessorNoisyClusterMasker::end() 
@@ -185,74 +155,3 @@ void EUTelProcessorNoisyClusterMasker::end()
   		streamlog_out ( MESSAGE4 ) << "Masked " << (*it).second << " noisy clusters on plane " << (*it).first << "." << endl;
 	}
 }
-
-int EUTelProcessorNoisyClusterMasker::encode(int X, int Y)
-{
-	//Cantor pairing function
-	return static_cast<int>( 0.5*(X+Y)*(X+Y+1)+Y );
-} 
-
-void EUTelProcessorNoisyClusterMasker::readHotPixelList(LCEvent* event)
-{
-	//Preapare pointer to hot pixel collection
-	LCCollectionVec* hotPixelCollectionVec = NULL;
-
-	//Try to obtain the collection
-	try 
-	{
-		hotPixelCollectionVec = static_cast< LCCollectionVec*>( event->getCollection(_hotPixelCollectionName) );
-	}	
-	catch (...)
-    	{
-		if (!_hotPixelCollectionName.empty())
-		{
-			streamlog_out ( WARNING1 ) << "_hotPixelCollectionName " << _hotPixelCollectionName.c_str() << " not found" << endl;
-			streamlog_out ( WARNING1 ) << "READ CAREFULLY: This means that no hot pixels will be removed, despite the processor successfully running!" << endl;
-		}
-		return;
-    	}
-
-	//Decoder to get sensor ID
-	CellIDDecoder<TrackerDataImpl> cellDecoder( hotPixelCollectionVec );
-
-        EUTelBaseSparsePixel* pixel = NULL;
-
-	//Loop over all hot pixels
-	for(int i=0; i<  hotPixelCollectionVec->getNumberOfElements(); i++)
-	{
-		//Get the TrackerData for the sensor ID
-		TrackerDataImpl* hotPixelData = dynamic_cast< TrackerDataImpl *> ( hotPixelCollectionVec->getElementAt( i ) );
-		int sensorID = cellDecoder( hotPixelData )["sensorID"];
-		int pixelType = cellDecoder( hotPixelData )["sparsePixelType"];
-		//And get the corresponding noise vector for that plane
-		std::vector<int>* noiseSensorVector = &(_hotPixelMap[sensorID]);
-
-		auto_ptr<EUTelTrackerDataInterfacer> noisyPixelData = auto_ptr<EUTelTrackerDataInterfacer>();
-
-		if( pixelType == kEUTelGenericSparsePixel )
-		{
-			noisyPixelData =  auto_ptr<EUTelTrackerDataInterfacer>( new EUTelTrackerDataInterfacerImpl<EUTelGenericSparsePixel>(hotPixelData) );
-		}
-		//else if
-		else
-		{
-		}
-		//Store all the noisy pixels in the noise vector, use the provided encoding to map two int's to an unique int
-		for ( unsigned int iPixel = 0; iPixel < noisyPixelData->size(); iPixel++ ) 
-		{
-			pixel = noisyPixelData->getSparsePixelAt( iPixel, pixel);
-			noiseSensorVector->push_back( encode(pixel->getXCoord(), pixel->getYCoord()) );
-
-		}
-	}
-
-	delete pixel;
-
-	for( std::map<int, std::vector<int> >::iterator it = _hotPixelMap.begin(); it != _hotPixelMap.end(); ++it)
-	{
-		//Sort the hot pixel maps
-		std::sort( (it->second).begin(), (it->second).end() );
-		std::cout << "Read in " << (it->second).size() << " hot pixels on plane " << (it->first) << std::endl;
-	}
-}
-
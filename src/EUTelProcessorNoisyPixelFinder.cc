@@ -74,6 +74,9 @@ EUTelProcessorNoisyPixelFinder::EUTelProcessorNoisyPixelFinder():
   _iEvt(0),
   _sensorIDVec(),
   _hotpixelDBFile(""),
+  _hitCountFile(""),
+  _hitCountCollectionName(""),
+  _nCountedEvents(0),
   _finished(false)
 {
   //processor description
@@ -106,6 +109,13 @@ EUTelProcessorNoisyPixelFinder::EUTelProcessorNoisyPixelFinder():
 
   registerOptionalParameter("HotPixelCollectionName", "This is the name of the hot pixel collection to be saved into the output slcio file",
                              _hotPixelCollectionName, static_cast< string > ( "hotpixel" ));
+
+  registerOptionalParameter("HitCountFile", "Name of the LCIO file with the hit count of every pixel, to be merged with hotpixelmerge."
+                             " Leave empty not to write it",
+                             _hitCountFile, static_cast< string > ( "" ));
+
+  registerOptionalParameter("HitCountCollectionName", "Name of the hit count collection in the HitCountFile, read by hotpixelmerge -i",
+                             _hitCountCollectionName, static_cast< string > ( "hitcount" ));
 }
 
 EUTelProcessorNoisyPixelFinder::~EUTelProcessorNoisyPixelFinder()
@@ -178,6 +188,7 @@ void EUTelProcessorNoisyPixelFinder::init()
 	// set to zero the run and event counters
 	_iRun = 0;
 	_iEvt = 0;
+	_nCountedEvents = 0;
 
 	//init new geometry
 	std::string name("test.root");
@@ -314,10 +325,24 @@ void EUTelProcessorNoisyPixelFinder::processEvent (LCEvent * event)
 
 	//don't forget to increment the event counter
 	++_iEvt;
+	++_nCountedEvents;
 }
 
 void EUTelProcessorNoisyPixelFinder::end() 
 {
+	if(!_hitCountFile.empty())
+	{
+		//the hit counts of a part of a run are merged with the other parts later on,
+		//so a job with fewer events than NoOfEvents is fine
+		HitCountWriter();
+		if(!_finished)
+		{
+			streamlog_out ( MESSAGE4 ) << "Hit counts of " << _nCountedEvents << " events written to " << _hitCountFile
+						   << ", use hotpixelmerge to build the hot pixel DB" << std::endl;
+			return;
+		}
+	}
+
 	if(_finished)
 	{
 		streamlog_out ( MESSAGE4 ) << "Noisy pixel finder has successfully finished!" << std::endl;
@@ -515,6 +540,68 @@ void EUTelProcessorNoisyPixelFinder::HotPixelDBWriter()
     lcWriter->close();
 }
 
+void EUTelProcessorNoisyPixelFinder::HitCountWriter()
+{
+	streamlog_out ( DEBUG5 ) << "Writing out the hit counts into " << _hitCountFile << std::endl;
+
+	auto_ptr<LCWriter> lcWriter( LCFactory::getInstance()->createLCWriter() );
+	try
+	{
+		lcWriter->open( _hitCountFile, LCIO::WRITE_NEW );
+	}
+	catch ( IOException& e )
+	{
+		streamlog_out ( ERROR4 ) << e.what() << std::endl << "Sorry, was not able to create the hit count file " << _hitCountFile << std::endl;
+		return;
+	}
+
+	auto_ptr<LCRunHeaderImpl> lcHeader( new LCRunHeaderImpl );
+	lcHeader->setRunNumber( 0 );
+	lcWriter->writeRunHeader( lcHeader.get() );
+
+	auto_ptr<LCEventImpl> event( new LCEventImpl );
+	event->setRunNumber( 0 );
+	event->setEventNumber( 0 );
+	LCTime now;
+	event->setTimeStamp( now.timeStamp() );
+
+	// the pixels which fired at least once, with the hit count as signal
+	LCCollectionVec* hitCountCollection = new LCCollectionVec( lcio::LCIO::TRACKERDATA );
+	hitCountCollection->parameters().setValue( EUTELESCOPE::NOOFEVENT, _nCountedEvents );
+	event->addCollection( hitCountCollection, _hitCountCollectionName );
+
+	CellIDEncoder< TrackerDataImpl > hitCountEncoder( eutelescope::EUTELESCOPE::ZSDATADEFAULTENCODING, hitCountCollection );
+	for( std::map<int, std::vector<std::vector<int> >* >::iterator it = _hitVecMap.begin(); it != _hitVecMap.end(); ++it )
+	{
+		hitCountEncoder["sensorID"]        = it->first;
+		hitCountEncoder["sparsePixelType"] = eutelescope::kEUTelGenericSparsePixel;
+
+		std::auto_ptr<lcio::TrackerDataImpl> currentFrame( new lcio::TrackerDataImpl );
+		hitCountEncoder.setCellID( currentFrame.get() );
+		std::auto_ptr< eutelescope::EUTelTrackerDataInterfacerImpl<eutelescope::EUTelGenericSparsePixel> >
+		sparseFrame( new eutelescope::EUTelTrackerDataInterfacerImpl< eutelescope::EUTelGenericSparsePixel > ( currentFrame.get() ) );
+
+		const sensor & currentSensor = _sensorMap[it->first];
+		const std::vector<std::vector<int> > & hitVector = *(it->second);
+		for( size_t x = 0; x < hitVector.size(); ++x )
+		{
+			for( size_t y = 0; y < hitVector[x].size(); ++y )
+			{
+				if( hitVector[x][y] == 0 ) continue;
+				EUTelGenericSparsePixel pixel;
+				pixel.setXCoord( x + currentSensor.offX );
+				pixel.setYCoord( y + currentSensor.offY );
+				pixel.setSignal( hitVector[x][y] );
+				sparseFrame->addSparsePixel( &pixel );
+			}
+		}
+		hitCountCollection->push_back( currentFrame.release() );
+	}
+
+	lcWriter->writeEvent( event.get() );
+	lcWriter->close();
+}
+
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
 
 void EUTelProcessorNoisyPixelFinder::bookAndFillHistos() 
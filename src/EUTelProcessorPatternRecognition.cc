@@ -250,13 +250,9 @@ void EUTelProcessorPatternRecognition::outputLCIO(LCEvent* evt, std::vector<EUTe
 
 		//Loop through all tracks
 		for ( size_t i = 0 ; i < tracks.size(); ++i) {
-			EUTelTrack* trackheap = new  EUTelTrack(tracks[i]);
-			trackheap->print();
-			//For every track add this to the collection
-			trkCandCollection->push_back(static_cast<EVENT::Track*>(trackheap));
-			for(size_t j = 0;j < trackheap->getTracks().size();++j){
-				stateCandCollection->push_back(trackheap->getTracks().at(j) );
-			}
+			tracks[i].print();
+			//For every track add this to the collection. The states go to their own collection.
+			trkCandCollection->push_back(static_cast<EVENT::Track*>(tracks[i].createLCIOTrack(stateCandCollection)));
 		}//END TRACK LOOP
 
 		//Now add this collection to the 
@@ -275,12 +271,13 @@ void EUTelProcessorPatternRecognition::plotHistos( vector<EUTelTrack>& trackCand
 	streamlog_out( MESSAGE2 ) << "Event #" << _nProcessedEvents << endl;
 	int numberOfHits =0;
 	for (size_t i = 0; i< trackCandidates.size( ) ; ++i ) {//loop over all tracks
-		for(size_t j = 0; j <trackCandidates[i].getTracks().size(); ++j){//loop over all states 
-			if(!trackCandidates[i].getStates()[j].getTrackerHits().empty()){//We only ever store on hit per state
+		const std::vector<EUTelState>& states = trackCandidates[i].getStates();
+		for(size_t j = 0; j <states.size(); ++j){//loop over all states 
+			if(states[j].getIsThereAHit()){//We only ever store on hit per state
 				continue;
 			}
 			numberOfHits++;
-			int sensorID = static_cast<int>(trackCandidates[i].getTracks()[j]->getZ0());//since we store sensor ID in Z0
+			int sensorID = states[j].getLocation();
 			static_cast < AIDA::IHistogram1D* > ( _aidaHistoMap1D[ _histName::_HitOnTrackCandidateHistName ] ) -> fill( sensorID );
 		}
 	streamlog_out( MESSAGE1 ) << "Track hits end:==============" << std::endl;
@@ -44,7 +44,7 @@ void EUTelProcessorTrackAnalysis::processEvent(LCEvent * evt){
 	if (eventCollection != NULL) {
 		streamlog_out(DEBUG2) << "Collection contains data! Continue!" << endl;
 		for (int iTrack = 0; iTrack < eventCollection->getNumberOfElements(); ++iTrack){
-			EUTelTrack track = *(static_cast<EUTelTrack*> (eventCollection->getElementAt(iTrack)));
+			EUTelTrack track(static_cast<EVENT::Track*> (eventCollection->getElementAt(iTrack)));
 			_analysis->plotResidualVsPosition(track);	
 			_analysis->plotIncidenceAngles(track);
 		}
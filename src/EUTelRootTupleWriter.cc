@@ -0,0 +1,280 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+#if defined(USE_ROOT) || defined(MARLIN_USE_ROOT)
+
+// eutelescope includes ".h"
+#include "EUTelRootTupleWriter.h"
+
+// marlin includes ".h"
+#include "marlin/VerbosityLevels.h"
+
+// lcio includes <.h>
+#include <Exceptions.h>
+
+// ROOT includes
+#include <TFile.h>
+#include <TTree.h>
+#include <TROOT.h>
+#include <RVersion.h>
+
+// system includes <>
+#include <algorithm>
+
+using namespace std;
+using namespace eutelescope;
+
+namespace {
+  //! Leaf type of the scalar column types, in the order of ColumnType
+  const char * leafTypes[] = { "/I", "/L", "/F", "/D" };
+}
+
+EUTelRootTupleWriter::EUTelRootTupleWriter() :
+  _file(NULL),
+  _trees(),
+  _columns(),
+  _basketSize(0),
+  _autoFlush(0),
+  _treeRow(),
+  _intVectorAddresses(),
+  _doubleVectorAddresses(),
+  _row(&_treeRow),
+  _booked(false),
+  _background(false),
+  _nRows(0),
+  _nFillErrors(0),
+  _queue(),
+  _queueDepth(0)
+#ifdef USE_PTHREAD
+  ,_thread(),
+  _mutex(),
+  _rowQueued(),
+  _rowWritten(),
+  _nQueued(0),
+  _producerSlot(0),
+  _consumerSlot(0),
+  _stop(false)
+#endif
+{
+  fill_n( _nSlots, 6, 0 );
+}
+
+EUTelRootTupleWriter::~EUTelRootTupleWriter() {
+  if ( _file ) close();
+}
+
+void EUTelRootTupleWriter::open( const string & fileName, int compressionLevel, int basketSize, Long64_t autoFlush, int queueDepth ) {
+#if defined(USE_PTHREAD) && ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+  // must be on before the file and the trees exist, they are used by the writer thread later
+  if ( queueDepth > 0 ) ROOT::EnableThreadSafety();
+#endif
+  _file = new TFile( fileName.c_str(), "RECREATE" );
+  if ( _file->IsZombie() ) {
+    delete _file;
+    _file = NULL;
+    throw lcio::IOException( "Unable to open the n-tuple file " + fileName );
+  }
+  if ( compressionLevel >= 0 ) _file->SetCompressionLevel( compressionLevel );
+  _basketSize = basketSize;
+  _autoFlush  = autoFlush;
+  _queueDepth = queueDepth > 0 ? queueDepth : 0;
+}
+
+int EUTelRootTupleWriter::addTree( const string & name, const string & title ) {
+  _file->cd();
+  TTree * tree = new TTree( name.c_str(), title.c_str() );
+  // the tree header is written once at the end instead of every few MB
+  tree->SetAutoSave( 1000000000 );
+  if ( _autoFlush != 0 ) tree->SetAutoFlush( _autoFlush );
+  _trees.push_back( tree );
+  return static_cast< int >( _trees.size() ) - 1;
+}
+
+int EUTelRootTupleWriter::addColumn( int tree, const string & name, ColumnType type, size_t reserve ) {
+  if ( _booked ) throw lcio::Exception( "EUTelRootTupleWriter: column " + name + " added after book()" );
+  Column column;
+  column.tree    = tree;
+  column.name    = name;
+  column.type    = type;
+  column.slot    = _nSlots[type]++;
+  column.reserve = reserve;
+  _columns.push_back( column );
+  return static_cast< int >( _columns.size() ) - 1;
+}
+
+void EUTelRootTupleWriter::addFriend( int tree, int friendTree ) {
+  if ( _booked ) throw lcio::Exception( "EUTelRootTupleWriter: friend of tree " + string( _trees[tree]->GetName() ) + " added after book()" );
+  _trees[tree]->AddFriend( _trees[friendTree] );
+}
+
+void EUTelRootTupleWriter::allocate( Row & row ) const {
+  row.ints.assign( _nSlots[kInt], 0 );
+  row.longs.assign( _nSlots[kLong], 0 );
+  row.floats.assign( _nSlots[kFloat], 0.f );
+  row.doubles.assign( _nSlots[kDouble], 0. );
+  row.intVectors.resize( _nSlots[kIntVector] );
+  row.doubleVectors.resize( _nSlots[kDoubleVector] );
+  for ( size_t i = 0; i < _columns.size(); ++i ) {
+    const Column & c = _columns[i];
+    if ( c.type == kIntVector ) row.intVectors[c.slot].reserve( c.reserve );
+    else if ( c.type == kDoubleVector ) row.doubleVectors[c.slot].reserve( c.reserve );
+  }
+}
+
+void EUTelRootTupleWriter::book() {
+  allocate( _treeRow );
+  _intVectorAddresses.resize( _nSlots[kIntVector] );
+  for ( size_t i = 0; i < _intVectorAddresses.size(); ++i ) _intVectorAddresses[i] = &_treeRow.intVectors[i];
+  _doubleVectorAddresses.resize( _nSlots[kDoubleVector] );
+  for ( size_t i = 0; i < _doubleVectorAddresses.size(); ++i ) _doubleVectorAddresses[i] = &_treeRow.doubleVectors[i];
+
+  for ( size_t i = 0; i < _columns.size(); ++i ) {
+    const Column & c = _columns[i];
+    TTree * tree = _trees[c.tree];
+    switch ( c.type ) {
+    case kInt:          tree->Branch( c.name.c_str(), &_treeRow.ints[c.slot],    ( c.name + leafTypes[c.type] ).c_str() ); break;
+    case kLong:         tree->Branch( c.name.c_str(), &_treeRow.longs[c.slot],   ( c.name + leafTypes[c.type] ).c_str() ); break;
+    case kFloat:        tree->Branch( c.name.c_str(), &_treeRow.floats[c.slot],  ( c.name + leafTypes[c.type] ).c_str() ); break;
+    case kDouble:       tree->Branch( c.name.c_str(), &_treeRow.doubles[c.slot], ( c.name + leafTypes[c.type] ).c_str() ); break;
+    case kIntVector:    tree->Branch( c.name.c_str(), &_intVectorAddresses[c.slot] ); break;
+    case kDoubleVector: tree->Branch( c.name.c_str(), &_doubleVectorAddresses[c.slot] ); break;
+    default:
+      throw lcio::Exception( "EUTelRootTupleWriter: column " + c.name + " has an unknown type" );
+    }
+  }
+  if ( _basketSize > 0 ) {
+    for ( size_t i = 0; i < _trees.size(); ++i ) _trees[i]->SetBasketSize( "*", _basketSize );
+  }
+  _booked = true;
+  _row = &_treeRow;
+
+  if ( _queueDepth == 0 ) return;
+#if defined(USE_PTHREAD) && ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+  // one slot more than the queue depth: the row being filled by the processor
+  _queue.resize( _queueDepth + 1 );
+  for ( size_t i = 0; i < _queue.size(); ++i ) allocate( _queue[i] );
+  _nQueued = _producerSlot = _consumerSlot = 0;
+  _stop = false;
+  pthread_mutex_init( &_mutex, NULL );
+  pthread_cond_init( &_rowQueued, NULL );
+  pthread_cond_init( &_rowWritten, NULL );
+  if ( pthread_create( &_thread, NULL, writerThread, this ) == 0 ) {
+    _background = true;
+    _row = &_queue[_producerSlot];
+  } else {
+    streamlog_out ( WARNING2 ) << "Unable to start the n-tuple writer thread, trees are filled in the processing thread" << endl;
+    pthread_cond_destroy( &_rowWritten );
+    pthread_cond_destroy( &_rowQueued );
+    pthread_mutex_destroy( &_mutex );
+  }
+#else
+  streamlog_out ( WARNING2 ) << "Background n-tuple writing needs pthreads and ROOT 6, trees are filled in the processing thread" << endl;
+#endif
+}
+
+void EUTelRootTupleWriter::clearRow() {
+  for ( size_t i = 0; i < _row->intVectors.size(); ++i ) _row->intVectors[i].clear();
+  for ( size_t i = 0; i < _row->doubleVectors.size(); ++i ) _row->doubleVectors[i].clear();
+}
+
+void EUTelRootTupleWriter::fillTrees( Row & row ) {
+  if ( &row != &_treeRow ) {
+    // scalars are copied, vectors swapped: the branch addresses stay valid and no memory moves
+    copy( row.ints.begin(), row.ints.end(), _treeRow.ints.begin() );
+    copy( row.longs.begin(), row.longs.end(), _treeRow.longs.begin() );
+    copy( row.floats.begin(), row.floats.end(), _treeRow.floats.begin() );
+    copy( row.doubles.begin(), row.doubles.end(), _treeRow.doubles.begin() );
+    for ( size_t i = 0; i < row.intVectors.size(); ++i ) _treeRow.intVectors[i].swap( row.intVectors[i] );
+    for ( size_t i = 0; i < row.doubleVectors.size(); ++i ) _treeRow.doubleVectors[i].swap( row.doubleVectors[i] );
+  }
+  for ( size_t i = 0; i < _trees.size(); ++i ) {
+    if ( _trees[i]->Fill() < 0 ) ++_nFillErrors;
+  }
+  for ( size_t i = 0; i < row.intVectors.size(); ++i ) row.intVectors[i].clear();
+  for ( size_t i = 0; i < row.doubleVectors.size(); ++i ) row.doubleVectors[i].clear();
+}
+
+void EUTelRootTupleWriter::fill() {
+  ++_nRows;
+  if ( !_background ) {
+    fillTrees( *_row );
+    return;
+  }
+#ifdef USE_PTHREAD
+  pthread_mutex_lock( &_mutex );
+  ++_nQueued;
+  pthread_cond_signal( &_rowQueued );
+  _producerSlot = ( _producerSlot + 1 ) % _queue.size();
+  while ( _nQueued == _queue.size() ) pthread_cond_wait( &_rowWritten, &_mutex );
+  pthread_mutex_unlock( &_mutex );
+  _row = &_queue[_producerSlot];
+#endif
+}
+
+#ifdef USE_PTHREAD
+void * EUTelRootTupleWriter::writerThread( void * writer ) {
+  static_cast< EUTelRootTupleWriter * >( writer )->writeQueue();
+  return NULL;
+}
+
+void EUTelRootTupleWriter::writeQueue() {
+  for ( ;; ) {
+    pthread_mutex_lock( &_mutex );
+    while ( _nQueued == 0 && !_stop ) pthread_cond_wait( &_rowQueued, &_mutex );
+    if ( _nQueued == 0 ) {
+      pthread_mutex_unlock( &_mutex );
+      return;
+    }
+    Row & row = _queue[_consumerSlot];
+    pthread_mutex_unlock( &_mutex );
+
+    fillTrees( row );
+
+    pthread_mutex_lock( &_mutex );
+    _consumerSlot = ( _consumerSlot + 1 ) % _queue.size();
+    --_nQueued;
+    pthread_cond_signal( &_rowWritten );
+    pthread_mutex_unlock( &_mutex );
+  }
+}
+#endif
+
+void EUTelRootTupleWriter::finish() {
+#ifdef USE_PTHREAD
+  if ( _background ) {
+    pthread_mutex_lock( &_mutex );
+    _stop = true;
+    pthread_cond_signal( &_rowQueued );
+    pthread_mutex_unlock( &_mutex );
+    pthread_join( _thread, NULL );
+    pthread_cond_destroy( &_rowWritten );
+    pthread_cond_destroy( &_rowQueued );
+    pthread_mutex_destroy( &_mutex );
+    _background = false;
+    _row = &_treeRow;
+  }
+#endif
+  if ( _nFillErrors > 0 ) {
+    streamlog_out ( ERROR5 ) << _nFillErrors << " n-tuple rows could not be written to " << ( _file ? _file->GetName() : "" ) << endl;
+    _nFillErrors = 0;
+  }
+}
+
+void EUTelRootTupleWriter::close() {
+  finish();
+  if ( !_file ) return;
+  _file->cd();
+  _file->Write();
+  _file->Close();
+  delete _file;
+  _file = NULL;
+  _trees.clear();
+}
+
+#endif // USE_ROOT || MARLIN_USE_ROOT
@@ -1,46 +1,68 @@
 #include "EUTelState.h"
 
 using namespace eutelescope;
-EUTelState::EUTelState(){
-setBeamCharge(-1.0);
-setBeamEnergy(5.0);
+EUTelState::EUTelState():
+_location(0),
+_dimension(0),
+_intersectionLocalXZ(0),
+_intersectionLocalYZ(0),
+_omega(0),
+_beamEnergy(0),
+_beamCharge(0),
+_arcLengthToNextState(0),
+_hit(NULL)
+{
+	_position[0] = _position[1] = _position[2] = 0;
+	_kinks[0] = _kinks[1] = 0;
+	_covCombinedMatrix[0] = _covCombinedMatrix[1] = _covCombinedMatrix[2] = _covCombinedMatrix[3] = 0;
+	setBeamCharge(-1.0);
+	setBeamEnergy(5.0);
 } 
-
-EUTelState::EUTelState(EUTelState *state){
-	//cout<<"Entering the copy constructor"<<endl;
-	setDimensionSize(state->getDimensionSize());
-	setLocation(state->getLocation());//This stores the location as a float in Z0 since no location for track LCIO. This is preferable to problems with storing hits.  
-	//cout<<"HEREoldstate: "<<state->getPosition()[0]<<","<<state->getPosition()[1]<<","<<state->getPosition()[2]<<","<<state->getLocation()<<endl;
-	float position[] = {state->getPosition()[0],state->getPosition()[1],state->getPosition()[2]};//Z position is not a state parameter but should add here for use later. 
-	setPositionLocal(position);//This will automatically take cartesian coordinate system and save it to reference point. //This is different from most LCIO applications since each track will have own reference point. 	
-	//cout<<"HEREnewstate: "<<getPosition()[0]<<","<<getPosition()[1]<<","<<getPosition()[2]<<","<<getLocation()<<endl;
-	setIntersectionLocalXZ(state->getIntersectionLocalXZ());    
-	setIntersectionLocalYZ(state->getIntersectionLocalYZ());  
-	setBeamCharge(state->getBeamCharge());//this is set for each state. to do: is there a more efficient way of doing this since we only need this stored once?
-	setBeamEnergy(state->getBeamEnergy());//this is saved in gev. 
-	initialiseCurvature(); //this will perform the calculation _beamq/_beame ad place in invp
-	if(getIsThereAHit()){
-		addHit(const_cast<EVENT::TrackerHit*>(state->getTrackerHits().at(0)));
+//The LCIO track fields are only containers for the state members. This mapping is kept from the time EUTelState was a TrackImpl, so older files can still be read.
+EUTelState::EUTelState(const EVENT::Track* lcioState):
+_location(static_cast<int>(lcioState->getZ0())),
+_dimension(static_cast<int>(lcioState->getD0())),
+_intersectionLocalXZ(lcioState->getPhi()),
+_intersectionLocalYZ(lcioState->getTanLambda()),
+_omega(lcioState->getOmega()),
+_beamEnergy(lcioState->getdEdx()),
+_beamCharge(lcioState->getdEdxError()),
+_arcLengthToNextState(lcioState->getChi2()),
+_hit(NULL)
+{
+	const float* referencePoint = lcioState->getReferencePoint();
+	_position[0] = referencePoint[0]; _position[1] = referencePoint[1]; _position[2] = referencePoint[2];
+	const EVENT::FloatVec& kinks = lcioState->getCovMatrix();
+	_kinks[0] = kinks.size() > 1 ? kinks[0] : 0;
+	_kinks[1] = kinks.size() > 1 ? kinks[1] : 0;
+	_covCombinedMatrix[0] = _covCombinedMatrix[1] = _covCombinedMatrix[2] = _covCombinedMatrix[3] = 0;
+	if(!lcioState->getTrackerHits().empty()){
+		_hit = lcioState->getTrackerHits().at(0);
 	}
 }
-//getters
-EVENT::TrackerHit* EUTelState::getHit(){
-	return	const_cast<EVENT::TrackerHit*>(getTrackerHits().at(0));
-}
-int EUTelState::getDimensionSize() const {
-	int dimension = static_cast<int>(getD0());
-	return dimension;
-}
-int EUTelState::getLocation() const {
-	int location = static_cast<int>(getZ0());
-	return location;
-}
-float* EUTelState::getPosition() const {
-	return const_cast<float*>(getReferencePoint());
+IMPL::TrackImpl* EUTelState::createLCIOTrack() const {
+	IMPL::TrackImpl* lcioState = new IMPL::TrackImpl;
+	lcioState->setD0(static_cast<float>(_dimension));
+	lcioState->setZ0(static_cast<float>(_location));//No location for track LCIO. This is preferable to problems with storing hits.
+	lcioState->setPhi(_intersectionLocalXZ);
+	lcioState->setTanLambda(_intersectionLocalYZ);
+	lcioState->setOmega(_omega);
+	lcioState->setdEdx(_beamEnergy);
+	lcioState->setdEdxError(_beamCharge);
+	lcioState->setChi2(_arcLengthToNextState);
+	lcioState->setReferencePoint(_position);
+	EVENT::FloatVec kinks(15, 0.);//LCIO always writes the 15 entries of the covariance matrix
+	kinks[0] = _kinks[0];
+	kinks[1] = _kinks[1];
+	lcioState->setCovMatrix(kinks);
+	if(_hit != NULL){
+		lcioState->addHit(_hit);
+	}
+	return lcioState;
 }
+//getters
 TVector3 EUTelState::getPositionGlobal() const {
-	float* local =  const_cast<float*>(getReferencePoint());
-	const double posLocal[3] = {local[0],local[1],local[2]};
+	const double posLocal[3] = {_position[0],_position[1],_position[2]};
   double posGlobal[3];
 	geo::gGeometry().local2Master(getLocation() ,posLocal,posGlobal);
 	TVector3 posGlobalVec(posGlobal[0],posGlobal[1],posGlobal[2]);
@@ -131,35 +153,6 @@ TMatrixDSym EUTelState::getScatteringVarianceInLocalFrame(float  percentageOfRad
 
 	return precisionMatrix;
 }
-TMatrixDSym EUTelState::getStateCov() const {
-
-	streamlog_out( DEBUG1 ) << "EUTelState::getTrackStateCov()----------------------------BEGIN" << std::endl;
-	TMatrixDSym C(5);   
-	const EVENT::FloatVec& trkCov = getCovMatrix();        
-	C.Zero();
-            
-	C[0][0] = trkCov[0]; 
-	C[1][0] = trkCov[1];  C[1][1] = trkCov[2]; 
-	C[2][0] = trkCov[3];  C[2][1] = trkCov[4];  C[2][2] = trkCov[5]; 
-	C[3][0] = trkCov[6];  C[3][1] = trkCov[7];  C[3][2] = trkCov[8];  C[3][3] = trkCov[9]; 
-	C[4][0] = trkCov[10]; C[4][1] = trkCov[11]; C[4][2] = trkCov[12]; C[4][3] = trkCov[13]; C[4][4] = trkCov[14]; 
-        
-	if ( streamlog_level(DEBUG0) ){
-		streamlog_out( DEBUG0 ) << "Track state covariance matrix:" << std::endl;
-		C.Print();
-	}
-        
-	return C;
-	streamlog_out( DEBUG1 ) << "EUTelState::getTrackStateCov()----------------------------END" << std::endl;
-}
-bool EUTelState::getIsThereAHit() const {
-	if(!getTrackerHits().empty()){
-		return true;
-	}else{
-		return false;
-	}
-}
-
 void EUTelState::getCombinedHitAndStateCovMatrixInLocalFrame( double (&cov)[4] ) const {
 	cov[0] = _covCombinedMatrix[0];
 	cov[1] = _covCombinedMatrix[1];
@@ -187,45 +180,41 @@ TVector3 EUTelState::getIncidenceUnitMomentumVectorInLocalFrame(){
   streamlog_out(DEBUG2) << "Momentum in local coordinates  Px,Py,Pz= " << pVecUnitLocal[0]<<","<<pVecUnitLocal[1]<<","<<pVecUnitLocal[2]<< std::endl;
 	return pVecUnitLocal;
 }
-TVectorD EUTelState::getKinks(){
-	EVENT::FloatVec kinksVec = getCovMatrix();
+TVectorD EUTelState::getKinks() const {
 	TVectorD kinks(2);
-	kinks(0) = kinksVec.at(0);
-	kinks(1) = kinksVec.at(1);
+	kinks(0) = _kinks[0];
+	kinks(1) = _kinks[1];
 	return kinks;
 }
 //setters
 void EUTelState::setDimensionSize(int dimension){
-	setD0(static_cast<float>(dimension));
+	_dimension = dimension;
 }
 void EUTelState::setLocation(int location){
-	float locationFloat = static_cast<float>(location);
-	setZ0(locationFloat);
+	_location = location;
 }
 void EUTelState::setBeamEnergy(float beamE){
-	setdEdx(beamE);
+	_beamEnergy = beamE;
 }
 
 void EUTelState::setBeamCharge(float beamQ){
-	setdEdxError(beamQ);
+	_beamCharge = beamQ;
 }
 //Note this is dy/dz in the LOCAL frame
 void EUTelState::setIntersectionLocalYZ(float directionYZ){
-	setTanLambda(directionYZ);
+	_intersectionLocalYZ = directionYZ;
 }	
 //Note this is the dx/dz in the LOCAL frame
 void EUTelState::setIntersectionLocalXZ(float directionXZ){
-	setPhi(directionXZ);//This is only a container. So hold inverseTan(Phi)
+	_intersectionLocalXZ = directionXZ;
 }
 void EUTelState::setPositionLocal(float position[]){
-	setReferencePoint(position);
+	_position[0] = position[0]; _position[1] = position[1]; _position[2] = position[2];
 }
 //TO D0: This does nothing at the moment but should be implimented for high radiation enviroments.
 void EUTelState::setKinks(TVectorD kinks){
-	EVENT::FloatVec kinksInput;
-	kinksInput.push_back(kinks[0]);
-	kinksInput.push_back(kinks[1]);
-	setCovMatrix(kinksInput);
+	_kinks[0] = kinks[0];
+	_kinks[1] = kinks[1];
 }
 void EUTelState::setPositionGlobal(float positionGlobal[]){
 	double localPosition [3];
@@ -233,7 +222,7 @@ void EUTelState::setPositionGlobal(float positionGlobal[]){
 	const double referencePoint[]	= {positionGlobal[0], positionGlobal[1],positionGlobal[2]};//Need this since geometry works with const doubles not floats 
 	geo::gGeometry().master2Localtwo( getLocation(), referencePoint, localPosition );
 	float posLocal[] = { static_cast<float>(localPosition[0]), static_cast<float>(localPosition[1]), static_cast<float>(localPosition[2]) };
-	setReferencePoint(posLocal);
+	setPositionLocal(posLocal);
 }
 //This sets the LOCAL frame intersection. Not the curvilinear frames intersection
 void EUTelState::setLocalXZAndYZIntersectionAndCurvatureUsingGlobalMomentum(TVector3 momentumIn){
@@ -348,7 +337,7 @@ TMatrix EUTelState::computePropagationJacobianFromLocalStateToNextLocalState(TVe
 	return localToNextLocalJacobian;
 }
 //print
-void EUTelState::print(){
+void EUTelState::print() const {
 	streamlog_out(DEBUG2) << "The state vector//////////////////////////////////////////////////////" << endl;
 	TVectorD stateVec = getStateVec();
 	streamlog_message( DEBUG0, stateVec.Print();, std::endl; );
@@ -357,17 +346,17 @@ void EUTelState::print(){
 	streamlog_out(DEBUG2) << "/////////////////////////////////////////////////////" << endl;
 	streamlog_out(DEBUG1) <<"State memory location "<< this << " The sensor location of the state " <<getLocation()<<std::endl;
 	if(getIsThereAHit()){
-			streamlog_out(DEBUG1) <<"The hit ID of the state is "<<getTrackerHits().at(0)->id()<<std::endl;
+			streamlog_out(DEBUG1) <<"The hit ID of the state is "<<_hit->id()<<std::endl;
 	}else{
 		streamlog_out(DEBUG1) <<"This state has no hit " <<endl;
 	}
 }	
 //Overload operators.
-bool EUTelState::operator<(const EUTelState compareState ) const {
+bool EUTelState::operator<(const EUTelState& compareState ) const {
 	return getPosition()[2]<compareState.getPosition()[2];
 }
 
-bool EUTelState::operator==(const EUTelState compareState ) const {
+bool EUTelState::operator==(const EUTelState& compareState ) const {
 	if(getLocation() == compareState.getLocation() and 	getPosition()[0] == compareState.getPosition()[0] and	getPosition()[1] == compareState.getPosition()[1] and 	getPosition()[2] == compareState.getPosition()[2]){
 		return true;
 	}else{
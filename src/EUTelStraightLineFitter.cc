@@ -0,0 +1,145 @@
+/*
+ *   This source code is part of the Eutelescope package of Marlin.
+ *   You are free to use this source files for your own development as
+ *   long as it stays in a public research context. You are not
+ *   allowed to use it for commercial purpose. You must put this
+ *   header with author names in all development based on this file.
+ *
+ */
+
+// eutelescope includes ".h"
+#include "EUTelStraightLineFitter.h"
+
+// system includes <>
+#include <algorithm>
+
+using namespace std;
+using namespace eutelescope;
+
+namespace {
+
+  //! Fits one coordinate of all tracks, the loops over tracks run on contiguous memory
+  void fitCoordinate( int nPlanes, int nTracks, const double * weight,
+                      const double * pos, const double * z, double * resid,
+                      double * meanZ, double * meanPos, double * sumZZ, double * slope, double * chi2 ) {
+
+    double sumWeight = 0.;
+    for ( int plane = 0; plane < nPlanes; ++plane ) sumWeight += weight[plane];
+    const double invSumWeight = 1. / sumWeight;
+
+    fill( meanZ, meanZ + nTracks, 0. );
+    fill( meanPos, meanPos + nTracks, 0. );
+    for ( int plane = 0; plane < nPlanes; ++plane ) {
+      const double w = weight[plane];
+      const double * zPlane = z + plane * nTracks;
+      const double * posPlane = pos + plane * nTracks;
+      for ( int track = 0; track < nTracks; ++track ) {
+        meanZ[track] += w * zPlane[track];
+        meanPos[track] += w * posPlane[track];
+      }
+    }
+    for ( int track = 0; track < nTracks; ++track ) {
+      meanZ[track] *= invSumWeight;
+      meanPos[track] *= invSumWeight;
+    }
+
+    // slope from the z coordinates relative to their weighted mean
+    fill( slope, slope + nTracks, 0. );
+    fill( sumZZ, sumZZ + nTracks, 0. );
+    for ( int plane = 0; plane < nPlanes; ++plane ) {
+      const double w = weight[plane];
+      const double * zPlane = z + plane * nTracks;
+      const double * posPlane = pos + plane * nTracks;
+      for ( int track = 0; track < nTracks; ++track ) {
+        const double zBar = zPlane[track] - meanZ[track];
+        slope[track] += w * zBar * posPlane[track];
+        sumZZ[track] += w * zBar * zBar;
+      }
+    }
+    for ( int track = 0; track < nTracks; ++track ) slope[track] /= sumZZ[track];
+
+    // residuals on all planes, chi2 only from the fitted ones
+    fill( chi2, chi2 + nTracks, 0. );
+    for ( int plane = 0; plane < nPlanes; ++plane ) {
+      const double w = weight[plane];
+      const double * zPlane = z + plane * nTracks;
+      const double * posPlane = pos + plane * nTracks;
+      double * residPlane = resid + plane * nTracks;
+      for ( int track = 0; track < nTracks; ++track ) {
+        const double r = meanPos[track] + slope[track] * ( zPlane[track] - meanZ[track] ) - posPlane[track];
+        residPlane[track] = r;
+        chi2[track] += w * r * r;
+      }
+    }
+  }
+
+}
+
+EUTelStraightLineFitter::EUTelStraightLineFitter() :
+  _nPlanes(0),
+  _nTracks(0),
+  _weightX(),
+  _weightY(),
+  _x(),
+  _y(),
+  _z(),
+  _residX(),
+  _residY(),
+  _meanZX(),
+  _meanZY(),
+  _meanX(),
+  _meanY(),
+  _slopeX(),
+  _slopeY(),
+  _chi2X(),
+  _chi2Y(),
+  _sumZZX(),
+  _sumZZY()
+{
+}
+
+void EUTelStraightLineFitter::reset( int nPlanes, int nTracks ) {
+  _nPlanes = nPlanes;
+  _nTracks = nTracks;
+
+  // resize never gives memory back, so a batch not larger than the previous ones does not allocate
+  _weightX.assign( nPlanes, 0. );
+  _weightY.assign( nPlanes, 0. );
+
+  const size_t nHits = static_cast< size_t >( nPlanes ) * nTracks;
+  _x.resize( nHits );
+  _y.resize( nHits );
+  _z.resize( nHits );
+  _residX.resize( nHits );
+  _residY.resize( nHits );
+
+  _meanZX.resize( nTracks );
+  _meanZY.resize( nTracks );
+  _meanX.resize( nTracks );
+  _meanY.resize( nTracks );
+  _slopeX.resize( nTracks );
+  _slopeY.resize( nTracks );
+  _chi2X.resize( nTracks );
+  _chi2Y.resize( nTracks );
+  _sumZZX.resize( nTracks );
+  _sumZZY.resize( nTracks );
+}
+
+void EUTelStraightLineFitter::setPlaneResolution( int plane, double resolX, double resolY ) {
+  _weightX[plane] = 1. / ( resolX * resolX );
+  _weightY[plane] = 1. / ( resolY * resolY );
+}
+
+void EUTelStraightLineFitter::excludePlane( int plane ) {
+  _weightX[plane] = 0.;
+  _weightY[plane] = 0.;
+}
+
+void EUTelStraightLineFitter::fit() {
+  if ( _nTracks == 0 || _nPlanes == 0 ) return;
+
+  fitCoordinate( _nPlanes, _nTracks, &_weightX[0], &_x[0], &_z[0], &_residX[0],
+                 &_meanZX[0], &_meanX[0], &_sumZZX[0], &_slopeX[0], &_chi2X[0] );
+  fitCoordinate( _nPlanes, _nTracks, &_weightY[0], &_y[0], &_z[0], &_residY[0],
+                 &_meanZY[0], &_meanY[0], &_sumZZY[0], &_slopeY[0], &_chi2Y[0] );
+}
@@ -61,6 +61,7 @@
 #include <map>
 #include <cstdlib>
 #include <limits>
+#include <ctime>
 
 // ROOT includes ".h"
 #if defined(USE_ROOT) || defined(MARLIN_USE_ROOT)
@@ -165,6 +166,11 @@ EUTelTestFitter::EUTelTestFitter()
   _planeHits(NULL),
   _planeChoice(NULL),
   _planeMod(NULL),
+  _useIncrementalFit(true),
+  _partialFitX(NULL),
+  _partialFitY(NULL),
+  _partialFitChoice(NULL),
+  _searchTime(),
   _planeX(NULL),
   _planeEx(NULL),
   _planeY(NULL),
@@ -304,6 +310,8 @@ EUTelTestFitter::EUTelTestFitter()
   registerOptionalParameter("SlopeDistanceMax","Maximum hit distance from the expected position, used for hit preselection in [mm]", _SlopeDistanceMax, static_cast <float> (1.));
   // -------------------------------------------------------------------------------------------------
 
+  registerOptionalParameter("IncrementalFit","Calculate chi2 of track hypotheses incrementally, plane by plane (full fit only for stored tracks)", _useIncrementalFit, static_cast <bool> (true));
+
   std::vector<int > initLayerIDs;
   std::vector<float > initLayerShift;
 
@@ -697,6 +705,10 @@ void EUTelTestFitter::init() {
   _planeChoice = new int[_nTelPlanes];
   _planeMod    = new type_fitcount[_nTelPlanes];
 
+  _partialFitX = new PartialFit[_nTelPlanes];
+  _partialFitY = new PartialFit[_nTelPlanes];
+  _partialFitChoice = new int[_nTelPlanes];
+
   _planeX  = new double[_nTelPlanes];
   _planeEx = new double[_nTelPlanes];
   _planeY  = new double[_nTelPlanes];
@@ -1396,6 +1408,28 @@ void EUTelTestFitter::processEvent( LCEvent * event ) {
 
     double chi2min  = numeric_limits<double >::max();
 
+    const clock_t searchStart = clock();
+
+    // Incremental fit: no partial fit calculated yet. Positions are
+    // taken w.r.t. the mean hit position, to limit rounding errors
+
+    double offsetX = 0.;
+    double offsetY = 0.;
+
+    if(_useIncrementalFit)
+    {
+      for(int ipl=0;ipl<_nTelPlanes;ipl++)
+      {
+        _partialFitChoice[ipl] = -1;
+
+        for(int ihit=0; ihit < _planeHits[ipl]; ihit++)
+        {
+          offsetX += hitX[planeHitID[ipl].at(ihit)] / nGoodHit;
+          offsetY += hitY[planeHitID[ipl].at(ihit)] / nGoodHit;
+        }
+      }
+    }
+
     // Loop over fit possibilities
     // Start from one-hit track to allow for "smart" skipping of wrong matches
 
@@ -1449,6 +1483,11 @@ void EUTelTestFitter::processEvent( LCEvent * event ) {
 
       double lastSlopeX=0.;
       double lastSlopeY=0.;
+
+      // Set when the hit choice differs from the one the partial fit
+      // was calculated for; partial fits have to be updated from there on
+
+      bool newPartialFit = false;
  
       // Fill position and error arrays for this hit configuration
 
@@ -1519,6 +1558,31 @@ void EUTelTestFitter::processEvent( LCEvent * event ) {
 			    // hits after the last hit
           }
         }
+
+        if(_useIncrementalFit)
+        {
+          int choice = _isActive[ipl] ? (ichoice/_planeMod[ipl])%_planeChoice[ipl] : 0 ;
+
+          if(newPartialFit || choice != _partialFitChoice[ipl])
+          {
+            newPartialFit = true;
+            _partialFitChoice[ipl] = choice;
+
+            double weightX = (_planeEx[ipl]>0.) ? 1./_planeEx[ipl]/_planeEx[ipl] : 0. ;
+            double weightY = (_planeEy[ipl]>0.) ? 1./_planeEy[ipl]/_planeEy[ipl] : 0. ;
+
+            if(ipl==0)
+            {
+              StartPartialFit(_partialFitX[0], _planeX[0]-offsetX, weightX);
+              StartPartialFit(_partialFitY[0], _planeY[0]-offsetY, weightY);
+            }
+            else
+            {
+              ExtendPartialFit(_partialFitX[ipl-1], _partialFitX[ipl], ipl, _planeX[ipl]-offsetX, weightX, _beamSlopeX);
+              ExtendPartialFit(_partialFitY[ipl-1], _partialFitY[ipl], ipl, _planeY[ipl]-offsetY, weightY, _beamSlopeY);
+            }
+          }
+        }
       }
       // End of plane loop (decoding fit hypothesis)
 
@@ -1569,16 +1633,48 @@ void EUTelTestFitter::processEvent( LCEvent * event ) {
      
 
  
+      // Penalty for missing or skiped hits
+      double penalty = 
+          (_nActivePlanes-nFiredPlanes)*_missingHitPenalty
+          +   
+          (nFiredPlanes-nChoiceFired)*_skipHitPenalty ;
+
+      // Incremental fit: chi2 of the hits up to the last fired plane.
+      // Full fit still needed if the track can be stored (fitted
+      // positions) or if chi2 is too close to the cuts to decide
+
+      bool doFullFit = true;
+
+      if(_useIncrementalFit)
+      {
+        choiceChi2 = GetPartialFitChi2(_partialFitX[ilast]) + GetPartialFitChi2(_partialFitY[ilast]);
+        if(choiceChi2 < 0.) choiceChi2 = 0.;
+
+        const double tolerance = 1.e-5;
+
+        doFullFit = 
+             abs(choiceChi2 - _chi2Max) <= tolerance*(1.+abs(_chi2Max))
+          || abs(choiceChi2 - _chi2Min) <= tolerance*(1.+abs(_chi2Min))
+          || abs(choiceChi2 + penalty - _chi2Max) <= tolerance*(1.+abs(_chi2Max))
+          || abs(choiceChi2 + penalty - _chi2Min) <= tolerance*(1.+abs(_chi2Min))
+          || ( choiceChi2 < _chi2Max && choiceChi2 >= _chi2Min
+               && choiceChi2 + penalty < _chi2Max && choiceChi2 + penalty > _chi2Min
+               && nChoiceFired + _allowMissingHits >= _nActivePlanes 
+               && nChoiceFired + _allowSkipHits    >= nFiredPlanes );
+      }
+
       // Select fit method
       // "Nominal" fit only if all active planes used
 
-      
-      if(_useNominalResolution && (nChoiceFired == _nActivePlanes)) 
+      if(doFullFit)
       {
-        choiceChi2 = NominalFit();
-      } else {
-        if(_useNominalResolution && _beamSlopeX==_beamSlopeY) choiceChi2 = SingleFit();
-        else choiceChi2 = MatrixFit();
+        if(_useNominalResolution && (nChoiceFired == _nActivePlanes)) 
+        {
+          choiceChi2 = NominalFit();
+        } else {
+          if(_useNominalResolution && _beamSlopeX==_beamSlopeY) choiceChi2 = SingleFit();
+          else choiceChi2 = MatrixFit();
+        }
       }
 
 
@@ -1592,13 +1688,6 @@ void EUTelTestFitter::processEvent( LCEvent * event ) {
         continue ;
       }
 
-      // Penalty for missing or skiped hits
-      double penalty = 
-          (_nActivePlanes-nFiredPlanes)*_missingHitPenalty
-          +   
-          (nFiredPlanes-nChoiceFired)*_skipHitPenalty ;
-
-
       trackChi2 = choiceChi2+penalty;
 
       if(
@@ -1698,6 +1787,10 @@ if(jhit>=0){
     }
     // End of loop over track possibilities
 
+    std::pair<double, int> & searchTime = _searchTime[nGoodHit];
+    searchTime.first += static_cast<double>(clock() - searchStart) / CLOCKS_PER_SEC;
+    searchTime.second++;
+
 #if defined(USE_AIDA) || defined(MARLIN_USE_AIDA)
     (dynamic_cast<AIDA::IHistogram1D*> ( _aidaHistoMap[_firstChi2HistoName]))->fill(log10(chi2min));
 #endif
@@ -2104,6 +2197,18 @@ void EUTelTestFitter::end(){
                            << "Total number of reconstructed tracks  " << setw(10) << setiosflags(ios::right) << _noOfTracks << resetiosflags(ios::right)
                            << endl;
 
+  // Track search CPU time as a function of the occupancy
+
+  stringstream ss;
+  ss << "Track search CPU time per event (" << (_useIncrementalFit ? "incremental" : "full") << " fit):" << endl
+     << setw(10) << "hits" << setw(10) << "events" << setw(16) << "time [ms]" << endl;
+  for(std::map<int, std::pair<double, int> >::const_iterator it = _searchTime.begin(); it != _searchTime.end(); ++it)
+    {
+      ss << setw(10) << it->first << setw(10) << it->second.second
+         << setw(16) << 1000. * it->second.first / it->second.second << endl;
+    }
+  streamlog_out( MESSAGE5 ) << ss.str();
+
 
   // Clean memory
 
@@ -2125,6 +2230,10 @@ void EUTelTestFitter::end(){
   delete [] _planeChoice ;
   delete [] _planeMod ;
 
+  delete [] _partialFitX ;
+  delete [] _partialFitY ;
+  delete [] _partialFitChoice ;
+
   delete [] _planeX ;
   delete [] _planeEx ;
   delete [] _planeY ;
@@ -2676,6 +2785,100 @@ double EUTelTestFitter::GetFitChi2()
 
 
 
+void EUTelTestFitter::StartPartialFit(PartialFit & fit, double pos, double weight)
+{
+  // Only the measurement in the first plane; the position in
+  // the (not existing) plane before it is not constrained
+
+  fit.m00 = fit.m01 = fit.g0 = 0. ;
+  fit.m11 = weight ;
+  fit.g1  = weight*pos ;
+  fit.c   = weight*pos*pos ;
+}
+
+
+void EUTelTestFitter::ExtendPartialFit(const PartialFit & prev, PartialFit & next, int ipl, double pos, double weight, double slope)
+{
+  // Quadratic form in positions in planes ipl-2, ipl-1 and ipl
+
+  double m[3][3] = { { prev.m00, prev.m01, 0. }, { prev.m01, prev.m11, 0. }, { 0., 0., 0. } };
+  double g[3] = { prev.g0, prev.g1, 0. };
+  double c = prev.c;
+
+  // Scattering angle in plane ipl-1 (same approximation as in GetFitChi2)
+
+  if(ipl > 1)
+    {
+      const double t[3] = { _planeDist[ipl-2], -(_planeDist[ipl-1]+_planeDist[ipl-2]), _planeDist[ipl-1] };
+
+      for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+          m[i][j] += _planeScat[ipl-1]*t[i]*t[j];
+    }
+
+  // Beam constraint, taking beam slope into account
+
+  if(ipl == 1 && _useBeamConstraint)
+    {
+      const double t[3] = { 0., -_planeDist[0], _planeDist[0] };
+
+      for(int i=0; i<3; i++)
+        {
+          for(int j=0; j<3; j++)
+            m[i][j] += _planeScat[0]*t[i]*t[j];
+          g[i] += _planeScat[0]*slope*t[i];
+        }
+      c += _planeScat[0]*slope*slope;
+    }
+
+  // Measurement
+
+  m[2][2] += weight;
+  g[2] += weight*pos;
+  c += weight*pos*pos;
+
+  // Minimise in position in plane ipl-2
+
+  if(m[0][0] > 0.)
+    {
+      for(int i=1; i<3; i++)
+        {
+          for(int j=1; j<3; j++)
+            m[i][j] -= m[i][0]*m[0][j]/m[0][0];
+          g[i] -= m[i][0]*g[0]/m[0][0];
+        }
+      c -= g[0]*g[0]/m[0][0];
+    }
+
+  next.m00 = m[1][1];
+  next.m01 = m[1][2];
+  next.m11 = m[2][2];
+  next.g0  = g[1];
+  next.g1  = g[2];
+  next.c   = c;
+}
+
+
+double EUTelTestFitter::GetPartialFitChi2(const PartialFit & fit)
+{
+  double m11 = fit.m11;
+  double g1  = fit.g1;
+  double c   = fit.c;
+
+  if(fit.m00 > 0.)
+    {
+      m11 -= fit.m01*fit.m01/fit.m00;
+      g1  -= fit.m01*fit.g0/fit.m00;
+      c   -= fit.g0*fit.g0/fit.m00;
+    }
+
+  if(m11 > 0.)
+    c -= g1*g1/m11;
+
+  return c;
+}
+
+
 int EUTelTestFitter::GaussjSolve(double *alfa,double *beta,int n)
 {
   int *ipiv;
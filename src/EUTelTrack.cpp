@@ -1,72 +1,55 @@
 #include "EUTelTrack.h"
 using namespace eutelescope;
-EUTelTrack::EUTelTrack(){
+EUTelTrack::EUTelTrack():
+_states(),
+_chi2(0),
+_ndf(0)
+{
 } 
-EUTelTrack::EUTelTrack(const EUTelTrack& track): IMPL::TrackImpl(){
-	setChi2(track.getChi2());
-	setNdf(track.getNdf());
-	for(size_t i=0; i<track.getTracks().size();++i){
-		addTrack(track.getTracks().at(i));
+EUTelTrack::EUTelTrack(const EVENT::Track* lcioTrack):
+_states(),
+_chi2(lcioTrack->getChi2()),
+_ndf(lcioTrack->getNdf())
+{
+	const EVENT::TrackVec& states = lcioTrack->getTracks();
+	_states.reserve(states.size());
+	for(size_t i=0; i<states.size();++i){
+		_states.push_back(EUTelState(states.at(i)));
 	}
 }
-EUTelTrack::EUTelTrack(const EUTelTrack& track, bool copyContents){
-	if( track.getChi2()== 0 or track.getNdf() == 0){
-		streamlog_out(MESSAGE5)<<"Chi: "<<track.getChi2() <<" ndf: "<<track.getNdf() <<endl;
-		throw(lcio::Exception("You are trying to create a track that is empty. With another track that has not chi2 or degrees of freedom.")); 	
+IMPL::TrackImpl* EUTelTrack::createLCIOTrack(IMPL::LCCollectionVec* stateCollection) const {
+	IMPL::TrackImpl* lcioTrack = new IMPL::TrackImpl;
+	lcioTrack->setChi2(_chi2);
+	lcioTrack->setNdf(_ndf);
+	for(size_t i=0; i<_states.size();++i){
+		IMPL::TrackImpl* lcioState = _states.at(i).createLCIOTrack();
+		stateCollection->push_back(lcioState);
+		lcioTrack->addTrack(lcioState);
 	}
-	setChi2(track.getChi2());
-	setNdf(track.getNdf());
+	return lcioTrack;
 }
 //getters
-std::vector<EUTelState> EUTelTrack::getStates(){
-	std::vector<EUTelState> states;
-	for(size_t i=0; i<getTracks().size();++i){
-		EUTelState* state = static_cast<EUTelState*>(getTracks().at(i));
-		states.push_back(*state);
-	}
-	return states;
-}
-std::vector<EUTelState*> EUTelTrack::getStatesPointers(){//This will return the pointers to the states. This is needed if we want to change the contents of the track and not just copyu like getStates()
-	std::vector<EUTelState*> states;
-	for(size_t i=0; i<getTracks().size();++i){
-		EUTelState* state = static_cast<EUTelState*>(getTracks().at(i));
-		states.push_back(state);
-	}
-	return states;
-}
 int EUTelTrack::getNumberOfHitsOnTrack() const {
-	//streamlog_out( DEBUG1 ) << "EUTelTrack::EUTelTrack::getNumberOfHitsOnTrack()---------------------------BEGIN" << std::endl;
-	int numberOfHitsOnTrack =0;
-	const EVENT::TrackVec& states = getTracks();
-	if(states.size() == 0){
+	if(_states.size() == 0){
 		throw(lcio::Exception("The number of states is 0.")); 	
 	}
-	//streamlog_out(DEBUG0) <<"The number of states " << states.size()<<std::endl; 
-	for(size_t i =0; i< states.size();++i){
-		//streamlog_out(DEBUG0) <<"The states memory address for loop number "<<i<<" " << &states<<std::endl; 
-		const EVENT::TrackerHitVec& hit = states[i]->getTrackerHits();
-		if(states[i]->getTrackerHits().size() == 0){
-			continue;
-		}
-		if(states[i]->getTrackerHits().size()>1){
-			streamlog_out( DEBUG1 ) << "The number of hits in one state is: "<< states[i]->getTrackerHits().size() << std::endl;
-			throw(lcio::Exception("The number of hits for the state is greater than 1.")); 	
+	int numberOfHitsOnTrack =0;
+	for(size_t i =0; i< _states.size();++i){
+		if(_states[i].getIsThereAHit()){
+			numberOfHitsOnTrack++;
 		}
-		numberOfHitsOnTrack++;
 	}
-	//streamlog_out( DEBUG1 ) << "EUTelTrack::EUTelTrack::getNumberOfHitsOnTrack()---------------------------END" << std::endl;
 	return numberOfHitsOnTrack;
 }
 
 void EUTelTrack::print(){
 	streamlog_out(DEBUG1) <<"TRACK INFORMATION//////////////////////////////////////////////////////////////////////////START"<<std::endl;
-	streamlog_out(DEBUG1) << "Track contains " << getTracks().size() << " states " << std::endl;
-	for(size_t i=0; i < getTracks().size(); ++i){
-		const  EVENT::Track* state = getTracks().at(i);
-		//Z0 contains the location. Need to static cast to EUTelState to use getLocation
-		streamlog_out(DEBUG1) <<"State memory location "<< state << " The sensor location of the state " <<state->getZ0()<<std::endl;
-		if(!state->getTrackerHits().empty()){
-			streamlog_out(DEBUG1) <<"The hit ID of the state is "<<state->getTrackerHits().at(0)->id()<<std::endl;
+	streamlog_out(DEBUG1) << "Track contains " << _states.size() << " states " << std::endl;
+	for(size_t i=0; i < _states.size(); ++i){
+		const EUTelState& state = _states.at(i);
+		streamlog_out(DEBUG1) <<"State memory location "<< &state << " The sensor location of the state " <<state.getLocation()<<std::endl;
+		if(state.getIsThereAHit()){
+			streamlog_out(DEBUG1) <<"The hit ID of the state is "<<state.getHit()->id()<<std::endl;
 		}
 	}	
 	streamlog_out(DEBUG1) <<"TRACK INFORMATION///////////////////////////////////////////////////////////////////////////////END"<<std::endl;
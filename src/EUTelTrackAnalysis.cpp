@@ -8,17 +8,17 @@ setSensorIDToIncidenceAngleYZ(mapFromSensorIDToKinkYZ);
 
 } 
 
-void EUTelTrackAnalysis::plotResidualVsPosition(EUTelTrack track){
+void EUTelTrackAnalysis::plotResidualVsPosition(const EUTelTrack& track){
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotResidualVsPosition------------------------------BEGIN"<< std::endl;
-	std::vector<EUTelState> states = track.getStates();
+	const std::vector<EUTelState>& states = track.getStates();
 	for(size_t i=0; i<states.size();++i){
-		EUTelState state  = states.at(i);
-		state.print();
+		const EUTelState& state  = states.at(i);
+		if(streamlog_level(DEBUG2)) state.print();
 		if(!state.getIsThereAHit()){
 			continue;
 		}
 		EVENT::TrackerHit* hit = state.getHit();	
-		float* statePosition = state.getPosition();
+		const float* statePosition = state.getPosition();
 		const double* hitPosition = hit->getPosition();
 		float residual[2];
 		streamlog_out(DEBUG2) << "State position: " << statePosition[0]<<","<<statePosition[1]<<","<<statePosition[2]<< std::endl;
@@ -47,12 +47,12 @@ void EUTelTrackAnalysis::plotResidualVsPosition(EUTelTrack track){
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotResidualVsPosition------------------------------END"<< std::endl;
 }
 
-void EUTelTrackAnalysis::plotIncidenceAngles(EUTelTrack track){
+void EUTelTrackAnalysis::plotIncidenceAngles(const EUTelTrack& track){
   streamlog_out(DEBUG2) << " EUTelTrackAnalysis::plotIncidenceAngles------------------------------BEGIN"<< std::endl;
-	std::vector<EUTelState> states = track.getStates();
+	const std::vector<EUTelState>& states = track.getStates();
 	for(size_t i=0; i<states.size();++i){
-		EUTelState state  = states.at(i);
-		state.print();
+		const EUTelState& state  = states.at(i);
+		if(streamlog_level(DEBUG2)) state.print();
 		TVectorD stateVec = state.getStateVec();
 		float incidenceXZ = stateVec[1];
 		typedef std::map<int , AIDA::IHistogram1D * >::iterator it_type;
@@ -65,8 +65,8 @@ void EUTelTrackAnalysis::plotIncidenceAngles(EUTelTrack track){
 		}
 	} 
 	for(size_t i=0; i<states.size();++i){
-		EUTelState state  = states.at(i);
-		state.print();
+		const EUTelState& state  = states.at(i);
+		if(streamlog_level(DEBUG2)) state.print();
 		TVectorD stateVec = state.getStateVec();
 		float incidenceYZ = stateVec[2];
 		typedef std::map<int , AIDA::IHistogram1D * >::iterator it_type;
@@ -13,6 +13,7 @@
 #include "EUTelBrickedClusterImpl.h"
 #include "EUTelDFFClusterImpl.h"
 #include "EUTelFFClusterImpl.h"
+#include "EUTelCellIDCodec.h"
 
 // lcio includes <.h>
 #include <EVENT/LCEvent.h>
@@ -74,83 +75,6 @@ namespace eutelescope {
             streamlog_out( DEBUG ) << "FillNotExcludedPlanesIndices" << std::endl;
         }
         
-        bool HitContainsHotPixels( const IMPL::TrackerHitImpl* hit, const std::map<std::string, bool >& hotPixelMap ) {
-            bool skipHit = false;
-
-            try {
-                try {
-                    LCObjectVec clusterVector = hit->getRawHits();
-
-                    EUTelVirtualCluster * cluster = NULL;
-
-                    if (hit->getType() == kEUTelSparseClusterImpl) {
-
-                        TrackerDataImpl * clusterFrame = dynamic_cast<TrackerDataImpl*> (clusterVector[0]);
-                        if (clusterFrame == 0) {
-                            // found invalid result from cast
-                            throw UnknownDataTypeException("Invalid hit found in method hitContainsHotPixels()");
-                        }
-
-                        eutelescope::EUTelSparseClusterImpl< eutelescope::EUTelGenericSparsePixel > *cluster = new eutelescope::EUTelSparseClusterImpl< eutelescope::EUTelGenericSparsePixel > (clusterFrame);
-                        int sensorID = cluster->getDetectorID();
-
-                        for (unsigned int iPixel = 0; iPixel < cluster->size(); iPixel++) {
-                            EUTelGenericSparsePixel m26Pixel;
-                            cluster->getSparsePixelAt(iPixel, &m26Pixel);
-                            {
-                                char ix[100];
-                                sprintf(ix, "%d,%d,%d", sensorID, m26Pixel.getXCoord(), m26Pixel.getYCoord());
-                                std::map < std::string, bool >::const_iterator z = hotPixelMap.find(ix);
-                                if (z != hotPixelMap.end() && hotPixelMap.at(ix) == true) {
-                                    skipHit = true;
-                                    streamlog_out(DEBUG3) << "Skipping hit as it was found in the hot pixel map." << std::endl;
-                                    break;
-//                                    delete cluster;
-//                                    return true; // if TRUE  this hit will be skipped
-                                } else {
-                                    skipHit = false;
-                                }
-                            }
-                        }
-                        delete cluster;
-                    } else if (hit->getType() == kEUTelBrickedClusterImpl) {
-
-                        // fixed cluster implementation. Remember it
-                        //  can come from
-                        //  both RAW and ZS data
-
-                        cluster = new EUTelBrickedClusterImpl(static_cast<TrackerDataImpl *> (clusterVector[0]));
-                        delete cluster;
-                    } else if (hit->getType() == kEUTelDFFClusterImpl) {
-
-                        // fixed cluster implementation. Remember it can come from
-                        // both RAW and ZS data
-                        cluster = new EUTelDFFClusterImpl(static_cast<TrackerDataImpl *> (clusterVector[0]));
-                        delete cluster;
-                    } else if (hit->getType() == kEUTelFFClusterImpl) {
-
-                        // fixed cluster implementation. Remember it can come from
-                        // both RAW and ZS data
-                        cluster = new EUTelFFClusterImpl(static_cast<TrackerDataImpl *> (clusterVector[0]));
-                        delete cluster;
-                    }
-                    
-//                if ( cluster != 0 ) delete cluster;
-                    
-                } catch (lcio::Exception e) {
-                    // catch specific exceptions
-                    streamlog_out(ERROR) << "Exception occured in hitContainsHotPixels(): " << e.what() << std::endl;
-                }
-            } catch (...) {
-                // if anything went wrong in the above return FALSE, meaning do not skip this hit
-                return 0;
-            }
-
-            // if none of the above worked return FALSE, meaning do not skip this hit
-            return skipHit;
-
-        }
-        
         /**
          * Provides access to raw cluster information for given hit
          * Constructed object is owned by caller. Cluster must be destroyed by caller.
@@ -197,64 +121,10 @@ namespace eutelescope {
                 return -1;
             }
 
-            try {
-
-                UTIL::CellIDDecoder<TrackerHitImpl> hitDecoder ( EUTELESCOPE::HITENCODING );
-
-                int sensorID = hitDecoder(static_cast< IMPL::TrackerHitImpl* >(hit))["sensorID"];
-                return sensorID;
-
-            } catch (...) {
-                streamlog_out(ERROR) << "getSensorIDfromHit() produced an exception!" << std::endl;
-            }
-
-            return -1;
+            // hits are always encoded with EUTELESCOPE::HITENCODING
+            return CellIDCodec::HitEncoding::sensorID::decode( CellIDCodec::cellID( hit ) );
         }     
  
-        std::map<std::string, bool > FillHotPixelMap( EVENT::LCEvent *event, const std::string& hotPixelCollectionName ) {
-            
-            std::map < std::string, bool > hotPixelMap;
-            
-            LCCollectionVec *hotPixelCollectionVec = 0;
-            try {
-                hotPixelCollectionVec = static_cast<LCCollectionVec*> (event->getCollection(hotPixelCollectionName));
-            } catch (...) {
-                streamlog_out( MESSAGE4 ) << "hotPixelCollectionName " << hotPixelCollectionName.c_str() << " not found" << std::endl;
-                return hotPixelMap;
-            }
-
-            CellIDDecoder<TrackerDataImpl> cellDecoder(hotPixelCollectionVec);
-
-            for (int i = 0; i < hotPixelCollectionVec -> getNumberOfElements(); i++) {
-                TrackerDataImpl* hotPixelData = dynamic_cast<TrackerDataImpl*> (hotPixelCollectionVec->getElementAt(i));
-                SparsePixelType type = static_cast<SparsePixelType> (static_cast<int> (cellDecoder(hotPixelData)["sparsePixelType"]));
-
-                int sensorID = static_cast<int> (cellDecoder(hotPixelData)["sensorID"]);
-
-                if (type == kEUTelGenericSparsePixel) {
-                    std::auto_ptr< EUTelSparseClusterImpl< EUTelGenericSparsePixel > > m26Data(new EUTelSparseClusterImpl< EUTelGenericSparsePixel > (hotPixelData));
-                    std::vector< EUTelGenericSparsePixel* > m26PixelVec;
-                    EUTelGenericSparsePixel m26Pixel;
-
-                    //Push all single Pixels of one plane in the m26PixelVec
-                    for (unsigned int iPixel = 0; iPixel < m26Data->size(); iPixel++) {
-                        std::vector<int> m26ColVec();
-                        m26Data->getSparsePixelAt(iPixel, &m26Pixel);
-                        streamlog_out(DEBUG0) << iPixel << " of " << m26Data->size() << " HotPixelInfo:  " << m26Pixel.getXCoord() << " " << m26Pixel.getYCoord() << " " << m26Pixel.getSignal() << std::endl;
-                        try {
-                            char ix[100];
-                            sprintf(ix, "%d,%d,%d", sensorID, m26Pixel.getXCoord(), m26Pixel.getYCoord());
-                            hotPixelMap[ix] = true;
-                        } catch (...) {
-                            std::cout << "can not add pixel " << std::endl;
-                            std::cout << sensorID << " " << m26Pixel.getXCoord() << " " << m26Pixel.getYCoord() << " " << std::endl;
-                        }
-                    }
-                }
-            }
-            return hotPixelMap;
-        }
-
         /** Highland's formula for multiple scattering 
          * @param p momentum of the particle [GeV/c]
          * @param x thickness of the material in units of radiation lenght
@@ -0,0 +1,246 @@
+// Version: $Id$
+/*
+   Description: Binary cache file for the integration results of Tracker Detailed Simulation.
+
+   The results are written as a fixed header (magic, version, key)
+   followed by (segment ID, result) records sorted in segment ID. At
+   the next job start the file is memory mapped and the records are
+   searched in place, so that loading does not depend on the size of
+   the table.
+*/
+
+#include <TDSIntegrationStorage.h>
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace TDS;
+using namespace std;
+
+namespace {
+
+  //! Layout of the cache file header, all members 8 bytes wide (no padding)
+  struct CacheFileHeader {
+    char magic[8];
+    unsigned long long int version;
+    TDSIntegrationStorageKey key;
+    unsigned long long int numberOfResults;
+  };
+
+  const char cacheFileMagic[8] = { 'T', 'D', 'S', 'I', 'N', 'T', 'E', 'G' };
+
+  bool sameKey(const TDSIntegrationStorageKey & a, const TDSIntegrationStorageKey & b)
+  {
+    return memcmp(&a, &b, sizeof(TDSIntegrationStorageKey)) == 0;
+  }
+
+  bool lessSegmentID(const TDSIntegrationStorageRecord & record, const unsigned long long int integSegmentID)
+  {
+    return record.integSegmentID < integSegmentID;
+  }
+
+  //! Reads the whole file, for file systems which cannot be mapped
+  void * readWholeFile(const int fd, const size_t size)
+  {
+    char * buffer = static_cast< char * >(malloc(size));
+    if ( buffer == 0 ) return 0;
+    size_t done = 0;
+    while ( done < size )
+      {
+        const ssize_t n = pread(fd, buffer + done, size - done, done);
+        if ( n <= 0 )
+          {
+            free(buffer);
+            return 0;
+          }
+        done += n;
+      }
+    return buffer;
+  }
+
+  bool writeAll(const int fd, const void * data, const size_t size)
+  {
+    const char * bytes = static_cast< const char * >(data);
+    size_t done = 0;
+    while ( done < size )
+      {
+        const ssize_t n = write(fd, bytes + done, size - done);
+        if ( n <= 0 ) return false;
+        done += n;
+      }
+    return true;
+  }
+
+}
+
+
+unsigned int TDSIntegrationStorage::attachCacheFile(const TDSIntegrationStorageKey & key)
+{
+  if ( isCacheAttached )
+    {
+      if ( !sameKey(cacheKey, key) )
+        {
+          cout << "TDSIntegrationStorage: cache file " << cacheFileName << " is attached for different parameters, the storage should not be shared by these layers" << endl;
+        }
+      return 0;
+    }
+  isCacheAttached = true;
+  cacheKey = key;
+
+  int fd = open(cacheFileName.c_str(), O_RDONLY);
+  if ( fd < 0 )
+    {
+      // nothing cached yet: the file is created when the storage is destroyed
+      isCacheModified = true;
+      return 0;
+    }
+
+  struct stat fileStat;
+  if ( fstat(fd, &fileStat) != 0 || static_cast< size_t >(fileStat.st_size) < sizeof(CacheFileHeader) )
+    {
+      close(fd);
+      cout << "TDSIntegrationStorage: cache file " << cacheFileName << " is corrupted, it will be rewritten" << endl;
+      isCacheModified = true;
+      return 0;
+    }
+
+  cacheDataSize = fileStat.st_size;
+  cacheData = mmap(0, cacheDataSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  isCacheDataMapped = ( cacheData != MAP_FAILED );
+  if ( !isCacheDataMapped )
+    {
+      cacheData = readWholeFile(fd, cacheDataSize);
+    }
+  close(fd);
+  if ( cacheData == 0 )
+    {
+      cout << "TDSIntegrationStorage: cannot read cache file " << cacheFileName << ", it will be rewritten" << endl;
+      cacheDataSize = 0;
+      isCacheModified = true;
+      return 0;
+    }
+
+  const CacheFileHeader * header = static_cast< const CacheFileHeader * >(cacheData);
+  const size_t expectedSize = sizeof(CacheFileHeader) + header->numberOfResults * sizeof(TDSIntegrationStorageRecord);
+
+  if ( memcmp(header->magic, cacheFileMagic, sizeof(cacheFileMagic)) != 0 ||
+       header->version != cacheFileVersion ||
+       cacheDataSize != expectedSize )
+    {
+      cout << "TDSIntegrationStorage: cache file " << cacheFileName << " has a different format, it will be rewritten" << endl;
+      releaseCacheData();
+      isCacheModified = true;
+      return 0;
+    }
+  if ( !sameKey(header->key, key) )
+    {
+      cout << "TDSIntegrationStorage: cache file " << cacheFileName << " was made for different parameters, it will be rewritten" << endl;
+      releaseCacheData();
+      isCacheModified = true;
+      return 0;
+    }
+
+  cacheRecords = reinterpret_cast< const TDSIntegrationStorageRecord * >(header + 1);
+  numberOfCacheRecords = header->numberOfResults;
+  return numberOfCacheRecords;
+}
+
+
+bool TDSIntegrationStorage::findCachedResult(const unsigned long long int integSegmentID, double & integrationResult) const
+{
+  const TDSIntegrationStorageRecord * end = cacheRecords + numberOfCacheRecords;
+  const TDSIntegrationStorageRecord * it = lower_bound(cacheRecords, end, integSegmentID, lessSegmentID);
+  if ( it == end || it->integSegmentID != integSegmentID ) return false;
+  integrationResult = it->integrationResult;
+  return true;
+}
+
+
+void TDSIntegrationStorage::releaseCacheData()
+{
+  if ( cacheData != 0 )
+    {
+      if ( isCacheDataMapped ) munmap(cacheData, cacheDataSize);
+      else free(cacheData);
+    }
+  cacheData = 0;
+  cacheDataSize = 0;
+  isCacheDataMapped = false;
+  cacheRecords = 0;
+  numberOfCacheRecords = 0;
+}
+
+
+bool TDSIntegrationStorage::writeToFile()
+{
+  if ( cacheFileName.empty() ) return false;
+
+  // write to a temporary file with a unique name in the same directory
+  // and rename it: parallel jobs sharing the cache never see a partial
+  // file and do not write into each other's temporary file
+  std::string tempFileName = cacheFileName + ".XXXXXX";
+  std::vector< char > tempFileNameBuffer(tempFileName.begin(), tempFileName.end());
+  tempFileNameBuffer.push_back('\0');
+  const int fd = mkstemp(&tempFileNameBuffer[0]);
+  if ( fd < 0 )
+    {
+      cout << "TDSIntegrationStorage: cannot create a temporary file for the cache file " << cacheFileName << endl;
+      return false;
+    }
+  tempFileName = &tempFileNameBuffer[0];
+  // mkstemp creates the file readable by the owner only
+  fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  CacheFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, cacheFileMagic, sizeof(cacheFileMagic));
+  header.version = cacheFileVersion;
+  header.key = cacheKey;
+
+  // merge the results of the cache file with the new ones, both sorted
+  std::vector< TDSIntegrationStorageRecord > records;
+  records.reserve(numberOfCacheRecords + integResultsForSegments.size());
+  const TDSIntegrationStorageRecord * cached = cacheRecords;
+  const TDSIntegrationStorageRecord * cachedEnd = cacheRecords + numberOfCacheRecords;
+  std::map<unsigned long long int, double>::const_iterator it = integResultsForSegments.begin();
+  while ( cached != cachedEnd || it != integResultsForSegments.end() )
+    {
+      TDSIntegrationStorageRecord record;
+      if ( it == integResultsForSegments.end() || ( cached != cachedEnd && cached->integSegmentID < it->first ) )
+        {
+          record = *cached++;
+        }
+      else
+        {
+          if ( cached != cachedEnd && cached->integSegmentID == it->first ) ++cached;
+          record.integSegmentID = it->first;
+          record.integrationResult = it->second;
+          ++it;
+        }
+      records.push_back(record);
+    }
+  header.numberOfResults = records.size();
+
+  bool written = writeAll(fd, &header, sizeof(header));
+  if ( written && !records.empty() ) written = writeAll(fd, &records[0], records.size() * sizeof(TDSIntegrationStorageRecord));
+  if ( close(fd) != 0 ) written = false;
+
+  if ( !written || rename(tempFileName.c_str(), cacheFileName.c_str()) != 0 )
+    {
+      cout << "TDSIntegrationStorage: writing cache file " << cacheFileName << " failed" << endl;
+      unlink(tempFileName.c_str());
+      return false;
+    }
+
+  isCacheModified = false;
+  return true;
+}
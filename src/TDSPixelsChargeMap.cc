@@ -17,13 +17,16 @@ Date: 2008-11-07
 
 #include "marlin/Processor.h"
 
+#include <cstring>
+
 
 using namespace TDS;
 using namespace std;
 
 // Constructor
 TDSPixelsChargeMap::TDSPixelsChargeMap(const double length, const double width, const double height, const double firstPixelCornerCoordL, const double firstPixelCornerCoordW) :
-  length(length), width(width), height(height), firstPixelCornerCoordL(firstPixelCornerCoordL), firstPixelCornerCoordW(firstPixelCornerCoordW)
+  length(length), width(width), height(height), firstPixelCornerCoordL(firstPixelCornerCoordL), firstPixelCornerCoordW(firstPixelCornerCoordW),
+  useDenseChargeMap(false), isDenseChargeMapChosen(false)
 {
   std::cout << " booking width="<< width << " and length=" << length << std::endl;
   if( height > 0. )
@@ -41,6 +44,7 @@ TDSPixelsChargeMap::TDSPixelsChargeMap(const double length, const double width,
 
   // By default no integration storage is used
   useIntegrationStorage = false;
+  isIntegrationStorageCacheAttached = false;
 
   // Integration should be initialized by user
   isIntegrationInitialized = false;
@@ -75,6 +79,7 @@ void TDSPixelsChargeMap::setPixelLength(const double val)
       exit(1);
     }
   isPixelLengthSet = true;
+  if (useDenseChargeMap) denseChargeMap.setSize(numberPixelsAlongL, numberPixelsAlongW);
 }
 
 
@@ -92,6 +97,48 @@ void TDSPixelsChargeMap::setPixelWidth (const double val) {
       exit(1);
     }
   isPixelWidthSet = true;
+  if (useDenseChargeMap) denseChargeMap.setSize(numberPixelsAlongL, numberPixelsAlongW);
+}
+
+
+// Dense charge storage
+void TDSPixelsChargeMap::setDenseChargeMap(const bool val)
+{
+  // The user's choice is kept, no automatic switch any more
+  isDenseChargeMapChosen = true;
+  moveChargeMap(val);
+}
+
+
+void TDSPixelsChargeMap::moveChargeMap(const bool val)
+{
+  if ( val == useDenseChargeMap ) return;
+
+  if ( val )
+    {
+      if ( ( ! isPixelLengthSet ) || ( ! isPixelWidthSet ) )
+        {
+          cout << "Error: Pixels' dimensions have to be set before the dense charge map is used!" << endl;
+          exit(1);
+        }
+      denseChargeMap.setSize(numberPixelsAlongL, numberPixelsAlongW);
+      for (type_PixelsChargeMap::iterator i = pixelsChargeMap.begin(); i != pixelsChargeMap.end(); ++i )
+        {
+          denseChargeMap.getCharge(i->first/tenTo10, i->first%tenTo10) = i->second;
+        }
+      pixelsChargeMap.clear();
+    }
+  else
+    {
+      vector<type_PixelID> pixIDs = getVectorOfPixelsIDs();
+      for (unsigned int k = 0; k < pixIDs.size(); k++)
+        {
+          pixelsChargeMap.insert(pixelsChargeMap.end(), make_pair(pixIDs[k], *denseChargeMap.findCharge(pixIDs[k]/tenTo10, pixIDs[k]%tenTo10)));
+        }
+      denseChargeMap.setSize(0, 0);
+    }
+
+  useDenseChargeMap = val;
 }
 
 
@@ -178,11 +225,38 @@ void TDSPixelsChargeMap::setIntegMaxNumberPixelsAlongW(const unsigned int val)
 }
 
 
+// Cache file for the integration storage, attached before the first integration
+void TDSPixelsChargeMap::attachIntegrationStorageCache()
+{
+  isIntegrationStorageCacheAttached = true;
+  if ( ( ! useIntegrationStorage ) || integrationStorage->getCacheFile().empty() ) return;
+
+  TDSIntegrationStorageKey key;
+  memset(&key, 0, sizeof(key));
+  key.pixelLength = pixelLength;
+  key.pixelWidth = pixelWidth;
+  key.height = height;
+  key.lambda = theParamsOfFunChargeDistribution.lambda;
+  key.reflectedContribution = theParamsOfFunChargeDistribution.addReflectedContribution ? theParamsOfFunChargeDistribution.reflectedContribution : 0.;
+  key.integMaxNumberPixelsAlongL = integMaxNumberPixelsAlongL;
+  key.integMaxNumberPixelsAlongW = integMaxNumberPixelsAlongW;
+  key.integPixelSegmentsAlongL = integrationStorage->integPixelSegmentsAlongL;
+  key.integPixelSegmentsAlongW = integrationStorage->integPixelSegmentsAlongW;
+  key.integPixelSegmentsAlongH = integrationStorage->integPixelSegmentsAlongH;
+  key.gslCalls = gsl_calls;
+  strncpy(key.detectorType, theParamsOfFunChargeDistribution.detectorType.c_str(), sizeof(key.detectorType) - 1);
+
+  const unsigned int nLoaded = integrationStorage->attachCacheFile(key);
+  if ( nLoaded > 0 )
+    {
+      cout << "TDSPixelsChargeMap: " << nLoaded << " integration results loaded from " << integrationStorage->getCacheFile() << endl;
+    }
+}
+
+
 // Function which adds charge contribution to pixels
 void TDSPixelsChargeMap::update(const TDSStep & step)
 {
-  int debug = 0;
-
   if ( ( ! isPixelLengthSet ) || ( ! isPixelWidthSet ) )
     {
       cout << "Error: Pixels' dimensions are not set!" << endl;
@@ -195,10 +269,16 @@ void TDSPixelsChargeMap::update(const TDSStep & step)
       exit(1);
     }
 
-  if (step.geomLength == 0.)    // Return (and take next step)
+  // all parameters the stored results depend on are final by now
+  if ( ! isIntegrationStorageCacheAttached ) attachIntegrationStorageCache();
+
+  // Switch to the dense charge map once the map holds more pixels than
+  // the grid has tiles; results do not depend on the storage used
+  if ( ! useDenseChargeMap && ! isDenseChargeMapChosen &&
+       pixelsChargeMap.size() >= denseChargeMapMinPixels &&
+       pixelsChargeMap.size() >= ((numberPixelsAlongL + TDSPixelsChargeGrid::tileSide - 1) / TDSPixelsChargeGrid::tileSide) * ((numberPixelsAlongW + TDSPixelsChargeGrid::tileSide - 1) / TDSPixelsChargeGrid::tileSide) )
     {
-//      cout << "Warning: Step length = 0." << endl;
-//      return;
+      moveChargeMap(true);
     }
 
   if (step.geomLength < 0.)
@@ -215,12 +295,15 @@ void TDSPixelsChargeMap::update(const TDSStep & step)
   integStepsNumber = ( temp > 0 ? temp : 1 );
 
   double integStep = step.geomLength / integStepsNumber;
-  if(debug>1) cout << "integ: length: " << step.geomLength << " stepnumber: " << integStepsNumber << endl;
-  // Charge per integration step
   // Charge per integration step
   double integChargePerStep = step.charge / integStepsNumber;
-  if(debug>1) cout << "integChargePerStep= " << integChargePerStep << ";  integStep= " << integStep << endl;
 
+  // First pass: place the integration points along the step and find
+  // the rectangle of core pixels. As before, the step is cut at the
+  // first point outside the sensitive volume.
+  integPointL.resize(integStepsNumber);
+  integPointW.resize(integStepsNumber);
+  integPointH.resize(integStepsNumber);
 
   // Initialize position before integration loop (one integration point back)
   double currentPoint[3];
@@ -228,45 +311,82 @@ void TDSPixelsChargeMap::update(const TDSStep & step)
   currentPoint[1] = step.midW - step.dirW*(step.geomLength + integStep)/2.;
   currentPoint[2] = step.midH - step.dirH*(step.geomLength + integStep)/2.;
 
-  // Go through points - integration along the step
+  unsigned long int coreLmin = numberPixelsAlongL, coreLmax = 0, coreWmin = numberPixelsAlongW, coreWmax = 0;
+  unsigned int nPoints = 0;
+  bool outsideLW = false, outsideH = false;
   for (unsigned int is = 0; is < integStepsNumber ; is++ )
     {
-
       // new position
       currentPoint[0] += step.dirL*integStep;
       currentPoint[1] += step.dirW*integStep;
       currentPoint[2] += step.dirH*integStep;
 
-      if(debug>1) cout << " currentPoint[0] = " << currentPoint[0] << "  currentPoint[1] = " << currentPoint[1] << " currentPoint[2] = " << currentPoint[2] << endl;
-
       // Determine integer coordinates of the main (core) pixel (under which the current point is placed)
-      unsigned long int iL, iW;
-      iL = static_cast< unsigned long int >((currentPoint[0]-firstPixelCornerCoordL)/pixelLength);
-      iW = static_cast< unsigned long int >((currentPoint[1]-firstPixelCornerCoordW)/pixelWidth);
-      if(debug>1) cout << "iL: " << iL << " " << static_cast< long unsigned int >((currentPoint[0]-firstPixelCornerCoordL)/pixelLength)  << " " ;
-      if(debug>1) cout << "iW: " << iW << " " << static_cast< long unsigned int >((currentPoint[1]-firstPixelCornerCoordW)/pixelWidth)  << endl;
+      unsigned long int iL = static_cast< unsigned long int >((currentPoint[0]-firstPixelCornerCoordL)/pixelLength);
+      unsigned long int iW = static_cast< unsigned long int >((currentPoint[1]-firstPixelCornerCoordW)/pixelWidth);
       if ( iL >= numberPixelsAlongL  || iW >= numberPixelsAlongW )
         {
-          cout << "Error: Core pixel (and step) outside the boundary of Length-Width plane!" << endl;
-          //      exit(1);
+          outsideLW = true;
           break;
         }
-
-
       if (currentPoint[2] > 0.)
         {
-          cout << "Error: Point outside sensitive volume (Height > 0)!" << endl;
-          //      exit(1);
-          streamlog_out(ERROR4) << 
-                                  " currentPoint[0] " << currentPoint[0] <<
-                                  " currentPoint[1] " << currentPoint[1] <<
-                                  " currentPoint[2] " << currentPoint[2] <<
-                                    endl;
+          outsideH = true;
           break;
         }
 
+      integPointL[nPoints] = currentPoint[0];
+      integPointW[nPoints] = currentPoint[1];
+      integPointH[nPoints] = currentPoint[2];
+      ++nPoints;
+
+      coreLmin = min(coreLmin, iL);
+      coreLmax = max(coreLmax, iL);
+      coreWmin = min(coreWmin, iW);
+      coreWmax = max(coreWmax, iW);
+    }
+
+  if ( outsideLW )
+    {
+      cout << "Error: Core pixel (and step) outside the boundary of Length-Width plane!" << endl;
+    }
+  if ( outsideH )
+    {
+      cout << "Error: Point outside sensitive volume (Height > 0)!" << endl;
+      streamlog_out(ERROR4) <<
+                              " currentPoint[0] " << currentPoint[0] <<
+                              " currentPoint[1] " << currentPoint[1] <<
+                              " currentPoint[2] " << currentPoint[2] <<
+                                endl;
+    }
+  if ( nPoints == 0 ) return;
+
+  // Rectangle of pixels which can receive charge from this step
+  // (borders of the pixel plane taken into account)
+  const unsigned long int halfL = integMaxNumberPixelsAlongL / 2;
+  const unsigned long int halfW = integMaxNumberPixelsAlongW / 2;
+  const unsigned long int rectLmin = coreLmin > halfL ? coreLmin - halfL : 0;
+  const unsigned long int rectLmax = min(coreLmax + halfL, numberPixelsAlongL - 1);
+  const unsigned long int rectWmin = coreWmin > halfW ? coreWmin - halfW : 0;
+  const unsigned long int rectWmax = min(coreWmax + halfW, numberPixelsAlongW - 1);
+  const unsigned long int rectW = rectWmax - rectWmin + 1;
+  const unsigned long int rectSize = (rectLmax - rectLmin + 1) * rectW;
+
+  stepDeposit.assign(rectSize, 0.);
+  stepDepositTouched.assign(rectSize, 0);
+
+  // Second pass: deposit the charge of each point into the rectangle
+  for (unsigned int ip = 0; ip < nPoints ; ip++ )
+    {
+      const double pointL = integPointL[ip];
+      const double pointW = integPointW[ip];
+      const double pointH = integPointH[ip];
+
+      unsigned long int iL = static_cast< unsigned long int >((pointL-firstPixelCornerCoordL)/pixelLength);
+      unsigned long int iW = static_cast< unsigned long int >((pointW-firstPixelCornerCoordW)/pixelWidth);
+
       // Set H for funChargeDistribution
-      theParamsOfFunChargeDistribution.H=currentPoint[2];
+      theParamsOfFunChargeDistribution.H = pointH;
 
       // Pixel segment for integration storage
       unsigned int segmentL=0, segmentW=0, segmentH=0;
@@ -275,11 +395,9 @@ void TDSPixelsChargeMap::update(const TDSStep & step)
         {
           // Determine pixel segment for integration results storage
           // Unreduced segments
-          segmentL = static_cast< unsigned int >( integrationStorage->integPixelSegmentsAlongL * ((currentPoint[0]-firstPixelCornerCoordL-pixelLength*iL ) / pixelLength) );
-          segmentW = static_cast< unsigned int >( integrationStorage->integPixelSegmentsAlongW * ((currentPoint[1]-firstPixelCornerCoordW-pixelWidth *iW ) / pixelWidth ) ) ;
-          segmentH = static_cast< unsigned int >( integrationStorage->integPixelSegmentsAlongH * (abs(currentPoint[2]) / abs(height) ) );
-          if(debug>1) std::cout << "segmentH: " << segmentH  << " point2: " << abs(currentPoint[2]) <<
-                    " " << integrationStorage->integPixelSegmentsAlongH << " 1./height:" << 1./height <<  std::endl;
+          segmentL = static_cast< unsigned int >( integrationStorage->integPixelSegmentsAlongL * ((pointL-firstPixelCornerCoordL-pixelLength*iL ) / pixelLength) );
+          segmentW = static_cast< unsigned int >( integrationStorage->integPixelSegmentsAlongW * ((pointW-firstPixelCornerCoordW-pixelWidth *iW ) / pixelWidth ) ) ;
+          segmentH = static_cast< unsigned int >( integrationStorage->integPixelSegmentsAlongH * (abs(pointH) / abs(height) ) );
           // Thanks to symmetry we can reduce L and W segments (we have to reduce pixels then, too!)
           if (segmentL >= integrationStorage->integPixelSegmentsAlongL/2)
             {
@@ -300,109 +418,95 @@ void TDSPixelsChargeMap::update(const TDSStep & step)
       double limitsLow[2];
       double limitsUp[2];
 
-      unsigned long int i,j, imin, imax, jmin, jmax; // Indexes of pixels for which contributions will be calculated
-      // Limits take into account borders of the pixel plane (rectangle)
-      long int temp;
-      temp = iL - integMaxNumberPixelsAlongL / 2;
-      temp < 0 ? imin = 0 : imin = temp;
-      temp = iL + integMaxNumberPixelsAlongL / 2;
-      temp >= static_cast< long int >(numberPixelsAlongL) ? imax = numberPixelsAlongL - 1 : imax = temp;
-      temp = iW - integMaxNumberPixelsAlongW / 2;
-      temp < 0 ? jmin = 0 : jmin = temp;
-      temp = iW + integMaxNumberPixelsAlongW / 2;
-      temp >= static_cast< long int >(numberPixelsAlongW) ? jmax = numberPixelsAlongW - 1 : jmax = temp;
-
-      // Loops over important pixels
-      // (borders of a layer part taken into account - see above)
-      if(debug>2) cout << "iL = " << iL << " iW = " << iW << " imin = " << imin << " imax = " << imax << " jmin = " << jmin << " jmax = " << jmax << endl;
-
-      // I use map<unsigned long long int pixId, double pixCharge> to keep charges collected in pixels.
-      // Machine limit for unsigned long int:
-      // ULLONG_MAX = 18 446 744 073 709 551 615
-      //                           ^           ^
-      // pixID = 10^10*i + j - key for the pixel (i,j) which is used in map<> container [(i,j) <-> (L,W)]
-      type_PixelID pixID;
-
-      for (i = imin ; i <= imax ; i++ )
+      // Indexes of pixels for which contributions will be calculated
+      const unsigned long int imin = iL > halfL ? iL - halfL : 0;
+      const unsigned long int imax = min(iL + halfL, numberPixelsAlongL - 1);
+      const unsigned long int jmin = iW > halfW ? iW - halfW : 0;
+      const unsigned long int jmax = min(iW + halfW, numberPixelsAlongW - 1);
+
+      for (unsigned long int i = imin ; i <= imax ; i++ )
         {
-          if(debug>2) cout << "i = " << i << endl;
           // L limits of integral
-          limitsLow[0] = firstPixelCornerCoordL + i*pixelLength - currentPoint[0];
+          limitsLow[0] = firstPixelCornerCoordL + i*pixelLength - pointL;
           limitsUp[0]  = limitsLow[0] + pixelLength;
 
-          for (j = jmin ; j <= jmax ; j++ )
+          const unsigned long int row = (i - rectLmin) * rectW;
+
+          for (unsigned long int j = jmin ; j <= jmax ; j++ )
             {
-              if(debug>2) cout << "j = " << j << endl;
               // W limits of integral
-              limitsLow[1] = firstPixelCornerCoordW + j*pixelWidth - currentPoint[1];
+              limitsLow[1] = firstPixelCornerCoordW + j*pixelWidth - pointW;
               limitsUp[1]  = limitsLow[1] + pixelWidth;
 
-              if(debug>2) std::cout << "limitsLow " << limitsLow[0] << " " << limitsLow[1] << std::endl; 
-              if(debug>2) std::cout << "limitsUp  " << limitsUp[0] << " " << limitsUp[1] << std::endl; 
- 
               // Should we use integration-results?
               if (useIntegrationStorage)
                 {
-
-                  if(debug>2) cout << "Integration-results storage is used!" << endl;
-
                   // Relative integer coordinates of pixel from main pixel
                   unsigned int pixelL, pixelW;
                   // Thanks to symmetry we can reduce L and W pixels indexes. We have to reduce segments simultaneously!
-
-                  if(debug>2) std::cout << " " << i << " " << iL << " " << integMaxNumberPixelsAlongL / 2 << std::endl;
                   pixelL = static_cast< long int >(i) - static_cast< long int >(iL) + integMaxNumberPixelsAlongL / 2;
                   if ( segmentL_reduced   &&  i != iL )
                     {
                       pixelL = integMaxNumberPixelsAlongL - pixelL - 1;
                     }
-
-                  if(debug>2) std::cout << " " << j << " " << iW << " " << integMaxNumberPixelsAlongW / 2 << std::endl;
                   pixelW = static_cast< long int >(j) - static_cast< long int >(iW) + integMaxNumberPixelsAlongW / 2;
                   if ( segmentW_reduced   &&  j != iW )
                     {
                       pixelW = integMaxNumberPixelsAlongW - pixelW - 1;
                     }
 
-                  if(debug>2) std::cout << "L: " << segmentL << " W: " << segmentW << " H: " << segmentH << " pixelL:" << pixelL << " pixelW:" << pixelW << std::endl;
                   unsigned long long int integSegID = integSegmentID(segmentL, segmentW, segmentH, pixelL, pixelW);
 
-                  if(debug>2) std::cout << " " << pixelL << " " << pixelW << " " << integSegID << std::endl;
-                  if ( integrationStorage->isResultStored(integSegID) )
+                  if ( ! integrationStorage->findResult(integSegID, gsl_res) )
                     {
-                      if(debug>2) std::cout << "1here no storage " << std::endl; 
-                      gsl_res = integrationStorage->getResult(integSegID);
-                    }
-                  else
-                    {
-                      if(debug>2) std::cout << "2here no storage " << std::endl; 
                       // Integrate
                       gsl_monte_miser_integrate (&gsl_funToIntegrate, limitsLow, limitsUp, 2, gsl_calls, gsl_r, gsl_s, &gsl_res, &gsl_err);
-                      if(debug>2) std::cout << " integration done    gsl_calls: " << gsl_calls <<
-                                "   r: " << gsl_r << "   s: " << gsl_s << "   res: " << gsl_res << "   err:" << gsl_err << std::endl;
                       // Store integration result
                       integrationStorage->rememberResult(integSegID,gsl_res);
                     };
                 }
               else
                 {
-                  if(debug>2) std::cout << " here no storage " << std::endl; 
                   // Integrate (here no storage)
                   gsl_monte_miser_integrate (&gsl_funToIntegrate, limitsLow, limitsUp, 2, gsl_calls, gsl_r, gsl_s, &gsl_res, &gsl_err);
                 };
 
-              if(debug>2)cout << "integChargePerStep " << integChargePerStep << " " << gsl_res << std::endl;
-               
-              // Pixels Charge Map
-              // "code" of the pixel - it serves as a key in the map container of pixels (relations: i <-> L, j <-> W)
-              pixID = 0UL + tenTo10*i + j ;
-              // Add contribution to pixelsChargeMap
-              pixelsChargeMap[ pixID ] = pixelsChargeMap[ pixID ] + ( gsl_res * integChargePerStep );
-              if(debug>2)cout << "charge collected in the pixel " << pixID << " = " << pixelsChargeMap[ pixID ] << endl;
-              if(debug>2)cout << "miser= " << gsl_res << " +- " << gsl_err << endl;
+              stepDeposit[row + j - rectWmin] += gsl_res * integChargePerStep;
+              stepDepositTouched[row + j - rectWmin] = 1;
             }
         }
     }
+
+  // Add the contributions of this step to the pixels, one access per
+  // pixel instead of one per pixel and integration point.
+  if (useDenseChargeMap)
+    {
+      for (unsigned long int i = rectLmin ; i <= rectLmax ; i++ )
+        {
+          const unsigned long int row = (i - rectLmin) * rectW;
+          for (unsigned long int j = rectWmin ; j <= rectWmax ; j++ )
+            {
+              if ( stepDepositTouched[row + j - rectWmin] ) denseChargeMap.getCharge(i, j) += stepDeposit[row + j - rectWmin];
+            }
+        }
+      return;
+    }
+
+  // pixID = 10^10*i + j increases along the loop, so each insertion
+  // starts from the previous position.
+  type_PixelsChargeMap::iterator hint = pixelsChargeMap.begin();
+  for (unsigned long int i = rectLmin ; i <= rectLmax ; i++ )
+    {
+      const unsigned long int row = (i - rectLmin) * rectW;
+      for (unsigned long int j = rectWmin ; j <= rectWmax ; j++ )
+        {
+          if ( ! stepDepositTouched[row + j - rectWmin] ) continue;
+          // "code" of the pixel - it serves as a key in the map container of pixels (relations: i <-> L, j <-> W)
+          type_PixelID pixID = 0UL + tenTo10*i + j ;
+          hint = pixelsChargeMap.insert(hint, make_pair(pixID, 0.));
+          hint->second += stepDeposit[row + j - rectWmin];
+        }
+    }
 }
 
 
@@ -410,6 +514,16 @@ void TDSPixelsChargeMap::print(string filename)
 {
   ofstream fout(filename.c_str());
 
+  if (useDenseChargeMap)
+    {
+      vector<type_PixelID> pixIDs = getVectorOfPixelsIDs();
+      for (unsigned int k = 0; k < pixIDs.size(); k++)
+        {
+          fout << pixIDs[k]/tenTo10 << "\t" << pixIDs[k]%tenTo10 << "\t" << getPixelCharge(pixIDs[k]) << endl;
+        }
+      return;
+    }
+
   type_PixelsChargeMap::iterator i;
   for( i = pixelsChargeMap.begin(); i != pixelsChargeMap.end(); ++i )
     {
@@ -421,36 +535,43 @@ void TDSPixelsChargeMap::print(string filename)
 
 double TDSPixelsChargeMap::getPixelCharge(unsigned long int indexAlongL, unsigned long int indexAlongW)
 {
+  if (useDenseChargeMap)
+    {
+      if ( ! isPixelStored(indexAlongL, indexAlongW) ) return 0.;
+      return *denseChargeMap.findCharge(indexAlongL, indexAlongW);
+    }
+
   type_PixelID pixID;
   pixID = tenTo10*indexAlongL + indexAlongW ;
-  if (pixelsChargeMap.find(pixID) == pixelsChargeMap.end() )
+  type_PixelsChargeMap::iterator i = pixelsChargeMap.find(pixID);
+  if (i == pixelsChargeMap.end() )
     {
       return 0.;
     }
   else
     {
-      return pixelsChargeMap[pixID];
+      return i->second;
     }
 }
 
 
 double TDSPixelsChargeMap::getPixelCharge(type_PixelID pixID)
 {
-  if (pixelsChargeMap.find(pixID) == pixelsChargeMap.end() )
+  if ( ! isPixelStored(pixID) )
     {
       cout << "Error: pixID not found in the map!" << endl;
       exit(1);
     }
   else
     {
-      return pixelsChargeMap[pixID];
+      return getPixelCharge(pixID/tenTo10, pixID%tenTo10);
     }
 }
 
 
 unsigned long int TDSPixelsChargeMap::getPixelIndexAlongL(type_PixelID pixID)
 {
-  if (pixelsChargeMap.find(pixID) == pixelsChargeMap.end() )
+  if ( ! isPixelStored(pixID) )
     {
       cout << "Error: pixID not found in the map!" << endl;
       exit(1);
@@ -464,7 +585,7 @@ unsigned long int TDSPixelsChargeMap::getPixelIndexAlongL(type_PixelID pixID)
 
 unsigned long int TDSPixelsChargeMap::getPixelIndexAlongW(type_PixelID pixID)
 {
-  if (pixelsChargeMap.find(pixID) == pixelsChargeMap.end() )
+  if ( ! isPixelStored(pixID) )
     {
       cout << "Error: pixID not found in the map!" << endl;
       exit(1);
@@ -492,7 +613,7 @@ double TDSPixelsChargeMap::getPixelCoordL(unsigned long int indexAlongL)
 
 double TDSPixelsChargeMap::getPixelCoordL(type_PixelID pixID)
 {
-  if (pixelsChargeMap.find(pixID) == pixelsChargeMap.end() )
+  if ( ! isPixelStored(pixID) )
     {
       cout << "Error: pixID not found in the map!" << endl;
       exit(1);
@@ -520,7 +641,7 @@ double TDSPixelsChargeMap::getPixelCoordW(unsigned long int indexAlongW)
 
 double TDSPixelsChargeMap::getPixelCoordW(type_PixelID pixID)
 {
-  if (pixelsChargeMap.find(pixID) == pixelsChargeMap.end() )
+  if ( ! isPixelStored(pixID) )
     {
       cout << "Error: pixID not found in the map!" << endl;
       exit(1);
@@ -532,8 +653,29 @@ double TDSPixelsChargeMap::getPixelCoordW(type_PixelID pixID)
 }  
 
 
+type_PixelID TDSPixelsChargeMap::getDensePixelID_extreme(bool (*smaller)(pair<type_PixelID, double>, pair<type_PixelID, double>), bool findMaximum)
+{
+  pair<type_PixelID, double> best(0, 0.);
+
+  // In pixel ID order the first of equal pixels is kept, as by
+  // max_element and min_element on the map
+  denseChargeMap.getStoredCells(denseCells);
+  for (unsigned int k = 0; k < denseCells.size(); k++)
+    {
+      const unsigned long int t = denseCells[k].first;
+      const unsigned int c = denseCells[k].second;
+      pair<type_PixelID, double> pixel(getPixelID(denseChargeMap.cellIndexAlongL(t, c), denseChargeMap.cellIndexAlongW(t, c)), denseChargeMap.tiles[t].charge[c]);
+      if ( k == 0 || ( findMaximum ? smaller(best, pixel) : smaller(pixel, best) ) ) best = pixel;
+    }
+
+  return best.first;
+}
+
+
 type_PixelID TDSPixelsChargeMap::getPixelID_maxDeposit()
 {
+  if (useDenseChargeMap) return getDensePixelID_extreme(TDSPixelsChargeMap::smallerDeposit, true);
+
   type_PixelsChargeMap::iterator i_maxDep;
 
   i_maxDep = max_element(pixelsChargeMap.begin(), pixelsChargeMap.end(), TDSPixelsChargeMap::smallerDeposit);
@@ -544,6 +686,8 @@ type_PixelID TDSPixelsChargeMap::getPixelID_maxDeposit()
 
 type_PixelID TDSPixelsChargeMap::getPixelID_maxCharge()
 {
+  if (useDenseChargeMap) return getDensePixelID_extreme(TDSPixelsChargeMap::smallerCharge, true);
+
   type_PixelsChargeMap::iterator i_maxCharge;
 
   i_maxCharge = max_element(pixelsChargeMap.begin(), pixelsChargeMap.end(), TDSPixelsChargeMap::smallerCharge);
@@ -554,6 +698,8 @@ type_PixelID TDSPixelsChargeMap::getPixelID_maxCharge()
 
 type_PixelID TDSPixelsChargeMap::getPixelID_minCharge()
 {
+  if (useDenseChargeMap) return getDensePixelID_extreme(TDSPixelsChargeMap::smallerCharge, false);
+
   type_PixelsChargeMap::iterator i_minCharge;
 
   i_minCharge = min_element(pixelsChargeMap.begin(), pixelsChargeMap.end(), TDSPixelsChargeMap::smallerCharge);
@@ -564,6 +710,11 @@ type_PixelID TDSPixelsChargeMap::getPixelID_minCharge()
 
 void TDSPixelsChargeMap::erasePixel(type_PixelID pixID)
 {
+  if (useDenseChargeMap)
+    {
+      if ( isPixelStored(pixID) ) denseChargeMap.erase(pixID/tenTo10, pixID%tenTo10);
+      return;
+    }
   pixelsChargeMap.erase(pixID);
 }
 
@@ -583,7 +734,17 @@ std::vector<type_PixelID> TDSPixelsChargeMap::getVectorOfPixelsIDs()
   vector<type_PixelID> vectorOfPixelsIDs;
 
   // Speed-up vector filling
-  vectorOfPixelsIDs.reserve(pixelsChargeMap.size());
+  vectorOfPixelsIDs.reserve(getPixelsNumber());
+
+  if (useDenseChargeMap)
+    {
+      denseChargeMap.getStoredCells(denseCells);
+      for (unsigned int k = 0; k < denseCells.size(); k++)
+        {
+          vectorOfPixelsIDs.push_back(getPixelID(denseChargeMap.cellIndexAlongL(denseCells[k].first, denseCells[k].second), denseChargeMap.cellIndexAlongW(denseCells[k].first, denseCells[k].second)));
+        }
+      return vectorOfPixelsIDs;
+    }
 
   for( i = pixelsChargeMap.begin(); i != pixelsChargeMap.end(); ++i )
     {
@@ -603,7 +764,18 @@ double TDSPixelsChargeMap::getTotalCharge()
   int debug = 0;
 
   int ipixel=0;
-  if(debug) streamlog_out ( MESSAGE5 ) << " pixelsChargeMap : " << pixelsChargeMap.size() << endl;
+  if(debug) streamlog_out ( MESSAGE5 ) << " pixelsChargeMap : " << getPixelsNumber() << endl;
+
+  if (useDenseChargeMap)
+    {
+      // Summed in the order of the map
+      denseChargeMap.getStoredCells(denseCells);
+      for (unsigned int k = 0; k < denseCells.size(); k++)
+        {
+          totalCharge += denseChargeMap.tiles[ denseCells[k].first ].charge[ denseCells[k].second ];
+        }
+      return totalCharge;
+    }
 
   for( i = pixelsChargeMap.begin(); i != pixelsChargeMap.end(); ++i )
     {
@@ -625,6 +797,18 @@ double TDSPixelsChargeMap::scaleCharge(double scaleFactor)
 
   double totalCharge = 0.;
 
+  if (useDenseChargeMap)
+    {
+      denseChargeMap.getStoredCells(denseCells);
+      for (unsigned int k = 0; k < denseCells.size(); k++)
+        {
+          double & charge = denseChargeMap.tiles[ denseCells[k].first ].charge[ denseCells[k].second ];
+          charge *= scaleFactor;
+          totalCharge += charge;
+        }
+      return totalCharge;
+    }
+
   for( i = pixelsChargeMap.begin(); i != pixelsChargeMap.end(); ++i )
     {
       i->second *= scaleFactor;
@@ -633,29 +817,63 @@ double TDSPixelsChargeMap::scaleCharge(double scaleFactor)
   return totalCharge;
 }
 
+// Charge after Poisson fluctuations (sign of the deposit is kept)
+static double fluctuatedCharge(const double deposit)
+{
+  double charge =  abs(deposit);
+  double varCharge;
+  if (charge > 1000.)
+    { // assume Gaussian
+      double sigma = std::sqrt(charge);
+      varCharge = double(CLHEP::RandGauss::shoot(charge,sigma));
+    }
+  else
+    { // assume Poisson
+      varCharge = double(CLHEP::RandPoisson::shoot(charge));
+    }
+
+  if ( deposit < 0.) varCharge = -varCharge;
+
+  return varCharge;
+}
+
+
+// Is the charge below the threshold cut?
+static inline bool isBelowThreshold(const double charge, const double threshold)
+{
+  return (threshold > 0 && charge < threshold) ||
+         (threshold < 0 && charge > threshold);
+}
+
+
   // Apply Poisson fluctuations to the charge deposited in single pixels
 
   void TDSPixelsChargeMap::applyPoissonFluctuations(bool doCleaning)
 {
+  if (useDenseChargeMap)
+    {
+      // Random numbers are drawn in pixel ID order, as for the map
+      denseChargeMap.getStoredCells(denseCells);
+      for (unsigned int k = 0; k < denseCells.size(); k++)
+        {
+          TDSPixelsChargeGrid::Tile & tile = denseChargeMap.tiles[ denseCells[k].first ];
+          const unsigned int c = denseCells[k].second;
+          double varCharge = fluctuatedCharge(tile.charge[c]);
+          if (varCharge == 0. && doCleaning)
+            denseChargeMap.eraseCell(tile, c);
+          else
+            tile.charge[c] = varCharge;
+        }
+      return;
+    }
+
   // As pixels will be removed we can not do simple for loop
 
   type_PixelsChargeMap::iterator i = pixelsChargeMap.begin();
 
   while( i != pixelsChargeMap.end() )
      {
-     double charge =  abs(i->second);
-     double varCharge;
-     if (charge > 1000.)
-       { // assume Gaussian
-	 double sigma = std::sqrt(charge);
-	 varCharge = double(CLHEP::RandGauss::shoot(charge,sigma));
-       }
-     else
-       { // assume Poisson
-	 varCharge = double(CLHEP::RandPoisson::shoot(charge));
-       }
-
-     if ( i->second < 0.) varCharge = -varCharge;
+      double varCharge = fluctuatedCharge(i->second);
 
       if (varCharge == 0. && doCleaning)
         pixelsChargeMap.erase(i++);
@@ -673,6 +891,23 @@ double TDSPixelsChargeMap::scaleCharge(double scaleFactor)
 
 void TDSPixelsChargeMap::applyGain(double gain, double gainVariation, double noise, double offset)
 {
+  if (useDenseChargeMap)
+    {
+      // Random numbers are drawn in pixel ID order, as for the map
+      denseChargeMap.getStoredCells(denseCells);
+      for (unsigned int k = 0; k < denseCells.size(); k++)
+        {
+          double & charge = denseChargeMap.tiles[ denseCells[k].first ].charge[ denseCells[k].second ];
+
+          double varGain = double(CLHEP::RandGauss::shoot(gain,gainVariation));
+
+          double varNoise = double(CLHEP::RandGauss::shoot(offset,noise));
+
+          charge = varGain*charge + varNoise;
+        }
+      return;
+    }
+
   type_PixelsChargeMap::iterator i;
 
   for( i = pixelsChargeMap.begin(); i != pixelsChargeMap.end(); ++i )
@@ -694,16 +929,26 @@ void TDSPixelsChargeMap::applyGain(double gain, double gainVariation, double noi
 
 void TDSPixelsChargeMap::applyThresholdCut(double threshold)
 {
+  if (useDenseChargeMap)
+    {
+      for (unsigned int k = 0; k < denseChargeMap.touchedTiles.size(); k++)
+        {
+          TDSPixelsChargeGrid::Tile & tile = denseChargeMap.tiles[ denseChargeMap.touchedTiles[k] ];
+          for (unsigned int c = 0; c < TDSPixelsChargeGrid::tileArea; c++)
+            {
+              if ( tile.stored[c] && isBelowThreshold(tile.charge[c], threshold) ) denseChargeMap.eraseCell(tile, c);
+            }
+        }
+      return;
+    }
+
   // As pixels will be removed we can not do simple for loop
 
   type_PixelsChargeMap::iterator i = pixelsChargeMap.begin();
 
   while( i != pixelsChargeMap.end() )
     {
-    double charge =  i->second;
-
-    if ( (threshold > 0 && charge < threshold) ||
-         (threshold < 0 && charge > threshold) )
+    if ( isBelowThreshold(i->second, threshold) )
       {
 	pixelsChargeMap.erase(i++);
       }
@@ -726,19 +971,35 @@ vector<TDSPixel> TDSPixelsChargeMap::getVectorOfPixels()
   vector<TDSPixel> vectorOfPixels;
 
   // Speed-up vector filling
-  vectorOfPixels.reserve(pixelsChargeMap.size());
+  vectorOfPixels.reserve(getPixelsNumber());
 
-  int ipixel = 0;
-  for( i = pixelsChargeMap.begin(); i != pixelsChargeMap.end(); ++i )
+  if (useDenseChargeMap)
     {
-      thePixel.indexAlongL = i->first/tenTo10;
-      thePixel.indexAlongW = i->first%tenTo10;
-      thePixel.coordL = (static_cast< double >(thePixel.indexAlongL)+0.5)*pixelLength + firstPixelCornerCoordL;
-      thePixel.coordW = (static_cast< double >(thePixel.indexAlongW)+0.5)*pixelWidth  + firstPixelCornerCoordW;
-      thePixel.charge = i->second;
-      vectorOfPixels.push_back(thePixel);
-      //streamlog_out( MESSAGE5 ) << "ipixel= " << ipixel << " " << thePixel.coordL << " " << thePixel.coordW << endl;
-      ipixel++;
+      // Same input order as from the map, the sort below is not stable
+      denseChargeMap.getStoredCells(denseCells);
+      for (unsigned int k = 0; k < denseCells.size(); k++)
+        {
+          const unsigned long int t = denseCells[k].first;
+          const unsigned int c = denseCells[k].second;
+          thePixel.indexAlongL = denseChargeMap.cellIndexAlongL(t, c);
+          thePixel.indexAlongW = denseChargeMap.cellIndexAlongW(t, c);
+          thePixel.coordL = (static_cast< double >(thePixel.indexAlongL)+0.5)*pixelLength + firstPixelCornerCoordL;
+          thePixel.coordW = (static_cast< double >(thePixel.indexAlongW)+0.5)*pixelWidth  + firstPixelCornerCoordW;
+          thePixel.charge = denseChargeMap.tiles[t].charge[c];
+          vectorOfPixels.push_back(thePixel);
+        }
+    }
+  else
+    {
+      for( i = pixelsChargeMap.begin(); i != pixelsChargeMap.end(); ++i )
+        {
+          thePixel.indexAlongL = i->first/tenTo10;
+          thePixel.indexAlongW = i->first%tenTo10;
+          thePixel.coordL = (static_cast< double >(thePixel.indexAlongL)+0.5)*pixelLength + firstPixelCornerCoordL;
+          thePixel.coordW = (static_cast< double >(thePixel.indexAlongW)+0.5)*pixelWidth  + firstPixelCornerCoordW;
+          thePixel.charge = i->second;
+          vectorOfPixels.push_back(thePixel);
+        }
     }
 
   // Sort pixels in charge in descending order.
@@ -794,7 +1055,7 @@ TDSPrecluster TDSPixelsChargeMap::getPrecluster(unsigned long int seedIndexAlong
   temp = thePrecluster.pixelW-rectWidth/2;
   temp < 0 ? wmin = 0 : wmin = temp;
   temp = thePrecluster.pixelW+rectWidth/2;
-  temp >= static_cast< long int >(numberPixelsAlongW) ? wmax = numberPixelsAlongL - 1 : wmax = temp;
+  temp >= static_cast< long int >(numberPixelsAlongW) ? wmax = numberPixelsAlongW - 1 : wmax = temp;
 
   thePrecluster.rectLmin = lmin;
   thePrecluster.rectLmax = lmax;
@@ -810,21 +1071,32 @@ TDSPrecluster TDSPixelsChargeMap::getPrecluster(unsigned long int seedIndexAlong
       
   for (l=lmin; l<=lmax; l++)
     {
+      const double coordL = getPixelCoordL(l);
       for (w=wmin; w<=wmax; w++)
 	{
-	  if ( isPixelStored(l,w) )
+	  // Single lookup per pixel
+	  if (useDenseChargeMap)
 	    {
-	      tempCharge = getPixelCharge(l,w);
-	      preclusterCharge += tempCharge;
-	      tempL += tempCharge * getPixelCoordL(l);
-	      tempW += tempCharge * getPixelCoordW(w);
-	      
-	      // Fill vector of pixels
-	      thePrecluster.vectorOfPixels.push_back( TDSPixel( l, w, getPixelCoordL(l), getPixelCoordW(w), getPixelCharge(l,w) ) );
-
-	      if ( removePixels ) erasePixel(l,w);
-	      
+	      double * charge = denseChargeMap.findCharge(l,w);
+	      if ( charge == 0 ) continue;
+	      tempCharge = *charge;
+	      if ( removePixels ) denseChargeMap.erase(l,w);
 	    }
+	  else
+	    {
+	      type_PixelsChargeMap::iterator i = pixelsChargeMap.find( getPixelID(l,w) );
+	      if ( i == pixelsChargeMap.end() ) continue;
+	      tempCharge = i->second;
+	      if ( removePixels ) pixelsChargeMap.erase(i);
+	    }
+
+	  const double coordW = getPixelCoordW(w);
+	  preclusterCharge += tempCharge;
+	  tempL += tempCharge * coordL;
+	  tempW += tempCharge * coordW;
+
+	  // Fill vector of pixels
+	  thePrecluster.vectorOfPixels.push_back( TDSPixel( l, w, coordL, coordW, tempCharge ) );
 	} // for w
     } // for l
 
@@ -16,6 +16,8 @@
 // eutelescope includes ".h"
 #include "EUTELESCOPE.h"
 #include "EUTelEventImpl.h"
+#include "EUTelEventTransfer.h"
+#include "EUTelExceptions.h"
 
 // marlin includes
 #include "marlin/Global.h"
@@ -34,6 +36,7 @@
 #include <IMPL/LCEventImpl.h>
 #include <UTIL/CellIDEncoder.h>
 #include <UTIL/CellIDDecoder.h>
+#include <Exceptions.h>
 
 // system includes
 #include <iostream>
@@ -44,6 +47,8 @@
 #include <memory>
 #include <stdlib.h>
 #include <algorithm>
+#include <set>
+#include <exception>
 
 using namespace std;
 using namespace marlin;
@@ -65,7 +70,21 @@ _alibavaPulseCollectionName(ALIBAVA::NOTSET),
 _alibavaSparseCollectionName(ALIBAVA::NOTSET),
 // output
 _outputPulseCollectionName(ALIBAVA::NOTSET),
-_outputSparseCollectionName(ALIBAVA::NOTSET)
+_outputSparseCollectionName(ALIBAVA::NOTSET),
+_eventIDDiff(0),
+_resynchronise(true),
+_syncKey("EventNumber"),
+_syncParameterName("TriggerNumber"),
+_timeStampTolerance(0),
+_prefetchDepth(16),
+_maxResyncSkip(100),
+_syncKeyType(kSyncEventNumber),
+_syncKeyOffset(0),
+_syncKeyOffsetSet(false),
+_skippedTelescopeEvents(0),
+_skippedAlibavaEvents(0),
+_resyncCounter(0),
+_droppedPulses(0)
 {
 	
 	
@@ -127,6 +146,30 @@ _outputSparseCollectionName(ALIBAVA::NOTSET)
                                                                                  "AlibavaEventNumber - TelescopeEventNumber",
                                                                                  _eventIDDiff , int(0));
 
+	registerOptionalParameter ("Resynchronise",
+										"If true, the synchronisation key difference of the first merged pair is kept for the whole run: events dropped by one of the streams are skipped",
+										_resynchronise , bool(true));
+
+	registerOptionalParameter ("SyncKey",
+										"Key on which the events are paired: EventNumber, TimeStamp (LCIO event time stamp) or Parameter (integer event parameter SyncParameterName, e.g. a trigger number)",
+										_syncKey , string("EventNumber"));
+
+	registerOptionalParameter ("SyncParameterName",
+										"Name of the integer event parameter used as key with SyncKey Parameter",
+										_syncParameterName , string("TriggerNumber"));
+
+	registerOptionalParameter ("TimeStampTolerance",
+										"Largest deviation of the time stamp difference of a pair still matching, with SyncKey TimeStamp",
+										_timeStampTolerance , int(0));
+
+	registerOptionalParameter ("PrefetchDepth",
+										"Number of events read ahead on a helper thread per input file, 0 to read the files in the processing thread",
+										_prefetchDepth , int(16));
+
+	registerOptionalParameter ("MaxResyncSkip",
+										"Maximum number of events skipped to resynchronise the streams before the merging is stopped",
+										_maxResyncSkip , int(100));
+
  	
 }
 
@@ -139,133 +182,270 @@ AlibavaClusterCollectionMerger * AlibavaClusterCollectionMerger::newProcessor ()
 void AlibavaClusterCollectionMerger::init () {
 	
 	printParameters ();
+
+	if ( _syncKey == "EventNumber" )
+		_syncKeyType = kSyncEventNumber;
+	else if ( _syncKey == "TimeStamp" )
+		_syncKeyType = kSyncTimeStamp;
+	else if ( _syncKey == "Parameter" )
+		_syncKeyType = kSyncParameter;
+	else {
+		streamlog_out ( ERROR5 ) << "Unknown SyncKey " << _syncKey << ", use EventNumber, TimeStamp or Parameter" << endl;
+		throw InvalidParameterException( "SyncKey" );
+	}
 }
 
 void AlibavaClusterCollectionMerger::readDataSource(int /* numEvents */) {
 	
-	
+	EventStream telescopeStream( "telescope" );
+	EventStream alibavaStream( "alibava" );
+
 	// open telescope file
-	LCReader* telescope_lcReader = LCFactory::getInstance()->createLCReader();
 	try {
-		telescope_lcReader->open(_telescopeFileName );
+		telescopeStream.open( _telescopeFileName );
 	} catch( IOException& e ){
 		streamlog_out ( ERROR1 ) << "Can't open the telescope file: " << e.what() << endl ;
+		return;
 	}
 	
 	// open alibava file
-	LCReader* alibava_lcReader = LCFactory::getInstance()->createLCReader();
 	try {
-		alibava_lcReader->open( _alibavaFileName );
+		alibavaStream.open( _alibavaFileName );
 	} catch( IOException& e ){
 		streamlog_out ( ERROR1 ) << "Can't open the alibava file: " << e.what() << endl ;
+		return;
 	}
 	
 	
 	// we will copy alibava run header to as the header of output file.
 	try {
-		LCRunHeader* alibava_runHeader = alibava_lcReader->readNextRunHeader();
-		ProcessorMgr::instance()->processRunHeader( alibava_runHeader ) ;
+		LCRunHeader* alibava_runHeader = alibavaStream.readNextRunHeader();
+		if ( alibava_runHeader != 0 )
+			ProcessorMgr::instance()->processRunHeader( alibava_runHeader ) ;
 	} catch( IOException& e ){
 		streamlog_out ( ERROR1 ) << "Can't access run header of the alibava file: " << e.what() << endl ;
 	}
 	
 	int eventCounter=0;
-	EUTelEventImpl*  telescopeEvent;
-	AlibavaEventImpl* alibavaEvent;
+	_syncKeyOffsetSet = false;
+	_skippedTelescopeEvents = 0;
+	_skippedAlibavaEvents = 0;
+	_resyncCounter = 0;
+	_droppedPulses = 0;
 
-	if (_eventIDDiff<0 ){
-		for (int i=0; i<abs(_eventIDDiff); i++)
-			telescopeEvent = static_cast<EUTelEventImpl*> ( telescope_lcReader->readNextEvent() );
-	}
-	else if (_eventIDDiff>0){
-		for (int i=0; i<_eventIDDiff; i++)
-			alibavaEvent = static_cast<AlibavaEventImpl*> ( alibava_lcReader->readNextEvent() );
-	}
+	// The input events are read in update mode: their clusters are
+	// moved to the output event instead of being copied.
+	telescopeStream.start( _prefetchDepth );
+	alibavaStream.start( _prefetchDepth );
 
-	while( ((telescopeEvent = static_cast<EUTelEventImpl*> ( telescope_lcReader->readNextEvent())) != 0 )
-			&& ((alibavaEvent = static_cast<AlibavaEventImpl*> (alibava_lcReader->readNextEvent())) != 0 ) )
-	{
-		if (telescopeEvent->getEventType() == kEORE){ 
-			streamlog_out ( MESSAGE5 ) << "Reached EORE of telescope data"<< endl;
-			break;		
+	LCEventImpl* telescopeEvent = 0;
+	LCEventImpl* alibavaEvent = 0;
+	try {
+		if (_eventIDDiff<0 ){
+			for (int i=0; i<abs(_eventIDDiff); i++)
+				delete telescopeStream.nextEvent();
 		}
-		if ( eventCounter % 1000 == 0 )
-			streamlog_out ( MESSAGE4 ) << "Looping events "<<alibavaEvent->getEventNumber() << endl;
-		
-		LCCollectionVec * alibavaPulseColVec = 0;
-		LCCollectionVec * alibavaSparseColVec = 0;
-		LCCollectionVec * telescopePulseColVec = 0;
-		LCCollectionVec * telescopeSparseColVec = 0;
-		try
+		else if (_eventIDDiff>0){
+			for (int i=0; i<_eventIDDiff; i++)
+				delete alibavaStream.nextEvent();
+		}
+
+		telescopeEvent = telescopeStream.nextEvent();
+		alibavaEvent = ( telescopeEvent != 0 ) ? alibavaStream.nextEvent() : 0;
+
+		while( telescopeEvent != 0 && alibavaEvent != 0 )
 		{
-			// get alibava collections
-			alibavaPulseColVec = dynamic_cast< LCCollectionVec * > ( alibavaEvent->getCollection( _alibavaPulseCollectionName ) ) ;
-			alibavaSparseColVec = dynamic_cast< LCCollectionVec * > ( alibavaEvent->getCollection( _alibavaSparseCollectionName ) ) ;
+			if (static_cast<EUTelEventImpl*>(telescopeEvent)->getEventType() == kEORE){ 
+				streamlog_out ( MESSAGE5 ) << "Reached EORE of telescope data"<< endl;
+				break;		
+			}
+
+			if ( _resynchronise && !synchroniseEvents(telescopeStream, alibavaStream, telescopeEvent, alibavaEvent) )
+				break;
+
+			AlibavaEventImpl* alibavaInputEvent = static_cast<AlibavaEventImpl*>(alibavaEvent);
+
+			if ( eventCounter % 1000 == 0 )
+				streamlog_out ( MESSAGE4 ) << "Looping events "<<alibavaInputEvent->getEventNumber() << endl;
 			
+			LCCollectionVec * alibavaPulseColVec = 0;
+			LCCollectionVec * alibavaSparseColVec = 0;
+			LCCollectionVec * telescopePulseColVec = 0;
+			LCCollectionVec * telescopeSparseColVec = 0;
+			try
+			{
+				// get alibava collections
+				alibavaPulseColVec = dynamic_cast< LCCollectionVec * > ( alibavaEvent->getCollection( _alibavaPulseCollectionName ) ) ;
+				alibavaSparseColVec = dynamic_cast< LCCollectionVec * > ( alibavaEvent->getCollection( _alibavaSparseCollectionName ) ) ;
+				
+				
+			} catch ( lcio::Exception& e) {
+				// do nothing again
+				streamlog_out( ERROR5 ) << e.what() << endl;
+			}
 			
-		} catch ( IOException& e) {
-			// do nothing again
-			streamlog_out( ERROR5 ) << e.what() << endl;
-		}
-		
-		try
-		{
-			// get telescope collections
-			telescopePulseColVec = dynamic_cast< LCCollectionVec * > ( telescopeEvent->getCollection( _telescopePulseCollectionName ) ) ;
-			telescopeSparseColVec = dynamic_cast< LCCollectionVec * > ( telescopeEvent->getCollection( _telescopeSparseCollectionName ) ) ;
+			try
+			{
+				// get telescope collections
+				telescopePulseColVec = dynamic_cast< LCCollectionVec * > ( telescopeEvent->getCollection( _telescopePulseCollectionName ) ) ;
+				telescopeSparseColVec = dynamic_cast< LCCollectionVec * > ( telescopeEvent->getCollection( _telescopeSparseCollectionName ) ) ;
+				
+			} catch ( lcio::Exception& e) {
+				// do nothing again
+				streamlog_out( ERROR5 ) << e.what() << endl;
+			}
 			
-		} catch ( IOException& e) {
-			// do nothing again
-			streamlog_out( ERROR5 ) << e.what() << endl;
-		}
-		
-		// create output collections
-		LCCollectionVec * outputPulseColVec = new LCCollectionVec(LCIO::TRACKERPULSE);
-		LCCollectionVec * outputSparseColVec = new LCCollectionVec(LCIO::TRACKERDATA);
-		
-		// copy telescope clusters
-		copyClustersInCollection(outputPulseColVec, outputSparseColVec, telescopePulseColVec, telescopeSparseColVec);
-		// copy alibava cluster
-		copyClustersInCollection(outputPulseColVec, outputSparseColVec, alibavaPulseColVec, alibavaSparseColVec);
-		
-		try
-		{
-			AlibavaEventImpl* outputEvent = new AlibavaEventImpl();
+			// create output collections
+			LCCollectionVec * outputPulseColVec = new LCCollectionVec(LCIO::TRACKERPULSE);
+			LCCollectionVec * outputSparseColVec = new LCCollectionVec(LCIO::TRACKERDATA);
 			
-			outputEvent->setRunNumber( alibavaEvent->getRunNumber() );
-			outputEvent->setEventNumber(eventCounter);
-			outputEvent->setEventType( alibavaEvent->getEventType() );
-			outputEvent->setEventSize( alibavaEvent->getEventSize() );
-			outputEvent->setEventValue( alibavaEvent->getEventValue() );
-			outputEvent->setEventTime( alibavaEvent->getEventTime() );
-			outputEvent->setEventTemp( alibavaEvent->getEventTemp() );
-			outputEvent->setCalCharge( alibavaEvent->getCalCharge() );
-			outputEvent->setCalDelay( alibavaEvent->getCalDelay() );
-			if (alibavaEvent->isEventMasked())
-				outputEvent->maskEvent();
-			else
-				outputEvent->unmaskEvent();
-						
-			outputEvent->addCollection(outputPulseColVec, _outputPulseCollectionName);
-			outputEvent->addCollection(outputSparseColVec, _outputSparseCollectionName);
+			// move telescope clusters
+			moveClustersToCollection(outputPulseColVec, outputSparseColVec, telescopePulseColVec, telescopeSparseColVec);
+			// move alibava cluster
+			moveClustersToCollection(outputPulseColVec, outputSparseColVec, alibavaPulseColVec, alibavaSparseColVec);
 			
-			ProcessorMgr::instance()->processEvent( static_cast<LCEventImpl*> ( outputEvent ) ) ;
-			// delete outputEvent;
-			//	streamlog_out ( MESSAGE1 ) << "Successfully copied Alibava collections to output event" << endl ;
+			try
+			{
+				AlibavaEventImpl* outputEvent = new AlibavaEventImpl();
+				
+				outputEvent->setRunNumber( alibavaInputEvent->getRunNumber() );
+				outputEvent->setEventNumber(eventCounter);
+				outputEvent->setEventType( alibavaInputEvent->getEventType() );
+				outputEvent->setEventSize( alibavaInputEvent->getEventSize() );
+				outputEvent->setEventValue( alibavaInputEvent->getEventValue() );
+				outputEvent->setEventTime( alibavaInputEvent->getEventTime() );
+				outputEvent->setEventTemp( alibavaInputEvent->getEventTemp() );
+				outputEvent->setCalCharge( alibavaInputEvent->getCalCharge() );
+				outputEvent->setCalDelay( alibavaInputEvent->getCalDelay() );
+				if (alibavaInputEvent->isEventMasked())
+					outputEvent->maskEvent();
+				else
+					outputEvent->unmaskEvent();
+							
+				outputEvent->addCollection(outputPulseColVec, _outputPulseCollectionName);
+				outputEvent->addCollection(outputSparseColVec, _outputSparseCollectionName);
+				
+				ProcessorMgr::instance()->processEvent( static_cast<LCEventImpl*> ( outputEvent ) ) ;
+				// delete outputEvent;
+				//	streamlog_out ( MESSAGE1 ) << "Successfully copied Alibava collections to output event" << endl ;
+				
+			} catch ( IOException& e) {
+				// do nothing again
+				streamlog_out( ERROR5 ) << e.what() << endl;
+			}
 			
-		} catch ( IOException& e) {
-			// do nothing again
-			streamlog_out( ERROR5 ) << e.what() << endl;
-		}
-		
-      eventCounter++;
-	}// end of loop over events
+			eventCounter++;
+
+			delete telescopeEvent;
+			delete alibavaEvent;
+			alibavaEvent = 0;
+			telescopeEvent = telescopeStream.nextEvent();
+			alibavaEvent = ( telescopeEvent != 0 ) ? alibavaStream.nextEvent() : 0;
+		}// end of loop over events
+	} catch ( ... ) {
+		// e.g. a StopProcessingException: the helper threads must not outlive the processing
+		delete telescopeEvent;
+		delete alibavaEvent;
+		telescopeStream.close();
+		alibavaStream.close();
+		throw;
+	}
+	delete telescopeEvent;
+	delete alibavaEvent;
+	telescopeStream.close();
+	alibavaStream.close();
+
+	if ( !telescopeStream.getReadError().empty() )
+		streamlog_out ( ERROR5 ) << "Reading the telescope file stopped: " << telescopeStream.getReadError() << endl;
+	if ( !alibavaStream.getReadError().empty() )
+		streamlog_out ( ERROR5 ) << "Reading the alibava file stopped: " << alibavaStream.getReadError() << endl;
+
+	if ( _resyncCounter > 0 ) {
+		streamlog_out ( WARNING5 ) << "The streams were resynchronised " << _resyncCounter << " times: "
+			<< _skippedTelescopeEvents << " telescope and " << _skippedAlibavaEvents << " alibava events skipped" << endl;
+	}
+	if ( _droppedPulses > 0 ) {
+		streamlog_out ( WARNING5 ) << _droppedPulses << " cluster pulses were dropped because their sparse frame was missing or shared with another pulse" << endl;
+	}
 	
 }
 
+lcio::long64 AlibavaClusterCollectionMerger::getSyncKey( const LCEvent * event ) const {
+	switch ( _syncKeyType ) {
+	case kSyncTimeStamp:
+		return event->getTimeStamp();
+	case kSyncParameter: {
+		// getIntVal returns 0 for a missing parameter, which would silently match other such events
+		EVENT::StringVec intKeys;
+		event->getParameters().getIntKeys( intKeys );
+		if ( find( intKeys.begin(), intKeys.end(), _syncParameterName ) == intKeys.end() ) {
+			stringstream ss;
+			ss << "Event " << event->getEventNumber() << " of run " << event->getRunNumber()
+			   << " has no integer parameter " << _syncParameterName << " to synchronise on";
+			throw lcio::DataNotAvailableException( ss.str() );
+		}
+		return event->getParameters().getIntVal( _syncParameterName );
+	}
+	default:
+		return event->getEventNumber();
+	}
+}
+
+bool AlibavaClusterCollectionMerger::synchroniseEvents(EventStream & telescopeStream, EventStream & alibavaStream, LCEventImpl *& telescopeEvent, LCEventImpl *& alibavaEvent){
+
+	if ( !_syncKeyOffsetSet ) {
+		_syncKeyOffset = getSyncKey( alibavaEvent ) - getSyncKey( telescopeEvent );
+		_syncKeyOffsetSet = true;
+		return true;
+	}
+
+	const lcio::long64 tolerance = ( _syncKeyType == kSyncTimeStamp ) ? _timeStampTolerance : 0;
+	int skipped = 0;
+	while ( telescopeEvent != 0 && alibavaEvent != 0 ) {
+		// > 0: the telescope is behind, its event has no alibava partner
+		// < 0: the alibava is behind
+		const lcio::long64 mismatch = ( getSyncKey( alibavaEvent ) - _syncKeyOffset ) - getSyncKey( telescopeEvent );
+		if ( mismatch <= tolerance && -mismatch <= tolerance ) {
+			// follow a slow drift of the time stamps
+			_syncKeyOffset += mismatch;
+			if ( skipped > 0 ) {
+				++_resyncCounter;
+				streamlog_out ( WARNING2 ) << "Resynchronised at telescope event " << telescopeEvent->getEventNumber()
+					<< " / alibava event " << alibavaEvent->getEventNumber() << " after skipping " << skipped << " events" << endl;
+			}
+			return true;
+		}
+
+		if ( skipped >= _maxResyncSkip ) {
+			streamlog_out ( ERROR5 ) << "Telescope event " << telescopeEvent->getEventNumber() << " and alibava event "
+				<< alibavaEvent->getEventNumber() << " cannot be resynchronised on their " << _syncKey << " within " << _maxResyncSkip
+				<< " events. Merging is stopped here, the following events would be mismatched." << endl;
+			return false;
+		}
+
+		if ( mismatch > 0 ) {
+			delete telescopeEvent;
+			telescopeEvent = telescopeStream.nextEvent();
+			++_skippedTelescopeEvents;
+			if ( telescopeEvent != 0 && static_cast<EUTelEventImpl*>(telescopeEvent)->getEventType() == kEORE ) {
+				streamlog_out ( MESSAGE5 ) << "Reached EORE of telescope data"<< endl;
+				return false;
+			}
+		} else {
+			delete alibavaEvent;
+			alibavaEvent = alibavaStream.nextEvent();
+			++_skippedAlibavaEvents;
+		}
+		++skipped;
+	}
+	return false;
+}
+
 
-void AlibavaClusterCollectionMerger::copyClustersInCollection(LCCollectionVec * outputPulseColVec, LCCollectionVec * outputSparseColVec, LCCollectionVec * inputPulseColVec, LCCollectionVec * inputSparseColVec){
+void AlibavaClusterCollectionMerger::moveClustersToCollection(LCCollectionVec * outputPulseColVec, LCCollectionVec * outputSparseColVec, LCCollectionVec * inputPulseColVec, LCCollectionVec * inputSparseColVec){
 	
+	if ( inputPulseColVec == 0 || inputSparseColVec == 0 ) return;
+
 	// Here is the Cell ID Encodes for pulseFrame and sparseFrame
 	// CellID Encodes are introduced in eutelescope::EUTELESCOPE
 	
@@ -278,42 +458,209 @@ void AlibavaClusterCollectionMerger::copyClustersInCollection(LCCollectionVec *
 	CellIDDecoder<TrackerPulseImpl> inputPulseColDecoder(inputPulseColVec);
 	CellIDDecoder<TrackerDataImpl> inputSparseColDecoder(inputSparseColVec);
 	
-	unsigned int noOfClusters;
-	// go through input clusters and copy them to output cluster collection
-	
-	noOfClusters = inputPulseColVec->getNumberOfElements();
+	// the sparse frames referenced by a pulse are handed over together with it
+	std::set<LCObject*> movedSparseFrames;
+	int droppedPulses = 0;
+
+	// go through input clusters and move them to output cluster collection
+	const size_t noOfClusters = inputPulseColVec->size();
+	outputPulseColVec->reserve( outputPulseColVec->size() + noOfClusters );
+	outputSparseColVec->reserve( outputSparseColVec->size() + noOfClusters );
 	for ( size_t i = 0; i < noOfClusters; ++i ){
-		TrackerPulseImpl * outputPulseFrame = new TrackerPulseImpl();
-		TrackerDataImpl * outputSparseFrame = new TrackerDataImpl();
-		
-		TrackerPulseImpl* inputPulseFrame = dynamic_cast<TrackerPulseImpl*>(inputPulseColVec->getElementAt(i));
-		TrackerDataImpl* inputSparseFrame = dynamic_cast<TrackerDataImpl*>(inputPulseFrame->getTrackerData());
+		TrackerPulseImpl* pulseFrame = dynamic_cast<TrackerPulseImpl*>( (*inputPulseColVec)[i] );
+		if ( pulseFrame == 0 ) continue;
+		TrackerDataImpl* sparseFrame = dynamic_cast<TrackerDataImpl*>(pulseFrame->getTrackerData());
+		if ( sparseFrame == 0 || movedSparseFrames.count(sparseFrame) != 0 ) {
+			// a sparse frame can only be owned by one output collection
+			++droppedPulses;
+			continue;
+		}
 		
 		// set Cell ID for sparse collection
-		outputSparseColEncoder["sensorID"] = static_cast<int>(inputSparseColDecoder(inputSparseFrame) ["sensorID"]);
-		outputSparseColEncoder["sparsePixelType"] =static_cast<int>(inputSparseColDecoder(inputSparseFrame)["sparsePixelType"]);
-		outputSparseColEncoder["quality"] = static_cast<int>(inputSparseColDecoder(inputSparseFrame)["quality"]);
-		outputSparseColEncoder.setCellID( outputSparseFrame );
+		outputSparseColEncoder["sensorID"] = static_cast<int>(inputSparseColDecoder(sparseFrame) ["sensorID"]);
+		outputSparseColEncoder["sparsePixelType"] =static_cast<int>(inputSparseColDecoder(sparseFrame)["sparsePixelType"]);
+		outputSparseColEncoder["quality"] = static_cast<int>(inputSparseColDecoder(sparseFrame)["quality"]);
+		outputSparseColEncoder.setCellID( sparseFrame );
 		
-		// copy tracker data
-		outputSparseFrame->setChargeValues(inputSparseFrame->getChargeValues());
 		// add it to the cluster collection
-		outputSparseColVec->push_back( outputSparseFrame );
+		outputSparseColVec->push_back( sparseFrame );
+		movedSparseFrames.insert( sparseFrame );
 		
 		// prepare a pulse for this cluster
-		outputPulseColEncoder["sensorID"] = static_cast<int> (inputPulseColDecoder(inputPulseFrame) ["sensorID"]);
-		outputPulseColEncoder["type"] = static_cast<int>(inputPulseColDecoder(inputPulseFrame) ["type"]);
-		outputPulseColEncoder.setCellID( outputPulseFrame );
+		outputPulseColEncoder["sensorID"] = static_cast<int> (inputPulseColDecoder(pulseFrame) ["sensorID"]);
+		outputPulseColEncoder["type"] = static_cast<int>(inputPulseColDecoder(pulseFrame) ["type"]);
+		outputPulseColEncoder.setCellID( pulseFrame );
 		
-		outputPulseFrame->setCharge( inputPulseFrame->getCharge() );
-		outputPulseFrame->setTrackerData( outputSparseFrame);
-		outputPulseColVec->push_back( outputPulseFrame );
+		outputPulseColVec->push_back( pulseFrame );
+		(*inputPulseColVec)[i] = 0;
 		
 	} // end of loop over input clusters
+
+	// the input event must not delete the moved frames
+	for ( size_t i = 0; i < inputSparseColVec->size(); ++i ){
+		if ( movedSparseFrames.count( (*inputSparseColVec)[i] ) != 0 )
+			(*inputSparseColVec)[i] = 0;
+	}
+
+	if ( droppedPulses > 0 ) {
+		_droppedPulses += droppedPulses;
+		streamlog_out ( WARNING2 ) << droppedPulses << " of " << noOfClusters << " cluster pulses dropped: their sparse frame is missing or shared with another pulse" << endl;
+	}
 	
 }
 
 
+AlibavaClusterCollectionMerger::EventStream::EventStream( const string & name ) :
+	_name( name ),
+	_reader( LCFactory::getInstance()->createLCReader() ),
+	_isOpen( false ),
+	_readError(),
+	_background( false ),
+	_queue()
+#ifdef USE_PTHREAD
+	,_thread(),
+	_mutex(),
+	_eventQueued(),
+	_eventTaken(),
+	_nQueued(0),
+	_producerSlot(0),
+	_consumerSlot(0),
+	_stop(false)
+#endif
+{
+}
+
+AlibavaClusterCollectionMerger::EventStream::~EventStream() {
+	close();
+	delete _reader;
+}
+
+void AlibavaClusterCollectionMerger::EventStream::open( const string & fileName ) {
+	_reader->open( fileName );
+	_isOpen = true;
+}
+
+LCRunHeader * AlibavaClusterCollectionMerger::EventStream::readNextRunHeader() {
+	return _reader->readNextRunHeader();
+}
+
+LCEventImpl * AlibavaClusterCollectionMerger::EventStream::readEvent() {
+	LCEvent * event = _reader->readNextEvent( LCIO::UPDATE );
+	return ( event != 0 ) ? takeEvent( event ) : 0;
+}
+
+void AlibavaClusterCollectionMerger::EventStream::start( int depth ) {
+	if ( depth <= 0 ) return;
+#if defined(USE_PTHREAD) && defined(EUTEL_SIO_THREAD_SAFE)
+	_queue.assign( depth, static_cast< LCEventImpl * >( 0 ) );
+	_nQueued = _producerSlot = _consumerSlot = 0;
+	_stop = false;
+	pthread_mutex_init( &_mutex, NULL );
+	pthread_cond_init( &_eventQueued, NULL );
+	pthread_cond_init( &_eventTaken, NULL );
+	_background = true;
+	if ( pthread_create( &_thread, NULL, readerThread, this ) != 0 ) {
+		_background = false;
+		streamlog_out ( WARNING2 ) << "Unable to start the reader thread of the " << _name << " file, it is read in the processing thread" << endl;
+		pthread_cond_destroy( &_eventTaken );
+		pthread_cond_destroy( &_eventQueued );
+		pthread_mutex_destroy( &_mutex );
+	}
+#else
+	streamlog_out ( WARNING2 ) << "Prefetching needs pthreads and LCIO v02-13, the " << _name << " file is read in the processing thread" << endl;
+#endif
+}
+
+LCEventImpl * AlibavaClusterCollectionMerger::EventStream::nextEvent() {
+#ifdef USE_PTHREAD
+	if ( _background ) {
+		pthread_mutex_lock( &_mutex );
+		while ( _nQueued == 0 ) pthread_cond_wait( &_eventQueued, &_mutex );
+		LCEventImpl * event = _queue[_consumerSlot];
+		// the end of the file stays in the queue for further calls
+		if ( event != 0 ) {
+			_consumerSlot = ( _consumerSlot + 1 ) % _queue.size();
+			--_nQueued;
+			pthread_cond_signal( &_eventTaken );
+		}
+		pthread_mutex_unlock( &_mutex );
+		return event;
+	}
+#endif
+	if ( !_isOpen ) return 0;
+	try {
+		return readEvent();
+	} catch ( lcio::Exception& e ) {
+		_readError = e.what();
+	}
+	return 0;
+}
+
+#ifdef USE_PTHREAD
+void * AlibavaClusterCollectionMerger::EventStream::readerThread( void * stream ) {
+	EventStream * reader = static_cast< EventStream * >( stream );
+	try {
+		for ( ;; ) {
+			LCEventImpl * event = reader->readEvent();
+			if ( event == 0 ) break;
+			if ( !reader->queueEvent( event ) ) {
+				delete event;
+				return NULL;
+			}
+		}
+	} catch ( lcio::Exception& e ) {
+		reader->_readError = e.what();
+	} catch ( std::exception& e ) {
+		reader->_readError = e.what();
+	}
+	// the end of the file, dropped if the merger stopped reading
+	reader->queueEvent( 0 );
+	return NULL;
+}
+
+bool AlibavaClusterCollectionMerger::EventStream::queueEvent( LCEventImpl * event ) {
+	pthread_mutex_lock( &_mutex );
+	while ( _nQueued == _queue.size() && !_stop ) pthread_cond_wait( &_eventTaken, &_mutex );
+	if ( _stop ) {
+		pthread_mutex_unlock( &_mutex );
+		return false;
+	}
+	_queue[_producerSlot] = event;
+	_producerSlot = ( _producerSlot + 1 ) % _queue.size();
+	++_nQueued;
+	pthread_cond_signal( &_eventQueued );
+	pthread_mutex_unlock( &_mutex );
+	return true;
+}
+#endif
+
+void AlibavaClusterCollectionMerger::EventStream::close() {
+#ifdef USE_PTHREAD
+	if ( _background ) {
+		pthread_mutex_lock( &_mutex );
+		_stop = true;
+		pthread_cond_signal( &_eventTaken );
+		pthread_mutex_unlock( &_mutex );
+		pthread_join( _thread, NULL );
+
+		// events read ahead but not merged any more
+		for ( ; _nQueued > 0; --_nQueued ) {
+			delete _queue[_consumerSlot];
+			_consumerSlot = ( _consumerSlot + 1 ) % _queue.size();
+		}
+		pthread_cond_destroy( &_eventTaken );
+		pthread_cond_destroy( &_eventQueued );
+		pthread_mutex_destroy( &_mutex );
+		_background = false;
+	}
+#endif
+	if ( _isOpen ) {
+		_reader->close();
+		_isOpen = false;
+	}
+}
+
+
 void AlibavaClusterCollectionMerger::end () {
 	
 	streamlog_out ( MESSAGE5 )  << "AlibavaClusterCollectionMerger Successfully finished" << endl;
@@ -25,6 +25,7 @@
 
 // system includes <>
 #include <string>
+#include <map>
 #include <sys/stat.h>
 
 using namespace std;
@@ -129,6 +130,14 @@ void AlibavaPedNoiCalIOManager::createFile(string filename, IMPL::LCRunHeaderImp
 
 
 void AlibavaPedNoiCalIOManager::addToFile( string filename, string collectionName, int chipnum, EVENT::FloatVec datavec){
+	
+	PedNoiCalContent content;
+	content[collectionName][chipnum] = datavec;
+	addToFile(filename, content);
+	
+}
+
+void AlibavaPedNoiCalIOManager::addToFile( string filename, const PedNoiCalContent & content){
 
 	// if file doesn't exist
 	if (!doesFileExist(filename)) {
@@ -141,9 +150,6 @@ void AlibavaPedNoiCalIOManager::addToFile( string filename, string collectionNam
 	LCRunHeaderImpl* runHeader = getRunHeader(filename);
 	LCEventImpl*  evt = getEvent(filename);
 	
-	FloatVec tmp_vec;
-	tmp_vec.clear();
-		
 	LCWriter * lcWriter = LCFactory::getInstance()->createLCWriter();
 	// we will write a new lcio file with the copied run header and event
 	try {
@@ -152,38 +158,44 @@ void AlibavaPedNoiCalIOManager::addToFile( string filename, string collectionNam
 		// first write runheader
 		lcWriter->writeRunHeader(runHeader);
 		
-		// check if the collection exists
-		LCCollectionVec* newCol = new LCCollectionVec(LCIO::TRACKERDATA);
+		for (PedNoiCalContent::const_iterator icol = content.begin(); icol != content.end(); ++icol) {
+			const string & collectionName = icol->first;
 
+			// check if the collection exists
+			LCCollectionVec* newCol = new LCCollectionVec(LCIO::TRACKERDATA);
 
-		if (doesCollectionExist(evt,collectionName)){
-			LCCollectionVec* col = dynamic_cast < LCCollectionVec * > (evt->getCollection(collectionName));
-			*newCol = *col;
-			evt->removeCollection(collectionName);
-		}
+			if (doesCollectionExist(evt,collectionName)){
+				LCCollectionVec* col = dynamic_cast < LCCollectionVec * > (evt->getCollection(collectionName));
+				*newCol = *col;
+				evt->removeCollection(collectionName);
+			}
 
-		// check if the data exists for this chip in this event
-		// if exists remove it
-		int ielement=0;
-		do {
-			ielement= getElementNumberOfChip(newCol,chipnum);
-			if (ielement!=-1)
-				newCol->removeElementAt(ielement);
-		} while (ielement!=-1);
-
-				
-		// now, add data vector to the collecton
-		TrackerDataImpl * tmp_data = new TrackerDataImpl();
-		tmp_data->setChargeValues(datavec);
-		
-		// set Cell ID encode
-		CellIDEncoder<TrackerDataImpl> chipIDEncoder(ALIBAVA::ALIBAVADATA_ENCODE,newCol);
-		
-		chipIDEncoder[ALIBAVA::ALIBAVADATA_ENCODE_CHIPNUM] = chipnum;
-		chipIDEncoder.setCellID(tmp_data);
+			// set Cell ID encode
+			CellIDEncoder<TrackerDataImpl> chipIDEncoder(ALIBAVA::ALIBAVADATA_ENCODE,newCol);
+
+			for (map< int, EVENT::FloatVec >::const_iterator ichip = icol->second.begin(); ichip != icol->second.end(); ++ichip) {
+				const int chipnum = ichip->first;
+
+				// check if the data exists for this chip in this event
+				// if exists remove it
+				int ielement=0;
+				do {
+					ielement= getElementNumberOfChip(newCol,chipnum);
+					if (ielement!=-1)
+						newCol->removeElementAt(ielement);
+				} while (ielement!=-1);
 
-		newCol->push_back(tmp_data);
-		evt->addCollection(newCol, collectionName);
+				// now, add data vector to the collecton
+				TrackerDataImpl * tmp_data = new TrackerDataImpl();
+				tmp_data->setChargeValues(ichip->second);
+
+				chipIDEncoder[ALIBAVA::ALIBAVADATA_ENCODE_CHIPNUM] = chipnum;
+				chipIDEncoder.setCellID(tmp_data);
+
+				newCol->push_back(tmp_data);
+			}
+			evt->addCollection(newCol, collectionName);
+		}
 		
 		lcWriter->writeEvent(evt);
 		lcWriter->close();
@@ -37,14 +37,17 @@
 #include "TH1D.h"
 #include "TF1.h"
 #include "TROOT.h"
-#include "TCanvas.h"
 #include "TSystem.h"
+#include "TMath.h"
 
 // system includes <>
 #include <string>
 #include <iostream>
 #include <sstream>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 
 
 using namespace std;
@@ -59,7 +62,10 @@ _pedestalHistoName ("hpedestal"),
 _noiseHistoName ("hnoise"),
 _temperatureHistoName("htemperature"),
 _chanDataHistoName ("Data_chan"),
-_chanDataFitName ("Fit_chan")
+_chanDataFitName ("Fit_chan"),
+_useGausFit(false),
+_refinementIterations(3),
+_refinementWindow(2.5)
 {
 	
 	// modify processor description
@@ -85,6 +91,18 @@ _chanDataFitName ("Fit_chan")
 										"Noise collection name, better not to change",
 										_noiseCollectionName, string ("noise"));
 
+	registerOptionalParameter ("UseGausFit",
+										"If true, each channel is fitted with a ROOT Gaussian (slow). Otherwise the fast moment estimator is used",
+										_useGausFit, bool(false));
+
+	registerOptionalParameter ("RefinementIterations",
+										"Number of truncated Gaussian iterations applied after the moment estimate, 0 to use the plain moments",
+										_refinementIterations, int(3));
+
+	registerOptionalParameter ("RefinementWindow",
+										"Half width of the truncated Gaussian window in units of noise",
+										_refinementWindow, float(2.5));
+
 }
 
 
@@ -189,9 +207,49 @@ void AlibavaPedestalNoiseProcessor::end() {
 	streamlog_out ( MESSAGE4 ) << "Successfully finished" << endl;
 }
 
+namespace {
+	// Estimates mean and sigma of a binned Gaussian peak from the
+	// histogram moments, then iterates on a window of +/- window
+	// sigma around the mean, correcting the truncated rms for the
+	// cut tails. Only reads the histogram, so it can run in parallel.
+	void estimateGaussianPeak(const TH1D * histo, int iterations, double window, double & mean, double & sigma){
+		mean = 0; sigma = 0;
+
+		const TAxis * axis = histo->GetXaxis();
+		const int nbins = histo->GetNbinsX();
+
+		double s0 = 0, s1 = 0, s2 = 0;
+		for (int ibin = 1; ibin <= nbins; ibin++) {
+			const double w = histo->GetBinContent(ibin);
+			const double x = axis->GetBinCenter(ibin);
+			s0 += w; s1 += w * x; s2 += w * x * x;
+		}
+		if (s0 <= 0) return;
+		mean = s1 / s0;
+		sigma = sqrt( max(0.0, s2 / s0 - mean * mean) );
+
+		// variance of a unit Gaussian truncated to [-window, window]
+		const double truncatedVariance = 1.0 - 2.0 * window * TMath::Gaus(window, 0.0, 1.0, true) / TMath::Erf(window / sqrt(2.0));
+		if (truncatedVariance <= 0) return;
+
+		for (int it = 0; it < iterations && sigma > 0; it++) {
+			const int firstBin = max(1, axis->FindFixBin(mean - window * sigma));
+			const int lastBin = min(nbins, axis->FindFixBin(mean + window * sigma));
+			s0 = 0; s1 = 0; s2 = 0;
+			for (int ibin = firstBin; ibin <= lastBin; ibin++) {
+				const double w = histo->GetBinContent(ibin);
+				const double x = axis->GetBinCenter(ibin);
+				s0 += w; s1 += w * x; s2 += w * x * x;
+			}
+			if (s0 < 2) break;
+			mean = s1 / s0;
+			sigma = sqrt( max(0.0, s2 / s0 - mean * mean) / truncatedVariance );
+		}
+	}
+}
+
 void AlibavaPedestalNoiseProcessor::calculatePedestalNoise(){
-	string tempHistoName,tempFitName;
-	TCanvas *cc = new TCanvas("cc","cc",800,600);
+	AlibavaPedNoiCalIOManager::PedNoiCalContent content;
 	
 	EVENT::IntVec chipSelection = getChipSelection();
 	for (unsigned int i=0; i<chipSelection.size(); i++) {
@@ -199,35 +257,49 @@ void AlibavaPedestalNoiseProcessor::calculatePedestalNoise(){
 		
 		TH1D * hped = dynamic_cast<TH1D*> (_rootObjectMap[getPedestalHistoName(ichip)]);
 		TH1D * hnoi = dynamic_cast<TH1D*> (_rootObjectMap[getNoiseHistoName(ichip)]);
-		EVENT::FloatVec pedestalVec,noiseVec;
-		
 		
+		// the map lookups are not thread safe: collect the channel histograms first
+		std::vector<TH1D*> histos(ALIBAVA::NOOFCHANNELS, static_cast<TH1D*>(0));
 		for (int ichan=0; ichan<ALIBAVA::NOOFCHANNELS; ichan++) {
-			double ped, noi;
-			// if channel is masked, set pedestal and noise to 0
-			if (isMasked(ichip,ichan)){
-				ped=0; noi=0;
+			if (!isMasked(ichip,ichan))
+				histos[ichan] = dynamic_cast<TH1D*> (_rootObjectMap[getChanDataHistoName(ichip, ichan)]);
+		}
+		
+		// if channel is masked, pedestal and noise are set to 0
+		std::vector<double> ped(ALIBAVA::NOOFCHANNELS, 0.0), noi(ALIBAVA::NOOFCHANNELS, 0.0);
+		if (_useGausFit) {
+			for (int ichan=0; ichan<ALIBAVA::NOOFCHANNELS; ichan++) {
+				if (histos[ichan] == 0) continue;
+				TF1 * tempfit = dynamic_cast<TF1*> (_rootObjectMap[getChanDataFitName(ichip, ichan)]);
+				histos[ichan]->Fit(tempfit,"Q");
+				ped[ichan] = tempfit->GetParameter(1);
+				noi[ichan] = tempfit->GetParameter(2);
 			}
-			else {
-				tempFitName = getChanDataFitName(ichip, ichan);
-				tempHistoName = getChanDataHistoName(ichip, ichan);
-				TH1D * histo = dynamic_cast<TH1D*> (_rootObjectMap[tempHistoName]);
-				TF1 * tempfit = dynamic_cast<TF1*> (_rootObjectMap[tempFitName]);
-				histo->Fit(tempfit,"Q");
-				ped = tempfit->GetParameter(1);
-				noi = tempfit->GetParameter(2);
-				hped->SetBinContent(ichan+1,ped);
-				hnoi->SetBinContent(ichan+1,noi);
+		}
+		else {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+			for (int ichan=0; ichan<ALIBAVA::NOOFCHANNELS; ichan++) {
+				if (histos[ichan] == 0) continue;
+				estimateGaussianPeak(histos[ichan], _refinementIterations, _refinementWindow, ped[ichan], noi[ichan]);
 			}
-			pedestalVec.push_back(ped);
-			noiseVec.push_back(noi);
 		}
 		
-		AlibavaPedNoiCalIOManager man;
-		man.addToFile(_pedestalFile,_pedestalCollectionName, ichip, pedestalVec);
-		man.addToFile(_pedestalFile,_noiseCollectionName, ichip, noiseVec);
+		EVENT::FloatVec & pedestalVec = content[_pedestalCollectionName][ichip];
+		EVENT::FloatVec & noiseVec = content[_noiseCollectionName][ichip];
+		for (int ichan=0; ichan<ALIBAVA::NOOFCHANNELS; ichan++) {
+			if (histos[ichan] != 0) {
+				hped->SetBinContent(ichan+1,ped[ichan]);
+				hnoi->SetBinContent(ichan+1,noi[ichan]);
+			}
+			pedestalVec.push_back(ped[ichan]);
+			noiseVec.push_back(noi[ichan]);
+		}
 	}
-	delete cc;
+	
+	AlibavaPedNoiCalIOManager man;
+	man.addToFile(_pedestalFile, content);
 }
 
 string AlibavaPedestalNoiseProcessor::getChanDataHistoName(unsigned int ichip, unsigned int ichan){
@@ -325,8 +397,10 @@ void AlibavaPedestalNoiseProcessor::bookHistos(){
 			string tmp_string = tempHistoTitle.str();
 			chanDataHisto->SetTitle(tmp_string.c_str());
 			
-			TF1 *chanDataFit = new TF1(tempFitName.c_str(),"gaus");
-			_rootObjectMap.insert(make_pair(tempFitName, chanDataFit));
+			if (_useGausFit) {
+				TF1 *chanDataFit = new TF1(tempFitName.c_str(),"gaus");
+				_rootObjectMap.insert(make_pair(tempFitName, chanDataFit));
+			}
 			
 			
 		}
@@ -0,0 +1,263 @@
+// eutelescope includes ""
+#include "anyoption.h"
+#include "EUTELESCOPE.h"
+#include "EUTelGenericSparsePixel.h"
+#include "EUTelTrackerDataInterfacerImpl.h"
+
+// lcio includes <>
+#include <IO/LCWriter.h>
+#include <IO/LCReader.h>
+#include <lcio.h>
+#include <Exceptions.h>
+#include <IMPL/LCRunHeaderImpl.h>
+#include <IMPL/LCEventImpl.h>
+#include <UTIL/LCTime.h>
+#include <IMPL/LCCollectionVec.h>
+#include <IMPL/TrackerDataImpl.h>
+#include <UTIL/CellIDEncoder.h>
+#include <UTIL/CellIDDecoder.h>
+
+//system includes <>
+#include <glob.h>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+using namespace IMPL;
+using namespace eutelescope;
+
+
+
+int main( int argc, char ** argv ) {
+
+  auto_ptr< AnyOption > option( new AnyOption );
+
+  string usageString =
+    "\n"
+    "This program merges the hit counts written by EUTelProcessorNoisyPixelFinder \n"
+    "(HitCountFile) in jobs processing different parts of the same run, and \n"
+    "writes the hot pixel DB of the whole run \n"
+    "\n"
+    "hotpixelmerge [option] -o hotpixel.slcio hitcount1.slcio hitcount2.slcio [hitcountN.slcio]\n"
+    "\n"
+    "-h --help             Print this help\n"
+    "-f --max-firing-freq  Maximum allowed firing frequency, default 0.2\n"
+    "-i --input-collection Name of the hit count collection (HitCountCollectionName), default hitcount\n"
+    "-c --collection       Name of the hot pixel collection in the DB file, default hotpixel\n"
+    "-m --write-mode       WRITE_APPEND to add the hot pixels to an existing DB file, as the\n"
+    "                      hot pixel finders do, or WRITE_NEW to overwrite it, default WRITE_APPEND\n";
+
+  option->addUsage( usageString.c_str() );
+  option->setFlag( "help", 'h');
+  option->setOption( "output", 'o' );
+  option->setOption( "max-firing-freq", 'f' );
+  option->setOption( "input-collection", 'i' );
+  option->setOption( "collection", 'c' );
+  option->setOption( "write-mode", 'm' );
+
+  option->processCommandArgs( argc,  argv );
+
+  if ( option->getFlag('h') || option->getFlag( "help" ) ) {
+    option->printUsage();
+    return 0;
+  }
+
+
+  if ( option->getValue( "output" ) == NULL ) {
+    cerr << "Please provide an output file name using -o option" << endl;
+    return 2;
+  }
+
+  string outputFileName = option->getValue( "output" );
+  // check if the output lcio file has the extension
+  if ( outputFileName.rfind( ".slcio", string::npos ) == string::npos ) {
+    outputFileName.append( ".slcio" );
+  }
+
+  float maxAllowedFiringFreq = 0.2;
+  if ( option->getValue( "max-firing-freq" ) != NULL ) maxAllowedFiringFreq = atof( option->getValue( "max-firing-freq" ) );
+
+  string hitCountCollectionName = "hitcount";
+  if ( option->getValue( "input-collection" ) != NULL ) hitCountCollectionName = option->getValue( "input-collection" );
+
+  string collectionName = "hotpixel";
+  if ( option->getValue( "collection" ) != NULL ) collectionName = option->getValue( "collection" );
+
+  string writeMode = "WRITE_APPEND";
+  if ( option->getValue( "write-mode" ) != NULL ) writeMode = option->getValue( "write-mode" );
+  if ( writeMode != "WRITE_APPEND" && writeMode != "WRITE_NEW" ) {
+    cerr << "The write mode has to be WRITE_APPEND or WRITE_NEW" << endl;
+    return 2;
+  }
+
+  // the input files may be using wildcards
+  glob_t globbuf;
+  for ( size_t iArg = 0 ; iArg < static_cast<size_t>(option->getArgc()); ++iArg ) {
+    if ( iArg == 0 ) glob( option->getArgv( iArg ), 0, NULL, &globbuf);
+    else  glob( option->getArgv( iArg ), GLOB_APPEND, NULL, &globbuf);
+  }
+
+  if ( option->getArgc() == 0 || globbuf.gl_pathc == 0 ) {
+    cerr << "Please provide at least one valid input file" << endl;
+    return 1;
+  }
+
+  // moving to a vector of string because it's easier
+  vector< string > inputFileNames( &globbuf.gl_pathv[0], &globbuf.gl_pathv[ globbuf.gl_pathc ] );
+  globfree( &globbuf );
+
+  // print some information
+  cout << "Target file: " << outputFileName << endl;
+
+  // hit count of every pixel, by sensor and pixel coordinates
+  map< int, map< pair< int, int >, double > > hitCounts;
+  long nEvents = 0;
+
+  auto_ptr< lcio::LCReader > lcReader( lcio::LCFactory::getInstance()->createLCReader() );
+  EUTelGenericSparsePixel pixel;
+
+  for ( size_t iFile = 0 ; iFile < inputFileNames.size(); ++iFile ) {
+
+    try {
+      lcReader->open( inputFileNames.at( iFile ).c_str() );
+
+      lcio::LCEvent * inputEvent = lcReader->readNextEvent();
+      if ( inputEvent == NULL ) {
+        cerr << "Error! " << inputFileNames.at( iFile ) << " contains no event" << endl;
+        return 4;
+      }
+      lcio::LCCollectionVec * inputCollection = dynamic_cast< lcio::LCCollectionVec* > ( inputEvent->getCollection( hitCountCollectionName ) );
+      if ( inputCollection == NULL ) {
+        cerr << "Error! The collection " << hitCountCollectionName << " in " << inputFileNames.at( iFile ) << " is not a hit count collection" << endl;
+        return 4;
+      }
+      const int nFileEvents = inputCollection->getParameters().getIntVal( EUTELESCOPE::NOOFEVENT );
+      nEvents += nFileEvents;
+      cout << "Input file: " << inputFileNames.at( iFile ) << " (" << nFileEvents << " events)" << endl;
+
+      lcio::CellIDDecoder< TrackerDataImpl > cellDecoder( inputCollection );
+      for ( size_t iElement = 0 ; iElement < inputCollection->size() ; ++iElement ) {
+        TrackerDataImpl * sensorData = dynamic_cast< TrackerDataImpl * > ( inputCollection->getElementAt( iElement ) );
+        map< pair< int, int >, double > & sensorCounts = hitCounts[ cellDecoder( sensorData )["sensorID"] ];
+
+        auto_ptr< EUTelTrackerDataInterfacerImpl< EUTelGenericSparsePixel > > sparseData( new EUTelTrackerDataInterfacerImpl< EUTelGenericSparsePixel > ( sensorData ) );
+        for ( unsigned int iPixel = 0; iPixel < sparseData->size(); ++iPixel ) {
+          sparseData->getSparsePixelAt( iPixel, &pixel );
+          sensorCounts[ make_pair( static_cast< int >( pixel.getXCoord() ), static_cast< int >( pixel.getYCoord() ) ) ] += pixel.getSignal();
+        }
+      }
+
+      lcReader->close();
+
+    } catch ( lcio::DataNotAvailableException& e ) {
+      cerr << "Error! " << inputFileNames.at( iFile ) << " has no collection " << hitCountCollectionName << endl;
+      return 4;
+    } catch ( lcio::IOException& e ) {
+      cerr << e.what() << endl;
+      return 3;
+    }
+  }
+
+  if ( nEvents == 0 ) {
+    cerr << "No event was counted in the input files" << endl;
+    return 1;
+  }
+  cout << "Total: " << nEvents << " events" << endl;
+
+  // open the LCIO output file. As in the hot pixel finders, the hot
+  // pixel collection is added to the first event of an existing DB
+  // file in append mode, otherwise a new file is written
+  auto_ptr< lcio::LCWriter > lcWriter( lcio::LCFactory::getInstance()->createLCWriter() );
+  auto_ptr< lcio::LCReader > dbReader( lcio::LCFactory::getInstance()->createLCReader() );
+  lcio::LCEventImpl * event = NULL;
+  bool isNewEvent = false;
+  bool isReaderOpen = false;
+
+  if ( writeMode == "WRITE_APPEND" ) {
+    try {
+      lcWriter->open( outputFileName.c_str() , lcio::LCIO::WRITE_APPEND );
+      try {
+        dbReader->open( outputFileName.c_str() );
+        isReaderOpen = true;
+        event = static_cast< lcio::LCEventImpl * >( dbReader->readNextEvent( lcio::LCIO::UPDATE ) );
+      } catch ( lcio::Exception& ) {
+        cout << "No hot pixel DB found in " << outputFileName << ", a new one is written" << endl;
+      }
+    } catch ( lcio::IOException& e ) {
+      cerr << e.what() << endl << "Not able to append to " << outputFileName << ", writing a new file" << endl;
+      writeMode = "WRITE_NEW";
+    }
+  }
+
+  try {
+    if ( writeMode == "WRITE_NEW" ) lcWriter->open( outputFileName.c_str() , lcio::LCIO::WRITE_NEW );
+  } catch ( lcio::IOException& e ) {
+    cerr << e.what() << endl;
+    return 3;
+  }
+
+  if ( event == NULL ) {
+    // write an almost empty run header
+    lcio::LCRunHeaderImpl * lcHeader  = new lcio::LCRunHeaderImpl;
+    lcHeader->setRunNumber( 0 );
+    lcWriter->writeRunHeader(lcHeader);
+    delete lcHeader;
+
+    // prepare an event, as EUTelProcessorNoisyPixelFinder does for its hot pixel DB
+    event = new lcio::LCEventImpl;
+    event->setRunNumber( 0 );
+    event->setEventNumber( 0 );
+    event->setDetectorName("Mimosa26");
+
+    lcio::LCTime * now = new lcio::LCTime;
+    event->setTimeStamp( now->timeStamp() );
+    delete now;
+    isNewEvent = true;
+  } else {
+    // the hot pixels of a previous merge are replaced
+    event->removeCollection( collectionName );
+  }
+
+  lcio::LCCollectionVec * hotPixelCollection = new lcio::LCCollectionVec( lcio::LCIO::TRACKERDATA );
+  lcio::CellIDEncoder< TrackerDataImpl > hotPixelEncoder( EUTELESCOPE::ZSDATADEFAULTENCODING, hotPixelCollection );
+
+  for ( map< int, map< pair< int, int >, double > >::iterator it = hitCounts.begin(); it != hitCounts.end(); ++it ) {
+    hotPixelEncoder["sensorID"]        = it->first;
+    hotPixelEncoder["sparsePixelType"] = kEUTelGenericSparsePixel;
+
+    auto_ptr< TrackerDataImpl > currentFrame( new TrackerDataImpl );
+    hotPixelEncoder.setCellID( currentFrame.get() );
+    auto_ptr< EUTelTrackerDataInterfacerImpl< EUTelGenericSparsePixel > > sparseFrame( new EUTelTrackerDataInterfacerImpl< EUTelGenericSparsePixel > ( currentFrame.get() ) );
+
+    int nHotPixels = 0;
+    for ( map< pair< int, int >, double >::iterator itt = it->second.begin(); itt != it->second.end(); ++itt ) {
+      const float fireFreq = static_cast< float >( itt->second / nEvents );
+      if ( fireFreq > maxAllowedFiringFreq ) {
+        EUTelGenericSparsePixel hotPixel;
+        hotPixel.setXCoord( itt->first.first );
+        hotPixel.setYCoord( itt->first.second );
+        hotPixel.setSignal( ceil( 100 * fireFreq ) );
+        sparseFrame->addSparsePixel( &hotPixel );
+        ++nHotPixels;
+      }
+    }
+    cout << "Sensor " << it->first << ": " << nHotPixels << " hot pixels" << endl;
+    hotPixelCollection->push_back( currentFrame.release() );
+  }
+
+  event->addCollection( hotPixelCollection, collectionName );
+  lcWriter->writeEvent( event );
+  // an event read back belongs to the reader
+  if ( isNewEvent ) delete event;
+
+  lcWriter->close();
+  if ( isReaderOpen ) dbReader->close();
+
+  return 0;
+
+}